@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(constant_id = 0) const uint TextureCount = 1024;
+layout(constant_id = 1) const uint SamplerCount = 16;
+
+layout(set = 0, binding = 1) uniform texture2D textures[TextureCount];
+layout(set = 0, binding = 2) uniform sampler samplers[SamplerCount];
+
+layout(push_constant) uniform DrawConstants {
+	uint TextureIndex;
+	uint SamplerIndex;
+} draw;
+
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	outColor = texture(sampler2D(textures[draw.TextureIndex], samplers[draw.SamplerIndex]), fragTexCoord);
+}
@@ -0,0 +1,19 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(set = 0, binding = 0) uniform ViewConstants {
+	mat4 View;
+	mat4 Proj;
+} view;
+
+// Compact vertices hold positions normalized to the mesh bounds; the instance matrix maps them back.
+layout(location = 0) in vec3 inPosition;
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in mat4 inModel;
+
+layout(location = 1) out vec2 fragTexCoord;
+
+void main() {
+	gl_Position = view.Proj * view.View * inModel * vec4(inPosition, 1.0);
+	fragTexCoord = inTexCoord;
+}
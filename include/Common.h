@@ -26,6 +26,8 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <deque>
 #include <exception>
 #include <fstream>
 #include <map>
@@ -33,6 +35,7 @@
 #include <optional>
 #include <set>
 #include <sstream>
+#include <tuple>
 #include <vector>
 #define NOMINMAX
 #include <Windows.h>
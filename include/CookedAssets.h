@@ -0,0 +1,51 @@
+#pragma once
+
+#include "MeshImporter.h"
+#include "TextureImporter.h"
+
+// Cooked assets are the output of the importers written to disk by AssetCooker, so that loading one is
+// a read and a copy. Every cooked file is named after the hash of its source's contents; identical
+// sources share a file, and a source whose cooked file exists does not need to be cooked again.
+
+enum CookedAssetKinds {
+	ECookedMesh = 0,
+	ECookedTexture,
+	ENumCookedAssetKinds
+};
+
+// Bumped whenever the importers or the cooked formats change, which gives every source a new name and
+// so cooks everything again.
+const std::uint32_t CookedAssetVersion = 2;
+
+// Maps the source paths, relative to the source directory and with forward slashes, to the names of
+// their cooked files in the cooked directory.
+using CookedManifest = std::map<std::string, std::string>;
+
+const char* const CookedManifestFileName = "manifest.txt";
+
+// Holds every cooked file under its source path, as in the manifest, when the cooker is asked for it.
+const char* const CookedPackFileName = "Assets.pack";
+
+// Returns the kind of source the cooker handles with that extension, or ENumCookedAssetKinds.
+CookedAssetKinds GetCookedAssetKind(const std::string& inExtension);
+
+// Name of the cooked file of a source with the given contents, such as "0123456789abcdef.mesh". The
+// variant stands for the options it is cooked with, such as the texture compression.
+std::string GetCookedFileName(CookedAssetKinds inKind, std::uint32_t inVariant, const void* pSourceData, size_t inSourceSize);
+
+// Writes go to a temporary file that replaces the destination once complete, so an interrupted cook
+// never leaves a truncated file under a valid name.
+bool WriteCookedMesh(const std::string& inFilePath, const Mesh& inMesh);
+bool WriteCookedTexture(const std::string& inFilePath, const TextureImport& inImport);
+bool WriteCookedManifest(const std::string& inFilePath, const CookedManifest& inManifest);
+
+// Fill the device-independent part of the mesh, as ImportMesh() does.
+bool ReadCookedMesh(const std::string& inFilePath, Mesh& outMesh);
+bool ReadCookedMesh(const PackEntry& inEntry, const std::string& inName, Mesh& outMesh);
+
+bool ReadCookedTexture(const std::string& inFilePath, TextureImport& outImport);
+
+// Reads the layout only and points outImport at the texels in the archive, which must stay open until
+// the texture has been uploaded.
+bool ReadCookedTexture(const PackEntry& inEntry, const std::string& inName, TextureImport& outImport);
+bool ReadCookedManifest(const std::string& inFilePath, CookedManifest& outManifest);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Common.h"
+
+// World-space bounding volumes kept as structure of arrays, so that the frustum test runs over four
+// (SSE) or eight (AVX2, when the CPU has it) objects at once. Each object is a sphere and an AABB
+// sharing the same center; it is culled when either of them is completely outside one of the planes.
+class FrustumCuller {
+public:
+	FrustumCuller() = default;
+	virtual ~FrustumCuller() = default;
+
+public:
+	void Clear();
+	void Reserve(std::uint32_t inCount);
+
+	std::uint32_t Add(const glm::vec3& inCenter, float inRadius, const glm::vec3& inExtents);
+	void Set(std::uint32_t inIndex, const glm::vec3& inCenter, float inRadius, const glm::vec3& inExtents);
+	void Get(std::uint32_t inIndex, glm::vec3& outCenter, float& outRadius, glm::vec3& outExtents) const;
+
+	// Moves the last object into the slot of the removed one.
+	void Remove(std::uint32_t inIndex);
+
+	std::uint32_t GetCount() const;
+
+	// Replaces outVisible with the indices of the objects intersecting the frustum, in ascending order.
+	// The planes point inwards and are normalized.
+	void Cull(const std::array<glm::vec4, 6>& inPlanes, bool bSimd, std::vector<std::uint32_t>& outVisible) const;
+
+	// Whether the SIMD path runs eight objects at a time; checked once from CPUID and XCR0.
+	static bool IsAvx2Supported();
+
+private:
+	std::uint32_t CullSimd(const std::array<glm::vec4, 6>& inPlanes, std::uint32_t* pOutVisible, std::uint32_t& ioVisibleCount) const;
+	// Defined in FrustumCullerAvx2.cpp, the only file built with AVX2 enabled.
+	std::uint32_t CullAvx2(const std::array<glm::vec4, 6>& inPlanes, std::uint32_t* pOutVisible, std::uint32_t& ioVisibleCount) const;
+	void CullScalar(
+		const std::array<glm::vec4, 6>& inPlanes, 
+		std::uint32_t inBegin, 
+		std::uint32_t* pOutVisible, 
+		std::uint32_t& ioVisibleCount) const;
+
+private:
+	std::vector<float> mCenterX;
+	std::vector<float> mCenterY;
+	std::vector<float> mCenterZ;
+	std::vector<float> mRadius;
+	std::vector<float> mExtentX;
+	std::vector<float> mExtentY;
+	std::vector<float> mExtentZ;
+};
\ No newline at end of file
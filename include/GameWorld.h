@@ -3,6 +3,14 @@
 #include "Renderer.h"
 
 class GameWorld {
+protected:
+	struct PendingModel {
+		std::string Name;
+		RenderTypes Type = RenderTypes::EOpaque;
+		bool bOccluder = false;
+		std::shared_future<bool> Loaded;
+	};
+
 public:
 	GameWorld() = default;
 	virtual ~GameWorld();
@@ -28,6 +36,10 @@ protected:
 
 	bool OnLoadingData();
 	void OnUnloadingData();
+	bool UpdateLoadingModels();
+
+	// Starts a static Renderer benchmark on its own thread unless one is still running.
+	void RunBenchmark(void(*pBenchmark)());
 
 	bool GameLoop();
 
@@ -51,6 +63,9 @@ private:
 	Renderer mRenderer;
 	GameTimer mTimer;
 
+	std::vector<PendingModel> mPendingModels;
+	std::future<void> mBenchmark;
+
 	float mForward = 0;
 	float mStrape = 0;
 
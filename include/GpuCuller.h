@@ -0,0 +1,127 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+// Per-object data read by the culling shader; laid out for std430.
+struct GpuObject {
+	glm::mat4 mModel;
+	glm::vec4 mBoundingSphere;	// local-space center and radius
+	std::uint32_t mBatchIndex;
+	std::uint32_t mPadding[3];
+};
+
+// One indexed draw of the culled scene. Its visible instances are written to
+// [mFirstInstance, mFirstInstance + number of objects in the batch) of the instance buffer.
+struct GpuBatch {
+	std::uint32_t mIndexCount;
+	std::uint32_t mFirstIndex;
+	std::int32_t mVertexOffset;
+	std::uint32_t mFirstInstance;
+
+	// Batches of a run are drawn with one indirect call; the run owns
+	// [mRunFirstDraw, mRunFirstDraw + batches in the run) of the draw command buffer.
+	std::uint32_t mRunIndex;
+	std::uint32_t mRunFirstDraw;
+	std::uint32_t mPadding[2];
+};
+
+// Frustum-culls objects on the GPU and writes the surviving model matrices and one
+// VkDrawIndexedIndirectCommand per batch. With bCompactDraws, empty draws are dropped and the
+// commands of each run are packed to its front, with their count in the draw count buffer.
+class GpuCuller {
+public:
+	GpuCuller() = default;
+	virtual ~GpuCuller();
+
+private:
+	GpuCuller(const GpuCuller& inRef) = delete;
+	GpuCuller(GpuCuller&& inRVal) = delete;
+	GpuCuller& operator=(const GpuCuller& inRef) = delete;
+	GpuCuller& operator=(GpuCuller&& inRVal) = delete;
+
+public:
+	bool Initialize(
+		const VkDevice& inDevice,
+		MemoryAllocator* pAllocator,
+		const VkShaderModule& inCullShader,
+		std::uint32_t inFrameCount,
+		bool bCompactDraws);
+	void CleanUp();
+
+	// Copies the scene into the buffers of a frame in flight whose fence has been waited on.
+	// When the frame already holds inVersion, only the objects marked dirty since its last update are.
+	bool UpdateScene(
+		std::uint32_t inFrameIndex,
+		std::uint64_t inVersion,
+		const std::vector<GpuObject>& inObjects,
+		const std::vector<GpuBatch>& inBatches,
+		std::uint32_t inRunCount);
+
+	// Marks an object whose data changed without a new version, for every frame to copy on its next update.
+	void MarkObjectDirty(std::uint32_t inIndex);
+
+	// Records the culling passes; must be outside of a render pass.
+	void RecordCulling(const VkCommandBuffer& inCommandBuffer, std::uint32_t inFrameIndex, const std::array<glm::vec4, 6>& inFrustumPlanes);
+
+	VkBuffer GetInstanceBuffer(std::uint32_t inFrameIndex) const;
+	VkBuffer GetDrawCommandBuffer(std::uint32_t inFrameIndex) const;
+	// Holds one 32-bit draw count per run, starting at offset 0.
+	VkBuffer GetDrawCountBuffer(std::uint32_t inFrameIndex) const;
+
+private:
+	struct FrameResources {
+		VkBuffer ObjectBuffer = VK_NULL_HANDLE;
+		Allocation ObjectBufferAllocation;
+		VkBuffer BatchBuffer = VK_NULL_HANDLE;
+		Allocation BatchBufferAllocation;
+
+		VkBuffer CounterBuffer = VK_NULL_HANDLE;
+		Allocation CounterBufferAllocation;
+		VkBuffer DrawCommandBuffer = VK_NULL_HANDLE;
+		Allocation DrawCommandBufferAllocation;
+		VkBuffer InstanceBuffer = VK_NULL_HANDLE;
+		Allocation InstanceBufferAllocation;
+
+		std::uint32_t ObjectCapacity = 0;
+		std::uint32_t BatchCapacity = 0;
+
+		std::uint32_t ObjectCount = 0;
+		std::uint32_t BatchCount = 0;
+		std::uint32_t RunCount = 0;
+		std::uint64_t Version = UINT64_MAX;
+
+		// [DirtyBegin, DirtyEnd) of the objects is stale; empty when DirtyBegin >= DirtyEnd.
+		std::uint32_t DirtyBegin = UINT32_MAX;
+		std::uint32_t DirtyEnd = 0;
+
+		VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+	};
+
+	struct CullConstants {
+		glm::vec4 mPlanes[6];
+		std::uint32_t mObjectCount;
+		std::uint32_t mBatchCount;
+		std::uint32_t mRunCount;
+		std::uint32_t mPass;
+	};
+
+	bool CreateFrameBuffers(FrameResources& ioFrame, std::uint32_t inObjectCapacity, std::uint32_t inBatchCapacity);
+	void DestroyFrameBuffers(FrameResources& ioFrame);
+	void WriteDescriptorSet(const FrameResources& inFrame);
+
+public:
+	static const std::uint32_t WorkGroupSize = 64;
+
+private:
+	bool bIsCleanedUp = true;
+
+	VkDevice mDevice = VK_NULL_HANDLE;
+	MemoryAllocator* mpAllocator = nullptr;
+
+	VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+	VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline mPipeline = VK_NULL_HANDLE;
+
+	std::vector<FrameResources> mFrames;
+};
\ No newline at end of file
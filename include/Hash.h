@@ -0,0 +1,7 @@
+#pragma once
+
+#include "Common.h"
+
+// XXH64 of inSize bytes. Every input bit affects every output bit, so any subset of the result bits can
+// be used as a table index.
+std::uint64_t HashBytes(const void* pData, size_t inSize, std::uint64_t inSeed = 0);
\ No newline at end of file
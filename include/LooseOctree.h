@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common.h"
+
+// Dynamic loose octree over axis-aligned boxes. Each node's bounds are twice the size of its cell, so
+// an object lives in exactly one node: the deepest one whose cell contains its center and is no
+// smaller than the object. The root grows on demand, so there are no fixed world bounds.
+// Objects are identified by ids chosen by the caller, which should be kept dense.
+class LooseOctree {
+public:
+	LooseOctree() = default;
+	virtual ~LooseOctree() = default;
+
+public:
+	void Clear();
+
+	void Insert(std::uint32_t inId, const glm::vec3& inCenter, const glm::vec3& inExtents);
+	void Update(std::uint32_t inId, const glm::vec3& inCenter, const glm::vec3& inExtents);
+	void Remove(std::uint32_t inId);
+
+	bool Contains(std::uint32_t inId) const;
+	std::uint32_t GetObjectCount() const;
+	std::uint32_t GetNodeCount() const;
+
+	// Queries replace outIds with the ids of the matching objects. The frustum planes point inwards
+	// and are normalized.
+	void QueryFrustum(const std::array<glm::vec4, 6>& inPlanes, std::vector<std::uint32_t>& outIds) const;
+	void QuerySphere(const glm::vec3& inCenter, float inRadius, std::vector<std::uint32_t>& outIds) const;
+	void QueryAabb(const glm::vec3& inMin, const glm::vec3& inMax, std::vector<std::uint32_t>& outIds) const;
+
+	// The inCount objects whose boxes are closest to inPoint, nearest first.
+	void QueryNearest(const glm::vec3& inPoint, std::uint32_t inCount, std::vector<std::uint32_t>& outIds) const;
+
+private:
+	struct Node {
+		glm::vec3 Center;
+		float HalfSize;
+
+		std::uint32_t Parent;
+		std::uint32_t Children[8];
+
+		// Objects in this node and all of its descendants.
+		std::uint32_t SubtreeCount;
+
+		std::vector<std::uint32_t> Objects;
+	};
+
+	struct Object {
+		glm::vec3 Center;
+		glm::vec3 Extents;
+
+		std::uint32_t Node = NullIndex;
+		std::uint32_t Slot = 0;
+	};
+
+	std::uint32_t NewNode(const glm::vec3& inCenter, float inHalfSize, std::uint32_t inParent);
+	void ReleaseNode(std::uint32_t inIndex);
+
+	bool FitsNode(const Node& inNode, const Object& inObject) const;
+	void GrowRoot(const glm::vec3& inTowards);
+
+	void Link(std::uint32_t inId);
+	void Unlink(std::uint32_t inId);
+
+	void CollectSubtree(std::uint32_t inNode, std::vector<std::uint32_t>& ioIds) const;
+
+public:
+	static const std::uint32_t NullIndex = UINT32_MAX;
+
+private:
+	static constexpr float InitialHalfSize = 64.0f;
+	static constexpr float MinHalfSize = 0.5f;
+
+	std::vector<Node> mNodes;
+	std::vector<std::uint32_t> mUnusedNodes;
+	std::uint32_t mRoot = NullIndex;
+
+	std::vector<Object> mObjects;
+	std::uint32_t mObjectCount = 0;
+};
\ No newline at end of file
@@ -5,9 +5,12 @@
 struct QueueFamilyIndices {
 	std::optional<std::uint32_t> GraphicsFamily;
 	std::optional<std::uint32_t> PresentFamily;
+	std::optional<std::uint32_t> TransferFamily;
 
 	std::uint32_t GetGraphicsFamilyIndex();
 	std::uint32_t GetPresentFamilyIndex();
+	// Falls back to the graphics family when the device has no separate transfer family.
+	std::uint32_t GetTransferFamilyIndex();
 	bool IsComplete();
 };
 
@@ -69,9 +72,15 @@ protected:
 
 	VkQueue mGraphicsQueue;
 	VkQueue mPresentQueue;
+	VkQueue mTransferQueue;
 
 	VkFormat mSwapChainImageFormat;
 	VkExtent2D mSwapChainExtent;
 
 	VkSampleCountFlagBits mMSAASamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPhysicalDeviceFeatures mEnabledFeatures = {};
+
+	bool bDrawIndirectCountSupported = false;
+	PFN_vkCmdDrawIndexedIndirectCountKHR mCmdDrawIndexedIndirectCount = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Common.h"
+
+// LZ4 block format: a run of sequences, each some literal bytes followed by a copy of at least four
+// bytes from up to 64 KB back. No frame, checksum or stored size; the caller keeps the sizes.
+
+// Largest compressed size of inSize bytes, reached when nothing matches.
+size_t GetLz4CompressBound(size_t inSize);
+
+// Returns the compressed size, or 0 when the result does not fit in inDstCapacity.
+size_t CompressLz4(const void* pSrc, size_t inSrcSize, void* pDst, size_t inDstCapacity);
+
+// Decodes the first inDstSize bytes of a block, so a header can be read without the rest. Fails on
+// malformed input and on blocks that decode to fewer bytes, never reading or writing out of bounds.
+bool DecompressLz4(const void* pSrc, size_t inSrcSize, void* pDst, size_t inDstSize);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Common.h"
+
+// Read-only view of a whole file mapped into the address space, so that it can be parsed or copied
+// from without first being read into a buffer.
+class MappedFile {
+public:
+	MappedFile() = default;
+	virtual ~MappedFile();
+
+private:
+	MappedFile(const MappedFile& inRef) = delete;
+	MappedFile(MappedFile&& inRVal) = delete;
+	MappedFile& operator=(const MappedFile& inRef) = delete;
+	MappedFile& operator=(MappedFile&& inRVal) = delete;
+
+public:
+	bool Open(const std::string& inFilePath);
+	void Close();
+
+	// Null for an empty file.
+	const std::uint8_t* GetData() const;
+	std::uint64_t GetSize() const;
+
+private:
+	HANDLE mhFile = INVALID_HANDLE_VALUE;
+	HANDLE mhMapping = NULL;
+
+	const std::uint8_t* mpData = nullptr;
+	std::uint64_t mSize = 0;
+};
\ No newline at end of file
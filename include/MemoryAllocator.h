@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Common.h"
+
+// Two-level segregated fit (TLSF) allocator over an abstract [0, size) range.
+// It only does the bookkeeping; the owner decides what the offsets refer to.
+class TlsfAllocator {
+public:
+	struct Stats {
+		std::uint64_t TotalSize = 0;
+		std::uint64_t UsedSize = 0;
+		std::uint64_t LargestFreeRange = 0;
+		std::uint32_t AllocationCount = 0;
+		std::uint32_t FreeRangeCount = 0;
+	};
+
+public:
+	TlsfAllocator() = default;
+	virtual ~TlsfAllocator() = default;
+
+public:
+	void Initialize(std::uint64_t inSize);
+
+	bool Allocate(std::uint64_t inSize, std::uint64_t inAlignment, std::uint64_t& outOffset);
+	void Free(std::uint64_t inOffset);
+
+	// Extends the managed range to [0, inNewSize); existing allocations keep their offsets.
+	bool Grow(std::uint64_t inNewSize);
+
+	bool IsEmpty() const;
+	std::uint64_t GetSize() const;
+	void GetStats(Stats& outStats) const;
+
+private:
+	struct Range {
+		std::uint64_t Offset;
+		std::uint64_t Size;
+		std::uint32_t PrevPhysical;
+		std::uint32_t NextPhysical;
+		std::uint32_t PrevFree;
+		std::uint32_t NextFree;
+		bool bFree;
+	};
+
+	void Mapping(std::uint64_t inSize, std::uint32_t& outFirstLevel, std::uint32_t& outSecondLevel) const;
+	std::uint32_t FindFree(std::uint64_t inSize) const;
+	void InsertFree(std::uint32_t inIndex);
+	void RemoveFree(std::uint32_t inIndex);
+
+	std::uint32_t NewRange();
+	void ReleaseRange(std::uint32_t inIndex);
+
+public:
+	static const std::uint32_t NullIndex = UINT32_MAX;
+
+private:
+	static const std::uint32_t SecondLevelLog2 = 4;
+	static const std::uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+	static const std::uint32_t FirstLevelCount = 64;
+
+	std::uint64_t mSize = 0;
+	std::uint64_t mUsedSize = 0;
+	std::uint32_t mFreeRangeCount = 0;
+
+	std::vector<Range> mRanges;
+	std::vector<std::uint32_t> mUnusedRanges;
+	std::unordered_map<std::uint64_t, std::uint32_t> mAllocatedRanges;
+
+	std::uint64_t mFirstLevelBitmap = 0;
+	std::uint32_t mSecondLevelBitmaps[FirstLevelCount] = {};
+	std::uint32_t mFreeHeads[FirstLevelCount][SecondLevelCount] = {};
+};
+
+enum ResourceKinds {
+	ELinearResource = 0,	// buffers
+	EOptimalResource,		// optimal-tiling images
+	ENumResourceKinds
+};
+
+struct MemoryBlock {
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkDeviceSize Size = 0;
+	std::uint32_t MemoryTypeIndex = 0;
+	std::uint8_t* pMappedData = nullptr;
+	ResourceKinds Kind = ResourceKinds::ELinearResource;
+	bool bDedicated = false;
+
+	TlsfAllocator Allocator;
+};
+
+struct Allocation {
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+
+	// Non-null when the memory is host visible; blocks stay mapped for their whole lifetime.
+	void* pMappedData = nullptr;
+
+	MemoryBlock* pBlock = nullptr;
+};
+
+// Pools device memory into large blocks per memory type and resource kind, and hands out
+// TLSF sub-allocations from them. Buffers and optimal images never share a block, so
+// bufferImageGranularity never has to be considered.
+class MemoryAllocator {
+public:
+	struct Stats {
+		std::uint32_t DeviceMemoryCount = 0;
+		std::uint32_t BlockCount = 0;
+		std::uint32_t DedicatedAllocationCount = 0;
+		std::uint32_t SubAllocationCount = 0;
+		std::uint32_t FreeRangeCount = 0;
+
+		VkDeviceSize ReservedBytes = 0;
+		VkDeviceSize UsedBytes = 0;
+		VkDeviceSize LargestFreeRange = 0;
+
+		// 0 when all free space of the pooled blocks is contiguous, approaching 1 when it is scattered.
+		float Fragmentation = 0.0f;
+	};
+
+public:
+	MemoryAllocator() = default;
+	virtual ~MemoryAllocator();
+
+private:
+	MemoryAllocator(const MemoryAllocator& inRef) = delete;
+	MemoryAllocator(MemoryAllocator&& inRVal) = delete;
+	MemoryAllocator& operator=(const MemoryAllocator& inRef) = delete;
+	MemoryAllocator& operator=(MemoryAllocator&& inRVal) = delete;
+
+public:
+	bool Initialize(const VkPhysicalDevice& inPhysicalDevice, const VkDevice& inDevice);
+	void CleanUp();
+
+	bool Allocate(
+		const VkMemoryRequirements& inRequirements,
+		const VkMemoryPropertyFlags& inProperties,
+		ResourceKinds inKind,
+		bool bDedicated,
+		Allocation& outAllocation);
+	void Free(Allocation& ioAllocation);
+
+	void GetStats(Stats& outStats) const;
+	void LogStats() const;
+
+private:
+	std::uint32_t FindMemoryType(std::uint32_t inTypeFilter, const VkMemoryPropertyFlags& inProperties) const;
+	VkDeviceSize GetPreferredBlockSize(std::uint32_t inMemoryTypeIndex) const;
+
+	bool AllocateDeviceMemory(std::uint32_t inMemoryTypeIndex, VkDeviceSize inSize, MemoryBlock& ioBlock);
+	void FreeDeviceMemory(MemoryBlock& ioBlock);
+
+	bool AllocateDedicated(const VkMemoryRequirements& inRequirements, std::uint32_t inMemoryTypeIndex, Allocation& outAllocation);
+
+public:
+	static const VkDeviceSize DefaultBlockSize = 64ull * 1024 * 1024;
+
+private:
+	bool bIsCleanedUp = true;
+
+	VkDevice mDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties mMemoryProperties = {};
+	std::uint32_t mMaxAllocationCount = 0;
+
+	std::vector<std::unique_ptr<MemoryBlock>> mBlocks[VK_MAX_MEMORY_TYPES][ResourceKinds::ENumResourceKinds];
+	std::unordered_map<MemoryBlock*, std::unique_ptr<MemoryBlock>> mDedicatedBlocks;
+
+	std::uint32_t mDeviceMemoryCount = 0;
+	std::uint32_t mSubAllocationCount = 0;
+};
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "FrustumCuller.h"
+#include "MeshletBuilder.h"
+#include "ObjParser.h"
+#include "VertexLayout.h"
+
+enum VertexFormats {
+	EFullVertex = 0,
+	ECompactVertex,			// texture coordinates in unorm16
+	ECompactHalfVertex,		// texture coordinates in half floats, for those outside of [0, 1]
+	ENumVertexFormats
+};
+
+struct Vertex {
+	glm::vec3 mPos;
+	glm::vec3 mColor;
+	glm::vec2 mTexCoord;
+
+	bool operator==(const Vertex& other) const {
+		return mPos == other.mPos && mColor == other.mColor && mTexCoord == other.mTexCoord;
+	}
+};
+
+// The color is constant, so it is not fetched.
+using FullVertexLayout = VertexLayout<
+	Vertex,
+	VK_VERTEX_INPUT_RATE_VERTEX,
+	VertexAttribute<0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, mPos)>,
+	VertexAttribute<2, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, mTexCoord)>>;
+
+// Quantized vertex. The position is snorm16 relative to the mesh bounds, and is dequantized by the
+// instance matrix; its w is unused. The constant color of Vertex is dropped.
+struct CompactVertex {
+	std::int16_t mPos[4];
+	std::uint16_t mTexCoord[2];
+};
+
+using CompactVertexLayout = VertexLayout<
+	CompactVertex,
+	VK_VERTEX_INPUT_RATE_VERTEX,
+	VertexAttribute<0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(CompactVertex, mPos)>,
+	VertexAttribute<2, VK_FORMAT_R16G16_UNORM, offsetof(CompactVertex, mTexCoord)>>;
+
+using CompactHalfVertexLayout = VertexLayout<
+	CompactVertex,
+	VK_VERTEX_INPUT_RATE_VERTEX,
+	VertexAttribute<0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(CompactVertex, mPos)>,
+	VertexAttribute<2, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, mTexCoord)>>;
+
+// Index range of one level of detail, relative to the mesh's first index.
+struct MeshLod {
+	std::uint32_t FirstIndex = 0;
+	std::uint32_t IndexCount = 0;
+
+	// Largest deviation from the full-detail mesh, in mesh units.
+	float Error = 0.0f;
+};
+
+struct Mesh {
+	// Offset into the vertex geometry of the mesh's vertex format.
+	std::int32_t VertexOffset = 0;
+	VertexFormats VertexFormat = VertexFormats::EFullVertex;
+
+	// Maps quantized positions to mesh space; applied on top of the world matrix of every instance.
+	glm::mat4 Dequantization = glm::mat4(1.0f);
+
+	// Offset into the index geometry of the mesh's index type.
+	std::uint32_t FirstIndex = 0;
+	VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+
+	std::uint32_t RefCount = 0;
+
+	// Local-space bounds, computed at import.
+	glm::vec3 BoundsMin = glm::vec3(0.0f);
+	glm::vec3 BoundsMax = glm::vec3(0.0f);
+	glm::vec3 BoundsCenter = glm::vec3(0.0f);
+	float BoundsRadius = 0.0f;
+
+	std::vector<Vertex> Vertices;
+
+	// Index lists of all levels of detail back to back, finest first; they share the vertices.
+	std::vector<std::uint32_t> Indices;
+	std::vector<MeshLod> Lods;
+
+	// Clusters of the full-detail level, only built for large meshes. Their mesh-space bounds are
+	// mirrored into MeshletBounds for the SIMD frustum test.
+	std::vector<Meshlet> Meshlets;
+	FrustumCuller MeshletBounds;
+};
+
+// Import settings of a mesh, taken when its load starts so that background loads never read the
+// renderer's own. The first two only apply when the mesh is built from its source; the others are
+// applied to cooked meshes as well.
+struct MeshImportOptions {
+	bool bOverdrawOrdering = true;
+	bool bParallelWelding = false;
+	bool bFlipped = false;
+	bool bCompactVertices = false;
+};
+
+// CPU side of a mesh, ready for upload. CompactVertices holds the vertices in the mesh's vertex format
+// when that is not the full one.
+struct MeshImport {
+	std::unique_ptr<Mesh> pMesh;
+	std::vector<CompactVertex> CompactVertices;
+};
+
+// Everything below is CPU work only and thread-safe, with all it needs passed in. Progress is logged
+// under inFilePath.
+
+// Parses an OBJ file and builds the device-independent part of the mesh: welded vertices, bounds, cache-
+// and overdraw-ordered indices, meshlets and levels of detail. Texture coordinates are left unflipped.
+bool ImportMesh(const std::string& inFilePath, const MeshImportOptions& inOptions, ThreadPool& inThreadPool, Mesh& outMesh);
+
+// Applies the load-time options to a mesh from ImportMesh() or a cooked file: flips the texture
+// coordinates and quantizes the vertices.
+void FinishMeshImport(const std::string& inFilePath, const MeshImportOptions& inOptions, MeshImport& ioImport);
+
+// Mirrors the meshlet bounds into Mesh::MeshletBounds.
+void BuildMeshletBounds(Mesh& ioMesh);
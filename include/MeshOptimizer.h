@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Common.h"
+
+// Import-time index and vertex reordering. All functions work on triangle lists.
+
+// Forsyth's linear-speed vertex cache optimization: reorders the triangles so that their vertices
+// are reused while still in the post-transform cache. The vertices may be any subset of a larger buffer.
+void OptimizeVertexCache(const std::vector<std::uint32_t>& inIndices, std::vector<std::uint32_t>& outIndices);
+
+// Cuts a cache-optimized order into clusters where it jumps to a new region, and draws the clusters
+// facing away from the mesh center first, so that the outer surface fills the depth buffer early.
+void OptimizeOverdraw(const std::vector<glm::vec3>& inPositions, std::vector<std::uint32_t>& ioIndices);
+
+// Renumbers the vertices by first use in ioIndices, so that fetches walk the vertex buffer forwards.
+// outRemap maps old to new vertex indices; unreferenced vertices map to UINT32_MAX and are dropped
+// from the returned count.
+std::uint32_t OptimizeVertexFetch(std::uint32_t inVertexCount, std::vector<std::uint32_t>& ioIndices, std::vector<std::uint32_t>& outRemap);
+
+// Average cache miss ratio (transformed vertices per triangle) and average transformed vertex ratio
+// (transformed vertices per referenced vertex) of a FIFO cache of inCacheSize entries.
+void AnalyzeVertexCache(const std::vector<std::uint32_t>& inIndices, std::uint32_t inCacheSize, float& outAcmr, float& outAtvr);
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Common.h"
+
+// Quadric error metric simplification by edge collapse. Vertices are only ever merged into existing
+// ones, so the result indexes into the same vertex buffer and can be uploaded as another index range.
+// Vertices on open borders and on attribute seams (several vertices sharing a position) are kept.
+//
+// outError is the largest error introduced, as a distance in mesh units.
+bool SimplifyMesh(
+	const std::vector<glm::vec3>& inPositions,
+	const std::vector<std::uint32_t>& inIndices,
+	std::uint32_t inTargetIndexCount,
+	std::vector<std::uint32_t>& outIndices,
+	float& outError);
\ No newline at end of file
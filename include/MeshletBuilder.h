@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Common.h"
+
+// A cluster of neighbouring triangles, stored as a contiguous range of the mesh's index list.
+// Bounds and the normal cone are in mesh space.
+struct Meshlet {
+	std::uint32_t FirstIndex = 0;
+	std::uint32_t TriangleCount = 0;
+	std::uint32_t VertexCount = 0;
+
+	glm::vec3 Center = glm::vec3(0.0f);
+	float Radius = 0.0f;
+	glm::vec3 Extents = glm::vec3(0.0f);
+
+	// Every face normal is within the cone around ConeAxis whose half angle has the cosine
+	// sqrt(1 - ConeCutoff^2). A cutoff of one or more means the cone is too wide to be culled.
+	glm::vec3 ConeAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	float ConeCutoff = 1.0f;
+};
+
+// Greedily grows meshlets of at most inMaxVertices distinct vertices and inMaxTriangles triangles,
+// preferring triangles that add few vertices and face the same way. outIndices holds the triangles
+// of inIndices reordered so that each meshlet is contiguous.
+bool BuildMeshlets(
+	const std::vector<glm::vec3>& inPositions,
+	const std::vector<std::uint32_t>& inIndices,
+	std::uint32_t inMaxVertices,
+	std::uint32_t inMaxTriangles,
+	std::vector<std::uint32_t>& outIndices,
+	std::vector<Meshlet>& outMeshlets);
+
+// True when no triangle of the meshlet can face a camera at inCameraPos (mesh space).
+bool IsMeshletBackFacing(const Meshlet& inMeshlet, const glm::vec3& inCameraPos);
\ No newline at end of file
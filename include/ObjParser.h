@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+// Corner of an OBJ face as zero-based indices into the positions and texture coordinates.
+struct ObjCorner {
+	std::uint32_t Position = 0;
+
+	// ObjNullIndex when the face has no texture coordinates.
+	std::uint32_t TexCoord = 0;
+};
+
+static const std::uint32_t ObjNullIndex = UINT32_MAX;
+
+struct ObjData {
+	std::vector<glm::vec3> Positions;
+	std::vector<glm::vec2> TexCoords;
+
+	// Three corners per triangle; polygons are triangulated as fans. Groups, objects and materials are
+	// ignored, so all faces of the file end up in one list.
+	std::vector<ObjCorner> Corners;
+};
+
+// Parses the positions, texture coordinates and faces of a Wavefront OBJ file. The text is split into
+// line-aligned chunks that are counted, and then parsed straight into their final place in outData, on
+// inThreadPool. Normals are skipped.
+bool ParseObj(const char* pText, size_t inSize, ThreadPool& inThreadPool, ObjData& outData);
+
+// Maps the file and parses it with ParseObj.
+bool LoadObjFile(const std::string& inFilePath, ThreadPool& inThreadPool, ObjData& outData);
\ No newline at end of file
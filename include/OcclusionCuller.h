@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Common.h"
+#include "ThreadPool.h"
+
+// Conservative software occlusion culling. Occluder triangles are binned into screen tiles and
+// rasterized into a low-resolution depth buffer, one tile per task; every tile also keeps its farthest
+// depth as a coarse hierarchical-Z level. Occludees are tested by their screen-space bounding
+// rectangle and nearest depth, first against the tile levels and then against the pixels.
+class OcclusionCuller {
+public:
+	OcclusionCuller() = default;
+	virtual ~OcclusionCuller() = default;
+
+public:
+	void Initialize();
+
+	void BeginFrame(const glm::mat4& inViewProj);
+
+	// Positions are read from the first 12 bytes of each vertex.
+	void AddOccluder(
+		const glm::mat4& inWorld,
+		const void* pVertices,
+		std::uint32_t inVertexStride,
+		std::uint32_t inVertexCount,
+		const std::uint32_t* pIndices,
+		std::uint32_t inIndexCount);
+
+	void Rasterize(ThreadPool& inThreadPool);
+
+	// World-space box given by its center and half extents. Thread safe once Rasterize has returned.
+	bool IsVisible(const glm::vec3& inCenter, const glm::vec3& inExtents) const;
+
+	std::uint32_t GetTriangleCount() const;
+
+private:
+	struct Triangle {
+		// Edge functions are A * x + B * y + C, non-negative inside.
+		float EdgeA[3];
+		float EdgeB[3];
+		float EdgeC[3];
+
+		// Depth plane, z = DepthA * x + DepthB * y + DepthC.
+		float DepthA;
+		float DepthB;
+		float DepthC;
+
+		std::int32_t MinX;
+		std::int32_t MinY;
+		std::int32_t MaxX;
+		std::int32_t MaxY;
+	};
+
+	void SetupTriangle(const glm::vec4& inV0, const glm::vec4& inV1, const glm::vec4& inV2);
+	void RasterizeTile(std::uint32_t inTileIndex);
+
+public:
+	static const std::uint32_t Width = 320;
+	static const std::uint32_t Height = 192;
+	static const std::uint32_t TileWidth = 64;
+	static const std::uint32_t TileHeight = 32;
+	static const std::uint32_t TileCountX = Width / TileWidth;
+	static const std::uint32_t TileCountY = Height / TileHeight;
+
+private:
+	glm::mat4 mViewProj;
+
+	std::vector<float> mDepth;
+	std::array<float, TileCountX * TileCountY> mTileMaxDepth;
+
+	std::vector<glm::vec4> mClipPositions;
+	std::vector<Triangle> mTriangles;
+	std::array<std::vector<std::uint32_t>, TileCountX * TileCountY> mTileBins;
+};
\ No newline at end of file
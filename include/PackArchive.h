@@ -0,0 +1,78 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+// A pack archive holds many files in one, laid out so that it can be used straight from a mapping:
+//
+//	header | payloads, each aligned | table of contents: entries, lookup slots, names
+//
+// The table of contents is aligned and read in place, and names are found through an open-addressing
+// table of name hashes that the writer built, so opening an archive only maps it and checks the
+// header, whatever the number of entries. Payloads are stored as is or LZ4 compressed, per entry.
+
+enum PackCompressions {
+	EPackUncompressed = 0,
+	EPackLz4,
+	ENumPackCompressions
+};
+
+// A payload inside an open archive, valid until the archive is closed.
+struct PackEntry {
+	const std::uint8_t* pData = nullptr;
+	std::uint64_t Offset = 0;
+	std::uint64_t StoredSize = 0;
+	std::uint64_t Size = 0;
+	PackCompressions Compression = PackCompressions::EPackUncompressed;
+};
+
+// Copies or decompresses the first inSize bytes of an entry to pDst, such as mapped staging memory.
+// Thread-safe.
+bool ReadPackEntry(const PackEntry& inEntry, void* pDst, std::uint64_t inSize);
+
+// Starts reading an entry into memory, so that a later ReadPackEntry() does not wait on the disk. For
+// loading threads to call ahead of reads on the render thread.
+void PrefetchPackEntry(const PackEntry& inEntry);
+
+class PackArchive {
+public:
+	PackArchive() = default;
+	virtual ~PackArchive();
+
+private:
+	PackArchive(const PackArchive& inRef) = delete;
+	PackArchive(PackArchive&& inRVal) = delete;
+	PackArchive& operator=(const PackArchive& inRef) = delete;
+	PackArchive& operator=(PackArchive&& inRVal) = delete;
+
+public:
+	bool Open(const std::string& inFilePath);
+	void Close();
+
+	bool IsOpen() const;
+	std::uint32_t GetEntryCount() const;
+
+	// Thread-safe. Entries are checked against the file size here rather than when opening.
+	bool Find(const std::string& inName, PackEntry& outEntry) const;
+
+private:
+	MappedFile mFile;
+
+	const void* mpEntries = nullptr;
+	const std::uint32_t* mpSlots = nullptr;
+	const char* mpNames = nullptr;
+
+	std::uint32_t mEntryCount = 0;
+	std::uint32_t mSlotMask = 0;
+	std::uint64_t mNamesSize = 0;
+};
+
+// What WritePackArchive() stores under a name. Entries with the same file share one payload.
+struct PackSource {
+	std::string Name;
+	std::string FilePath;
+};
+
+// Payloads are compressed with LZ4 when bCompress is set and that makes them smaller. Files are read
+// and compressed on inThreadPool; the archive is written through a temporary file.
+bool WritePackArchive(const std::string& inFilePath, const std::vector<PackSource>& inSources, bool bCompress, ThreadPool& inThreadPool);
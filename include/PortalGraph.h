@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common.h"
+
+// Cell-and-portal visibility. Cells are axis-aligned boxes connected by two-sided portal quads.
+// Each frame the graph is flood-filled from the cell containing the eye, and the frustum is narrowed
+// to every portal it passes through, so a cell ends up with the frusta it can be seen through.
+// Everything runs on the CPU and is deterministic for the same cells, portals and view.
+class PortalGraph {
+public:
+	PortalGraph() = default;
+	virtual ~PortalGraph() = default;
+
+public:
+	void Clear();
+
+	std::uint32_t AddCell(const glm::vec3& inMin, const glm::vec3& inMax);
+
+	// The corners have to go around the quad, in either direction.
+	bool AddPortal(std::uint32_t inCellA, std::uint32_t inCellB, const std::array<glm::vec3, 4>& inCorners);
+
+	std::uint32_t GetCellCount() const;
+
+	// First cell containing the point, or NullIndex.
+	std::uint32_t FindCell(const glm::vec3& inPoint) const;
+
+	// Returns false when portals cannot cull anything this frame: the eye is outside every cell, or the
+	// flood fill gave up on a cell reached through too many portal paths.
+	bool ComputeVisibility(const glm::vec3& inEye, const std::array<glm::vec4, 6>& inFrustum);
+
+	bool IsCellVisible(std::uint32_t inCell) const;
+	std::uint32_t GetVisibleCellCount() const;
+
+	// Box given by its center and half extents, tested against the frusta its cell is seen through.
+	bool IsVisible(std::uint32_t inCell, const glm::vec3& inCenter, const glm::vec3& inExtents) const;
+
+private:
+	struct Cell {
+		glm::vec3 Min;
+		glm::vec3 Max;
+
+		std::vector<std::uint32_t> Portals;
+
+		// Frusta reaching this cell in the last flood fill.
+		std::vector<std::uint32_t> Frusta;
+	};
+
+	struct Portal {
+		std::uint32_t Cells[2];
+		std::array<glm::vec3, 4> Corners;
+		glm::vec3 Center;
+		glm::vec3 Normal;
+	};
+
+	struct Frustum {
+		std::uint32_t FirstPlane;
+		std::uint32_t PlaneCount;
+	};
+
+	bool Visit(std::uint32_t inCell, std::uint32_t inFrustum, std::uint32_t inDepth);
+	bool NarrowFrustum(const Portal& inPortal, std::uint32_t inFrustum, std::uint32_t& outFrustum);
+
+public:
+	static const std::uint32_t NullIndex = UINT32_MAX;
+
+private:
+	static const std::uint32_t MaxDepth = 32;
+	static const std::uint32_t MaxFrustaPerCell = 8;
+
+	std::vector<Cell> mCells;
+	std::vector<Portal> mPortals;
+
+	glm::vec3 mEye;
+	glm::vec4 mFarPlane;
+
+	std::vector<Frustum> mFrusta;
+	std::vector<glm::vec4> mPlanes;
+	std::vector<std::uint32_t> mPath;
+	std::uint32_t mVisibleCellCount = 0;
+};
\ No newline at end of file
@@ -1,29 +1,37 @@
 #pragma once
 
 #include "LowRenderer.h"
-
-struct Vertex {
-	glm::vec3 mPos;
-	glm::vec3 mColor;
-	glm::vec2 mTexCoord;
-
-	static VkVertexInputBindingDescription GetBindingDescription();
-	static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions();
-
-	bool operator==(const Vertex& other) const {
-		return mPos == other.mPos && mColor == other.mColor && mTexCoord == other.mTexCoord;
-	}
+#include "MemoryAllocator.h"
+#include "UploadContext.h"
+#include "ThreadPool.h"
+#include "TaskQueue.h"
+#include "GpuCuller.h"
+#include "FrustumCuller.h"
+#include "LooseOctree.h"
+#include "OcclusionCuller.h"
+#include "PortalGraph.h"
+#include "CookedAssets.h"
+
+#include <future>
+
+// Per-instance vertex data, fed through the second vertex binding at VK_VERTEX_INPUT_RATE_INSTANCE.
+struct InstanceData {
+	glm::mat4 mModel;
 };
 
-namespace std {
-	template<> struct hash<Vertex> {
-		size_t operator()(Vertex const& vertex) const {
-			return ((hash<glm::vec3>()(vertex.mPos) ^
-				(hash<glm::vec3>()(vertex.mColor) << 1)) >> 1) ^
-				(hash<glm::vec2>()(vertex.mTexCoord) << 1);
-		}
-	};
-}
+// A mat4 attribute occupies four consecutive locations, one per column.
+using InstanceLayout = VertexLayout<
+	InstanceData,
+	VK_VERTEX_INPUT_RATE_INSTANCE,
+	VertexAttribute<3, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, mModel)>,
+	VertexAttribute<4, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, mModel) + sizeof(glm::vec4)>,
+	VertexAttribute<5, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, mModel) + sizeof(glm::vec4) * 2>,
+	VertexAttribute<6, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, mModel) + sizeof(glm::vec4) * 3>>;
+
+// Vertex input of the scene pipeline for a vertex format: the format's layout at binding 0 and the
+// instances at binding 1. Texture coordinates stay at location 2 in all formats.
+VkPipelineVertexInputStateCreateInfo GetVertexInputState(VertexFormats inFormat);
+std::uint32_t GetVertexStride(VertexFormats inFormat);
 
 enum RenderTypes {
 	EOpaque = 0,
@@ -31,49 +39,283 @@ enum RenderTypes {
 	ENumTypes,
 };
 
-struct Mesh {
-	VkBuffer VertexBuffer;
-	VkDeviceMemory VertexBufferMemory;
+enum CullingMethods {
+	EScalarCulling = 0,
+	ESimdCulling,
+	EOctreeCulling,
+	ENumCullingMethods
+};
+
+// One large device-local buffer shared by all meshes. Ranges are handed out in elements
+// (vertices or indices) so that they can be passed straight to vkCmdDrawIndexed.
+struct GeometryBuffer {
+	VkBuffer Buffer = VK_NULL_HANDLE;
+	Allocation BufferAllocation;
 
-	VkBuffer IndexBuffer;
-	VkDeviceMemory IndexBufferMemory;
+	VkBufferUsageFlags Usage = 0;
+	std::uint32_t Stride = 0;
+	std::uint32_t Capacity = 0;
 
-	std::unordered_map<Vertex, std::uint32_t> UniqueVertices;
-	std::vector<Vertex> Vertices;
-	std::vector<std::uint32_t> Indices;
+	TlsfAllocator Allocator;
 };
 
 struct RenderItem {
-	std::vector<VkDescriptorSet> DescriptorSets;
-
-	std::vector<VkBuffer> UniformBuffers;
-	std::vector<VkDeviceMemory> UniformBufferMemories;
-
+	std::string Name;
 	std::string MeshName;
 	std::string MatName;
 
+	// Not drawn until its mesh and texture uploads are available to the graphics queue.
+	std::uint64_t UploadTicket = 0;
+
+	// Slot of the world bounds in the frustum culler and scene index of the item's render type.
+	std::uint32_t CullIndex = 0;
+
+	// Rasterized into the software depth buffer to hide the items behind it.
+	bool bOccluder = false;
+
+	// Portal cell containing the center of the world bounds, if any.
+	std::uint32_t CellIndex = PortalGraph::NullIndex;
+
+	// Slot in the GPU scene of an opaque item, or NullGpuObject while it is not in it.
+	static const std::uint32_t NullGpuObject = UINT32_MAX;
+	std::uint32_t GpuObjectIndex = NullGpuObject;
+
+	// Level of detail drawn in the last frame the item was visible, and the one its projected error
+	// picked before the triangle budget coarsened it. The latter seeds the next selection.
+	std::uint32_t LodIndex = 0;
+	std::uint32_t ErrorLodIndex = 0;
+
 	glm::vec3 Scale = glm::vec3(1.0f);
 	glm::fquat Quat = glm::quat(0.0f, 0.0f, 0.0f, 1.0f);
 	glm::vec3 Pos = glm::vec3(0.0f, 0.0f, 0.0f);
 };
 
+// A texture whose finer levels are only in video memory while items using it are large enough on
+// screen. Its image holds the levels from ResidentMip on; finer ones are staged again from Source.
+struct TextureStreaming {
+	TextureImport Source;
+
+	std::uint32_t ResidentMip = 0;
+	std::uint32_t WantedMip = 0;
+	std::uint32_t TailMip = 0;	// the finest level that always stays resident
+
+	VkDeviceSize ResidentSize = 0;
+	std::uint64_t LastUsedFrame = 0;
+
+	// The image is not replaced again before its last one is available, which keeps one upload per
+	// texture in flight.
+	std::uint64_t UploadTicket = 0;
+};
+
 struct Material {
 	VkImage TextureImage;
-	VkDeviceMemory TextureImageMemory;
+	Allocation TextureImageAllocation;
 	VkImageView TextureImageView;
-	VkSampler TextureSampler;
 
-	std::uint32_t MipLevels;
+	// Slots in the texture and sampler tables of the frame descriptor sets.
+	std::uint32_t TextureIndex = 0;
+	std::uint32_t SamplerIndex = 0;
+
+	VkFormat TextureFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	std::uint32_t MipLevels;	// levels in the image, which may start below the finest one
+
+	// Null unless the texture is streamed.
+	std::unique_ptr<TextureStreaming> pStreaming;
+};
+
+// A texture image replaced by streaming. It is destroyed once its replacement is written to every
+// frame descriptor set and no frame in flight can still sample it.
+struct RetiredTexture {
+	VkImage Image = VK_NULL_HANDLE;
+	Allocation ImageAllocation;
+	VkImageView ImageView = VK_NULL_HANDLE;
+
+	std::uint64_t UploadTicket = 0;	// of the replacement
+	std::uint64_t ReleaseFrame = 0;	// zero until the replacement is available
+};
+
+struct SamplerDesc {
+	VkFilter Filter = VK_FILTER_LINEAR;
+	VkSamplerMipmapMode MipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	VkSamplerAddressMode AddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	float MaxAnisotropy = 16.0f;
+
+	bool operator==(const SamplerDesc& other) const {
+		return Filter == other.Filter && MipmapMode == other.MipmapMode && AddressMode == other.AddressMode && MaxAnisotropy == other.MaxAnisotropy;
+	}
+};
+
+// Where a mesh or texture is loaded from. Loaded data is keyed by Key, which sources that cooked to
+// the same data share.
+struct AssetSource {
+	std::string Key;
+	std::string FilePath;	// a cooked file or a source, or the entry name when packed
+	std::string SourcePath;	// the path asked for, imported instead when the cooked data is rejected
+
+	// Null data unless the asset is in the asset pack.
+	PackEntry Entry;
+};
+
+// A mesh or texture being loaded on the load queue, shared by all model loads that need it. The task
+// fills in the import and then sets bDone; only the render thread reads it after that.
+struct AsyncMeshLoad {
+	std::atomic<bool> bDone = false;
+	bool bSucceeded = false;
+	MeshImport Import;
+};
+
+struct AsyncTextureLoad {
+	std::atomic<bool> bDone = false;
+	bool bSucceeded = false;
+	TextureImport Import;
+};
+
+// A model waiting for its mesh and texture, then for its uploads. Loads are null for data that was
+// already resident when the model was requested.
+struct AsyncModelLoad {
+	std::string FilePath;
+	std::string TexFilePath;
+	std::string Name;
+	RenderTypes Type = RenderTypes::EOpaque;
+	glm::vec3 Scale = glm::vec3(1.0f);
+	glm::fquat Quat = glm::fquat(0.0f, 0.0f, 0.0f, 1.0f);
+	glm::vec3 Pos = glm::vec3(0.0f);
+
+	std::shared_ptr<AsyncMeshLoad> pMeshLoad;
+	std::shared_ptr<AsyncTextureLoad> pTextureLoad;
+
+	std::uint64_t UploadTicket = 0;
+	std::promise<bool> Resident;
+};
+
+// A texture or sampler table slot that has not been written to a frame descriptor set yet.
+struct PendingDescriptorWrite {
+	std::uint32_t Binding = 0;
+	std::uint32_t Slot = 0;
+
+	// Textures are only written once their upload is available to the graphics queue. Streaming
+	// replaces the view of a slot, so each write carries its own.
+	std::uint64_t UploadTicket = 0;
+	VkImageView ImageView = VK_NULL_HANDLE;
+};
+
+// Render items sharing a mesh and a material, drawn with a single instanced draw.
+struct InstanceBatch {
+	Mesh* pMesh = nullptr;
+	Material* pMaterial = nullptr;
+	std::uint32_t LodIndex = 0;
+
+	// Index range relative to the mesh's first index; a part of the level when clusters are culled.
+	std::uint32_t FirstIndex = 0;
+	std::uint32_t IndexCount = 0;
+
+	std::uint32_t FirstInstance = 0;
+	std::uint32_t InstanceCount = 0;
+};
+
+// Consecutive indirect draws sharing a material, issued with one indirect call.
+struct IndirectRun {
+	Material* pMaterial = nullptr;
+	VertexFormats VertexFormat = VertexFormats::EFullVertex;
+	VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+
+	std::uint32_t FirstDraw = 0;
+	std::uint32_t DrawCount = 0;
+};
+
+// Persistently mapped, host-coherent uniform and instance buffer owned by one frame in flight.
+// It is refilled from the start every frame once that frame's fence has signaled.
+struct UniformArena {
+	VkBuffer Buffer = VK_NULL_HANDLE;
+	Allocation BufferAllocation;
+
+	VkDeviceSize Capacity = 0;
+	VkDeviceSize Head = 0;
+
+	VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+
+	// The set may still be in use by this frame until its fence is waited on, so table
+	// updates are queued per frame and applied at the start of it.
+	std::vector<PendingDescriptorWrite> PendingWrites;
+};
+
+// Command pool and secondary command buffer used by one recording task of one frame in flight.
+struct RecordingContext {
+	VkCommandPool CommandPool = VK_NULL_HANDLE;
+	VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
 };
 
 class Renderer : LowRenderer {
+public:
+	struct RecordingStats {
+		std::uint64_t FrameCount = 0;
+		std::uint64_t DrawCount = 0;
+		std::uint64_t TaskCount = 0;
+		double RecordingTime = 0.0;	// milliseconds
+	};
+
+	struct CullingStats {
+		std::uint64_t FrameCount = 0;
+		std::uint64_t TestedCount = 0;
+		std::uint64_t VisibleCount = 0;
+		double CullingTime = 0.0;	// microseconds
+	};
+
+	struct OcclusionStats {
+		std::uint64_t FrameCount = 0;
+		std::uint64_t OccluderTriangleCount = 0;
+		std::uint64_t TestedCount = 0;
+		std::uint64_t RejectedCount = 0;
+		double RasterizationTime = 0.0;	// milliseconds
+		double TestTime = 0.0;			// milliseconds
+	};
+
+	struct LodStats {
+		std::uint64_t FrameCount = 0;
+		std::uint64_t TriangleCount = 0;
+		std::uint64_t FullDetailTriangleCount = 0;
+		std::uint64_t BudgetFrameCount = 0;	// frames in which the triangle budget coarsened items
+	};
+
+	struct TextureStreamingStats {
+		std::uint64_t FrameCount = 0;
+		std::uint64_t TextureCount = 0;		// streamed textures
+		std::uint64_t ResidentSize = 0;		// bytes of their levels in video memory
+		std::uint64_t FullSize = 0;			// bytes of all their levels
+		std::uint64_t UpgradeCount = 0;
+		std::uint64_t EvictionCount = 0;
+		std::uint64_t DeferredCount = 0;	// upgrades left for later by the budget
+		std::uint64_t StagedSize = 0;
+	};
+
+	struct ClusterStats {
+		std::uint64_t FrameCount = 0;
+		std::uint64_t TestedCount = 0;
+		std::uint64_t FrustumRejectedCount = 0;
+		std::uint64_t BackFacingRejectedCount = 0;
+		std::uint64_t TriangleCount = 0;			// triangles of the tested items
+		std::uint64_t DrawnTriangleCount = 0;
+	};
+
+	struct PortalStats {
+		std::uint64_t FrameCount = 0;
+		std::uint64_t VisibleCellCount = 0;
+		std::uint64_t TestedCount = 0;
+		std::uint64_t RejectedCount = 0;
+		double CullingTime = 0.0;	// microseconds
+	};
+
 protected:
-	struct UniformBufferObject {
-		alignas(16) glm::mat4 mModel;
+	struct ViewConstants {
 		alignas(16) glm::mat4 mView;
 		alignas(16) glm::mat4 mProj;
 	};
 
+	struct DrawConstants {
+		std::uint32_t mTextureIndex;
+		std::uint32_t mSamplerIndex;
+	};
+
 public:
 	Renderer() = default;
 	virtual ~Renderer();
@@ -99,6 +341,32 @@ public:
 		glm::vec3 inScale = glm::vec3(1.0f),
 		glm::fquat inQuat = glm::fquat(0.0f, 0.0f, 0.0f, 1.0f),
 		glm::vec3 inPos = glm::vec3(0.0f));
+	// Parses the mesh and decodes the texture on the load queue, then uploads them from Update(). The
+	// item shows up once its uploads are available; the future becomes true at that point, or false when
+	// loading failed. Meshes and textures already loading are shared rather than loaded again.
+	std::shared_future<bool> AddModelAsync(
+		const std::string& inFilePath,
+		const std::string& inTexFilePath,
+		const std::string& inName,
+		RenderTypes inType = RenderTypes::EOpaque,
+		bool bFlipped = false,
+		glm::vec3 inScale = glm::vec3(1.0f),
+		glm::fquat inQuat = glm::fquat(0.0f, 0.0f, 0.0f, 1.0f),
+		glm::vec3 inPos = glm::vec3(0.0f));
+	bool RemoveModel(const std::string& inName, RenderTypes inType);
+
+	// Models added from now on load the cooked files of the sources listed in the manifest of
+	// inCookedDir, which AssetCooker wrote for inSourceDir; other sources are still imported. Sources
+	// with identical contents then share one mesh or texture. Returns false when there is no manifest.
+	bool SetCookedAssets(const std::string& inSourceDir, const std::string& inCookedDir);
+
+	// Like SetCookedAssets(), from the pack archive AssetCooker wrote for inSourceDir, which takes
+	// precedence over the manifest. Cooked textures are staged straight from the mapped archive. Fails
+	// while models are loading, since their data may point into the archive already open.
+	bool OpenAssetPack(const std::string& inSourceDir, const std::string& inPackPath);
+
+	bool SubmitUploads(std::uint64_t& outTicket);
+	bool IsUploadComplete(std::uint64_t inTicket);
 
 	bool UpdateCamera(const glm::vec3& inPos, const glm::vec3& inTarget);
 	bool UpdateModel(
@@ -111,34 +379,192 @@ public:
 	bool Update(const GameTimer& gt);
 	bool Draw();
 
+	void GetMemoryStats(MemoryAllocator::Stats& outStats) const;
+	void LogMemoryStats() const;
+
+	// Draws are recorded into secondary command buffers on the thread pool when enabled.
+	void SetParallelRecording(bool bEnabled);
+	bool IsParallelRecording() const;
+
+	void GetRecordingStats(bool bParallel, RecordingStats& outStats) const;
+	void LogRecordingStats() const;
+
+	// Opaque items are culled by a compute pass and drawn indirectly when enabled.
+	// Returns false when the device lacks drawIndirectFirstInstance.
+	bool SetGpuDrivenRendering(bool bEnabled);
+	bool IsGpuDrivenRendering() const;
+
+	// Render items are frustum culled on the CPU each frame, either by testing every item or by
+	// walking the scene index.
+	void SetCullingMethod(CullingMethods inMethod);
+	CullingMethods GetCullingMethod() const;
+
+	void GetCullingStats(CullingMethods inMethod, CullingStats& outStats) const;
+	void LogCullingStats() const;
+
+	// Spatial queries over the render items of one type; outNames is replaced with the matches.
+	void QuerySphere(RenderTypes inType, const glm::vec3& inCenter, float inRadius, std::vector<std::string>& outNames) const;
+	void QueryBox(RenderTypes inType, const glm::vec3& inMin, const glm::vec3& inMax, std::vector<std::string>& outNames) const;
+	void QueryNearest(RenderTypes inType, const glm::vec3& inPoint, std::uint32_t inCount, std::vector<std::string>& outNames) const;
+
+	// Times the scene index against linear scans on synthetic scenes of 1k to 1M items.
+	static void LogSceneIndexScaling();
+
+	// Times the OBJ parser against tinyobjloader on synthetic grid meshes of up to a few hundred MB.
+	static void LogObjParsingBenchmark();
+
+	// Times loading cooked-sized files into staging-like memory from loose files and from pack
+	// archives, stored and LZ4 compressed, along with opening archives of 1k to 64k entries.
+	static void LogAssetIoBenchmark();
+
+	// Times the block-compression encoders on a synthetic 2048x2048 texture with its mips, and reports
+	// the PSNR of each format decoded back against the source.
+	static void LogTextureCompressionBenchmark();
+
+	// Frustum-visible items are also tested against a depth buffer rasterized on the CPU from the
+	// items marked as occluders.
+	bool SetOccluder(const std::string& inName, RenderTypes inType, bool bOccluder);
+	void SetOcclusionCulling(bool bEnabled);
+	bool IsOcclusionCulling() const;
+
+	void GetOcclusionStats(OcclusionStats& outStats) const;
+	void LogOcclusionStats() const;
+
+	// Items inside a cell are only drawn when the cell is seen through the portals from the camera's
+	// cell. Cells are either authored boxes or the world bounds of a render item, such as a room.
+	std::uint32_t AddCell(const glm::vec3& inMin, const glm::vec3& inMax);
+	bool AddCellFromModel(const std::string& inName, RenderTypes inType, std::uint32_t& outCell);
+	bool AddPortal(std::uint32_t inCellA, std::uint32_t inCellB, const std::array<glm::vec3, 4>& inCorners);
+
+	void SetPortalCulling(bool bEnabled);
+	bool IsPortalCulling() const;
+
+	void GetPortalStats(PortalStats& outStats) const;
+	void LogPortalStats() const;
+
+	// Levels of detail are picked by the projected size of their error. With a non-zero budget, the
+	// smallest items on screen are coarsened further until the visible triangles fit.
+	void SetLodSelection(bool bEnabled);
+	bool IsLodSelection() const;
+	void SetTriangleBudget(std::uint64_t inTriangleCount);
+
+	// Whether meshes loaded from now on get their clusters sorted to reduce overdraw.
+	void SetOverdrawOrdering(bool bEnabled);
+
+	// Whether meshes loaded from now on are uploaded in a compact vertex format. Ignored when the device
+	// cannot fetch the compact formats.
+	void SetCompactVertices(bool bEnabled);
+
+	// Whether very large meshes imported from now on are welded by a parallel sort instead of the hash
+	// table.
+	void SetParallelWelding(bool bEnabled);
+
+	void GetLodStats(LodStats& outStats) const;
+	void LogLodStats() const;
+
+	// Full-detail items with meshlets only draw the clusters inside the frustum that face the camera.
+	void SetClusterCulling(bool bEnabled);
+	bool IsClusterCulling() const;
+
+	void GetClusterStats(ClusterStats& outStats) const;
+	void LogClusterStats() const;
+
+	// Textures load their levels of StreamingTailSize and smaller first, and finer ones as the items
+	// using them grow on screen. Past the budget, in bytes, the finer levels of the least recently seen
+	// textures are dropped; zero leaves it unlimited. Without streaming, all levels are wanted.
+	void SetTextureStreaming(bool bEnabled);
+	bool IsTextureStreaming() const;
+	void SetTextureBudget(std::uint64_t inSize);
+
+	void GetTextureStreamingStats(TextureStreamingStats& outStats) const;
+	void LogTextureStreamingStats() const;
+
 protected:
 	virtual bool RecreateSwapChain() override;
 	virtual void CleanUpSwapChain() override;
 
 private:
-	bool AddTexture(const std::string& inFilePath);
+	// Thread-safe: CPU work only, with everything it needs passed in. Packed and cooked data is read,
+	// other paths are imported from the source. Textures in a format missing from inSupportedFormats,
+	// one bit per TextureFormats, are decoded to RGBA8.
+	static bool PrepareMesh(const AssetSource& inSource, const MeshImportOptions& inOptions, ThreadPool& inThreadPool, MeshImport& outImport);
+	static bool PrepareTexture(const AssetSource& inSource, std::uint32_t inSupportedFormats, ThreadPool& inThreadPool, TextureImport& outImport);
+
+	void ResolveAsset(const std::string& inFilePath, AssetSource& outSource) const;
+
+	MeshImportOptions GetMeshImportOptions(bool bFlipped) const;
+	bool UploadMesh(const std::string& inFilePath, MeshImport& ioImport);
+	bool AddRenderItem(
+		const std::string& inFilePath,
+		const std::string& inTexFilePath,
+		const std::string& inName,
+		RenderTypes inType,
+		glm::vec3 inScale,
+		glm::fquat inQuat,
+		glm::vec3 inPos);
+	bool AddLoadedModel(AsyncModelLoad& ioLoad);
+	bool ProcessModelLoads();
+
+	bool AddTexture(const std::string& inFilePath, TextureImport&& inImport);
+	bool CreateDefaultTexture();
+	bool RegisterTexture(Material* ioMaterial, std::uint64_t inUploadTicket);
+	void QueueTextureWrite(const Material* pMaterial, std::uint64_t inUploadTicket);
+	bool GetSampler(const SamplerDesc& inDesc, std::uint32_t& outIndex);
+	void FlushDescriptorWrites(UniformArena& ioArena);
+
+	void UpdateViewConstants();
+	void AddCullingVolume(RenderTypes inType, RenderItem* pRItem);
+	void UpdateCullingVolume(RenderTypes inType, RenderItem* pRItem);
+	void RemoveCullingVolume(RenderTypes inType, RenderItem* pRItem);
+	void GetQueryNames(RenderTypes inType, const std::vector<std::uint32_t>& inIds, std::vector<std::string>& outNames) const;
+	void CullRenderItems();
+	void CullOccludedRenderItems();
+	void CullPortalRenderItems();
+	void AssignCells();
+	void SelectLods();
+
+	bool UpdateTextureStreaming();
+	void RequestTextureMip(RenderTypes inType, std::uint32_t inIndex, float inPixelsPerUnit);
+	bool StreamTexture(Material* ioMaterial, std::uint32_t inFirstMip);
+	void ReleaseRetiredTextures(bool bAll);
+
+	void BuildInstanceBatches();
+	void AppendInstance(RenderTypes inType, Mesh* pMesh, Material* pMaterial, RenderItem* pRItem);
+	void AppendClusters(Mesh* pMesh, Material* pMaterial, RenderItem* pRItem);
 
 	bool UpdateUniformBuffer(const GameTimer& gt);
-	bool UpdateDescriptorSet();
 
-	bool CreateVertexBuffer(Mesh* ioMesh);
+	void RecordDraws(VkCommandBuffer inCommandBuffer, size_t inBegin, size_t inEnd);
+	void RecordIndirectDraws(VkCommandBuffer inCommandBuffer);
+	void BuildGpuScene();
+	bool RecordDrawsParallel(std::uint32_t inTaskCount, size_t inDrawCount);
+
+	bool CreateUniformArena(UniformArena& ioArena, VkDeviceSize inCapacity);
+	bool AllocateArena(UniformArena& ioArena, VkDeviceSize inSize, VkDeviceSize inAlignment, VkDeviceSize& outOffset, std::uint8_t*& pOutData);
+	void DestroyUniformArena(UniformArena& ioArena);
+
+	bool CreateGeometryBuffer(GeometryBuffer& ioGeometry, std::uint32_t inStride, const VkBufferUsageFlags& inUsage, std::uint32_t inCapacity);
+	bool AllocateGeometry(GeometryBuffer& ioGeometry, std::uint32_t inCount, std::uint32_t& outOffset);
+	bool GrowGeometryBuffer(GeometryBuffer& ioGeometry, std::uint32_t inMinCapacity);
+	bool UploadGeometry(GeometryBuffer& ioGeometry, std::uint32_t inOffset, const void* pData, VkDeviceSize inSize);
+	void DestroyGeometryBuffer(GeometryBuffer& ioGeometry);
+
+	bool CreateVertexBuffer(Mesh* ioMesh, const std::vector<CompactVertex>& inCompactVertices);
 	bool CreateIndexBuffer(Mesh* ioMesh);
-	bool CreateUniformBuffers(RenderItem* inRItem);
-	bool RecreateUniformBuffers();
-	bool CreateDescriptorSets(RenderItem* inRItem);
-	bool RecreateDescriptorSets();
-	bool CreateTextureImage(int inTexWidth, int inTexHeight, void* pData, Material* ioMaterial);
+	bool StageTextureMips(const TextureImport& inImport, std::uint32_t inFirstMip, VkBuffer& outBuffer, VkDeviceSize& outOffset);
+	bool CreateTextureImage(const TextureImport& inImport, std::uint32_t inFirstMip, Material* ioMaterial);
 	bool CreateTextureImageView(Material* ioMaterial);
-	bool CreateTextureSampler(Material* ioMaterial);
 
 	bool CreateImageViews();
 	bool CreateRenderPass();
 	bool CreateCommandPool();
+	bool CreateRecordingContexts();
 	bool CreateColorResources();
 	bool CreateDepthResources();
 	bool CreateFramebuffers();
 	bool CreateDescriptorSetLayout();
 	bool CreateGraphicsPipeline();
+	bool CreateGpuCuller();
 	bool CreateDescriptorPool();
 	bool CreateCommandBuffers();
 	bool CreateSyncObjects();
@@ -147,32 +573,91 @@ private:
 	bool bIsCleanedUp = false;
 
 public:
-	VkFormat ImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	static const std::uint32_t InitialVertexCapacity = 256 * 1024;
+	static const std::uint32_t InitialIndexCapacity = 1024 * 1024;
+
+	static const VkDeviceSize StagingBufferSize = 32ull * 1024 * 1024;
+	static const VkDeviceSize StagingAlignment = 16;
+
+	static const VkDeviceSize InitialUniformArenaSize = 256 * 1024;
+	static const std::uint32_t MaxTextureCount = 1024;
+	static const std::uint32_t MaxSamplerCount = 16;
+
+	static const std::uint32_t MaxRecordingThreadCount = 8;
+	static const std::uint32_t MinDrawsPerRecordingTask = 128;
+	static const std::uint32_t MinOccludeesPerTask = 256;
+
+	static constexpr float MaxLodPixelError = 1.0f;
+	static constexpr float LodHysteresis = 0.25f;
+
+	static const std::uint32_t MaxLoadThreadCount = 4;
+
+	static const std::uint32_t StreamingTailSize = 64;
+	static const VkDeviceSize DefaultTextureBudget = 256ull * 1024 * 1024;
+	static const VkDeviceSize MaxStreamingSizePerFrame = 8ull * 1024 * 1024;
 
 protected:
 	std::vector<VkImageView> mSwapChainImageViews;
 	VkRenderPass mRenderPass;
 	std::vector<VkFramebuffer> mSwapChainFramebuffers;
 
+	MemoryAllocator mMemoryAllocator;
+	UploadContext mUploadContext;
+
 	VkCommandPool mCommandPool;
 	std::vector<VkCommandBuffer> mCommandBuffers;
 
+	ThreadPool mThreadPool;
+	std::vector<RecordingContext> mRecordingContexts[SwapChainImageCount];
+	bool bParallelRecording = true;
+	RecordingStats mRecordingStats[2];
+
 	VkImage mColorImage;
-	VkDeviceMemory mColorImageMemory;
+	Allocation mColorImageAllocation;
 	VkImageView mColorImageView;
 
 	VkImage mDepthImage;
-	VkDeviceMemory mDepthImageMemory;
+	Allocation mDepthImageAllocation;
 	VkImageView mDepthImageView;
 
+	GeometryBuffer mVertexGeometries[VertexFormats::ENumVertexFormats];
+	GeometryBuffer mIndexGeometry;
+	GeometryBuffer mShortIndexGeometry;
+
 	std::unordered_map<std::string, std::unique_ptr<Mesh>> mMeshes;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
 
-	VkDescriptorSetLayout mDescriptorSetLayout;
+	// Cooked file of every source in the manifest, by normalized absolute source path.
+	std::unordered_map<std::string, std::string> mCookedAssetPaths;
+
+	// Entries are named by source path relative to mAssetPackSourceDir, which is normalized and absolute.
+	PackArchive mAssetPack;
+	std::string mAssetPackPath;
+	std::string mAssetPackSourceDir;
+
+	// Background loads. The maps hold the meshes and textures in flight by file path; model loads wait
+	// for their data in mModelLoads, then for their uploads in mUploadingModelLoads.
+	TaskQueue mLoadQueue;
+	std::unordered_map<std::string, std::shared_ptr<AsyncMeshLoad>> mMeshLoads;
+	std::unordered_map<std::string, std::shared_ptr<AsyncTextureLoad>> mTextureLoads;
+	std::vector<std::unique_ptr<AsyncModelLoad>> mModelLoads;
+	std::vector<std::unique_ptr<AsyncModelLoad>> mUploadingModelLoads;
+
+	VkDescriptorSetLayout mFrameDescriptorSetLayout;
 	VkDescriptorPool mDescriptorPool;
 
+	std::unique_ptr<Material> mDefaultMaterial;
+	std::vector<VkImageView> mTextureTable;
+	std::vector<std::pair<SamplerDesc, VkSampler>> mSamplerTable;
+	std::uint32_t mTextureCapacity = MaxTextureCount;
+
+	std::array<UniformArena, SwapChainImageCount> mUniformArenas;
+	VkDeviceSize mUniformAlignment = 256;
+	std::uint32_t mViewUniformOffset = 0;
+	VkDeviceSize mInstanceOffset = 0;
+
 	VkPipelineLayout mPipelineLayout;
-	VkPipeline mGraphicsPipeline;
+	VkPipeline mGraphicsPipelines[VertexFormats::ENumVertexFormats];
 
 	std::string mModelFilePath;
 
@@ -180,16 +665,78 @@ protected:
 	std::unordered_map<std::string, RenderItem*> mRItemRefs[RenderTypes::ENumTypes];
 	std::multimap<float, RenderItem*> mOrderedRItemRefs;
 
+	std::vector<std::tuple<Mesh*, Material*, RenderItem*>> mSortedOpaqueRItems;
+	std::vector<RenderItem*> mInstancedRItems;
+	std::vector<InstanceBatch> mInstanceBatches[RenderTypes::ENumTypes];
+
+	ViewConstants mViewConstants;
+	std::array<glm::vec4, 6> mFrustumPlanes;
+
+	FrustumCuller mFrustumCullers[RenderTypes::ENumTypes];
+	LooseOctree mSceneIndices[RenderTypes::ENumTypes];
+	std::vector<RenderItem*> mCullableRItems[RenderTypes::ENumTypes];
+	std::vector<std::uint32_t> mVisibleIndices[RenderTypes::ENumTypes];
+	// Opaque items inside the frustum in GPU-driven mode, where the compute pass culls and draws them.
+	std::vector<std::uint32_t> mGpuCulledIndices;
+	CullingMethods mCullingMethod = CullingMethods::EOctreeCulling;
+	CullingStats mCullingStats[CullingMethods::ENumCullingMethods];
+
+	OcclusionCuller mOcclusionCuller;
+	bool bOcclusionCulling = true;
+	std::vector<std::uint8_t> mOcclusionResults;
+	OcclusionStats mOcclusionStats;
+
+	PortalGraph mPortalGraph;
+	bool bPortalCulling = true;
+	PortalStats mPortalStats;
+
+	bool bLodSelection = true;
+	std::uint64_t mTriangleBudget = 0;
+	std::vector<std::pair<float, RenderItem*>> mLodCandidates;
+	LodStats mLodStats;
+
+	bool bOverdrawOrdering = true;
+	bool bParallelWelding = false;
+
+	bool bCompactVertices = true;
+	bool bCompactVerticesSupported = false;
+
+	// One bit per TextureFormats the device can sample and filter.
+	std::uint32_t mSupportedTextureFormats = 0;
+
+	// Budgeted in the bytes of the levels, without the padding of their allocations.
+	bool bTextureStreaming = true;
+	std::uint64_t mTextureBudget = DefaultTextureBudget;
+	std::uint64_t mStreamedTextureSize = 0;
+	std::vector<Material*> mStreamedMaterials;
+	std::vector<Material*> mStreamingOrder;
+	std::vector<Material*> mEvictionOrder;
+	std::vector<RetiredTexture> mRetiredTextures;
+	TextureStreamingStats mTextureStreamingStats;
+
+	bool bClusterCulling = true;
+	std::vector<std::uint32_t> mVisibleMeshlets;
+	ClusterStats mClusterStats;
+
+	GpuCuller mGpuCuller;
+	bool bGpuCullerAvailable = false;
+	bool bGpuDriven = false;
+	bool bGpuSceneDirty = true;
+	std::uint64_t mGpuSceneVersion = 0;
+	std::vector<GpuObject> mGpuObjects;
+	std::vector<GpuBatch> mGpuBatches;
+	std::vector<IndirectRun> mIndirectRuns;
+
 	std::vector<VkSemaphore> mImageAvailableSemaphores;
 	std::vector<VkSemaphore> mRenderFinishedSemaphores;
 	std::vector<VkFence> mInFlightFences;
 	std::vector<VkFence> mImagesInFlight;
 	std::uint32_t mCurentImageIndex = 0;
 	size_t mCurrentFrame = 0;
+	std::uint64_t mFrameNumber = 0;	// frames begun so far, where mCurrentFrame cycles
 
 	glm::vec3 mCameraPos = ZeroVector;
 	glm::vec3 mCameraTarget = ForwardVector;
 
 	bool bFramebufferResized = false;
-	bool bNeedToUpdateDescriptorSet = false;
 };
\ No newline at end of file
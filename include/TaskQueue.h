@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Common.h"
+
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+// Worker threads running independent background tasks, such as asset loads, in the order they were
+// pushed. Unlike ThreadPool::Run(), Push() returns at once; tasks hand their results back themselves.
+class TaskQueue {
+public:
+	using TaskFunc = std::function<void()>;
+
+public:
+	TaskQueue() = default;
+	virtual ~TaskQueue();
+
+private:
+	TaskQueue(const TaskQueue& inRef) = delete;
+	TaskQueue(TaskQueue&& inRVal) = delete;
+	TaskQueue& operator=(const TaskQueue& inRef) = delete;
+	TaskQueue& operator=(TaskQueue&& inRVal) = delete;
+
+public:
+	bool Initialize(std::uint32_t inWorkerCount);
+
+	// Waits for the running tasks; the ones that have not started are dropped.
+	void CleanUp();
+
+	void Push(TaskFunc&& inFunc);
+
+private:
+	void WorkerLoop();
+
+private:
+	bool bIsCleanedUp = true;
+	bool bQuit = false;
+
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	std::condition_variable mTaskAvailable;
+
+	std::deque<TaskFunc> mTasks;
+};
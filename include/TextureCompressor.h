@@ -0,0 +1,30 @@
+#pragma once
+
+#include "TextureImporter.h"
+#include "ThreadPool.h"
+
+// CPU encoders for the block-compressed formats textures are cooked to:
+//
+//	BC1	8 bytes per block: two RGB565 endpoints and a 2-bit index per texel; opaque color
+//	BC3	16 bytes per block: BC1 color and an alpha block of two 8-bit endpoints and 3-bit indices
+//	BC7	16 bytes per block: written in mode 6 only, two RGBA 7777 endpoints with a low bit each and
+//		a 4-bit index per texel
+//
+// Each block starts from the line through its texels along their principal axis, which least squares
+// then refines over the indices it chose. Indices are picked four texels at a time with SSE, and the
+// block rows of all levels are spread over a thread pool.
+
+// True when every texel of the finest level of an RGBA8 import has full alpha.
+bool IsTextureOpaque(const TextureImport& inImport);
+
+// Encodes every level of an RGBA8 import.
+bool CompressTexture(const TextureImport& inImport, TextureFormats inFormat, ThreadPool& inThreadPool, TextureImport& outImport);
+
+// Decodes the levels of a block-compressed import, with its texels at pTexels, back to RGBA8. BC7 is
+// decoded as CompressTexture() writes it, and blocks in other modes fail. For devices that cannot
+// sample a format, and for measuring the encoders.
+bool DecompressTexture(const TextureImport& inImport, const std::uint8_t* pTexels, ThreadPool& inThreadPool, TextureImport& outImport);
+
+// Peak signal-to-noise ratio in dB of the finest level of an RGBA8 import against a reference, over
+// inChannelCount channels from inFirstChannel. Infinite when they are identical.
+double GetTexturePsnr(const TextureImport& inReference, const TextureImport& inImport, std::uint32_t inFirstChannel, std::uint32_t inChannelCount);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "PackArchive.h"
+
+// Layouts of the texels of a texture. Block-compressed levels are rows of 4x4 blocks, with the blocks
+// at the right and bottom edges padded.
+enum TextureFormats {
+	ETextureRgba8 = 0,
+	ETextureBc1,
+	ETextureBc3,
+	ETextureBc7,
+	ENumTextureFormats
+};
+
+// One level of a mip chain, as a range of TextureImport::Pixels.
+struct TextureMip {
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	size_t Offset = 0;
+	size_t Size = 0;
+};
+
+// Texels of a texture with its full mip chain, finest level first, back to back.
+struct TextureImport {
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	TextureFormats Format = TextureFormats::ETextureRgba8;
+	std::vector<TextureMip> Mips;
+	std::vector<std::uint8_t> Pixels;
+
+	// Set instead of Pixels for a cooked texture in a pack archive, whose entry holds the texels from
+	// PackedPixelOffset on. They are read straight into staging memory when uploaded.
+	PackEntry PackedEntry;
+	std::uint64_t PackedPixelOffset = 0;
+};
+
+// Number of levels down to 1x1.
+std::uint32_t GetMipLevelCount(std::uint32_t inWidth, std::uint32_t inHeight);
+
+// Bytes per 4x4 block, or 0 for a format that is not block-compressed.
+std::uint32_t GetTextureBlockSize(TextureFormats inFormat);
+
+// Lays out the levels of a inWidth by inHeight chain and returns the size of all of them.
+size_t LayoutTextureMips(std::uint32_t inWidth, std::uint32_t inHeight, TextureFormats inFormat, std::vector<TextureMip>& outMips);
+
+// Lays out the levels of a inWidth by inHeight RGBA8 chain in outImport and sizes its pixels.
+void InitTextureMips(std::uint32_t inWidth, std::uint32_t inHeight, TextureImport& outImport);
+
+// Decodes an image file and builds its mip chain. Thread-safe.
+bool ImportTexture(const std::string& inFilePath, TextureImport& outImport);
+
+// Fills every level after the first by box filtering the one above it; odd texels at the edge are
+// folded into the last column or row.
+void GenerateMipChain(TextureImport& ioImport);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+// Fixed set of worker threads running parallel-for style jobs. Run() hands out task indices to the
+// workers and the calling thread, and returns once every task has finished.
+class ThreadPool {
+public:
+	using TaskFunc = std::function<void(std::uint32_t inTaskIndex, std::uint32_t inThreadIndex)>;
+
+public:
+	ThreadPool() = default;
+	virtual ~ThreadPool();
+
+private:
+	ThreadPool(const ThreadPool& inRef) = delete;
+	ThreadPool(ThreadPool&& inRVal) = delete;
+	ThreadPool& operator=(const ThreadPool& inRef) = delete;
+	ThreadPool& operator=(ThreadPool&& inRVal) = delete;
+
+public:
+	bool Initialize(std::uint32_t inWorkerCount);
+	void CleanUp();
+
+	void Run(std::uint32_t inTaskCount, const TaskFunc& inFunc);
+
+	// Number of threads that may execute tasks, including the caller of Run(); thread indices are below it.
+	std::uint32_t GetThreadCount() const;
+
+private:
+	void WorkerLoop(std::uint32_t inThreadIndex);
+	void ExecuteTasks(std::uint32_t inThreadIndex);
+
+private:
+	bool bIsCleanedUp = true;
+	bool bQuit = false;
+
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	std::condition_variable mWorkAvailable;
+	std::condition_variable mWorkDone;
+
+	const TaskFunc* mpFunc = nullptr;
+	std::uint32_t mTaskCount = 0;
+	std::uint64_t mGeneration = 0;
+	std::uint32_t mBusyWorkerCount = 0;
+
+	std::atomic<std::uint32_t> mNextTask = 0;
+};
\ No newline at end of file
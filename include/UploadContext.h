@@ -0,0 +1,149 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+// Records staging copies, layout transitions and mip blits from many uploads and submits them
+// together. Staging memory is carved out of a persistently mapped ring buffer that is reclaimed
+// as submitted batches complete, so nothing blocks on the queue.
+//
+// When the device has a separate transfer family, copies run on the transfer queue and release
+// ownership of what they wrote; the graphics side of the batch (acquires, blits and layout
+// transitions) is submitted only after the transfer work has finished, so it never holds up frame
+// submission. On single-family devices both sides are the same command buffer.
+//
+// Stage data before fetching a command buffer: running out of staging space submits the batch
+// being recorded to make room.
+class UploadContext {
+public:
+	UploadContext() = default;
+	virtual ~UploadContext();
+
+private:
+	UploadContext(const UploadContext& inRef) = delete;
+	UploadContext(UploadContext&& inRVal) = delete;
+	UploadContext& operator=(const UploadContext& inRef) = delete;
+	UploadContext& operator=(UploadContext&& inRVal) = delete;
+
+public:
+	bool Initialize(
+		const VkDevice& inDevice,
+		const VkQueue& inGraphicsQueue,
+		std::uint32_t inGraphicsFamilyIndex,
+		const VkQueue& inTransferQueue,
+		std::uint32_t inTransferFamilyIndex,
+		MemoryAllocator* pAllocator,
+		VkDeviceSize inStagingSize);
+	void CleanUp();
+
+	bool Stage(const void* pData, VkDeviceSize inSize, VkDeviceSize inAlignment, VkBuffer& outBuffer, VkDeviceSize& outOffset);
+
+	// Like Stage(), but leaves the copy to the caller: outMappedData points at inSize bytes of staging
+	// memory to fill before the batch is submitted, such as data decompressed in place.
+	bool Reserve(VkDeviceSize inSize, VkDeviceSize inAlignment, VkBuffer& outBuffer, VkDeviceSize& outOffset, void*& outMappedData);
+
+	// Copies go into the transfer command buffer; anything that needs the graphics queue
+	// (blits, graphics-only layouts, reading previously uploaded data) goes into the graphics one.
+	bool GetTransferCommandBuffer(VkCommandBuffer& outCommandBuffer);
+	bool GetGraphicsCommandBuffer(VkCommandBuffer& outCommandBuffer);
+
+	// Hands a range written on the transfer side over to the graphics side.
+	void ReleaseBuffer(
+		const VkBuffer& inBuffer,
+		VkDeviceSize inOffset,
+		VkDeviceSize inSize,
+		const VkPipelineStageFlags& inDstStages,
+		const VkAccessFlags& inDstAccess);
+	void ReleaseImage(
+		const VkImage& inImage,
+		const VkImageSubresourceRange& inRange,
+		const VkImageLayout& inLayout,
+		const VkPipelineStageFlags& inDstStages,
+		const VkAccessFlags& inDstAccess);
+
+	// The buffer is destroyed once everything recorded so far has completed on the GPU.
+	void DeferDestroy(const VkBuffer& inBuffer, const Allocation& inAllocation);
+
+	bool HasPendingWork() const;
+	bool HasDedicatedTransferQueue() const;
+
+	// Returns a ticket that completes once every upload recorded before the call is done.
+	bool Submit(std::uint64_t& outTicket);
+
+	// Submits the graphics side of batches whose transfer work has finished. Call once per frame.
+	bool Pump();
+
+	// The ticket that the uploads recorded so far will complete with.
+	std::uint64_t GetPendingTicket() const;
+
+	// Available: ordered before any graphics work submitted from now on. Complete: finished on the GPU.
+	bool IsAvailable(std::uint64_t inTicket) const;
+	bool IsComplete(std::uint64_t inTicket);
+	bool Wait(std::uint64_t inTicket);
+
+private:
+	enum BatchStates {
+		ERecording = 0,
+		ETransferSubmitted,
+		EGraphicsSubmitted
+	};
+
+	struct Batch {
+		VkCommandBuffer TransferCommandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer GraphicsCommandBuffer = VK_NULL_HANDLE;
+
+		VkSemaphore TransferSemaphore = VK_NULL_HANDLE;
+		VkFence TransferFence = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;
+
+		BatchStates State = BatchStates::ERecording;
+
+		std::uint64_t Ticket = 0;
+		std::uint64_t RingBegin = 0;
+		std::uint64_t RingEnd = 0;
+
+		std::vector<std::pair<VkBuffer, Allocation>> DeferredBuffers;
+	};
+
+	bool CreateBatch(std::unique_ptr<Batch>& outBatch);
+	void DestroyBatch(Batch& ioBatch);
+
+	bool BeginBatch();
+	bool SubmitGraphics(Batch& ioBatch);
+	bool PumpBatches(bool bWaitForOldest);
+	bool RetireBatches(bool bWaitForOldest);
+	void ReleaseDeferredBuffers(Batch& ioBatch);
+
+	std::uint64_t GetRingTail() const;
+	bool ReserveRing(VkDeviceSize inSize, VkDeviceSize inAlignment, VkDeviceSize& outOffset);
+	bool ReserveOversized(VkDeviceSize inSize, VkBuffer& outBuffer, VkDeviceSize& outOffset, void*& outMappedData);
+
+private:
+	bool bIsCleanedUp = true;
+
+	VkDevice mDevice = VK_NULL_HANDLE;
+	MemoryAllocator* mMemoryAllocator = nullptr;
+
+	VkQueue mGraphicsQueue = VK_NULL_HANDLE;
+	VkQueue mTransferQueue = VK_NULL_HANDLE;
+	std::uint32_t mGraphicsFamilyIndex = 0;
+	std::uint32_t mTransferFamilyIndex = 0;
+	bool bDedicatedTransfer = false;
+
+	VkCommandPool mGraphicsCommandPool = VK_NULL_HANDLE;
+	VkCommandPool mTransferCommandPool = VK_NULL_HANDLE;
+
+	VkBuffer mStagingBuffer = VK_NULL_HANDLE;
+	Allocation mStagingBufferAllocation;
+	VkDeviceSize mStagingSize = 0;
+
+	// Monotonic byte position; the physical offset is mRingHead % mStagingSize.
+	std::uint64_t mRingHead = 0;
+
+	std::unique_ptr<Batch> mRecordingBatch;
+	std::deque<std::unique_ptr<Batch>> mInFlightBatches;
+	std::vector<std::unique_ptr<Batch>> mFreeBatches;
+
+	std::uint64_t mNextTicket = 1;
+	std::uint64_t mAvailableTicket = 0;
+	std::uint64_t mCompletedTicket = 0;
+};
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Common.h"
+#include "Hash.h"
+
+#include <cstring>
+#include <utility>
+
+// Size in bytes of the attribute formats vertex layouts may use; zero for the others.
+constexpr std::uint32_t GetAttributeFormatSize(VkFormat inFormat) {
+	switch (inFormat) {
+	case VK_FORMAT_R16G16_UNORM:
+	case VK_FORMAT_R16G16_SFLOAT:
+		return 4;
+	case VK_FORMAT_R16G16B16A16_SNORM:
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_R32G32_SFLOAT:
+		return 8;
+	case VK_FORMAT_R32G32B32_SFLOAT:
+		return 12;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+// One attribute of a vertex: the shader location, the format and the byte offset in the vertex.
+template <std::uint32_t Location, VkFormat Format, std::uint32_t Offset>
+struct VertexAttribute {
+	static constexpr std::uint32_t AttributeLocation = Location;
+	static constexpr VkFormat AttributeFormat = Format;
+	static constexpr std::uint32_t AttributeOffset = Offset;
+	static constexpr std::uint32_t AttributeSize = GetAttributeFormatSize(Format);
+
+	static_assert(AttributeSize != 0, "Unsupported vertex attribute format");
+};
+
+// A vertex type and the attributes fetched from it, declared once; the first attribute is the position.
+// Everything else is derived from the template arguments: the Vulkan binding and attribute descriptions,
+// the hash and equality used for welding, and the position-only stream of depth-only passes. Welding
+// looks at the attribute bytes alone, so padding and members that are not fetched are ignored.
+template <typename VertexT, VkVertexInputRate InputRate, typename PositionT, typename... AttributeTs>
+struct VertexLayout {
+	using VertexType = VertexT;
+
+	static constexpr std::uint32_t Stride = sizeof(VertexT);
+	static constexpr std::uint32_t AttributeCount = 1 + sizeof...(AttributeTs);
+
+	// Bytes taken by the attributes, which are what welding hashes and compares.
+	static constexpr std::uint32_t KeySize = PositionT::AttributeSize + (AttributeTs::AttributeSize + ... + 0);
+
+	static_assert(
+		PositionT::AttributeOffset + PositionT::AttributeSize <= Stride &&
+		((AttributeTs::AttributeOffset + AttributeTs::AttributeSize <= Stride) && ...),
+		"Vertex attribute outside of the vertex");
+
+	static constexpr VkVertexInputBindingDescription GetBindingDescription(std::uint32_t inBinding) {
+		return { inBinding, Stride, InputRate };
+	}
+
+	static constexpr std::array<VkVertexInputAttributeDescription, AttributeCount> GetAttributeDescriptions(std::uint32_t inBinding) {
+		return { {
+			{ PositionT::AttributeLocation, inBinding, PositionT::AttributeFormat, PositionT::AttributeOffset },
+			{ AttributeTs::AttributeLocation, inBinding, AttributeTs::AttributeFormat, AttributeTs::AttributeOffset }...
+		} };
+	}
+
+	static std::uint64_t Hash(const VertexT& inVertex) {
+		// Gathered into one key, so the hash runs once over contiguous bytes.
+		const std::uint8_t* pBytes = reinterpret_cast<const std::uint8_t*>(&inVertex);
+
+		std::uint8_t key[KeySize];
+		std::memcpy(key, pBytes + PositionT::AttributeOffset, PositionT::AttributeSize);
+
+		std::uint32_t offset = PositionT::AttributeSize;
+		((std::memcpy(key + offset, pBytes + AttributeTs::AttributeOffset, AttributeTs::AttributeSize), offset += AttributeTs::AttributeSize), ...);
+
+		return HashBytes(key, KeySize);
+	}
+
+	static bool Equal(const VertexT& inLhs, const VertexT& inRhs) {
+		const std::uint8_t* pLhs = reinterpret_cast<const std::uint8_t*>(&inLhs);
+		const std::uint8_t* pRhs = reinterpret_cast<const std::uint8_t*>(&inRhs);
+
+		return std::memcmp(pLhs + PositionT::AttributeOffset, pRhs + PositionT::AttributeOffset, PositionT::AttributeSize) == 0 &&
+			((std::memcmp(pLhs + AttributeTs::AttributeOffset, pRhs + AttributeTs::AttributeOffset, AttributeTs::AttributeSize) == 0) && ...);
+	}
+
+	// The positions alone, tightly packed, at the same location as in the full layout.
+	struct PositionVertex {
+		std::uint8_t mBytes[PositionT::AttributeSize];
+	};
+	using PositionLayout = VertexLayout<
+		PositionVertex,
+		InputRate,
+		VertexAttribute<PositionT::AttributeLocation, PositionT::AttributeFormat, 0>>;
+
+	static void SplitPositions(const VertexT* pVertices, size_t inCount, PositionVertex* pOutPositions) {
+		for (size_t i = 0; i < inCount; ++i) {
+			std::memcpy(
+				pOutPositions[i].mBytes,
+				reinterpret_cast<const std::uint8_t*>(pVertices + i) + PositionT::AttributeOffset,
+				PositionT::AttributeSize);
+		}
+	}
+};
+
+// Vertex input state of a pipeline that binds the given layouts, in order from binding 0. The arrays are
+// filled from the layouts' template arguments, so a constexpr instance costs nothing at run time.
+template <typename... LayoutTs>
+struct VertexInputState {
+	std::array<VkVertexInputBindingDescription, sizeof...(LayoutTs)> Bindings = {};
+	std::array<VkVertexInputAttributeDescription, (LayoutTs::AttributeCount + ...)> Attributes = {};
+
+	constexpr VertexInputState() {
+		Fill(std::index_sequence_for<LayoutTs...>());
+	}
+
+	VkPipelineVertexInputStateCreateInfo GetCreateInfo() const {
+		VkPipelineVertexInputStateCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		createInfo.vertexBindingDescriptionCount = static_cast<std::uint32_t>(Bindings.size());
+		createInfo.pVertexBindingDescriptions = Bindings.data();
+		createInfo.vertexAttributeDescriptionCount = static_cast<std::uint32_t>(Attributes.size());
+		createInfo.pVertexAttributeDescriptions = Attributes.data();
+		return createInfo;
+	}
+
+private:
+	template <std::size_t... BindingIndices>
+	constexpr void Fill(std::index_sequence<BindingIndices...>) {
+		std::size_t attribute = 0;
+		(FillBinding<LayoutTs>(static_cast<std::uint32_t>(BindingIndices), attribute), ...);
+	}
+
+	template <typename LayoutT>
+	constexpr void FillBinding(std::uint32_t inBinding, std::size_t& ioAttribute) {
+		Bindings[inBinding] = LayoutT::GetBindingDescription(inBinding);
+
+		const auto attributes = LayoutT::GetAttributeDescriptions(inBinding);
+		for (std::size_t i = 0; i < attributes.size(); ++i) {
+			Attributes[ioAttribute++] = attributes[i];
+		}
+	}
+};
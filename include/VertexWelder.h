@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+// Merges vertices whose attributes are identical, as told by the Hash and Equal of their VertexLayout.
+// Vertices are kept in a flat, linearly probed table of indices into the caller's vertex array; each
+// lookup-or-insert is a single probe sequence.
+class VertexWelder {
+public:
+	VertexWelder() = default;
+	virtual ~VertexWelder() = default;
+
+private:
+	VertexWelder(const VertexWelder& inRef) = delete;
+	VertexWelder(VertexWelder&& inRVal) = delete;
+	VertexWelder& operator=(const VertexWelder& inRef) = delete;
+	VertexWelder& operator=(VertexWelder&& inRVal) = delete;
+
+public:
+	// Sizes the table for about inExpectedCount unique vertices.
+	void Reset(std::uint32_t inExpectedCount);
+
+	// pVertices holds the inUniqueCount unique vertices found so far. Returns the index of the one equal
+	// to inVertex, or inUniqueCount when there is none; the caller must then append inVertex to its
+	// vertices before the next call. All calls between two resets must use the same layout.
+	template <typename LayoutT>
+	std::uint32_t Weld(
+		const typename LayoutT::VertexType& inVertex,
+		const typename LayoutT::VertexType* pVertices,
+		std::uint32_t inUniqueCount);
+
+private:
+	void Grow();
+
+private:
+	static const std::uint32_t NullIndex = UINT32_MAX;
+
+	struct Slot {
+		std::uint32_t Hash;
+		std::uint32_t Index;
+	};
+
+	std::uint32_t mMask = 0;
+	std::uint32_t mCount = 0;
+
+	std::vector<Slot> mSlots;
+};
+
+template <typename LayoutT>
+std::uint32_t VertexWelder::Weld(
+		const typename LayoutT::VertexType& inVertex,
+		const typename LayoutT::VertexType* pVertices,
+		std::uint32_t inUniqueCount) {
+	if ((static_cast<size_t>(mCount) + 1) * 2 > mSlots.size()) Grow();
+
+	// The low bits pick the slot. All 32 are stored, to skip most comparisons and to place the entry
+	// again when the table grows.
+	std::uint32_t hash = static_cast<std::uint32_t>(LayoutT::Hash(inVertex));
+
+	for (std::uint32_t slot = hash & mMask;; slot = (slot + 1) & mMask) {
+		auto& entry = mSlots[slot];
+		if (entry.Index == NullIndex) {
+			entry.Hash = hash;
+			entry.Index = inUniqueCount;
+			++mCount;
+			return inUniqueCount;
+		}
+
+		if (entry.Hash == hash && LayoutT::Equal(pVertices[entry.Index], inVertex)) {
+			return entry.Index;
+		}
+	}
+}
+
+using VertexHashFunc = std::uint64_t(*)(const void* pVertex);
+using VertexEqualFunc = bool(*)(const void* pLhs, const void* pRhs);
+
+// Sort-based welding for very large meshes: the vertices are hashed and sorted by hash on inThreadPool,
+// and equal vertices are found among neighbours. outRemap maps every vertex to its unique index; the
+// unique vertices are numbered in order of first occurrence, as VertexWelder would. Returns their count.
+std::uint32_t WeldVerticesSorted(
+	const void* pVertices,
+	std::uint32_t inCount,
+	std::uint32_t inStride,
+	VertexHashFunc inHash,
+	VertexEqualFunc inEqual,
+	ThreadPool& inThreadPool,
+	std::vector<std::uint32_t>& outRemap);
+
+template <typename LayoutT>
+std::uint32_t WeldVerticesSorted(
+		const typename LayoutT::VertexType* pVertices,
+		std::uint32_t inCount,
+		ThreadPool& inThreadPool,
+		std::vector<std::uint32_t>& outRemap) {
+	using VertexT = typename LayoutT::VertexType;
+
+	return WeldVerticesSorted(
+		pVertices,
+		inCount,
+		LayoutT::Stride,
+		[](const void* pVertex) { return LayoutT::Hash(*static_cast<const VertexT*>(pVertex)); },
+		[](const void* pLhs, const void* pRhs) { return LayoutT::Equal(*static_cast<const VertexT*>(pLhs), *static_cast<const VertexT*>(pRhs)); },
+		inThreadPool,
+		outRemap);
+}
\ No newline at end of file
@@ -0,0 +1,305 @@
+// Command-line cooker: converts the OBJ and PNG files under a source directory into cooked meshes and
+// textures, and writes the manifest the renderer resolves source paths with.
+//
+//	AssetCooker <source directory> <cooked directory> [-j <thread count>] [-bc <compression>] [-pack [-lz4]]
+//
+// Sources are identified by the hash of their contents. A source whose cooked file already exists is
+// skipped, and sources with identical contents under different paths are cooked once. Cooked files no
+// manifest entry refers to any more are deleted.
+//
+// Textures are block-compressed as -bc says: auto, the default, picks BC1 for opaque textures and BC7
+// for the others; bc1, bc3 and bc7 force a format, and none keeps RGBA8. Cooking with another setting
+// gives every texture a new name.
+//
+// With -pack, every cooked file is also written to a pack archive in the cooked directory, under its
+// source path; -lz4 compresses the entries that get smaller. Without it, an earlier archive is deleted
+// so that it cannot shadow the manifest.
+
+#include "CookedAssets.h"
+#include "MappedFile.h"
+#include "PackArchive.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+	namespace fs = std::filesystem;
+
+	enum TextureCompressions {
+		ETextureCompressAuto = 0,
+		ETextureCompressNone,
+		ETextureCompressBc1,
+		ETextureCompressBc3,
+		ETextureCompressBc7,
+		ENumTextureCompressions
+	};
+
+	const char* const TextureCompressionNames[ENumTextureCompressions] = {"auto", "none", "bc1", "bc3", "bc7"};
+
+	struct CookSource {
+		CookedAssetKinds Kind = CookedAssetKinds::ENumCookedAssetKinds;
+		std::string FilePath;
+		std::string RelativePath;	// forward slashes, as the manifest stores it
+		std::string CookedName;		// empty when the source could not be read
+	};
+
+	struct CookJob {
+		const CookSource* pSource = nullptr;
+		bool bSucceeded = false;
+	};
+
+	bool IsInside(const fs::path& inPath, const fs::path& inDirectory) {
+		const fs::path relative = inPath.lexically_relative(inDirectory);
+		return !relative.empty() && *relative.begin() != "..";
+	}
+
+	void PrintUsage() {
+		std::cout << "Usage: AssetCooker <source directory> <cooked directory> [-j <thread count>] "
+			"[-bc <auto|none|bc1|bc3|bc7>] [-pack [-lz4]]" << std::endl;
+	}
+
+	// Meshes are cooked by one task each, so every job runs its own import inline. They are cooked with
+	// their texture coordinates unflipped and in full vertices; the renderer applies both at load.
+	bool CookMesh(const CookSource& inSource, const fs::path& inCookedDir) {
+		MeshImportOptions options;
+		options.bOverdrawOrdering = true;
+		options.bParallelWelding = false;
+
+		ThreadPool inlinePool;
+		Mesh mesh;
+		CheckReturn(ImportMesh(inSource.FilePath, options, inlinePool, mesh));
+		CheckReturn(WriteCookedMesh((inCookedDir / inSource.CookedName).string(), mesh));
+
+		return true;
+	}
+
+	// Textures are cooked one at a time, each encoded on the whole pool.
+	bool CookTexture(const CookSource& inSource, const fs::path& inCookedDir, TextureCompressions inCompression, ThreadPool& inThreadPool) {
+		TextureImport import;
+		CheckReturn(ImportTexture(inSource.FilePath, import));
+
+		TextureFormats format = TextureFormats::ETextureRgba8;
+		switch (inCompression) {
+		case ETextureCompressAuto:
+			format = IsTextureOpaque(import) ? TextureFormats::ETextureBc1 : TextureFormats::ETextureBc7;
+			break;
+		case ETextureCompressBc1:
+			format = TextureFormats::ETextureBc1;
+			break;
+		case ETextureCompressBc3:
+			format = TextureFormats::ETextureBc3;
+			break;
+		case ETextureCompressBc7:
+			format = TextureFormats::ETextureBc7;
+			break;
+		default:
+			break;
+		}
+
+		if (format != TextureFormats::ETextureRgba8) {
+			TextureImport compressed;
+			CheckReturn(CompressTexture(import, format, inThreadPool, compressed));
+			import = std::move(compressed);
+		}
+
+		CheckReturn(WriteCookedTexture((inCookedDir / inSource.CookedName).string(), import));
+
+		return true;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		PrintUsage();
+		return 1;
+	}
+
+	std::uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	TextureCompressions textureCompression = ETextureCompressAuto;
+	bool bPack = false;
+	bool bCompress = false;
+	for (int i = 3; i < argc; ++i) {
+		const std::string option = argv[i];
+		if (option == "-j" && i + 1 < argc) {
+			threadCount = static_cast<std::uint32_t>(std::max(std::atoi(argv[++i]), 1));
+		}
+		else if (option == "-bc" && i + 1 < argc) {
+			const std::string name = argv[++i];
+			const auto pName = std::find(std::begin(TextureCompressionNames), std::end(TextureCompressionNames), name);
+			if (pName == std::end(TextureCompressionNames)) {
+				PrintUsage();
+				return 1;
+			}
+			textureCompression = static_cast<TextureCompressions>(pName - std::begin(TextureCompressionNames));
+		}
+		else if (option == "-pack") {
+			bPack = true;
+		}
+		else if (option == "-lz4") {
+			bCompress = true;
+		}
+		else {
+			PrintUsage();
+			return 1;
+		}
+	}
+	if (bCompress && !bPack) {
+		PrintUsage();
+		return 1;
+	}
+
+	const fs::path sourceDir = fs::absolute(argv[1]).lexically_normal();
+	const fs::path cookedDir = fs::absolute(argv[2]).lexically_normal();
+
+	std::error_code error;
+	if (!fs::is_directory(sourceDir, error)) {
+		std::cerr << "Not a directory: " << sourceDir.string() << std::endl;
+		return 1;
+	}
+	fs::create_directories(cookedDir, error);
+	if (error) {
+		std::cerr << "Failed to create " << cookedDir.string() << std::endl;
+		return 1;
+	}
+
+	auto beginTime = std::chrono::steady_clock::now();
+
+	// The cooked directory may live inside the source directory; its files are never sources.
+	std::vector<CookSource> sources;
+	for (const auto& entry : fs::recursive_directory_iterator(sourceDir, fs::directory_options::skip_permission_denied, error)) {
+		if (!entry.is_regular_file()) continue;
+
+		const fs::path& path = entry.path();
+		CookedAssetKinds kind = GetCookedAssetKind(path.extension().string());
+		if (kind == CookedAssetKinds::ENumCookedAssetKinds || IsInside(path, cookedDir)) continue;
+
+		CookSource source;
+		source.Kind = kind;
+		source.FilePath = path.string();
+		source.RelativePath = path.lexically_relative(sourceDir).generic_string();
+		sources.push_back(std::move(source));
+	}
+	if (error) {
+		std::cerr << "Failed to scan " << sourceDir.string() << std::endl;
+		return 1;
+	}
+
+	ThreadPool threadPool;
+	threadPool.Initialize(threadCount - 1);
+
+	// Hashing reads every source, so it runs in parallel as well.
+	const std::uint32_t sourceCount = static_cast<std::uint32_t>(sources.size());
+	threadPool.Run(sourceCount, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		auto& source = sources[inTaskIndex];
+
+		MappedFile file;
+		if (!file.Open(source.FilePath)) return;
+
+		const std::uint32_t variant = source.Kind == CookedAssetKinds::ECookedTexture ? textureCompression : 0;
+		source.CookedName = GetCookedFileName(source.Kind, variant, file.GetData(), static_cast<size_t>(file.GetSize()));
+	});
+
+	// One job per distinct content that has not been cooked yet.
+	std::vector<CookJob> jobs;
+	std::set<std::string> cookedNames;
+	std::uint32_t unreadableCount = 0;
+	std::uint32_t upToDateCount = 0;
+	std::uint32_t duplicateCount = 0;
+	for (const auto& source : sources) {
+		if (source.CookedName.empty()) {
+			++unreadableCount;
+			continue;
+		}
+
+		if (!cookedNames.insert(source.CookedName).second) {
+			++duplicateCount;
+			continue;
+		}
+
+		if (fs::exists(cookedDir / source.CookedName, error)) {
+			++upToDateCount;
+			continue;
+		}
+
+		CookJob job;
+		job.pSource = &source;
+		jobs.push_back(job);
+	}
+
+	threadPool.Run(static_cast<std::uint32_t>(jobs.size()), [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		auto& job = jobs[inTaskIndex];
+		if (job.pSource->Kind == CookedAssetKinds::ECookedMesh) job.bSucceeded = CookMesh(*job.pSource, cookedDir);
+	});
+	for (auto& job : jobs) {
+		if (job.pSource->Kind == CookedAssetKinds::ECookedTexture) {
+			job.bSucceeded = CookTexture(*job.pSource, cookedDir, textureCompression, threadPool);
+		}
+	}
+
+	std::uint32_t failedCount = unreadableCount;
+	for (const auto& job : jobs) {
+		if (job.bSucceeded) continue;
+
+		cookedNames.erase(job.pSource->CookedName);
+		std::cerr << "Failed to cook " << job.pSource->RelativePath << std::endl;
+		++failedCount;
+	}
+
+	CookedManifest manifest;
+	for (const auto& source : sources) {
+		if (cookedNames.count(source.CookedName) != 0) manifest[source.RelativePath] = source.CookedName;
+	}
+
+	if (!WriteCookedManifest((cookedDir / CookedManifestFileName).string(), manifest)) {
+		std::cerr << "Failed to write the manifest" << std::endl;
+		return 1;
+	}
+
+	// Packs are always written whole; entries of identical sources share their payload.
+	const fs::path packPath = cookedDir / CookedPackFileName;
+	if (bPack) {
+		std::vector<PackSource> packSources;
+		for (const auto& entry : manifest) {
+			PackSource source;
+			source.Name = entry.first;
+			source.FilePath = (cookedDir / entry.second).string();
+			packSources.push_back(std::move(source));
+		}
+
+		if (!WritePackArchive(packPath.string(), packSources, bCompress, threadPool)) {
+			std::cerr << "Failed to write the pack archive" << std::endl;
+			return 1;
+		}
+	}
+	else {
+		fs::remove(packPath, error);
+	}
+
+	threadPool.CleanUp();
+
+	// Outputs of sources that changed or were removed, and temporaries of interrupted cooks.
+	std::uint32_t staleCount = 0;
+	for (const auto& entry : fs::directory_iterator(cookedDir, error)) {
+		if (!entry.is_regular_file()) continue;
+
+		const fs::path& path = entry.path();
+		const std::string extension = path.extension().string();
+		if (extension != ".mesh" && extension != ".tex" && extension != ".tmp") continue;
+		if (cookedNames.count(path.filename().string()) != 0) continue;
+
+		std::error_code removeError;
+		if (fs::remove(path, removeError)) ++staleCount;
+	}
+
+	auto endTime = std::chrono::steady_clock::now();
+
+	std::cout << sources.size() << " sources, " << jobs.size() - (failedCount - unreadableCount) << " cooked, "
+		<< upToDateCount << " up to date, " << duplicateCount << " duplicates, " << failedCount << " failed, "
+		<< staleCount << " stale files removed in " << std::chrono::duration<double>(endTime - beginTime).count()
+		<< " s on " << threadCount << " threads" << std::endl;
+
+	return failedCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,344 @@
+#include "CookedAssets.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <type_traits>
+
+namespace {
+	const std::uint32_t CookedMeshMagic = 0x4853454D;		// "MESH"
+	const std::uint32_t CookedTextureMagic = 0x58455443;	// "CTEX"
+
+	const char* const CookedManifestHeader = "CookedAssets";
+
+	struct CookedMeshHeader {
+		std::uint32_t Magic;
+		std::uint32_t Version;
+
+		std::uint32_t VertexCount;
+		std::uint32_t IndexCount;
+		std::uint32_t LodCount;
+		std::uint32_t MeshletCount;
+		std::uint32_t IndexType;
+
+		glm::vec3 BoundsMin;
+		glm::vec3 BoundsMax;
+		glm::vec3 BoundsCenter;
+		float BoundsRadius;
+	};
+
+	struct CookedTextureHeader {
+		std::uint32_t Magic;
+		std::uint32_t Version;
+
+		std::uint32_t Width;
+		std::uint32_t Height;
+		std::uint32_t Format;
+		std::uint32_t Reserved;
+		std::uint64_t PixelSize;
+	};
+
+	// Texels right after the header can be copied to an image from where the header was staged, which
+	// takes an offset aligned to the size of a texel or block.
+	static_assert(sizeof(CookedTextureHeader) % 16 == 0, "Cooked texels stay aligned to the block size");
+
+	static_assert(std::is_trivially_copyable<Vertex>::value, "Cooked vertices are copied as bytes");
+	static_assert(std::is_trivially_copyable<MeshLod>::value, "Cooked levels of detail are copied as bytes");
+	static_assert(std::is_trivially_copyable<Meshlet>::value, "Cooked meshlets are copied as bytes");
+
+	bool WriteFileReplacing(const std::string& inFilePath, const std::function<void(std::ofstream&)>& inWrite) {
+		const std::string tempPath = inFilePath + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				std::wstringstream wsstream;
+				wsstream << L"Failed to create file: " << tempPath.c_str();
+				ReturnFalse(wsstream.str());
+			}
+
+			inWrite(file);
+
+			if (!file.good()) {
+				std::wstringstream wsstream;
+				wsstream << L"Failed to write file: " << tempPath.c_str();
+				ReturnFalse(wsstream.str());
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, inFilePath, error);
+		if (error) {
+			std::filesystem::remove(tempPath, error);
+
+			std::wstringstream wsstream;
+			wsstream << L"Failed to replace file: " << inFilePath.c_str();
+			ReturnFalse(wsstream.str());
+		}
+
+		return true;
+	}
+
+	template <typename T>
+	void WriteArray(std::ofstream& ioFile, const std::vector<T>& inArray) {
+		if (inArray.empty()) return;
+		ioFile.write(reinterpret_cast<const char*>(inArray.data()), static_cast<std::streamsize>(sizeof(T) * inArray.size()));
+	}
+
+	// Bounds-checked reads from a mapped file or pack entry.
+	class CookedReader {
+	public:
+		CookedReader(const std::uint8_t* pData, std::uint64_t inSize) : mpCursor(pData), mpEnd(pData + inSize) {}
+
+		template <typename T>
+		bool Read(T& outValue) {
+			if (static_cast<size_t>(mpEnd - mpCursor) < sizeof(T)) return false;
+			std::memcpy(&outValue, mpCursor, sizeof(T));
+			mpCursor += sizeof(T);
+			return true;
+		}
+
+		template <typename T>
+		bool ReadArray(std::uint64_t inCount, std::vector<T>& outArray) {
+			if (static_cast<std::uint64_t>(mpEnd - mpCursor) / sizeof(T) < inCount) return false;
+			outArray.resize(static_cast<size_t>(inCount));
+			if (inCount > 0) std::memcpy(outArray.data(), mpCursor, sizeof(T) * outArray.size());
+			mpCursor += sizeof(T) * outArray.size();
+			return true;
+		}
+
+		bool AtEnd() const {
+			return mpCursor == mpEnd;
+		}
+
+	private:
+		const std::uint8_t* mpCursor;
+		const std::uint8_t* mpEnd;
+	};
+
+	bool CookedFileError(const std::string& inFilePath) {
+		std::wstringstream wsstream;
+		wsstream << L"Invalid or outdated cooked file: " << inFilePath.c_str();
+		ReturnFalse(wsstream.str());
+	}
+
+	bool ParseCookedMesh(const std::uint8_t* pData, std::uint64_t inSize, const std::string& inName, Mesh& outMesh) {
+		CookedReader reader(pData, inSize);
+
+		CookedMeshHeader header;
+		if (!reader.Read(header) || header.Magic != CookedMeshMagic || header.Version != CookedAssetVersion) {
+			return CookedFileError(inName);
+		}
+
+		if (!reader.ReadArray(header.VertexCount, outMesh.Vertices) ||
+				!reader.ReadArray(header.IndexCount, outMesh.Indices) ||
+				!reader.ReadArray(header.LodCount, outMesh.Lods) ||
+				!reader.ReadArray(header.MeshletCount, outMesh.Meshlets) ||
+				!reader.AtEnd()) {
+			return CookedFileError(inName);
+		}
+
+		// Everything below ends up in index and indirect reads on the GPU, so a stale or corrupt file is
+		// rejected here and the source imported instead.
+		const bool bShortIndices = header.IndexType == VK_INDEX_TYPE_UINT16;
+		if ((!bShortIndices && header.IndexType != VK_INDEX_TYPE_UINT32) ||
+				(bShortIndices && header.VertexCount > static_cast<std::uint32_t>(UINT16_MAX) + 1)) {
+			return CookedFileError(inName);
+		}
+
+		for (std::uint32_t index : outMesh.Indices) {
+			if (index >= header.VertexCount) return CookedFileError(inName);
+		}
+
+		for (const auto& lod : outMesh.Lods) {
+			if (static_cast<std::uint64_t>(lod.FirstIndex) + lod.IndexCount > header.IndexCount) return CookedFileError(inName);
+		}
+
+		for (const auto& meshlet : outMesh.Meshlets) {
+			if (static_cast<std::uint64_t>(meshlet.FirstIndex) + static_cast<std::uint64_t>(meshlet.TriangleCount) * 3 > header.IndexCount) {
+				return CookedFileError(inName);
+			}
+		}
+
+		outMesh.IndexType = static_cast<VkIndexType>(header.IndexType);
+		outMesh.BoundsMin = header.BoundsMin;
+		outMesh.BoundsMax = header.BoundsMax;
+		outMesh.BoundsCenter = header.BoundsCenter;
+		outMesh.BoundsRadius = header.BoundsRadius;
+
+		BuildMeshletBounds(outMesh);
+
+		return true;
+	}
+
+	bool ParseCookedTextureHeader(const CookedTextureHeader& inHeader, std::uint64_t inSize, const std::string& inName, TextureImport& outImport) {
+		if (inHeader.Magic != CookedTextureMagic || inHeader.Version != CookedAssetVersion || inHeader.Width == 0 || inHeader.Height == 0 ||
+				inHeader.Format >= TextureFormats::ENumTextureFormats) {
+			return CookedFileError(inName);
+		}
+
+		// The layout of the levels follows from the size and format alone.
+		outImport.Width = inHeader.Width;
+		outImport.Height = inHeader.Height;
+		outImport.Format = static_cast<TextureFormats>(inHeader.Format);
+		const size_t pixelSize = LayoutTextureMips(inHeader.Width, inHeader.Height, outImport.Format, outImport.Mips);
+		if (inHeader.PixelSize != pixelSize || inSize != sizeof(inHeader) + pixelSize) {
+			return CookedFileError(inName);
+		}
+
+		return true;
+	}
+}
+
+CookedAssetKinds GetCookedAssetKind(const std::string& inExtension) {
+	std::string extension = inExtension;
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+		return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	});
+
+	if (extension == ".obj") return CookedAssetKinds::ECookedMesh;
+	if (extension == ".png") return CookedAssetKinds::ECookedTexture;
+	return CookedAssetKinds::ENumCookedAssetKinds;
+}
+
+std::string GetCookedFileName(CookedAssetKinds inKind, std::uint32_t inVariant, const void* pSourceData, size_t inSourceSize) {
+	// The version, the kind and the variant seed the hash, so a new cooker version or other options never
+	// match an old file.
+	const std::uint64_t kindSeed = static_cast<std::uint64_t>(CookedAssetVersion) * CookedAssetKinds::ENumCookedAssetKinds + inKind;
+	const std::uint64_t seed = (kindSeed << 32) | inVariant;
+	const std::uint64_t hash = HashBytes(pSourceData, inSourceSize, seed);
+
+	std::stringstream sstream;
+	sstream << std::hex;
+	sstream.width(16);
+	sstream.fill('0');
+	sstream << hash << (inKind == CookedAssetKinds::ECookedMesh ? ".mesh" : ".tex");
+	return sstream.str();
+}
+
+bool WriteCookedMesh(const std::string& inFilePath, const Mesh& inMesh) {
+	CookedMeshHeader header = {};
+	header.Magic = CookedMeshMagic;
+	header.Version = CookedAssetVersion;
+	header.VertexCount = static_cast<std::uint32_t>(inMesh.Vertices.size());
+	header.IndexCount = static_cast<std::uint32_t>(inMesh.Indices.size());
+	header.LodCount = static_cast<std::uint32_t>(inMesh.Lods.size());
+	header.MeshletCount = static_cast<std::uint32_t>(inMesh.Meshlets.size());
+	header.IndexType = static_cast<std::uint32_t>(inMesh.IndexType);
+	header.BoundsMin = inMesh.BoundsMin;
+	header.BoundsMax = inMesh.BoundsMax;
+	header.BoundsCenter = inMesh.BoundsCenter;
+	header.BoundsRadius = inMesh.BoundsRadius;
+
+	return WriteFileReplacing(inFilePath, [&](std::ofstream& ioFile) {
+		ioFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WriteArray(ioFile, inMesh.Vertices);
+		WriteArray(ioFile, inMesh.Indices);
+		WriteArray(ioFile, inMesh.Lods);
+		WriteArray(ioFile, inMesh.Meshlets);
+	});
+}
+
+bool WriteCookedTexture(const std::string& inFilePath, const TextureImport& inImport) {
+	CookedTextureHeader header = {};
+	header.Magic = CookedTextureMagic;
+	header.Version = CookedAssetVersion;
+	header.Width = inImport.Width;
+	header.Height = inImport.Height;
+	header.Format = static_cast<std::uint32_t>(inImport.Format);
+	header.PixelSize = inImport.Pixels.size();
+
+	return WriteFileReplacing(inFilePath, [&](std::ofstream& ioFile) {
+		ioFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WriteArray(ioFile, inImport.Pixels);
+	});
+}
+
+bool WriteCookedManifest(const std::string& inFilePath, const CookedManifest& inManifest) {
+	return WriteFileReplacing(inFilePath, [&](std::ofstream& ioFile) {
+		ioFile << CookedManifestHeader << ' ' << CookedAssetVersion << '\n';
+		for (const auto& entry : inManifest) {
+			ioFile << entry.second << '\t' << entry.first << '\n';
+		}
+	});
+}
+
+bool ReadCookedMesh(const std::string& inFilePath, Mesh& outMesh) {
+	MappedFile file;
+	CheckReturn(file.Open(inFilePath));
+
+	return ParseCookedMesh(file.GetData(), file.GetSize(), inFilePath, outMesh);
+}
+
+bool ReadCookedMesh(const PackEntry& inEntry, const std::string& inName, Mesh& outMesh) {
+	if (inEntry.Compression == PackCompressions::EPackUncompressed) {
+		return ParseCookedMesh(inEntry.pData, inEntry.Size, inName, outMesh);
+	}
+
+	std::vector<std::uint8_t> data(static_cast<size_t>(inEntry.Size));
+	CheckReturn(ReadPackEntry(inEntry, data.data(), inEntry.Size));
+
+	return ParseCookedMesh(data.data(), inEntry.Size, inName, outMesh);
+}
+
+bool ReadCookedTexture(const std::string& inFilePath, TextureImport& outImport) {
+	MappedFile file;
+	CheckReturn(file.Open(inFilePath));
+
+	CookedTextureHeader header;
+	CookedReader reader(file.GetData(), file.GetSize());
+	if (!reader.Read(header)) return CookedFileError(inFilePath);
+
+	CheckReturn(ParseCookedTextureHeader(header, file.GetSize(), inFilePath, outImport));
+
+	if (!reader.ReadArray(header.PixelSize, outImport.Pixels)) return CookedFileError(inFilePath);
+
+	return true;
+}
+
+bool ReadCookedTexture(const PackEntry& inEntry, const std::string& inName, TextureImport& outImport) {
+	// Only the header is decoded; the texels stay in the archive until they are staged.
+	CookedTextureHeader header;
+	if (inEntry.Size < sizeof(header)) return CookedFileError(inName);
+	CheckReturn(ReadPackEntry(inEntry, &header, sizeof(header)));
+
+	CheckReturn(ParseCookedTextureHeader(header, inEntry.Size, inName, outImport));
+
+	// The texels are staged on the render thread, which should not wait for them to be paged in.
+	PrefetchPackEntry(inEntry);
+
+	outImport.Pixels.clear();
+	outImport.PackedEntry = inEntry;
+	outImport.PackedPixelOffset = sizeof(header);
+
+	return true;
+}
+
+bool ReadCookedManifest(const std::string& inFilePath, CookedManifest& outManifest) {
+	std::ifstream file(inFilePath);
+	if (!file.is_open()) {
+		std::wstringstream wsstream;
+		wsstream << L"Failed to open cooked asset manifest: " << inFilePath.c_str();
+		ReturnFalse(wsstream.str());
+	}
+
+	std::string header;
+	std::uint32_t version = 0;
+	if (!(file >> header >> version) || header != CookedManifestHeader || version != CookedAssetVersion) {
+		return CookedFileError(inFilePath);
+	}
+
+	outManifest.clear();
+
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t tab = line.find('\t');
+		if (tab == std::string::npos) continue;
+
+		outManifest[line.substr(tab + 1)] = line.substr(0, tab);
+	}
+
+	return true;
+}
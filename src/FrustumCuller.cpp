@@ -0,0 +1,172 @@
+#include "FrustumCuller.h"
+
+#include <immintrin.h>
+#include <intrin.h>
+
+void FrustumCuller::Clear() {
+	mCenterX.clear();
+	mCenterY.clear();
+	mCenterZ.clear();
+	mRadius.clear();
+	mExtentX.clear();
+	mExtentY.clear();
+	mExtentZ.clear();
+}
+
+void FrustumCuller::Reserve(std::uint32_t inCount) {
+	mCenterX.reserve(inCount);
+	mCenterY.reserve(inCount);
+	mCenterZ.reserve(inCount);
+	mRadius.reserve(inCount);
+	mExtentX.reserve(inCount);
+	mExtentY.reserve(inCount);
+	mExtentZ.reserve(inCount);
+}
+
+std::uint32_t FrustumCuller::Add(const glm::vec3& inCenter, float inRadius, const glm::vec3& inExtents) {
+	mCenterX.push_back(inCenter.x);
+	mCenterY.push_back(inCenter.y);
+	mCenterZ.push_back(inCenter.z);
+	mRadius.push_back(inRadius);
+	mExtentX.push_back(inExtents.x);
+	mExtentY.push_back(inExtents.y);
+	mExtentZ.push_back(inExtents.z);
+
+	return static_cast<std::uint32_t>(mRadius.size() - 1);
+}
+
+void FrustumCuller::Set(std::uint32_t inIndex, const glm::vec3& inCenter, float inRadius, const glm::vec3& inExtents) {
+	mCenterX[inIndex] = inCenter.x;
+	mCenterY[inIndex] = inCenter.y;
+	mCenterZ[inIndex] = inCenter.z;
+	mRadius[inIndex] = inRadius;
+	mExtentX[inIndex] = inExtents.x;
+	mExtentY[inIndex] = inExtents.y;
+	mExtentZ[inIndex] = inExtents.z;
+}
+
+void FrustumCuller::Get(std::uint32_t inIndex, glm::vec3& outCenter, float& outRadius, glm::vec3& outExtents) const {
+	outCenter = glm::vec3(mCenterX[inIndex], mCenterY[inIndex], mCenterZ[inIndex]);
+	outRadius = mRadius[inIndex];
+	outExtents = glm::vec3(mExtentX[inIndex], mExtentY[inIndex], mExtentZ[inIndex]);
+}
+
+void FrustumCuller::Remove(std::uint32_t inIndex) {
+	mCenterX[inIndex] = mCenterX.back();
+	mCenterY[inIndex] = mCenterY.back();
+	mCenterZ[inIndex] = mCenterZ.back();
+	mRadius[inIndex] = mRadius.back();
+	mExtentX[inIndex] = mExtentX.back();
+	mExtentY[inIndex] = mExtentY.back();
+	mExtentZ[inIndex] = mExtentZ.back();
+
+	mCenterX.pop_back();
+	mCenterY.pop_back();
+	mCenterZ.pop_back();
+	mRadius.pop_back();
+	mExtentX.pop_back();
+	mExtentY.pop_back();
+	mExtentZ.pop_back();
+}
+
+std::uint32_t FrustumCuller::GetCount() const {
+	return static_cast<std::uint32_t>(mRadius.size());
+}
+
+bool FrustumCuller::IsAvx2Supported() {
+	static const bool bSupported = []() {
+		int info[4] = {};
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+
+		// The OS has to save the YMM registers too, or AVX instructions fault.
+		__cpuid(info, 1);
+		const int osxsave = 1 << 27;
+		const int avx = 1 << 28;
+		if ((info[2] & (osxsave | avx)) != (osxsave | avx)) return false;
+		if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+		__cpuidex(info, 7, 0);
+		const int avx2 = 1 << 5;
+		return (info[1] & avx2) != 0;
+	}();
+
+	return bSupported;
+}
+
+void FrustumCuller::Cull(const std::array<glm::vec4, 6>& inPlanes, bool bSimd, std::vector<std::uint32_t>& outVisible) const {
+	outVisible.resize(GetCount());
+
+	std::uint32_t visibleCount = 0;
+	std::uint32_t begin = bSimd ? CullSimd(inPlanes, outVisible.data(), visibleCount) : 0;
+	CullScalar(inPlanes, begin, outVisible.data(), visibleCount);
+
+	outVisible.resize(visibleCount);
+}
+
+// Returns the number of objects processed; the remainder is left to CullScalar.
+std::uint32_t FrustumCuller::CullSimd(const std::array<glm::vec4, 6>& inPlanes, std::uint32_t* pOutVisible, std::uint32_t& ioVisibleCount) const {
+	if (IsAvx2Supported()) return CullAvx2(inPlanes, pOutVisible, ioVisibleCount);
+
+	std::uint32_t count = GetCount();
+	std::uint32_t visibleCount = ioVisibleCount;
+
+	const std::uint32_t LaneCount = 4;
+	std::uint32_t end = count & ~(LaneCount - 1);
+
+	const __m128 zero = _mm_setzero_ps();
+
+	for (std::uint32_t i = 0; i < end; i += LaneCount) {
+		__m128 centerX = _mm_loadu_ps(&mCenterX[i]);
+		__m128 centerY = _mm_loadu_ps(&mCenterY[i]);
+		__m128 centerZ = _mm_loadu_ps(&mCenterZ[i]);
+		__m128 radius = _mm_loadu_ps(&mRadius[i]);
+		__m128 extentX = _mm_loadu_ps(&mExtentX[i]);
+		__m128 extentY = _mm_loadu_ps(&mExtentY[i]);
+		__m128 extentZ = _mm_loadu_ps(&mExtentZ[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const auto& plane : inPlanes) {
+			__m128 dist = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_mul_ps(centerY, _mm_set1_ps(plane.y))),
+				_mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+			__m128 reach = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(extentX, _mm_set1_ps(std::abs(plane.x))), _mm_mul_ps(extentY, _mm_set1_ps(std::abs(plane.y)))),
+				_mm_mul_ps(extentZ, _mm_set1_ps(std::abs(plane.z))));
+
+			__m128 test = _mm_add_ps(dist, _mm_min_ps(radius, reach));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(test, zero));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (std::uint32_t lane = 0; lane < LaneCount; ++lane) {
+			pOutVisible[visibleCount] = i + lane;
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+
+	ioVisibleCount = visibleCount;
+
+	return end;
+}
+
+void FrustumCuller::CullScalar(
+		const std::array<glm::vec4, 6>& inPlanes, 
+		std::uint32_t inBegin, 
+		std::uint32_t* pOutVisible, 
+		std::uint32_t& ioVisibleCount) const {
+	for (std::uint32_t i = inBegin, end = GetCount(); i < end; ++i) {
+		bool bInside = true;
+		for (const auto& plane : inPlanes) {
+			float dist = mCenterX[i] * plane.x + mCenterY[i] * plane.y + mCenterZ[i] * plane.z + plane.w;
+			float reach = mExtentX[i] * std::abs(plane.x) + mExtentY[i] * std::abs(plane.y) + mExtentZ[i] * std::abs(plane.z);
+
+			if (dist + std::min(mRadius[i], reach) < 0.0f) {
+				bInside = false;
+				break;
+			}
+		}
+
+		if (bInside) pOutVisible[ioVisibleCount++] = i;
+	}
+}
\ No newline at end of file
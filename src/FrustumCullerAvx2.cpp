@@ -0,0 +1,48 @@
+#include "FrustumCuller.h"
+
+#include <immintrin.h>
+
+// Only called once IsAvx2Supported() has returned true. Returns the number of objects processed; the
+// remainder is left to CullScalar.
+std::uint32_t FrustumCuller::CullAvx2(const std::array<glm::vec4, 6>& inPlanes, std::uint32_t* pOutVisible, std::uint32_t& ioVisibleCount) const {
+	std::uint32_t count = GetCount();
+	std::uint32_t visibleCount = ioVisibleCount;
+
+	const std::uint32_t LaneCount = 8;
+	std::uint32_t end = count & ~(LaneCount - 1);
+
+	const __m256 zero = _mm256_setzero_ps();
+
+	for (std::uint32_t i = 0; i < end; i += LaneCount) {
+		__m256 centerX = _mm256_loadu_ps(&mCenterX[i]);
+		__m256 centerY = _mm256_loadu_ps(&mCenterY[i]);
+		__m256 centerZ = _mm256_loadu_ps(&mCenterZ[i]);
+		__m256 radius = _mm256_loadu_ps(&mRadius[i]);
+		__m256 extentX = _mm256_loadu_ps(&mExtentX[i]);
+		__m256 extentY = _mm256_loadu_ps(&mExtentY[i]);
+		__m256 extentZ = _mm256_loadu_ps(&mExtentZ[i]);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const auto& plane : inPlanes) {
+			__m256 dist = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)), _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y))),
+				_mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+			__m256 reach = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(extentX, _mm256_set1_ps(std::abs(plane.x))), _mm256_mul_ps(extentY, _mm256_set1_ps(std::abs(plane.y)))),
+				_mm256_mul_ps(extentZ, _mm256_set1_ps(std::abs(plane.z))));
+
+			__m256 test = _mm256_add_ps(dist, _mm256_min_ps(radius, reach));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(test, zero, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		for (std::uint32_t lane = 0; lane < LaneCount; ++lane) {
+			pOutVisible[visibleCount] = i + lane;
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+
+	ioVisibleCount = visibleCount;
+
+	return end;
+}
\ No newline at end of file
@@ -97,6 +97,8 @@ bool GameWorld::RunLoop() {
 }
 
 void GameWorld::CleanUp() {
+	if (mBenchmark.valid()) mBenchmark.wait();
+
 	mRenderer.CleanUp();
 
 	glfwDestroyWindow(mGLFWWindow);
@@ -112,6 +114,73 @@ void GameWorld::MsgProc(GLFWwindow* pWnd, int inKey, int inScanCode, int inActio
 			bQuit = true;
 		}
 		return;
+	case GLFW_KEY_F1:
+		if (inAction == GLFW_PRESS) {
+			mRenderer.LogRecordingStats();
+			mRenderer.SetParallelRecording(!mRenderer.IsParallelRecording());
+		}
+		return;
+	case GLFW_KEY_F2:
+		if (inAction == GLFW_PRESS) {
+			mRenderer.SetGpuDrivenRendering(!mRenderer.IsGpuDrivenRendering());
+		}
+		return;
+	case GLFW_KEY_F3:
+		if (inAction == GLFW_PRESS) {
+			mRenderer.LogCullingStats();
+			mRenderer.SetCullingMethod(static_cast<CullingMethods>((mRenderer.GetCullingMethod() + 1) % CullingMethods::ENumCullingMethods));
+		}
+		return;
+	case GLFW_KEY_F4:
+		if (inAction == GLFW_PRESS) {
+			RunBenchmark(&Renderer::LogSceneIndexScaling);
+		}
+		return;
+	case GLFW_KEY_F5:
+		if (inAction == GLFW_PRESS) {
+			mRenderer.LogOcclusionStats();
+			mRenderer.SetOcclusionCulling(!mRenderer.IsOcclusionCulling());
+		}
+		return;
+	case GLFW_KEY_F6:
+		if (inAction == GLFW_PRESS) {
+			mRenderer.LogPortalStats();
+			mRenderer.SetPortalCulling(!mRenderer.IsPortalCulling());
+		}
+		return;
+	case GLFW_KEY_F7:
+		if (inAction == GLFW_PRESS) {
+			mRenderer.LogLodStats();
+			mRenderer.SetLodSelection(!mRenderer.IsLodSelection());
+		}
+		return;
+	case GLFW_KEY_F8:
+		if (inAction == GLFW_PRESS) {
+			mRenderer.LogClusterStats();
+			mRenderer.SetClusterCulling(!mRenderer.IsClusterCulling());
+		}
+		return;
+	case GLFW_KEY_F9:
+		if (inAction == GLFW_PRESS) {
+			RunBenchmark(&Renderer::LogObjParsingBenchmark);
+		}
+		return;
+	case GLFW_KEY_F10:
+		if (inAction == GLFW_PRESS) {
+			RunBenchmark(&Renderer::LogAssetIoBenchmark);
+		}
+		return;
+	case GLFW_KEY_F11:
+		if (inAction == GLFW_PRESS) {
+			RunBenchmark(&Renderer::LogTextureCompressionBenchmark);
+		}
+		return;
+	case GLFW_KEY_F12:
+		if (inAction == GLFW_PRESS) {
+			mRenderer.LogTextureStreamingStats();
+			mRenderer.SetTextureStreaming(!mRenderer.IsTextureStreaming());
+		}
+		return;
 	default:
 		return;
 	}
@@ -160,19 +229,94 @@ bool GameWorld::InitMainWnd() {
 }
 
 bool GameWorld::OnLoadingData() {
-	CheckReturn(mRenderer.AddModel("./../../../../Assets/Models/plane.obj", "./../../../../Assets/Textures/slaataker1.png", "slaataker1", RenderTypes::EBlend));
-	CheckReturn(mRenderer.AddModel("./../../../../Assets/Models/plane.obj", "./../../../../Assets/Textures/slaataker2.png", "slaataker2", RenderTypes::EBlend));
-	CheckReturn(mRenderer.AddModel("./../../../../Assets/Models/plane.obj", "./../../../../Assets/Textures/slaataker3.png", "slaataker3", RenderTypes::EBlend));
-	CheckReturn(mRenderer.AddModel("./../../../../Assets/Models/viking_room.obj", "./../../../../Assets/Textures/viking_room.png", "viking1", RenderTypes::EOpaque, true));
-	CheckReturn(mRenderer.AddModel("./../../../../Assets/Models/viking_room.obj", "./../../../../Assets/Textures/viking_room.png", "viking2", RenderTypes::EOpaque, true));
-	CheckReturn(mRenderer.AddModel("./../../../../Assets/Models/viking_room.obj", "./../../../../Assets/Textures/viking_room.png", "viking3", RenderTypes::EOpaque, true));
-	CheckReturn(mRenderer.AddModel("./../../../../Assets/Models/viking_room.obj", "./../../../../Assets/Textures/viking_room.png", "viking4", RenderTypes::EOpaque, true));
+	// Cooked by AssetCooker, into a pack or loose files; without them, every asset is imported from its source.
+	if (!mRenderer.OpenAssetPack("./../../../../Assets", "./../../../../Assets/Cooked/Assets.pack") &&
+			!mRenderer.SetCookedAssets("./../../../../Assets", "./../../../../Assets/Cooked")) {
+		WLogln(L"No cooked assets; importing the sources");
+	}
+
+	auto correctQuat = glm::angleAxis(glm::radians(-90.0f), RightVector);
+
+	// Models stream in while the loop runs; UpdateLoadingModels() finishes their setup as they arrive.
+	auto addModel = [&](
+			const std::string& inFilePath,
+			const std::string& inTexFilePath,
+			const std::string& inName,
+			RenderTypes inType,
+			bool bFlipped,
+			bool bOccluder,
+			glm::vec3 inScale,
+			glm::fquat inQuat,
+			glm::vec3 inPos) {
+		PendingModel model;
+		model.Name = inName;
+		model.Type = inType;
+		model.bOccluder = bOccluder;
+		model.Loaded = mRenderer.AddModelAsync(inFilePath, inTexFilePath, inName, inType, bFlipped, inScale, inQuat, inPos);
+		mPendingModels.push_back(model);
+	};
+
+	addModel("./../../../../Assets/Models/plane.obj", "./../../../../Assets/Textures/slaataker1.png", "slaataker1", RenderTypes::EBlend, false, false,
+		glm::vec3(1.0f), correctQuat, glm::vec3(0.0f, 1.9f, -3.0f));
+	addModel("./../../../../Assets/Models/plane.obj", "./../../../../Assets/Textures/slaataker2.png", "slaataker2", RenderTypes::EBlend, false, false,
+		glm::vec3(1.0f), correctQuat, glm::vec3(3.0f, 1.0f, -0.5f));
+	addModel("./../../../../Assets/Models/plane.obj", "./../../../../Assets/Textures/slaataker3.png", "slaataker3", RenderTypes::EBlend, false, false,
+		glm::vec3(1.0f), correctQuat, glm::vec3(1.3f, 1.6f, 2.0f));
+	addModel("./../../../../Assets/Models/viking_room.obj", "./../../../../Assets/Textures/viking_room.png", "viking1", RenderTypes::EOpaque, true, true,
+		glm::vec3(6.0f), correctQuat, glm::vec3(0.0f, 0.0f, 0.0f));
+	addModel("./../../../../Assets/Models/viking_room.obj", "./../../../../Assets/Textures/viking_room.png", "viking2", RenderTypes::EOpaque, true, true,
+		glm::vec3(6.0f), glm::angleAxis(glm::radians(-90.0f), UpVector) * correctQuat, glm::vec3(0.0f, 0.0f, -8.9f));
+	addModel("./../../../../Assets/Models/viking_room.obj", "./../../../../Assets/Textures/viking_room.png", "viking3", RenderTypes::EOpaque, true, true,
+		glm::vec3(6.0f), glm::angleAxis(glm::radians(90.0f), UpVector) * correctQuat, glm::vec3(8.9f, 0.0f, 0.0f));
+	addModel("./../../../../Assets/Models/viking_room.obj", "./../../../../Assets/Textures/viking_room.png", "viking4", RenderTypes::EOpaque, true, true,
+		glm::vec3(6.0f), glm::angleAxis(glm::radians(180.0f), UpVector) * correctQuat, glm::vec3(8.9f, 0.0f, -8.9f));
 
 	return true;
 }
 
-void GameWorld::OnUnloadingData() {
+bool GameWorld::UpdateLoadingModels() {
+	if (mPendingModels.empty()) return true;
+
+	for (auto iter = mPendingModels.begin(); iter != mPendingModels.end();) {
+		if (iter->Loaded.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++iter;
+			continue;
+		}
+
+		if (!iter->Loaded.get()) {
+			std::wstringstream wsstream;
+			wsstream << L"Failed to load " << iter->Name.c_str();
+			ReturnFalse(wsstream.str());
+		}
+
+		if (iter->bOccluder) CheckReturn(mRenderer.SetOccluder(iter->Name, iter->Type, true));
+
+		iter = mPendingModels.erase(iter);
+	}
 
+	if (mPendingModels.empty()) mRenderer.LogMemoryStats();
+
+	return true;
+}
+
+void GameWorld::RunBenchmark(void(*pBenchmark)()) {
+	// The benchmarks take seconds and only log, so they run beside the frame loop, one at a time.
+	if (mBenchmark.valid() && mBenchmark.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+		WLogln(L"A benchmark is still running");
+		return;
+	}
+
+	mBenchmark = std::async(std::launch::async, pBenchmark);
+}
+
+void GameWorld::OnUnloadingData() {
+	mRenderer.LogRecordingStats();
+	mRenderer.LogCullingStats();
+	mRenderer.LogOcclusionStats();
+	mRenderer.LogPortalStats();
+	mRenderer.LogLodStats();
+	mRenderer.LogClusterStats();
+	mRenderer.LogTextureStreamingStats();
 }
 
 bool GameWorld::GameLoop() {
@@ -246,6 +390,8 @@ bool GameWorld::Update(const GameTimer& gt) {
 	auto cameraTarget = mCameraPos + glm::rotateY(glm::rotateX(ForwardVector, glm::radians(mPitch * -1.0f)), glm::radians(mYaw));
 	mRenderer.UpdateCamera(mCameraPos, cameraTarget);
 
+	CheckReturn(UpdateLoadingModels());
+
 	auto correctQuat = glm::angleAxis(glm::radians(-90.0f), RightVector);
 
 	auto slaatakerPos1 = glm::vec3(0.0f, 1.9f, -3.0f);
@@ -0,0 +1,383 @@
+#include "GpuCuller.h"
+
+namespace {
+	const std::uint32_t CullPass = 0;
+	const std::uint32_t BuildDrawsPass = 1;
+
+	bool CreateStorageBuffer(
+			MemoryAllocator& inAllocator,
+			const VkDevice& inDevice,
+			VkDeviceSize inSize,
+			const VkBufferUsageFlags& inUsage,
+			const VkMemoryPropertyFlags& inProperties,
+			VkBuffer& outBuffer,
+			Allocation& outAllocation) {
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = inSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | inUsage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(inDevice, &bufferInfo, nullptr, &outBuffer) != VK_SUCCESS) {
+			ReturnFalse(L"Failed to create culling buffer");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(inDevice, outBuffer, &memRequirements);
+
+		if (!inAllocator.Allocate(memRequirements, inProperties, ResourceKinds::ELinearResource, false, outAllocation)) {
+			vkDestroyBuffer(inDevice, outBuffer, nullptr);
+			ReturnFalse(L"Failed to allocate culling buffer memory");
+		}
+
+		vkBindBufferMemory(inDevice, outBuffer, outAllocation.Memory, outAllocation.Offset);
+
+		return true;
+	}
+
+	void DestroyStorageBuffer(MemoryAllocator& inAllocator, const VkDevice& inDevice, VkBuffer& ioBuffer, Allocation& ioAllocation) {
+		if (ioBuffer == VK_NULL_HANDLE) return;
+
+		vkDestroyBuffer(inDevice, ioBuffer, nullptr);
+		inAllocator.Free(ioAllocation);
+
+		ioBuffer = VK_NULL_HANDLE;
+	}
+
+	std::uint32_t DivideRoundUp(std::uint32_t inValue, std::uint32_t inDivisor) {
+		return (inValue + inDivisor - 1) / inDivisor;
+	}
+}
+
+GpuCuller::~GpuCuller() {
+	if (!bIsCleanedUp) {
+		CleanUp();
+	}
+}
+
+bool GpuCuller::Initialize(
+		const VkDevice& inDevice,
+		MemoryAllocator* pAllocator,
+		const VkShaderModule& inCullShader,
+		std::uint32_t inFrameCount,
+		bool bCompactDraws) {
+	mDevice = inDevice;
+	mpAllocator = pAllocator;
+
+	// 0: objects, 1: batches, 2: counters, 3: draw commands, 4: instances
+	std::array<VkDescriptorSetLayoutBinding, 5> bindings = {};
+	for (std::uint32_t i = 0, end = static_cast<std::uint32_t>(bindings.size()); i < end; ++i) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[i].pImmutableSamplers = nullptr;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<std::uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mDescriptorSetLayout) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to create descriptor set layout");
+	}
+
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = static_cast<std::uint32_t>(bindings.size()) * inFrameCount;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = inFrameCount;
+
+	if (vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to create descriptor pool");
+	}
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &mDescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to create pipeline layout");
+	}
+
+	VkBool32 compactDraws = bCompactDraws ? VK_TRUE : VK_FALSE;
+
+	VkSpecializationMapEntry specializationEntry = {};
+	specializationEntry.constantID = 0;
+	specializationEntry.offset = 0;
+	specializationEntry.size = sizeof(VkBool32);
+
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = 1;
+	specializationInfo.pMapEntries = &specializationEntry;
+	specializationInfo.dataSize = sizeof(compactDraws);
+	specializationInfo.pData = &compactDraws;
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = inCullShader;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+	pipelineInfo.layout = mPipelineLayout;
+
+	if (vkCreateComputePipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mPipeline) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to create culling pipeline");
+	}
+
+	mFrames.resize(inFrameCount);
+	for (auto& frame : mFrames) {
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = mDescriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &mDescriptorSetLayout;
+
+		if (vkAllocateDescriptorSets(mDevice, &allocInfo, &frame.DescriptorSet) != VK_SUCCESS) {
+			ReturnFalse(L"Failed to allocate descriptor sets");
+		}
+
+		CheckReturn(CreateFrameBuffers(frame, 1024, 64));
+	}
+
+	bIsCleanedUp = false;
+
+	return true;
+}
+
+void GpuCuller::CleanUp() {
+	for (auto& frame : mFrames) {
+		DestroyFrameBuffers(frame);
+	}
+	mFrames.clear();
+
+	vkDestroyPipeline(mDevice, mPipeline, nullptr);
+	vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
+	vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayout, nullptr);
+
+	bIsCleanedUp = true;
+}
+
+bool GpuCuller::UpdateScene(
+		std::uint32_t inFrameIndex,
+		std::uint64_t inVersion,
+		const std::vector<GpuObject>& inObjects,
+		const std::vector<GpuBatch>& inBatches,
+		std::uint32_t inRunCount) {
+	auto& frame = mFrames[inFrameIndex];
+	if (frame.Version == inVersion) {
+		if (frame.DirtyBegin < frame.DirtyEnd) {
+			std::memcpy(
+				static_cast<GpuObject*>(frame.ObjectBufferAllocation.pMappedData) + frame.DirtyBegin,
+				inObjects.data() + frame.DirtyBegin,
+				sizeof(GpuObject) * (frame.DirtyEnd - frame.DirtyBegin));
+
+			frame.DirtyBegin = UINT32_MAX;
+			frame.DirtyEnd = 0;
+		}
+		return true;
+	}
+
+	std::uint32_t objectCount = static_cast<std::uint32_t>(inObjects.size());
+	std::uint32_t batchCount = static_cast<std::uint32_t>(inBatches.size());
+
+	if (objectCount > frame.ObjectCapacity || batchCount > frame.BatchCapacity) {
+		std::uint32_t objectCapacity = std::max(frame.ObjectCapacity, objectCount);
+		std::uint32_t batchCapacity = std::max(frame.BatchCapacity, batchCount);
+
+		DestroyFrameBuffers(frame);
+		CheckReturn(CreateFrameBuffers(frame, std::max(objectCapacity, frame.ObjectCapacity * 2), std::max(batchCapacity, frame.BatchCapacity * 2)));
+	}
+
+	if (objectCount > 0) std::memcpy(frame.ObjectBufferAllocation.pMappedData, inObjects.data(), sizeof(GpuObject) * objectCount);
+	if (batchCount > 0) std::memcpy(frame.BatchBufferAllocation.pMappedData, inBatches.data(), sizeof(GpuBatch) * batchCount);
+
+	frame.ObjectCount = objectCount;
+	frame.BatchCount = batchCount;
+	frame.RunCount = inRunCount;
+	frame.Version = inVersion;
+	frame.DirtyBegin = UINT32_MAX;
+	frame.DirtyEnd = 0;
+
+	return true;
+}
+
+void GpuCuller::MarkObjectDirty(std::uint32_t inIndex) {
+	for (auto& frame : mFrames) {
+		frame.DirtyBegin = std::min(frame.DirtyBegin, inIndex);
+		frame.DirtyEnd = std::max(frame.DirtyEnd, inIndex + 1);
+	}
+}
+
+void GpuCuller::RecordCulling(const VkCommandBuffer& inCommandBuffer, std::uint32_t inFrameIndex, const std::array<glm::vec4, 6>& inFrustumPlanes) {
+	const auto& frame = mFrames[inFrameIndex];
+	if (frame.BatchCount == 0) return;
+
+	// The draw counts of the runs are followed by the instance counts of the batches.
+	vkCmdFillBuffer(inCommandBuffer, frame.CounterBuffer, 0, sizeof(std::uint32_t) * (frame.RunCount + frame.BatchCount), 0);
+
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(
+		inCommandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	vkCmdBindPipeline(inCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+	vkCmdBindDescriptorSets(inCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &frame.DescriptorSet, 0, nullptr);
+
+	CullConstants constants = {};
+	for (size_t i = 0; i < 6; ++i) {
+		constants.mPlanes[i] = inFrustumPlanes[i];
+	}
+	constants.mObjectCount = frame.ObjectCount;
+	constants.mBatchCount = frame.BatchCount;
+	constants.mRunCount = frame.RunCount;
+	constants.mPass = CullPass;
+
+	vkCmdPushConstants(inCommandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(inCommandBuffer, DivideRoundUp(frame.ObjectCount, WorkGroupSize), 1, 1);
+
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(
+		inCommandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	constants.mPass = BuildDrawsPass;
+
+	vkCmdPushConstants(inCommandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(inCommandBuffer, DivideRoundUp(frame.BatchCount, WorkGroupSize), 1, 1);
+
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+	vkCmdPipelineBarrier(
+		inCommandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+}
+
+VkBuffer GpuCuller::GetInstanceBuffer(std::uint32_t inFrameIndex) const {
+	return mFrames[inFrameIndex].InstanceBuffer;
+}
+
+VkBuffer GpuCuller::GetDrawCommandBuffer(std::uint32_t inFrameIndex) const {
+	return mFrames[inFrameIndex].DrawCommandBuffer;
+}
+
+VkBuffer GpuCuller::GetDrawCountBuffer(std::uint32_t inFrameIndex) const {
+	return mFrames[inFrameIndex].CounterBuffer;
+}
+
+bool GpuCuller::CreateFrameBuffers(FrameResources& ioFrame, std::uint32_t inObjectCapacity, std::uint32_t inBatchCapacity) {
+	const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	CheckReturn(CreateStorageBuffer(
+		*mpAllocator, mDevice,
+		sizeof(GpuObject) * inObjectCapacity,
+		0,
+		hostVisible,
+		ioFrame.ObjectBuffer, ioFrame.ObjectBufferAllocation));
+	CheckReturn(CreateStorageBuffer(
+		*mpAllocator, mDevice,
+		sizeof(GpuBatch) * inBatchCapacity,
+		0,
+		hostVisible,
+		ioFrame.BatchBuffer, ioFrame.BatchBufferAllocation));
+
+	// Batch capacity also covers the runs, which never outnumber the batches.
+	CheckReturn(CreateStorageBuffer(
+		*mpAllocator, mDevice,
+		sizeof(std::uint32_t) * inBatchCapacity * 2,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		ioFrame.CounterBuffer, ioFrame.CounterBufferAllocation));
+	CheckReturn(CreateStorageBuffer(
+		*mpAllocator, mDevice,
+		sizeof(VkDrawIndexedIndirectCommand) * inBatchCapacity,
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		ioFrame.DrawCommandBuffer, ioFrame.DrawCommandBufferAllocation));
+	CheckReturn(CreateStorageBuffer(
+		*mpAllocator, mDevice,
+		sizeof(glm::mat4) * inObjectCapacity,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		ioFrame.InstanceBuffer, ioFrame.InstanceBufferAllocation));
+
+	ioFrame.ObjectCapacity = inObjectCapacity;
+	ioFrame.BatchCapacity = inBatchCapacity;
+
+	WriteDescriptorSet(ioFrame);
+
+	return true;
+}
+
+void GpuCuller::DestroyFrameBuffers(FrameResources& ioFrame) {
+	DestroyStorageBuffer(*mpAllocator, mDevice, ioFrame.InstanceBuffer, ioFrame.InstanceBufferAllocation);
+	DestroyStorageBuffer(*mpAllocator, mDevice, ioFrame.DrawCommandBuffer, ioFrame.DrawCommandBufferAllocation);
+	DestroyStorageBuffer(*mpAllocator, mDevice, ioFrame.CounterBuffer, ioFrame.CounterBufferAllocation);
+	DestroyStorageBuffer(*mpAllocator, mDevice, ioFrame.BatchBuffer, ioFrame.BatchBufferAllocation);
+	DestroyStorageBuffer(*mpAllocator, mDevice, ioFrame.ObjectBuffer, ioFrame.ObjectBufferAllocation);
+
+	ioFrame.ObjectCapacity = 0;
+	ioFrame.BatchCapacity = 0;
+}
+
+void GpuCuller::WriteDescriptorSet(const FrameResources& inFrame) {
+	std::array<VkDescriptorBufferInfo, 5> bufferInfos = {};
+	bufferInfos[0].buffer = inFrame.ObjectBuffer;
+	bufferInfos[1].buffer = inFrame.BatchBuffer;
+	bufferInfos[2].buffer = inFrame.CounterBuffer;
+	bufferInfos[3].buffer = inFrame.DrawCommandBuffer;
+	bufferInfos[4].buffer = inFrame.InstanceBuffer;
+
+	std::array<VkWriteDescriptorSet, 5> descriptorWrites = {};
+	for (std::uint32_t i = 0, end = static_cast<std::uint32_t>(descriptorWrites.size()); i < end; ++i) {
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = inFrame.DescriptorSet;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(mDevice, static_cast<std::uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "Hash.h"
+
+#include <cstring>
+
+namespace {
+	const std::uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+	const std::uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+	const std::uint64_t Prime3 = 0x165667B19E3779F9ull;
+	const std::uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+	const std::uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+	inline std::uint64_t Rotl(std::uint64_t inValue, int inShift) {
+		return (inValue << inShift) | (inValue >> (64 - inShift));
+	}
+
+	inline std::uint64_t Read64(const std::uint8_t* p) {
+		std::uint64_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline std::uint32_t Read32(const std::uint8_t* p) {
+		std::uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline std::uint64_t Round(std::uint64_t inAccumulator, std::uint64_t inInput) {
+		inAccumulator += inInput * Prime2;
+		inAccumulator = Rotl(inAccumulator, 31);
+		return inAccumulator * Prime1;
+	}
+
+	inline std::uint64_t MergeRound(std::uint64_t inAccumulator, std::uint64_t inValue) {
+		inAccumulator ^= Round(0, inValue);
+		return inAccumulator * Prime1 + Prime4;
+	}
+}
+
+std::uint64_t HashBytes(const void* pData, size_t inSize, std::uint64_t inSeed) {
+	const std::uint8_t* p = static_cast<const std::uint8_t*>(pData);
+	const std::uint8_t* pEnd = p + inSize;
+
+	std::uint64_t hash = 0;
+
+	if (inSize >= 32) {
+		// Four independent lanes over 32-byte stripes.
+		std::uint64_t v1 = inSeed + Prime1 + Prime2;
+		std::uint64_t v2 = inSeed + Prime2;
+		std::uint64_t v3 = inSeed;
+		std::uint64_t v4 = inSeed - Prime1;
+
+		const std::uint8_t* pLimit = pEnd - 32;
+		do {
+			v1 = Round(v1, Read64(p));
+			v2 = Round(v2, Read64(p + 8));
+			v3 = Round(v3, Read64(p + 16));
+			v4 = Round(v4, Read64(p + 24));
+			p += 32;
+		} while (p <= pLimit);
+
+		hash = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+		hash = MergeRound(hash, v1);
+		hash = MergeRound(hash, v2);
+		hash = MergeRound(hash, v3);
+		hash = MergeRound(hash, v4);
+	}
+	else {
+		hash = inSeed + Prime5;
+	}
+
+	hash += static_cast<std::uint64_t>(inSize);
+
+	for (; p + 8 <= pEnd; p += 8) {
+		hash ^= Round(0, Read64(p));
+		hash = Rotl(hash, 27) * Prime1 + Prime4;
+	}
+	if (p + 4 <= pEnd) {
+		hash ^= static_cast<std::uint64_t>(Read32(p)) * Prime1;
+		hash = Rotl(hash, 23) * Prime2 + Prime3;
+		p += 4;
+	}
+	for (; p < pEnd; ++p) {
+		hash ^= static_cast<std::uint64_t>(*p) * Prime5;
+		hash = Rotl(hash, 11) * Prime1;
+	}
+
+	// Avalanche.
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
\ No newline at end of file
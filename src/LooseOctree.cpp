@@ -0,0 +1,364 @@
+#include "LooseOctree.h"
+
+#include <queue>
+
+namespace {
+	float MaxComponent(const glm::vec3& inVec) {
+		return std::max(inVec.x, std::max(inVec.y, inVec.z));
+	}
+
+	std::uint32_t GetOctant(const glm::vec3& inCenter, const glm::vec3& inPoint) {
+		return (inPoint.x >= inCenter.x ? 1u : 0u) | (inPoint.y >= inCenter.y ? 2u : 0u) | (inPoint.z >= inCenter.z ? 4u : 0u);
+	}
+
+	float DistanceSqToBox(const glm::vec3& inPoint, const glm::vec3& inCenter, const glm::vec3& inExtents) {
+		glm::vec3 offset = glm::max(glm::abs(inPoint - inCenter) - inExtents, glm::vec3(0.0f));
+		return glm::dot(offset, offset);
+	}
+
+	bool Overlaps(const glm::vec3& inCenter, const glm::vec3& inExtents, const glm::vec3& inMin, const glm::vec3& inMax) {
+		glm::vec3 boxMin = inCenter - inExtents;
+		glm::vec3 boxMax = inCenter + inExtents;
+		return boxMin.x <= inMax.x && boxMax.x >= inMin.x &&
+			boxMin.y <= inMax.y && boxMax.y >= inMin.y &&
+			boxMin.z <= inMax.z && boxMax.z >= inMin.z;
+	}
+
+	enum FrustumTests {
+		EOutside = 0,
+		EIntersecting,
+		EInside
+	};
+
+	FrustumTests TestFrustum(const std::array<glm::vec4, 6>& inPlanes, const glm::vec3& inCenter, const glm::vec3& inExtents) {
+		FrustumTests result = FrustumTests::EInside;
+		for (const auto& plane : inPlanes) {
+			float dist = glm::dot(glm::vec3(plane), inCenter) + plane.w;
+			float reach = glm::dot(glm::abs(glm::vec3(plane)), inExtents);
+
+			if (dist + reach < 0.0f) return FrustumTests::EOutside;
+			if (dist - reach < 0.0f) result = FrustumTests::EIntersecting;
+		}
+		return result;
+	}
+}
+
+void LooseOctree::Clear() {
+	mNodes.clear();
+	mUnusedNodes.clear();
+	mRoot = NullIndex;
+
+	mObjects.clear();
+	mObjectCount = 0;
+}
+
+void LooseOctree::Insert(std::uint32_t inId, const glm::vec3& inCenter, const glm::vec3& inExtents) {
+	if (inId >= mObjects.size()) mObjects.resize(static_cast<size_t>(inId) + 1);
+
+	auto& object = mObjects[inId];
+	if (object.Node != NullIndex) Unlink(inId);
+	else ++mObjectCount;
+
+	object.Center = inCenter;
+	object.Extents = inExtents;
+
+	Link(inId);
+}
+
+void LooseOctree::Update(std::uint32_t inId, const glm::vec3& inCenter, const glm::vec3& inExtents) {
+	auto& object = mObjects[inId];
+	object.Center = inCenter;
+	object.Extents = inExtents;
+
+	// Most updates are small moves that stay within the same node.
+	if (FitsNode(mNodes[object.Node], object)) return;
+
+	Unlink(inId);
+	Link(inId);
+}
+
+void LooseOctree::Remove(std::uint32_t inId) {
+	if (!Contains(inId)) return;
+
+	Unlink(inId);
+	--mObjectCount;
+}
+
+bool LooseOctree::Contains(std::uint32_t inId) const {
+	return inId < mObjects.size() && mObjects[inId].Node != NullIndex;
+}
+
+std::uint32_t LooseOctree::GetObjectCount() const {
+	return mObjectCount;
+}
+
+std::uint32_t LooseOctree::GetNodeCount() const {
+	return static_cast<std::uint32_t>(mNodes.size() - mUnusedNodes.size());
+}
+
+void LooseOctree::QueryFrustum(const std::array<glm::vec4, 6>& inPlanes, std::vector<std::uint32_t>& outIds) const {
+	outIds.clear();
+	if (mRoot == NullIndex) return;
+
+	std::vector<std::uint32_t> stack;
+	stack.push_back(mRoot);
+
+	while (!stack.empty()) {
+		const auto& node = mNodes[stack.back()];
+		std::uint32_t nodeIndex = stack.back();
+		stack.pop_back();
+
+		FrustumTests test = TestFrustum(inPlanes, node.Center, glm::vec3(node.HalfSize * 2.0f));
+		if (test == FrustumTests::EOutside) continue;
+
+		// Everything below a node that is fully inside is visible without further tests.
+		if (test == FrustumTests::EInside) {
+			CollectSubtree(nodeIndex, outIds);
+			continue;
+		}
+
+		for (std::uint32_t id : node.Objects) {
+			const auto& object = mObjects[id];
+			if (TestFrustum(inPlanes, object.Center, object.Extents) != FrustumTests::EOutside) outIds.push_back(id);
+		}
+
+		for (std::uint32_t child : node.Children) {
+			if (child != NullIndex) stack.push_back(child);
+		}
+	}
+}
+
+void LooseOctree::QuerySphere(const glm::vec3& inCenter, float inRadius, std::vector<std::uint32_t>& outIds) const {
+	outIds.clear();
+	if (mRoot == NullIndex) return;
+
+	float radiusSq = inRadius * inRadius;
+
+	std::vector<std::uint32_t> stack;
+	stack.push_back(mRoot);
+
+	while (!stack.empty()) {
+		const auto& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (DistanceSqToBox(inCenter, node.Center, glm::vec3(node.HalfSize * 2.0f)) > radiusSq) continue;
+
+		for (std::uint32_t id : node.Objects) {
+			const auto& object = mObjects[id];
+			if (DistanceSqToBox(inCenter, object.Center, object.Extents) <= radiusSq) outIds.push_back(id);
+		}
+
+		for (std::uint32_t child : node.Children) {
+			if (child != NullIndex) stack.push_back(child);
+		}
+	}
+}
+
+void LooseOctree::QueryAabb(const glm::vec3& inMin, const glm::vec3& inMax, std::vector<std::uint32_t>& outIds) const {
+	outIds.clear();
+	if (mRoot == NullIndex) return;
+
+	std::vector<std::uint32_t> stack;
+	stack.push_back(mRoot);
+
+	while (!stack.empty()) {
+		const auto& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (!Overlaps(node.Center, glm::vec3(node.HalfSize * 2.0f), inMin, inMax)) continue;
+
+		for (std::uint32_t id : node.Objects) {
+			const auto& object = mObjects[id];
+			if (Overlaps(object.Center, object.Extents, inMin, inMax)) outIds.push_back(id);
+		}
+
+		for (std::uint32_t child : node.Children) {
+			if (child != NullIndex) stack.push_back(child);
+		}
+	}
+}
+
+void LooseOctree::QueryNearest(const glm::vec3& inPoint, std::uint32_t inCount, std::vector<std::uint32_t>& outIds) const {
+	outIds.clear();
+	if (mRoot == NullIndex || inCount == 0) return;
+
+	// Best-first search; a node's distance is a lower bound for everything below it, so objects
+	// come off the queue in order of distance.
+	struct Entry {
+		float DistanceSq;
+		std::uint32_t Index;
+		bool bNode;
+
+		bool operator>(const Entry& inOther) const { return DistanceSq > inOther.DistanceSq; }
+	};
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	queue.push({ 0.0f, mRoot, true });
+
+	while (!queue.empty() && outIds.size() < inCount) {
+		Entry entry = queue.top();
+		queue.pop();
+
+		if (!entry.bNode) {
+			outIds.push_back(entry.Index);
+			continue;
+		}
+
+		const auto& node = mNodes[entry.Index];
+		for (std::uint32_t id : node.Objects) {
+			const auto& object = mObjects[id];
+			queue.push({ DistanceSqToBox(inPoint, object.Center, object.Extents), id, false });
+		}
+
+		for (std::uint32_t child : node.Children) {
+			if (child == NullIndex) continue;
+
+			const auto& childNode = mNodes[child];
+			queue.push({ DistanceSqToBox(inPoint, childNode.Center, glm::vec3(childNode.HalfSize * 2.0f)), child, true });
+		}
+	}
+}
+
+std::uint32_t LooseOctree::NewNode(const glm::vec3& inCenter, float inHalfSize, std::uint32_t inParent) {
+	std::uint32_t index;
+	if (mUnusedNodes.empty()) {
+		index = static_cast<std::uint32_t>(mNodes.size());
+		mNodes.emplace_back();
+	}
+	else {
+		index = mUnusedNodes.back();
+		mUnusedNodes.pop_back();
+	}
+
+	auto& node = mNodes[index];
+	node.Center = inCenter;
+	node.HalfSize = inHalfSize;
+	node.Parent = inParent;
+	for (auto& child : node.Children) {
+		child = NullIndex;
+	}
+	node.SubtreeCount = 0;
+	node.Objects.clear();
+
+	return index;
+}
+
+void LooseOctree::ReleaseNode(std::uint32_t inIndex) {
+	mUnusedNodes.push_back(inIndex);
+}
+
+bool LooseOctree::FitsNode(const Node& inNode, const Object& inObject) const {
+	glm::vec3 offset = glm::abs(inObject.Center - inNode.Center);
+	if (MaxComponent(offset) > inNode.HalfSize) return false;
+
+	float size = MaxComponent(inObject.Extents);
+	if (size > inNode.HalfSize) return false;
+
+	// The object belongs to a child when it also fits the child's cell.
+	float childHalfSize = inNode.HalfSize * 0.5f;
+	return size > childHalfSize || childHalfSize < MinHalfSize;
+}
+
+void LooseOctree::GrowRoot(const glm::vec3& inTowards) {
+	const auto& root = mNodes[mRoot];
+	float halfSize = root.HalfSize;
+
+	glm::vec3 direction = glm::vec3(
+		inTowards.x >= root.Center.x ? 1.0f : -1.0f,
+		inTowards.y >= root.Center.y ? 1.0f : -1.0f,
+		inTowards.z >= root.Center.z ? 1.0f : -1.0f);
+	glm::vec3 center = root.Center + direction * halfSize;
+
+	std::uint32_t oldRoot = mRoot;
+	std::uint32_t oldCount = root.SubtreeCount;
+
+	mRoot = NewNode(center, halfSize * 2.0f, NullIndex);
+
+	// An empty root is simply dropped instead of being kept as a child.
+	if (oldCount == 0) {
+		ReleaseNode(oldRoot);
+		return;
+	}
+
+	auto& newRoot = mNodes[mRoot];
+	newRoot.Children[GetOctant(center, mNodes[oldRoot].Center)] = oldRoot;
+	newRoot.SubtreeCount = oldCount;
+	mNodes[oldRoot].Parent = mRoot;
+}
+
+void LooseOctree::Link(std::uint32_t inId) {
+	const auto& object = mObjects[inId];
+	float size = MaxComponent(object.Extents);
+
+	if (mRoot == NullIndex) mRoot = NewNode(glm::vec3(0.0f), InitialHalfSize, NullIndex);
+
+	while (MaxComponent(glm::abs(object.Center - mNodes[mRoot].Center)) > mNodes[mRoot].HalfSize || size > mNodes[mRoot].HalfSize) {
+		GrowRoot(object.Center);
+	}
+
+	std::uint32_t nodeIndex = mRoot;
+	while (!FitsNode(mNodes[nodeIndex], object)) {
+		const auto& node = mNodes[nodeIndex];
+		float childHalfSize = node.HalfSize * 0.5f;
+		std::uint32_t octant = GetOctant(node.Center, object.Center);
+
+		std::uint32_t child = node.Children[octant];
+		if (child == NullIndex) {
+			glm::vec3 childCenter = node.Center + glm::vec3(
+				(octant & 1) ? childHalfSize : -childHalfSize,
+				(octant & 2) ? childHalfSize : -childHalfSize,
+				(octant & 4) ? childHalfSize : -childHalfSize);
+
+			child = NewNode(childCenter, childHalfSize, nodeIndex);
+			mNodes[nodeIndex].Children[octant] = child;
+		}
+
+		nodeIndex = child;
+	}
+
+	auto& node = mNodes[nodeIndex];
+	mObjects[inId].Node = nodeIndex;
+	mObjects[inId].Slot = static_cast<std::uint32_t>(node.Objects.size());
+	node.Objects.push_back(inId);
+
+	for (std::uint32_t index = nodeIndex; index != NullIndex; index = mNodes[index].Parent) {
+		++mNodes[index].SubtreeCount;
+	}
+}
+
+void LooseOctree::Unlink(std::uint32_t inId) {
+	auto& object = mObjects[inId];
+	std::uint32_t nodeIndex = object.Node;
+
+	auto& objects = mNodes[nodeIndex].Objects;
+	std::uint32_t moved = objects.back();
+	objects[object.Slot] = moved;
+	mObjects[moved].Slot = object.Slot;
+	objects.pop_back();
+
+	object.Node = NullIndex;
+
+	for (std::uint32_t index = nodeIndex; index != NullIndex; index = mNodes[index].Parent) {
+		--mNodes[index].SubtreeCount;
+	}
+
+	// Empty nodes have no children left either, so they are cut off bottom-up.
+	while (nodeIndex != mRoot && mNodes[nodeIndex].SubtreeCount == 0) {
+		std::uint32_t parent = mNodes[nodeIndex].Parent;
+
+		for (auto& child : mNodes[parent].Children) {
+			if (child == nodeIndex) child = NullIndex;
+		}
+
+		ReleaseNode(nodeIndex);
+		nodeIndex = parent;
+	}
+}
+
+void LooseOctree::CollectSubtree(std::uint32_t inNode, std::vector<std::uint32_t>& ioIds) const {
+	const auto& node = mNodes[inNode];
+	ioIds.insert(ioIds.end(), node.Objects.begin(), node.Objects.end());
+
+	for (std::uint32_t child : node.Children) {
+		if (child != NullIndex) CollectSubtree(child, ioIds);
+	}
+}
\ No newline at end of file
@@ -151,6 +151,20 @@ namespace {
 		return requiredExtensions.empty();
 	}
 
+	bool IsDeviceExtensionAvailable(const VkPhysicalDevice& inPhysicalDevice, const char* inExtensionName) {
+		std::uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(inPhysicalDevice, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(inPhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+		for (const auto& extension : availableExtensions) {
+			if (std::strcmp(extension.extensionName, inExtensionName) == 0) return true;
+		}
+
+		return false;
+	}
+
 	SwapChainSupportDetails QuerySwapChainSupport(const VkPhysicalDevice& inPhysicalDevice, const VkSurfaceKHR& inSurface) {
 		SwapChainSupportDetails details = {};
 
@@ -188,7 +202,8 @@ namespace {
 		VkPhysicalDeviceFeatures supportedFeatures;
 		vkGetPhysicalDeviceFeatures(inPhysicalDevice, &supportedFeatures);
 
-		return indices.IsComplete() && extensionSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+		return indices.IsComplete() && extensionSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy &&
+			supportedFeatures.shaderSampledImageArrayDynamicIndexing;
 	}
 
 	int RateDeviceSuitability(const VkPhysicalDevice& inPhysicalDevice, const VkSurfaceKHR& inSurface) {
@@ -319,6 +334,10 @@ std::uint32_t QueueFamilyIndices::GetPresentFamilyIndex() {
 	return PresentFamily.value();
 }
 
+std::uint32_t QueueFamilyIndices::GetTransferFamilyIndex() {
+	return TransferFamily.has_value() ? TransferFamily.value() : GraphicsFamily.value();
+}
+
 bool QueueFamilyIndices::IsComplete() {
 	return GraphicsFamily.has_value() && PresentFamily.has_value();
 }
@@ -334,15 +353,27 @@ QueueFamilyIndices FindQueueFamilies(const VkPhysicalDevice& inPhysicalDevice, c
 
 	std::uint32_t i = 0;
 	for (const auto& queueFamiliy : queueFamilies) {
-		if (queueFamiliy.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-			indices.GraphicsFamily = i;
+		if (!indices.IsComplete()) {
+			if (queueFamiliy.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+				indices.GraphicsFamily = i;
+			}
+
+			VkBool32 presentSupport = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(inPhysicalDevice, i, inSurface, &presentSupport);
+
+			if (presentSupport) indices.PresentFamily = i;
 		}
 
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(inPhysicalDevice, i, inSurface, &presentSupport);
+		// Prefer a pure copy-engine family; a compute family without graphics is the next best thing.
+		if ((queueFamiliy.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamiliy.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+			bool bPureTransfer = !(queueFamiliy.queueFlags & VK_QUEUE_COMPUTE_BIT);
+			bool bHadPureTransfer = indices.TransferFamily.has_value() &&
+				!(queueFamilies[indices.TransferFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT);
 
-		if (presentSupport) indices.PresentFamily = i;
-		if (indices.IsComplete()) break;
+			if (!indices.TransferFamily.has_value() || (bPureTransfer && !bHadPureTransfer)) {
+				indices.TransferFamily = i;
+			}
+		}
 
 		++i;
 	}
@@ -518,7 +549,8 @@ bool LowRenderer::CreateLogicalDevice() {
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<std::uint32_t> uniqueQueueFamilies = {
 		indices.GetGraphicsFamilyIndex(),
-		indices.GetPresentFamilyIndex()
+		indices.GetPresentFamilyIndex(),
+		indices.GetTransferFamilyIndex()
 	};
 
 	float queuePriority = 1.0f;
@@ -531,17 +563,31 @@ bool LowRenderer::CreateLogicalDevice() {
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(mPhysicalDevice, &supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.sampleRateShading = VK_TRUE;
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+	// Optional; used by GPU-driven rendering.
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	// Optional; block-compressed textures are decoded on the CPU without it.
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+	std::vector<const char*> deviceExtensions = DeviceExtensions;
+
+	bDrawIndirectCountSupported = IsDeviceExtensionAvailable(mPhysicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	if (bDrawIndirectCountSupported) deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
 
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = static_cast<std::uint32_t>(queueCreateInfos.size());
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<std::uint32_t>(DeviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = DeviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<std::uint32_t>(deviceExtensions.size());
+	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
 	if (EnableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<std::uint32_t>(ValidationLayers.size());
@@ -557,6 +603,15 @@ bool LowRenderer::CreateLogicalDevice() {
 
 	vkGetDeviceQueue(mDevice, indices.GetGraphicsFamilyIndex(), 0, &mGraphicsQueue);
 	vkGetDeviceQueue(mDevice, indices.GetPresentFamilyIndex(), 0, &mPresentQueue);
+	vkGetDeviceQueue(mDevice, indices.GetTransferFamilyIndex(), 0, &mTransferQueue);
+
+	mEnabledFeatures = deviceFeatures;
+
+	if (bDrawIndirectCountSupported) {
+		mCmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+			vkGetDeviceProcAddr(mDevice, "vkCmdDrawIndexedIndirectCountKHR"));
+		bDrawIndirectCountSupported = mCmdDrawIndexedIndirectCount != nullptr;
+	}
 
 	return true;
 }
@@ -0,0 +1,238 @@
+#include "Lz4.h"
+
+#include <cstring>
+
+namespace {
+	const size_t MinMatch = 4;
+	const size_t MaxOffset = 65535;
+
+	// The format requires the last five bytes to be literals and the last match to start at least
+	// twelve bytes before the end.
+	const size_t LastLiterals = 5;
+	const size_t MatchSearchEnd = 12;
+
+	const std::uint32_t HashLog = 14;
+
+	// Searching skips ahead faster the longer nothing matches, which keeps incompressible data cheap.
+	const std::uint32_t SkipTrigger = 6;
+
+	inline std::uint32_t Read32(const std::uint8_t* p) {
+		std::uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	// Copies may run this far past their end when there is room for it.
+	const size_t WildCopy = 32;
+
+	inline void WildCopy16(std::uint8_t* pDst, const std::uint8_t* pSrc, size_t inSize) {
+		for (size_t i = 0; i < inSize; i += 16) {
+			std::memcpy(pDst + i, pSrc + i, 16);
+		}
+	}
+
+	inline std::uint32_t HashSequence(std::uint32_t inSequence) {
+		return (inSequence * 2654435761u) >> (32 - HashLog);
+	}
+
+	// Lengths of 15 and more continue in bytes of 255 and a final remainder.
+	inline void WriteLength(std::uint8_t*& iopDst, size_t inLength) {
+		for (; inLength >= 255; inLength -= 255) {
+			*iopDst++ = 255;
+		}
+		*iopDst++ = static_cast<std::uint8_t>(inLength);
+	}
+
+	inline bool ReadLength(const std::uint8_t*& iopSrc, const std::uint8_t* pSrcEnd, size_t& ioLength) {
+		std::uint8_t byte;
+		do {
+			if (iopSrc >= pSrcEnd) return false;
+			byte = *iopSrc++;
+			ioLength += byte;
+		} while (byte == 255);
+		return true;
+	}
+}
+
+size_t GetLz4CompressBound(size_t inSize) {
+	return inSize + inSize / 255 + 16;
+}
+
+size_t CompressLz4(const void* pSrc, size_t inSrcSize, void* pDst, size_t inDstCapacity) {
+	const std::uint8_t* const pBase = static_cast<const std::uint8_t*>(pSrc);
+	const std::uint8_t* const pSrcEnd = pBase + inSrcSize;
+	std::uint8_t* const pDstBegin = static_cast<std::uint8_t*>(pDst);
+	std::uint8_t* const pDstEnd = pDstBegin + inDstCapacity;
+
+	std::uint8_t* pOut = pDstBegin;
+	const std::uint8_t* pAnchor = pBase;
+
+	// Writes one sequence; a null pMatch writes the closing literals.
+	auto emit = [&](const std::uint8_t* pLiteralEnd, const std::uint8_t* pMatch, size_t inMatchLength) {
+		const size_t literalLength = static_cast<size_t>(pLiteralEnd - pAnchor);
+		if (static_cast<size_t>(pDstEnd - pOut) < 1 + literalLength + literalLength / 255 + 1 + 2 + inMatchLength / 255 + 1) {
+			return false;
+		}
+
+		std::uint8_t* pToken = pOut++;
+		*pToken = static_cast<std::uint8_t>(std::min<size_t>(literalLength, 15) << 4);
+		if (literalLength >= 15) WriteLength(pOut, literalLength - 15);
+
+		if (literalLength > 0) std::memcpy(pOut, pAnchor, literalLength);
+		pOut += literalLength;
+
+		if (pMatch == nullptr) return true;
+
+		const size_t offset = static_cast<size_t>(pLiteralEnd - pMatch);
+		*pOut++ = static_cast<std::uint8_t>(offset);
+		*pOut++ = static_cast<std::uint8_t>(offset >> 8);
+
+		const size_t extraLength = inMatchLength - MinMatch;
+		*pToken |= static_cast<std::uint8_t>(std::min<size_t>(extraLength, 15));
+		if (extraLength >= 15) WriteLength(pOut, extraLength - 15);
+
+		return true;
+	};
+
+	if (inSrcSize > MatchSearchEnd) {
+		// Positions are stored plus one, so zero marks an empty slot.
+		std::vector<std::uint32_t> table(static_cast<size_t>(1) << HashLog, 0);
+
+		const std::uint8_t* const pSearchEnd = pSrcEnd - MatchSearchEnd;
+		const std::uint8_t* const pMatchEnd = pSrcEnd - LastLiterals;
+
+		const std::uint8_t* p = pBase;
+		std::uint32_t missCount = 0;
+		while (p <= pSearchEnd) {
+			const std::uint32_t sequence = Read32(p);
+			std::uint32_t& slot = table[HashSequence(sequence)];
+			const std::uint8_t* pCandidate = slot != 0 ? pBase + (slot - 1) : nullptr;
+			slot = static_cast<std::uint32_t>(p - pBase) + 1;
+
+			if (pCandidate == nullptr || static_cast<size_t>(p - pCandidate) > MaxOffset || Read32(pCandidate) != sequence) {
+				p += 1 + (missCount++ >> SkipTrigger);
+				continue;
+			}
+			missCount = 0;
+
+			// Extend backwards into the pending literals, then forwards.
+			while (p > pAnchor && pCandidate > pBase && p[-1] == pCandidate[-1]) {
+				--p;
+				--pCandidate;
+			}
+
+			size_t length = MinMatch;
+			while (p + length < pMatchEnd && p[length] == pCandidate[length]) {
+				++length;
+			}
+
+			if (!emit(p, pCandidate, length)) return 0;
+
+			p += length;
+			pAnchor = p;
+
+			// Remember a position inside the match so the next one can start right after it.
+			if (p <= pSearchEnd) {
+				table[HashSequence(Read32(p - 2))] = static_cast<std::uint32_t>(p - 2 - pBase) + 1;
+			}
+		}
+	}
+
+	if (!emit(pSrcEnd, nullptr, 0)) return 0;
+
+	return static_cast<size_t>(pOut - pDstBegin);
+}
+
+bool DecompressLz4(const void* pSrc, size_t inSrcSize, void* pDst, size_t inDstSize) {
+	const std::uint8_t* pIn = static_cast<const std::uint8_t*>(pSrc);
+	const std::uint8_t* const pInEnd = pIn + inSrcSize;
+	std::uint8_t* const pDstBegin = static_cast<std::uint8_t*>(pDst);
+	std::uint8_t* pOut = pDstBegin;
+	std::uint8_t* const pOutEnd = pDstBegin + inDstSize;
+
+	while (pOut < pOutEnd) {
+		if (pIn >= pInEnd) return false;
+		const std::uint8_t token = *pIn++;
+
+		size_t literalLength = token >> 4;
+
+		// Most sequences are short and far from both ends: their lengths fit in the token, and fixed-size
+		// copies cover them without any length checks.
+		if (literalLength < 15 && (token & 15) < 15 &&
+				static_cast<size_t>(pInEnd - pIn) >= 16 + 2 && static_cast<size_t>(pOutEnd - pOut) >= WildCopy) {
+			std::memcpy(pOut, pIn, 16);
+			pOut += literalLength;
+			pIn += literalLength;
+
+			const size_t offset = static_cast<size_t>(pIn[0]) | (static_cast<size_t>(pIn[1]) << 8);
+			pIn += 2;
+			if (offset == 0 || offset > static_cast<size_t>(pOut - pDstBegin)) return false;
+
+			const size_t matchLength = (token & 15) + MinMatch;
+			const std::uint8_t* pMatch = pOut - offset;
+			if (offset >= 8) {
+				std::memcpy(pOut, pMatch, 8);
+				std::memcpy(pOut + 8, pMatch + 8, 8);
+				std::memcpy(pOut + 16, pMatch + 16, 2);
+			}
+			else {
+				// A fixed count unrolls; bytes past the match are overwritten later.
+				for (size_t i = 0; i < 18; ++i) {
+					pOut[i] = pMatch[i];
+				}
+			}
+			pOut += matchLength;
+			continue;
+		}
+
+		if (literalLength == 15 && !ReadLength(pIn, pInEnd, literalLength)) return false;
+		if (static_cast<size_t>(pInEnd - pIn) < literalLength) return false;
+
+		if (static_cast<size_t>(pInEnd - pIn) >= literalLength + WildCopy && static_cast<size_t>(pOutEnd - pOut) >= literalLength + WildCopy) {
+			// Away from both ends, copy whole chunks and let the next sequence overwrite the excess.
+			WildCopy16(pOut, pIn, literalLength);
+			pOut += literalLength;
+		}
+		else {
+			const size_t literalCopy = std::min(literalLength, static_cast<size_t>(pOutEnd - pOut));
+			std::memcpy(pOut, pIn, literalCopy);
+			pOut += literalCopy;
+		}
+		pIn += literalLength;
+
+		// The block ends after the literals of its last sequence.
+		if (pOut == pOutEnd) return true;
+		if (pIn == pInEnd) return false;
+
+		if (pInEnd - pIn < 2) return false;
+		const size_t offset = static_cast<size_t>(pIn[0]) | (static_cast<size_t>(pIn[1]) << 8);
+		pIn += 2;
+		if (offset == 0 || offset > static_cast<size_t>(pOut - pDstBegin)) return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(pIn, pInEnd, matchLength)) return false;
+		matchLength = std::min(matchLength + MinMatch, static_cast<size_t>(pOutEnd - pOut));
+
+		const std::uint8_t* pMatch = pOut - offset;
+		if (offset >= 8 && static_cast<size_t>(pOutEnd - pOut) >= matchLength + WildCopy) {
+			// Eight bytes back or more, each chunk reads only bytes already written.
+			std::uint8_t* const pMatchEnd = pOut + matchLength;
+			for (; pOut < pMatchEnd; pOut += 8, pMatch += 8) {
+				std::memcpy(pOut, pMatch, 8);
+			}
+			pOut = pMatchEnd;
+		}
+		else if (offset >= matchLength) {
+			std::memcpy(pOut, pMatch, matchLength);
+			pOut += matchLength;
+		}
+		else {
+			// Overlapping copies repeat the last offset bytes, so they go byte by byte.
+			for (size_t i = 0; i < matchLength; ++i) {
+				*pOut++ = *pMatch++;
+			}
+		}
+	}
+
+	return true;
+}
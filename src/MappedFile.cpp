@@ -0,0 +1,59 @@
+#include "MappedFile.h"
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const std::string& inFilePath) {
+	Close();
+
+	mhFile = CreateFileA(inFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (mhFile == INVALID_HANDLE_VALUE) {
+		std::wstringstream wsstream;
+		wsstream << L"Failed to open file: " << inFilePath.c_str();
+		ReturnFalse(wsstream.str());
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mhFile, &size)) {
+		Close();
+		ReturnFalse(L"Failed to get file size");
+	}
+	mSize = static_cast<std::uint64_t>(size.QuadPart);
+
+	// Empty files cannot be mapped.
+	if (mSize == 0) return true;
+
+	mhMapping = CreateFileMappingA(mhFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mhMapping == NULL) {
+		Close();
+		ReturnFalse(L"Failed to create file mapping");
+	}
+
+	mpData = reinterpret_cast<const std::uint8_t*>(MapViewOfFile(mhMapping, FILE_MAP_READ, 0, 0, 0));
+	if (mpData == nullptr) {
+		Close();
+		ReturnFalse(L"Failed to map file");
+	}
+
+	return true;
+}
+
+void MappedFile::Close() {
+	if (mpData != nullptr) UnmapViewOfFile(mpData);
+	if (mhMapping != NULL) CloseHandle(mhMapping);
+	if (mhFile != INVALID_HANDLE_VALUE) CloseHandle(mhFile);
+
+	mpData = nullptr;
+	mhMapping = NULL;
+	mhFile = INVALID_HANDLE_VALUE;
+	mSize = 0;
+}
+
+const std::uint8_t* MappedFile::GetData() const {
+	return mpData;
+}
+
+std::uint64_t MappedFile::GetSize() const {
+	return mSize;
+}
\ No newline at end of file
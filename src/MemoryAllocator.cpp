@@ -0,0 +1,587 @@
+#include "MemoryAllocator.h"
+
+#include <intrin.h>
+
+namespace {
+	std::uint32_t FindLastSet(std::uint64_t inValue) {
+		unsigned long index = 0;
+		_BitScanReverse64(&index, inValue);
+		return static_cast<std::uint32_t>(index);
+	}
+
+	std::uint32_t FindFirstSet(std::uint64_t inValue) {
+		unsigned long index = 0;
+		_BitScanForward64(&index, inValue);
+		return static_cast<std::uint32_t>(index);
+	}
+
+	std::uint64_t AlignUp(std::uint64_t inValue, std::uint64_t inAlignment) {
+		if (inAlignment <= 1) return inValue;
+		return (inValue + inAlignment - 1) / inAlignment * inAlignment;
+	}
+}
+
+void TlsfAllocator::Initialize(std::uint64_t inSize) {
+	mSize = inSize;
+	mUsedSize = 0;
+	mFreeRangeCount = 0;
+
+	mRanges.clear();
+	mUnusedRanges.clear();
+	mAllocatedRanges.clear();
+
+	mFirstLevelBitmap = 0;
+	for (std::uint32_t fl = 0; fl < FirstLevelCount; ++fl) {
+		mSecondLevelBitmaps[fl] = 0;
+		for (std::uint32_t sl = 0; sl < SecondLevelCount; ++sl)
+			mFreeHeads[fl][sl] = NullIndex;
+	}
+
+	std::uint32_t index = NewRange();
+	auto& range = mRanges[index];
+	range.Offset = 0;
+	range.Size = inSize;
+
+	InsertFree(index);
+}
+
+bool TlsfAllocator::Allocate(std::uint64_t inSize, std::uint64_t inAlignment, std::uint64_t& outOffset) {
+	std::uint64_t size = std::max<std::uint64_t>(inSize, 1);
+	std::uint64_t alignment = std::max<std::uint64_t>(inAlignment, 1);
+
+	// Ask for the worst-case padding up front so that any range found is guaranteed to fit.
+	std::uint32_t index = FindFree(size + alignment - 1);
+	if (index == NullIndex) return false;
+
+	RemoveFree(index);
+
+	std::uint64_t alignedOffset = AlignUp(mRanges[index].Offset, alignment);
+	std::uint64_t padding = alignedOffset - mRanges[index].Offset;
+
+	if (padding > 0) {
+		std::uint32_t front = NewRange();
+		auto& frontRange = mRanges[front];
+		auto& range = mRanges[index];
+
+		frontRange.Offset = range.Offset;
+		frontRange.Size = padding;
+		frontRange.PrevPhysical = range.PrevPhysical;
+		frontRange.NextPhysical = index;
+		if (range.PrevPhysical != NullIndex) mRanges[range.PrevPhysical].NextPhysical = front;
+
+		range.PrevPhysical = front;
+		range.Offset = alignedOffset;
+		range.Size -= padding;
+
+		InsertFree(front);
+	}
+
+	if (mRanges[index].Size > size) {
+		std::uint32_t back = NewRange();
+		auto& backRange = mRanges[back];
+		auto& range = mRanges[index];
+
+		backRange.Offset = range.Offset + size;
+		backRange.Size = range.Size - size;
+		backRange.PrevPhysical = index;
+		backRange.NextPhysical = range.NextPhysical;
+		if (range.NextPhysical != NullIndex) mRanges[range.NextPhysical].PrevPhysical = back;
+
+		range.NextPhysical = back;
+		range.Size = size;
+
+		InsertFree(back);
+	}
+
+	auto& range = mRanges[index];
+	range.bFree = false;
+
+	mAllocatedRanges[range.Offset] = index;
+	mUsedSize += range.Size;
+
+	outOffset = range.Offset;
+
+	return true;
+}
+
+void TlsfAllocator::Free(std::uint64_t inOffset) {
+	auto iter = mAllocatedRanges.find(inOffset);
+	if (iter == mAllocatedRanges.end()) return;
+
+	std::uint32_t index = iter->second;
+	mAllocatedRanges.erase(iter);
+
+	mUsedSize -= mRanges[index].Size;
+	mRanges[index].bFree = true;
+
+	std::uint32_t prev = mRanges[index].PrevPhysical;
+	if (prev != NullIndex && mRanges[prev].bFree) {
+		RemoveFree(prev);
+
+		mRanges[prev].Size += mRanges[index].Size;
+		mRanges[prev].NextPhysical = mRanges[index].NextPhysical;
+		if (mRanges[index].NextPhysical != NullIndex) mRanges[mRanges[index].NextPhysical].PrevPhysical = prev;
+
+		ReleaseRange(index);
+		index = prev;
+	}
+
+	std::uint32_t next = mRanges[index].NextPhysical;
+	if (next != NullIndex && mRanges[next].bFree) {
+		RemoveFree(next);
+
+		mRanges[index].Size += mRanges[next].Size;
+		mRanges[index].NextPhysical = mRanges[next].NextPhysical;
+		if (mRanges[next].NextPhysical != NullIndex) mRanges[mRanges[next].NextPhysical].PrevPhysical = index;
+
+		ReleaseRange(next);
+	}
+
+	InsertFree(index);
+}
+
+bool TlsfAllocator::Grow(std::uint64_t inNewSize) {
+	if (inNewSize <= mSize) return false;
+
+	std::uint64_t extra = inNewSize - mSize;
+
+	std::uint32_t last = NullIndex;
+	for (std::uint32_t i = 0, end = static_cast<std::uint32_t>(mRanges.size()); i < end; ++i) {
+		const auto& range = mRanges[i];
+		if (range.Size > 0 && range.Offset + range.Size == mSize) {
+			last = i;
+			break;
+		}
+	}
+
+	if (last != NullIndex && mRanges[last].bFree) {
+		RemoveFree(last);
+		mRanges[last].Size += extra;
+		InsertFree(last);
+	}
+	else {
+		std::uint32_t index = NewRange();
+		auto& range = mRanges[index];
+		range.Offset = mSize;
+		range.Size = extra;
+		range.PrevPhysical = last;
+		if (last != NullIndex) mRanges[last].NextPhysical = index;
+
+		InsertFree(index);
+	}
+
+	mSize = inNewSize;
+
+	return true;
+}
+
+bool TlsfAllocator::IsEmpty() const {
+	return mAllocatedRanges.empty();
+}
+
+std::uint64_t TlsfAllocator::GetSize() const {
+	return mSize;
+}
+
+void TlsfAllocator::GetStats(Stats& outStats) const {
+	outStats.TotalSize = mSize;
+	outStats.UsedSize = mUsedSize;
+	outStats.AllocationCount = static_cast<std::uint32_t>(mAllocatedRanges.size());
+	outStats.FreeRangeCount = mFreeRangeCount;
+	outStats.LargestFreeRange = 0;
+
+	if (mFirstLevelBitmap == 0) return;
+
+	// Only the highest non-empty first level can hold the largest range.
+	std::uint32_t fl = FindLastSet(mFirstLevelBitmap);
+	for (std::uint32_t sl = 0; sl < SecondLevelCount; ++sl) {
+		for (std::uint32_t index = mFreeHeads[fl][sl]; index != NullIndex; index = mRanges[index].NextFree)
+			outStats.LargestFreeRange = std::max(outStats.LargestFreeRange, mRanges[index].Size);
+	}
+}
+
+void TlsfAllocator::Mapping(std::uint64_t inSize, std::uint32_t& outFirstLevel, std::uint32_t& outSecondLevel) const {
+	if (inSize < SecondLevelCount) {
+		outFirstLevel = 0;
+		outSecondLevel = static_cast<std::uint32_t>(inSize);
+	}
+	else {
+		std::uint32_t lastSet = FindLastSet(inSize);
+		outFirstLevel = lastSet - SecondLevelLog2 + 1;
+		outSecondLevel = static_cast<std::uint32_t>(inSize >> (lastSet - SecondLevelLog2)) ^ SecondLevelCount;
+	}
+}
+
+std::uint32_t TlsfAllocator::FindFree(std::uint64_t inSize) const {
+	// Round the request up to the next list boundary so that every range in the chosen list fits.
+	std::uint64_t size = inSize;
+	if (size >= SecondLevelCount) size += (1ull << (FindLastSet(size) - SecondLevelLog2)) - 1;
+
+	std::uint32_t fl = 0;
+	std::uint32_t sl = 0;
+	Mapping(size, fl, sl);
+	if (fl >= FirstLevelCount) return NullIndex;
+
+	std::uint32_t slMap = mSecondLevelBitmaps[fl] & (~0u << sl);
+	if (slMap == 0) {
+		if (fl + 1 >= FirstLevelCount) return NullIndex;
+
+		std::uint64_t flMap = mFirstLevelBitmap & (~0ull << (fl + 1));
+		if (flMap == 0) return NullIndex;
+
+		fl = FindFirstSet(flMap);
+		slMap = mSecondLevelBitmaps[fl];
+	}
+
+	sl = FindFirstSet(slMap);
+
+	return mFreeHeads[fl][sl];
+}
+
+void TlsfAllocator::InsertFree(std::uint32_t inIndex) {
+	std::uint32_t fl = 0;
+	std::uint32_t sl = 0;
+	Mapping(mRanges[inIndex].Size, fl, sl);
+
+	auto& range = mRanges[inIndex];
+	range.bFree = true;
+	range.PrevFree = NullIndex;
+	range.NextFree = mFreeHeads[fl][sl];
+	if (range.NextFree != NullIndex) mRanges[range.NextFree].PrevFree = inIndex;
+
+	mFreeHeads[fl][sl] = inIndex;
+	mFirstLevelBitmap |= 1ull << fl;
+	mSecondLevelBitmaps[fl] |= 1u << sl;
+
+	++mFreeRangeCount;
+}
+
+void TlsfAllocator::RemoveFree(std::uint32_t inIndex) {
+	std::uint32_t fl = 0;
+	std::uint32_t sl = 0;
+	Mapping(mRanges[inIndex].Size, fl, sl);
+
+	auto& range = mRanges[inIndex];
+	if (range.PrevFree != NullIndex) mRanges[range.PrevFree].NextFree = range.NextFree;
+	if (range.NextFree != NullIndex) mRanges[range.NextFree].PrevFree = range.PrevFree;
+
+	if (mFreeHeads[fl][sl] == inIndex) {
+		mFreeHeads[fl][sl] = range.NextFree;
+
+		if (mFreeHeads[fl][sl] == NullIndex) {
+			mSecondLevelBitmaps[fl] &= ~(1u << sl);
+			if (mSecondLevelBitmaps[fl] == 0) mFirstLevelBitmap &= ~(1ull << fl);
+		}
+	}
+
+	range.bFree = false;
+	range.PrevFree = NullIndex;
+	range.NextFree = NullIndex;
+
+	--mFreeRangeCount;
+}
+
+std::uint32_t TlsfAllocator::NewRange() {
+	std::uint32_t index = 0;
+
+	if (!mUnusedRanges.empty()) {
+		index = mUnusedRanges.back();
+		mUnusedRanges.pop_back();
+	}
+	else {
+		index = static_cast<std::uint32_t>(mRanges.size());
+		mRanges.emplace_back();
+	}
+
+	auto& range = mRanges[index];
+	range.Offset = 0;
+	range.Size = 0;
+	range.PrevPhysical = NullIndex;
+	range.NextPhysical = NullIndex;
+	range.PrevFree = NullIndex;
+	range.NextFree = NullIndex;
+	range.bFree = false;
+
+	return index;
+}
+
+void TlsfAllocator::ReleaseRange(std::uint32_t inIndex) {
+	auto& range = mRanges[inIndex];
+	range.Size = 0;
+	range.bFree = false;
+	range.PrevPhysical = NullIndex;
+	range.NextPhysical = NullIndex;
+
+	mUnusedRanges.push_back(inIndex);
+}
+
+MemoryAllocator::~MemoryAllocator() {
+	if (!bIsCleanedUp) {
+		CleanUp();
+	}
+}
+
+bool MemoryAllocator::Initialize(const VkPhysicalDevice& inPhysicalDevice, const VkDevice& inDevice) {
+	mDevice = inDevice;
+
+	vkGetPhysicalDeviceMemoryProperties(inPhysicalDevice, &mMemoryProperties);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(inPhysicalDevice, &deviceProperties);
+	mMaxAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+
+	mDeviceMemoryCount = 0;
+	mSubAllocationCount = 0;
+
+	bIsCleanedUp = false;
+
+	return true;
+}
+
+void MemoryAllocator::CleanUp() {
+	if (mSubAllocationCount > 0 || !mDedicatedBlocks.empty()) {
+		WLogln(L"Memory allocator is cleaned up with live allocations: ",
+			std::to_wstring(mSubAllocationCount), L" sub-allocation(s), ",
+			std::to_wstring(mDedicatedBlocks.size()), L" dedicated allocation(s)");
+	}
+
+	for (std::uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i) {
+		for (std::uint32_t kind = 0; kind < ResourceKinds::ENumResourceKinds; ++kind) {
+			for (auto& block : mBlocks[i][kind])
+				FreeDeviceMemory(*block);
+
+			mBlocks[i][kind].clear();
+		}
+	}
+
+	for (auto& blockPair : mDedicatedBlocks)
+		FreeDeviceMemory(*blockPair.second);
+
+	mDedicatedBlocks.clear();
+
+	mSubAllocationCount = 0;
+
+	bIsCleanedUp = true;
+}
+
+bool MemoryAllocator::Allocate(
+		const VkMemoryRequirements& inRequirements,
+		const VkMemoryPropertyFlags& inProperties,
+		ResourceKinds inKind,
+		bool bDedicated,
+		Allocation& outAllocation) {
+	std::uint32_t memoryTypeIndex = FindMemoryType(inRequirements.memoryTypeBits, inProperties);
+	if (memoryTypeIndex == std::numeric_limits<std::uint32_t>::max()) {
+		ReturnFalse(L"Failed to find suitable memory type");
+	}
+
+	VkDeviceSize blockSize = GetPreferredBlockSize(memoryTypeIndex);
+
+	// Large resources would waste most of a block on their own, so they get their own memory object.
+	if (bDedicated || inRequirements.size > (blockSize >> 1)) {
+		CheckReturn(AllocateDedicated(inRequirements, memoryTypeIndex, outAllocation));
+
+		return true;
+	}
+
+	auto& blocks = mBlocks[memoryTypeIndex][inKind];
+
+	MemoryBlock* pBlock = nullptr;
+	std::uint64_t offset = 0;
+
+	for (auto& block : blocks) {
+		if (block->Allocator.Allocate(inRequirements.size, inRequirements.alignment, offset)) {
+			pBlock = block.get();
+			break;
+		}
+	}
+
+	if (pBlock == nullptr) {
+		auto block = std::make_unique<MemoryBlock>();
+		block->Kind = inKind;
+		CheckReturn(AllocateDeviceMemory(memoryTypeIndex, blockSize, *block));
+
+		if (!block->Allocator.Allocate(inRequirements.size, inRequirements.alignment, offset)) {
+			FreeDeviceMemory(*block);
+			ReturnFalse(L"Failed to sub-allocate from a new memory block");
+		}
+
+		pBlock = block.get();
+		blocks.push_back(std::move(block));
+	}
+
+	outAllocation.Memory = pBlock->Memory;
+	outAllocation.Offset = offset;
+	outAllocation.Size = inRequirements.size;
+	outAllocation.pMappedData = pBlock->pMappedData != nullptr ? pBlock->pMappedData + offset : nullptr;
+	outAllocation.pBlock = pBlock;
+
+	++mSubAllocationCount;
+
+	return true;
+}
+
+void MemoryAllocator::Free(Allocation& ioAllocation) {
+	MemoryBlock* pBlock = ioAllocation.pBlock;
+	if (pBlock == nullptr) return;
+
+	if (pBlock->bDedicated) {
+		auto iter = mDedicatedBlocks.find(pBlock);
+		if (iter != mDedicatedBlocks.end()) {
+			FreeDeviceMemory(*pBlock);
+			mDedicatedBlocks.erase(iter);
+		}
+	}
+	else {
+		pBlock->Allocator.Free(ioAllocation.Offset);
+		--mSubAllocationCount;
+
+		// Keep one block around per heap so that a free/allocate pattern does not thrash vkAllocateMemory.
+		auto& blocks = mBlocks[pBlock->MemoryTypeIndex][pBlock->Kind];
+		if (pBlock->Allocator.IsEmpty() && blocks.size() > 1) {
+			auto iter = std::find_if(blocks.begin(), blocks.end(), [&](const std::unique_ptr<MemoryBlock>& block) {
+				return block.get() == pBlock;
+			});
+
+			if (iter != blocks.end()) {
+				FreeDeviceMemory(*pBlock);
+				blocks.erase(iter);
+			}
+		}
+	}
+
+	ioAllocation = Allocation();
+}
+
+void MemoryAllocator::GetStats(Stats& outStats) const {
+	outStats = Stats();
+	outStats.DeviceMemoryCount = mDeviceMemoryCount;
+	outStats.DedicatedAllocationCount = static_cast<std::uint32_t>(mDedicatedBlocks.size());
+	outStats.SubAllocationCount = mSubAllocationCount;
+
+	VkDeviceSize freeBytes = 0;
+
+	for (std::uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i) {
+		for (std::uint32_t kind = 0; kind < ResourceKinds::ENumResourceKinds; ++kind) {
+			for (const auto& block : mBlocks[i][kind]) {
+				TlsfAllocator::Stats blockStats;
+				block->Allocator.GetStats(blockStats);
+
+				++outStats.BlockCount;
+				outStats.ReservedBytes += blockStats.TotalSize;
+				outStats.UsedBytes += blockStats.UsedSize;
+				outStats.FreeRangeCount += blockStats.FreeRangeCount;
+				outStats.LargestFreeRange = std::max(outStats.LargestFreeRange, blockStats.LargestFreeRange);
+
+				freeBytes += blockStats.TotalSize - blockStats.UsedSize;
+			}
+		}
+	}
+
+	for (const auto& blockPair : mDedicatedBlocks) {
+		outStats.ReservedBytes += blockPair.second->Size;
+		outStats.UsedBytes += blockPair.second->Size;
+	}
+
+	if (freeBytes > 0) {
+		outStats.Fragmentation = 1.0f - static_cast<float>(
+			static_cast<double>(outStats.LargestFreeRange) / static_cast<double>(freeBytes));
+	}
+}
+
+void MemoryAllocator::LogStats() const {
+	Stats stats;
+	GetStats(stats);
+
+	WLogln(L"Device memory statistics:");
+	WLogln(L"\t Device memory objects: ", std::to_wstring(stats.DeviceMemoryCount), L" / ", std::to_wstring(mMaxAllocationCount));
+	WLogln(L"\t Blocks: ", std::to_wstring(stats.BlockCount), L", dedicated allocations: ", std::to_wstring(stats.DedicatedAllocationCount));
+	WLogln(L"\t Sub-allocations: ", std::to_wstring(stats.SubAllocationCount), L", free ranges: ", std::to_wstring(stats.FreeRangeCount));
+	WLogln(L"\t Used bytes: ", std::to_wstring(stats.UsedBytes), L" / ", std::to_wstring(stats.ReservedBytes));
+	WLogln(L"\t Largest free range: ", std::to_wstring(stats.LargestFreeRange), L", fragmentation: ", std::to_wstring(stats.Fragmentation));
+}
+
+std::uint32_t MemoryAllocator::FindMemoryType(std::uint32_t inTypeFilter, const VkMemoryPropertyFlags& inProperties) const {
+	std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+
+	for (std::uint32_t i = 0; i < mMemoryProperties.memoryTypeCount; ++i) {
+		if ((inTypeFilter & (1 << i)) && (mMemoryProperties.memoryTypes[i].propertyFlags & inProperties) == inProperties) {
+			index = i;
+			break;
+		}
+	}
+
+	return index;
+}
+
+VkDeviceSize MemoryAllocator::GetPreferredBlockSize(std::uint32_t inMemoryTypeIndex) const {
+	std::uint32_t heapIndex = mMemoryProperties.memoryTypes[inMemoryTypeIndex].heapIndex;
+	VkDeviceSize heapSize = mMemoryProperties.memoryHeaps[heapIndex].size;
+
+	// Small heaps (e.g. the 256 MiB host-visible device-local heap) should not be eaten by a few blocks.
+	return heapSize <= 1024ull * 1024 * 1024 ? std::min(DefaultBlockSize, heapSize >> 3) : DefaultBlockSize;
+}
+
+bool MemoryAllocator::AllocateDeviceMemory(std::uint32_t inMemoryTypeIndex, VkDeviceSize inSize, MemoryBlock& ioBlock) {
+	if (mDeviceMemoryCount >= mMaxAllocationCount) {
+		ReturnFalse(L"Reached maxMemoryAllocationCount");
+	}
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = inSize;
+	allocInfo.memoryTypeIndex = inMemoryTypeIndex;
+
+	if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &ioBlock.Memory) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to allocate device memory");
+	}
+
+	ioBlock.Size = inSize;
+	ioBlock.MemoryTypeIndex = inMemoryTypeIndex;
+	ioBlock.pMappedData = nullptr;
+	ioBlock.Allocator.Initialize(inSize);
+
+	if (mMemoryProperties.memoryTypes[inMemoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		void* pData = nullptr;
+		if (vkMapMemory(mDevice, ioBlock.Memory, 0, VK_WHOLE_SIZE, 0, &pData) != VK_SUCCESS) {
+			vkFreeMemory(mDevice, ioBlock.Memory, nullptr);
+			ioBlock.Memory = VK_NULL_HANDLE;
+			ReturnFalse(L"Failed to map device memory");
+		}
+
+		ioBlock.pMappedData = reinterpret_cast<std::uint8_t*>(pData);
+	}
+
+	++mDeviceMemoryCount;
+
+	return true;
+}
+
+void MemoryAllocator::FreeDeviceMemory(MemoryBlock& ioBlock) {
+	if (ioBlock.Memory == VK_NULL_HANDLE) return;
+
+	if (ioBlock.pMappedData != nullptr) vkUnmapMemory(mDevice, ioBlock.Memory);
+	vkFreeMemory(mDevice, ioBlock.Memory, nullptr);
+
+	ioBlock.Memory = VK_NULL_HANDLE;
+	ioBlock.pMappedData = nullptr;
+
+	--mDeviceMemoryCount;
+}
+
+bool MemoryAllocator::AllocateDedicated(const VkMemoryRequirements& inRequirements, std::uint32_t inMemoryTypeIndex, Allocation& outAllocation) {
+	auto block = std::make_unique<MemoryBlock>();
+	block->bDedicated = true;
+
+	CheckReturn(AllocateDeviceMemory(inMemoryTypeIndex, inRequirements.size, *block));
+
+	outAllocation.Memory = block->Memory;
+	outAllocation.Offset = 0;
+	outAllocation.Size = inRequirements.size;
+	outAllocation.pMappedData = block->pMappedData;
+	outAllocation.pBlock = block.get();
+
+	mDedicatedBlocks[block.get()] = std::move(block);
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexWelder.h"
+
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+namespace {
+	const std::uint32_t MaxLodCount = 5;
+	const std::uint32_t MinLodTriangleCount = 32;
+
+	const std::uint32_t MaxMeshletVertices = 64;
+	const std::uint32_t MaxMeshletTriangles = 124;
+	const std::uint32_t MinMeshletMeshTriangleCount = 4096;
+
+	// FIFO size the vertex cache statistics are reported for.
+	const std::uint32_t VertexCacheSize = 16;
+	const std::uint32_t MaxShortIndexVertexCount = 65536;
+
+	const std::uint32_t ParallelWeldCornerCount = 4 * 1024 * 1024;
+
+	void GatherPositions(const Mesh& inMesh, std::vector<glm::vec3>& outPositions) {
+		outPositions.resize(inMesh.Vertices.size());
+		for (size_t i = 0, end = outPositions.size(); i < end; ++i) {
+			outPositions[i] = inMesh.Vertices[i].mPos;
+		}
+	}
+
+	void ComputeBounds(Mesh& ioMesh) {
+		if (ioMesh.Vertices.empty()) return;
+
+		ioMesh.BoundsMin = ioMesh.Vertices[0].mPos;
+		ioMesh.BoundsMax = ioMesh.Vertices[0].mPos;
+		for (const auto& vertex : ioMesh.Vertices) {
+			ioMesh.BoundsMin = glm::min(ioMesh.BoundsMin, vertex.mPos);
+			ioMesh.BoundsMax = glm::max(ioMesh.BoundsMax, vertex.mPos);
+		}
+
+		ioMesh.BoundsCenter = (ioMesh.BoundsMin + ioMesh.BoundsMax) * 0.5f;
+
+		float radiusSq = 0.0f;
+		for (const auto& vertex : ioMesh.Vertices) {
+			glm::vec3 offset = vertex.mPos - ioMesh.BoundsCenter;
+			radiusSq = std::max(radiusSq, glm::dot(offset, offset));
+		}
+		ioMesh.BoundsRadius = std::sqrt(radiusSq);
+	}
+
+	// Faces index positions and texture coordinates separately, so every corner becomes a full vertex and
+	// identical ones are merged. The weld table only lives until the mesh has its vertices.
+	void WeldMesh(const ObjData& inObj, const MeshImportOptions& inOptions, ThreadPool& inThreadPool, Mesh& ioMesh) {
+		auto buildVertex = [&](const ObjCorner& inCorner, Vertex& outVertex) {
+			outVertex = {};
+			outVertex.mPos = inObj.Positions[inCorner.Position];
+
+			if (inCorner.TexCoord != ObjNullIndex) {
+				const auto& texCoord = inObj.TexCoords[inCorner.TexCoord];
+				outVertex.mTexCoord = { texCoord.x, texCoord.y };
+			}
+
+			outVertex.mColor = { 1.0f, 1.0f, 1.0f };
+		};
+
+		const std::uint32_t cornerCount = static_cast<std::uint32_t>(inObj.Corners.size());
+		ioMesh.Indices.resize(cornerCount);
+
+		if (inOptions.bParallelWelding && cornerCount >= ParallelWeldCornerCount) {
+			std::vector<Vertex> corners(cornerCount);
+
+			const std::uint32_t taskCount = inThreadPool.GetThreadCount();
+			inThreadPool.Run(taskCount, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+				std::uint32_t begin = static_cast<std::uint32_t>(static_cast<std::uint64_t>(cornerCount) * inTaskIndex / taskCount);
+				std::uint32_t end = static_cast<std::uint32_t>(static_cast<std::uint64_t>(cornerCount) * (inTaskIndex + 1) / taskCount);
+				for (std::uint32_t i = begin; i < end; ++i) {
+					buildVertex(inObj.Corners[i], corners[i]);
+				}
+			});
+
+			std::vector<std::uint32_t> remap;
+			std::uint32_t vertexCount = WeldVerticesSorted<FullVertexLayout>(corners.data(), cornerCount, inThreadPool, remap);
+
+			ioMesh.Vertices.resize(vertexCount);
+			for (std::uint32_t i = 0; i < cornerCount; ++i) {
+				ioMesh.Vertices[remap[i]] = corners[i];
+				ioMesh.Indices[i] = remap[i];
+			}
+
+			return;
+		}
+
+		// Most corners share a vertex with others, so there are usually about as many unique vertices as
+		// positions or texture coordinates.
+		std::uint32_t expectedCount = static_cast<std::uint32_t>(std::max(inObj.Positions.size(), inObj.TexCoords.size()));
+
+		VertexWelder welder;
+		welder.Reset(expectedCount);
+		ioMesh.Vertices.reserve(expectedCount);
+
+		Vertex vertex;
+		for (std::uint32_t i = 0; i < cornerCount; ++i) {
+			buildVertex(inObj.Corners[i], vertex);
+
+			std::uint32_t vertexCount = static_cast<std::uint32_t>(ioMesh.Vertices.size());
+			std::uint32_t index = welder.Weld<FullVertexLayout>(vertex, ioMesh.Vertices.data(), vertexCount);
+			if (index == vertexCount) ioMesh.Vertices.push_back(vertex);
+
+			ioMesh.Indices[i] = index;
+		}
+	}
+
+	// Reorders the full-detail indices so that each meshlet is a contiguous range. Must run before the
+	// coarser levels are appended.
+	bool BuildMeshMeshlets(Mesh& ioMesh) {
+		if (ioMesh.Indices.size() < MinMeshletMeshTriangleCount * 3) return true;
+
+		std::vector<glm::vec3> positions;
+		GatherPositions(ioMesh, positions);
+
+		std::vector<std::uint32_t> clusteredIndices;
+		CheckReturn(BuildMeshlets(positions, ioMesh.Indices, MaxMeshletVertices, MaxMeshletTriangles, clusteredIndices, ioMesh.Meshlets));
+		ioMesh.Indices.swap(clusteredIndices);
+
+		return true;
+	}
+
+	// Raw OBJ order is close to the worst case for the post-transform cache. Triangles are reordered for the
+	// cache, whole clusters for overdraw, and the vertices by first use; coarser levels are optimized when built.
+	bool OptimizeMesh(const std::string& inFilePath, const MeshImportOptions& inOptions, Mesh& ioMesh) {
+		float rawAcmr = 0.0f;
+		float rawAtvr = 0.0f;
+		AnalyzeVertexCache(ioMesh.Indices, VertexCacheSize, rawAcmr, rawAtvr);
+
+		CheckReturn(BuildMeshMeshlets(ioMesh));
+
+		std::vector<std::uint32_t> optimizedIndices;
+		if (ioMesh.Meshlets.empty()) {
+			OptimizeVertexCache(ioMesh.Indices, optimizedIndices);
+			ioMesh.Indices.swap(optimizedIndices);
+
+			if (inOptions.bOverdrawOrdering) {
+				std::vector<glm::vec3> positions;
+				GatherPositions(ioMesh, positions);
+				OptimizeOverdraw(positions, ioMesh.Indices);
+			}
+		}
+		else {
+			// Meshlets have to stay contiguous, so the cache order is built inside each of them and the
+			// meshlets themselves are the overdraw clusters.
+			auto& meshlets = ioMesh.Meshlets;
+			if (inOptions.bOverdrawOrdering) {
+				const glm::vec3 center = ioMesh.BoundsCenter;
+				std::stable_sort(meshlets.begin(), meshlets.end(), [&](const Meshlet& inLhs, const Meshlet& inRhs) {
+					float lhs = inLhs.ConeCutoff < 1.0f ? glm::dot(inLhs.Center - center, inLhs.ConeAxis) : 0.0f;
+					float rhs = inRhs.ConeCutoff < 1.0f ? glm::dot(inRhs.Center - center, inRhs.ConeAxis) : 0.0f;
+					return lhs > rhs;
+				});
+			}
+
+			std::vector<std::uint32_t> meshletIndices;
+			std::vector<std::uint32_t> optimizedMeshletIndices;
+			optimizedIndices.reserve(ioMesh.Indices.size());
+			for (auto& meshlet : meshlets) {
+				auto begin = ioMesh.Indices.begin() + meshlet.FirstIndex;
+				meshletIndices.assign(begin, begin + meshlet.TriangleCount * 3);
+				OptimizeVertexCache(meshletIndices, optimizedMeshletIndices);
+
+				meshlet.FirstIndex = static_cast<std::uint32_t>(optimizedIndices.size());
+				optimizedIndices.insert(optimizedIndices.end(), optimizedMeshletIndices.begin(), optimizedMeshletIndices.end());
+			}
+			ioMesh.Indices.swap(optimizedIndices);
+
+			BuildMeshletBounds(ioMesh);
+		}
+
+		std::vector<std::uint32_t> remap;
+		std::uint32_t vertexCount = OptimizeVertexFetch(static_cast<std::uint32_t>(ioMesh.Vertices.size()), ioMesh.Indices, remap);
+
+		std::vector<Vertex> vertices(vertexCount);
+		for (size_t i = 0, end = remap.size(); i < end; ++i) {
+			if (remap[i] != UINT32_MAX) vertices[remap[i]] = ioMesh.Vertices[i];
+		}
+		ioMesh.Vertices.swap(vertices);
+
+		// Vertex offsets are applied by the draws, so the indices only have to address the mesh's own vertices.
+		ioMesh.IndexType = vertexCount <= MaxShortIndexVertexCount ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+		float acmr = 0.0f;
+		float atvr = 0.0f;
+		AnalyzeVertexCache(ioMesh.Indices, VertexCacheSize, acmr, atvr);
+
+		std::wstringstream wsstream;
+		wsstream << inFilePath.c_str() << L": " << ioMesh.Indices.size() / 3 << L" triangles, " << vertexCount << L" vertices, "
+			<< (ioMesh.IndexType == VK_INDEX_TYPE_UINT16 ? L"16" : L"32") << L"-bit indices, ACMR "
+			<< rawAcmr << L" -> " << acmr << L", ATVR " << rawAtvr << L" -> " << atvr;
+		WLogln(wsstream.str());
+
+		return true;
+	}
+
+	// Each level halves the triangles of the one before, simplified from the full-detail indices so that
+	// its error is measured against the original surface.
+	bool BuildMeshLods(Mesh& ioMesh) {
+		MeshLod baseLod;
+		baseLod.IndexCount = static_cast<std::uint32_t>(ioMesh.Indices.size());
+		ioMesh.Lods.push_back(baseLod);
+
+		std::vector<glm::vec3> positions;
+		GatherPositions(ioMesh, positions);
+
+		const std::vector<std::uint32_t> baseIndices = ioMesh.Indices;
+		std::vector<std::uint32_t> lodIndices;
+		std::vector<std::uint32_t> optimizedIndices;
+
+		while (ioMesh.Lods.size() < MaxLodCount) {
+			std::uint32_t prevIndexCount = ioMesh.Lods.back().IndexCount;
+			std::uint32_t targetIndexCount = prevIndexCount / 6 * 3;
+			if (targetIndexCount < MinLodTriangleCount * 3) break;
+
+			float error = 0.0f;
+			CheckReturn(SimplifyMesh(positions, baseIndices, targetIndexCount, lodIndices, error));
+			OptimizeVertexCache(lodIndices, optimizedIndices);
+			lodIndices.swap(optimizedIndices);
+
+			// Locked seams and borders can stop the simplifier early; such a level is not worth keeping.
+			if (lodIndices.size() * 4 > static_cast<size_t>(prevIndexCount) * 3) break;
+
+			MeshLod lod;
+			lod.FirstIndex = static_cast<std::uint32_t>(ioMesh.Indices.size());
+			lod.IndexCount = static_cast<std::uint32_t>(lodIndices.size());
+			lod.Error = error;
+			ioMesh.Lods.push_back(lod);
+
+			ioMesh.Indices.insert(ioMesh.Indices.end(), lodIndices.begin(), lodIndices.end());
+		}
+
+		return true;
+	}
+
+	// Positions are scaled per axis to fill the snorm16 range over the mesh bounds. Texture coordinates use
+	// unorm16 when all of them lie in [0, 1], which is finer than half floats over the upper half of the range.
+	void QuantizeVertices(const std::string& inFilePath, Mesh& ioMesh, std::vector<CompactVertex>& outVertices) {
+		const auto& vertices = ioMesh.Vertices;
+
+		glm::vec3 offset = ioMesh.BoundsCenter;
+		glm::vec3 scale = (ioMesh.BoundsMax - ioMesh.BoundsMin) * 0.5f;
+		for (int i = 0; i < 3; ++i) {
+			// Flat axes quantize to zero whatever the scale.
+			if (scale[i] <= 0.0f) scale[i] = 1.0f;
+		}
+
+		bool bUnormTexCoords = true;
+		for (const auto& vertex : vertices) {
+			if (vertex.mTexCoord.x < 0.0f || vertex.mTexCoord.x > 1.0f || vertex.mTexCoord.y < 0.0f || vertex.mTexCoord.y > 1.0f) {
+				bUnormTexCoords = false;
+				break;
+			}
+		}
+
+		ioMesh.VertexFormat = bUnormTexCoords ? VertexFormats::ECompactVertex : VertexFormats::ECompactHalfVertex;
+		ioMesh.Dequantization = glm::translate(glm::mat4(1.0f), offset) * glm::scale(glm::mat4(1.0f), scale);
+
+		float maxPositionError = 0.0f;
+		float maxTexCoordError = 0.0f;
+
+		outVertices.resize(vertices.size());
+		for (size_t i = 0, end = vertices.size(); i < end; ++i) {
+			const auto& vertex = vertices[i];
+			auto& compact = outVertices[i];
+
+			glm::vec3 normalized = (vertex.mPos - offset) / scale;
+			for (int c = 0; c < 3; ++c) {
+				std::uint16_t packed = glm::packSnorm1x16(normalized[c]);
+				std::memcpy(&compact.mPos[c], &packed, sizeof(packed));
+
+				float decoded = glm::unpackSnorm1x16(packed) * scale[c] + offset[c];
+				maxPositionError = std::max(maxPositionError, std::abs(decoded - vertex.mPos[c]));
+			}
+			compact.mPos[3] = 0;
+
+			for (int c = 0; c < 2; ++c) {
+				float decoded = 0.0f;
+				if (bUnormTexCoords) {
+					compact.mTexCoord[c] = glm::packUnorm1x16(vertex.mTexCoord[c]);
+					decoded = glm::unpackUnorm1x16(compact.mTexCoord[c]);
+				}
+				else {
+					compact.mTexCoord[c] = glm::packHalf1x16(vertex.mTexCoord[c]);
+					decoded = glm::unpackHalf1x16(compact.mTexCoord[c]);
+				}
+				maxTexCoordError = std::max(maxTexCoordError, std::abs(decoded - vertex.mTexCoord[c]));
+			}
+		}
+
+		std::wstringstream wsstream;
+		wsstream << inFilePath.c_str() << L": " << sizeof(CompactVertex) << L"-byte vertices ("
+			<< (bUnormTexCoords ? L"unorm16" : L"half") << L" UVs), " << vertices.size() * sizeof(Vertex) / 1024 << L" KB -> "
+			<< outVertices.size() * sizeof(CompactVertex) / 1024 << L" KB, max position error " << maxPositionError
+			<< L" (" << (ioMesh.BoundsRadius > 0.0f ? maxPositionError / ioMesh.BoundsRadius : 0.0f)
+			<< L" of the radius), max UV error " << maxTexCoordError;
+		WLogln(wsstream.str());
+	}
+}
+
+bool ImportMesh(const std::string& inFilePath, const MeshImportOptions& inOptions, ThreadPool& inThreadPool, Mesh& outMesh) {
+	ObjData obj;
+	CheckReturn(LoadObjFile(inFilePath, inThreadPool, obj));
+
+	WeldMesh(obj, inOptions, inThreadPool, outMesh);
+
+	ComputeBounds(outMesh);
+	CheckReturn(OptimizeMesh(inFilePath, inOptions, outMesh));
+	CheckReturn(BuildMeshLods(outMesh));
+
+	return true;
+}
+
+void FinishMeshImport(const std::string& inFilePath, const MeshImportOptions& inOptions, MeshImport& ioImport) {
+	auto& mesh = *ioImport.pMesh;
+
+	// Flipping maps distinct texture coordinates to distinct ones, so the welded vertices stay unique.
+	if (inOptions.bFlipped) {
+		for (auto& vertex : mesh.Vertices) {
+			vertex.mTexCoord.y = 1.0f - vertex.mTexCoord.y;
+		}
+	}
+
+	// The float vertices stay on the CPU for culling and picking either way.
+	if (inOptions.bCompactVertices) QuantizeVertices(inFilePath, mesh, ioImport.CompactVertices);
+}
+
+void BuildMeshletBounds(Mesh& ioMesh) {
+	ioMesh.MeshletBounds.Clear();
+	ioMesh.MeshletBounds.Reserve(static_cast<std::uint32_t>(ioMesh.Meshlets.size()));
+	for (const auto& meshlet : ioMesh.Meshlets) {
+		ioMesh.MeshletBounds.Add(meshlet.Center, meshlet.Radius, meshlet.Extents);
+	}
+}
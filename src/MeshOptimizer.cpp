@@ -0,0 +1,266 @@
+#include "MeshOptimizer.h"
+
+namespace {
+	const std::uint32_t NullIndex = UINT32_MAX;
+
+	// Scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation".
+	const std::uint32_t MaxCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	// Triangles whose vertices were all missing from a cache of this size start a new overdraw cluster.
+	const std::uint32_t ClusterCacheSize = 16;
+	const std::uint32_t MinClusterTriangleCount = 32;
+
+	float VertexScore(std::uint32_t inCachePosition, std::uint32_t inRemainingTriangles) {
+		if (inRemainingTriangles == 0) return -1.0f;
+
+		float score = 0.0f;
+		if (inCachePosition != NullIndex) {
+			// The three vertices of the last triangle get a fixed score, so that no order among them is preferred.
+			if (inCachePosition < 3) {
+				score = LastTriangleScore;
+			}
+			else {
+				float scaler = 1.0f / static_cast<float>(MaxCacheSize - 3);
+				score = std::pow(1.0f - static_cast<float>(inCachePosition - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		// Vertices with few triangles left are finished off first, to avoid leaving lone triangles behind.
+		score += ValenceBoostScale * std::pow(static_cast<float>(inRemainingTriangles), -ValenceBoostPower);
+
+		return score;
+	}
+
+	// Maps the referenced vertices onto [0, count), so that the working arrays only cover them.
+	std::uint32_t CompactIndices(const std::vector<std::uint32_t>& inIndices, std::vector<std::uint32_t>& outLocal, std::vector<std::uint32_t>& outVertices) {
+		outVertices = inIndices;
+		std::sort(outVertices.begin(), outVertices.end());
+		outVertices.erase(std::unique(outVertices.begin(), outVertices.end()), outVertices.end());
+
+		outLocal.resize(inIndices.size());
+		for (size_t i = 0, end = inIndices.size(); i < end; ++i) {
+			outLocal[i] = static_cast<std::uint32_t>(std::lower_bound(outVertices.begin(), outVertices.end(), inIndices[i]) - outVertices.begin());
+		}
+
+		return static_cast<std::uint32_t>(outVertices.size());
+	}
+}
+
+void OptimizeVertexCache(const std::vector<std::uint32_t>& inIndices, std::vector<std::uint32_t>& outIndices) {
+	const std::uint32_t triangleCount = static_cast<std::uint32_t>(inIndices.size() / 3);
+
+	std::vector<std::uint32_t> indices;
+	std::vector<std::uint32_t> vertices;
+	const std::uint32_t vertexCount = CompactIndices(inIndices, indices, vertices);
+
+	std::vector<std::uint32_t> triangleOffsets(vertexCount + 1, 0);
+	for (std::uint32_t index : indices) {
+		++triangleOffsets[index + 1];
+	}
+	for (std::uint32_t i = 0; i < vertexCount; ++i) {
+		triangleOffsets[i + 1] += triangleOffsets[i];
+	}
+
+	// Triangles still to be emitted per vertex; emitted ones are swapped past the end of the live part.
+	std::vector<std::uint32_t> vertexTriangles(indices.size());
+	std::vector<std::uint32_t> remaining(vertexCount, 0);
+	for (std::uint32_t i = 0, end = static_cast<std::uint32_t>(indices.size()); i < end; ++i) {
+		std::uint32_t vertex = indices[i];
+		vertexTriangles[triangleOffsets[vertex] + remaining[vertex]++] = i / 3;
+	}
+
+	std::vector<std::uint32_t> cachePositions(vertexCount, NullIndex);
+	std::vector<float> vertexScores(vertexCount);
+	for (std::uint32_t i = 0; i < vertexCount; ++i) {
+		vertexScores[i] = VertexScore(NullIndex, remaining[i]);
+	}
+
+	std::vector<bool> bEmitted(triangleCount, false);
+	std::vector<std::uint32_t> cache;
+	std::vector<std::uint32_t> newCache;
+	cache.reserve(MaxCacheSize + 3);
+	newCache.reserve(MaxCacheSize + 3);
+
+	outIndices.clear();
+	outIndices.reserve(inIndices.size());
+
+	std::uint32_t bestTriangle = NullIndex;
+	std::uint32_t nextCandidate = 0;
+
+	for (std::uint32_t emitted = 0; emitted < triangleCount; ++emitted) {
+		// Only triangles touching the cache are scored; when none is left, the best of the rest would
+		// need a full scan, so the next unemitted one in input order is taken instead.
+		if (bestTriangle == NullIndex) {
+			while (bEmitted[nextCandidate]) ++nextCandidate;
+			bestTriangle = nextCandidate;
+		}
+
+		bEmitted[bestTriangle] = true;
+
+		newCache.clear();
+		for (std::uint32_t v = 0; v < 3; ++v) {
+			std::uint32_t vertex = indices[bestTriangle * 3 + v];
+			outIndices.push_back(vertices[vertex]);
+			newCache.push_back(vertex);
+
+			std::uint32_t begin = triangleOffsets[vertex];
+			std::uint32_t last = begin + remaining[vertex] - 1;
+			for (std::uint32_t i = begin; i <= last; ++i) {
+				if (vertexTriangles[i] == bestTriangle) {
+					std::swap(vertexTriangles[i], vertexTriangles[last]);
+					break;
+				}
+			}
+			--remaining[vertex];
+		}
+
+		for (std::uint32_t vertex : cache) {
+			if (vertex != newCache[0] && vertex != newCache[1] && vertex != newCache[2]) newCache.push_back(vertex);
+		}
+
+		// Vertices pushed out of the cache lose their cache score.
+		for (size_t i = MaxCacheSize; i < newCache.size(); ++i) {
+			std::uint32_t vertex = newCache[i];
+			cachePositions[vertex] = NullIndex;
+			vertexScores[vertex] = VertexScore(NullIndex, remaining[vertex]);
+		}
+		if (newCache.size() > MaxCacheSize) newCache.resize(MaxCacheSize);
+		cache.swap(newCache);
+
+		for (std::uint32_t i = 0, end = static_cast<std::uint32_t>(cache.size()); i < end; ++i) {
+			std::uint32_t vertex = cache[i];
+			cachePositions[vertex] = i;
+			vertexScores[vertex] = VertexScore(i, remaining[vertex]);
+		}
+
+		bestTriangle = NullIndex;
+		float bestScore = -1.0f;
+		for (std::uint32_t vertex : cache) {
+			for (std::uint32_t i = triangleOffsets[vertex], end = i + remaining[vertex]; i < end; ++i) {
+				std::uint32_t triangle = vertexTriangles[i];
+				float score =
+					vertexScores[indices[triangle * 3 + 0]] +
+					vertexScores[indices[triangle * 3 + 1]] +
+					vertexScores[indices[triangle * 3 + 2]];
+
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = triangle;
+				}
+			}
+		}
+	}
+}
+
+void OptimizeOverdraw(const std::vector<glm::vec3>& inPositions, std::vector<std::uint32_t>& ioIndices) {
+	const std::uint32_t triangleCount = static_cast<std::uint32_t>(ioIndices.size() / 3);
+	if (triangleCount == 0) return;
+
+	std::vector<std::uint32_t> clusterStarts;
+	{
+		std::deque<std::uint32_t> cache;
+		for (std::uint32_t i = 0; i < triangleCount; ++i) {
+			std::uint32_t missCount = 0;
+			for (std::uint32_t v = 0; v < 3; ++v) {
+				std::uint32_t index = ioIndices[i * 3 + v];
+				if (std::find(cache.begin(), cache.end(), index) != cache.end()) continue;
+
+				++missCount;
+				cache.push_back(index);
+				if (cache.size() > ClusterCacheSize) cache.pop_front();
+			}
+
+			if (clusterStarts.empty() || (missCount == 3 && i - clusterStarts.back() >= MinClusterTriangleCount)) clusterStarts.push_back(i);
+		}
+	}
+	if (clusterStarts.size() < 2) return;
+
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+
+	const std::uint32_t clusterCount = static_cast<std::uint32_t>(clusterStarts.size());
+	std::vector<glm::vec3> clusterCenters(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	std::vector<float> clusterAreas(clusterCount, 0.0f);
+
+	for (std::uint32_t cluster = 0; cluster < clusterCount; ++cluster) {
+		std::uint32_t end = cluster + 1 < clusterCount ? clusterStarts[cluster + 1] : triangleCount;
+		for (std::uint32_t i = clusterStarts[cluster]; i < end; ++i) {
+			const auto& p0 = inPositions[ioIndices[i * 3 + 0]];
+			const auto& p1 = inPositions[ioIndices[i * 3 + 1]];
+			const auto& p2 = inPositions[ioIndices[i * 3 + 2]];
+
+			// Twice the area, which cancels out in the weighted means.
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+
+			clusterCenters[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormals[cluster] += normal;
+			clusterAreas[cluster] += area;
+		}
+
+		meshCenter += clusterCenters[cluster];
+		meshArea += clusterAreas[cluster];
+
+		if (clusterAreas[cluster] > 0.0f) clusterCenters[cluster] /= clusterAreas[cluster];
+	}
+	if (meshArea > 0.0f) meshCenter /= meshArea;
+
+	std::vector<std::pair<float, std::uint32_t>> order(clusterCount);
+	for (std::uint32_t cluster = 0; cluster < clusterCount; ++cluster) {
+		float length = glm::length(clusterNormals[cluster]);
+		glm::vec3 normal = length > 0.0f ? clusterNormals[cluster] / length : glm::vec3(0.0f);
+
+		order[cluster] = std::make_pair(-glm::dot(clusterCenters[cluster] - meshCenter, normal), cluster);
+	}
+	std::stable_sort(order.begin(), order.end(), [](const auto& inLhs, const auto& inRhs) {
+		return inLhs.first < inRhs.first;
+	});
+
+	std::vector<std::uint32_t> indices;
+	indices.reserve(ioIndices.size());
+	for (const auto& entry : order) {
+		std::uint32_t cluster = entry.second;
+		std::uint32_t end = cluster + 1 < clusterCount ? clusterStarts[cluster + 1] : triangleCount;
+		indices.insert(indices.end(), ioIndices.begin() + clusterStarts[cluster] * 3, ioIndices.begin() + end * 3);
+	}
+	ioIndices.swap(indices);
+}
+
+std::uint32_t OptimizeVertexFetch(std::uint32_t inVertexCount, std::vector<std::uint32_t>& ioIndices, std::vector<std::uint32_t>& outRemap) {
+	outRemap.assign(inVertexCount, NullIndex);
+
+	std::uint32_t nextVertex = 0;
+	for (auto& index : ioIndices) {
+		if (outRemap[index] == NullIndex) outRemap[index] = nextVertex++;
+		index = outRemap[index];
+	}
+
+	return nextVertex;
+}
+
+void AnalyzeVertexCache(const std::vector<std::uint32_t>& inIndices, std::uint32_t inCacheSize, float& outAcmr, float& outAtvr) {
+	outAcmr = 0.0f;
+	outAtvr = 0.0f;
+	if (inIndices.empty()) return;
+
+	std::uint32_t vertexCount = 0;
+	std::unordered_map<std::uint32_t, std::uint64_t> entryTimes;
+
+	// A vertex is in the FIFO if it entered within the last inCacheSize misses.
+	std::uint64_t missCount = 0;
+	for (std::uint32_t index : inIndices) {
+		auto result = entryTimes.emplace(index, 0);
+		if (result.second) ++vertexCount;
+		else if (missCount - result.first->second <= inCacheSize) continue;
+
+		result.first->second = missCount++;
+	}
+
+	outAcmr = static_cast<float>(static_cast<double>(missCount) / static_cast<double>(inIndices.size() / 3));
+	outAtvr = static_cast<float>(static_cast<double>(missCount) / static_cast<double>(vertexCount));
+}
\ No newline at end of file
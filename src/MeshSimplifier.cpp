@@ -0,0 +1,235 @@
+#include "MeshSimplifier.h"
+
+namespace {
+	// Symmetric 4x4 matrix of the plane equations, plus the total weight of the planes.
+	struct Quadric {
+		double A00 = 0.0, A01 = 0.0, A02 = 0.0, A03 = 0.0;
+		double A11 = 0.0, A12 = 0.0, A13 = 0.0;
+		double A22 = 0.0, A23 = 0.0;
+		double A33 = 0.0;
+		double Weight = 0.0;
+
+		void AddPlane(const glm::dvec3& inNormal, double inDist, double inWeight) {
+			A00 += inWeight * inNormal.x * inNormal.x;
+			A01 += inWeight * inNormal.x * inNormal.y;
+			A02 += inWeight * inNormal.x * inNormal.z;
+			A03 += inWeight * inNormal.x * inDist;
+			A11 += inWeight * inNormal.y * inNormal.y;
+			A12 += inWeight * inNormal.y * inNormal.z;
+			A13 += inWeight * inNormal.y * inDist;
+			A22 += inWeight * inNormal.z * inNormal.z;
+			A23 += inWeight * inNormal.z * inDist;
+			A33 += inWeight * inDist * inDist;
+			Weight += inWeight;
+		}
+
+		void Add(const Quadric& inOther) {
+			A00 += inOther.A00; A01 += inOther.A01; A02 += inOther.A02; A03 += inOther.A03;
+			A11 += inOther.A11; A12 += inOther.A12; A13 += inOther.A13;
+			A22 += inOther.A22; A23 += inOther.A23;
+			A33 += inOther.A33;
+			Weight += inOther.Weight;
+		}
+
+		// Weighted mean of the squared distances to the planes.
+		double Evaluate(const glm::vec3& inPoint) const {
+			double x = inPoint.x, y = inPoint.y, z = inPoint.z;
+			double error =
+				A00 * x * x + 2.0 * A01 * x * y + 2.0 * A02 * x * z + 2.0 * A03 * x +
+				A11 * y * y + 2.0 * A12 * y * z + 2.0 * A13 * y +
+				A22 * z * z + 2.0 * A23 * z +
+				A33;
+			return Weight > 0.0 ? std::max(error, 0.0) / Weight : 0.0;
+		}
+	};
+
+	struct Collapse {
+		double Cost;
+		std::uint32_t From;
+		std::uint32_t To;
+	};
+
+	const float MinNormalCosine = 0.25f;
+
+	std::uint64_t EdgeKey(std::uint32_t inA, std::uint32_t inB) {
+		return (static_cast<std::uint64_t>(std::min(inA, inB)) << 32) | std::max(inA, inB);
+	}
+}
+
+bool SimplifyMesh(
+		const std::vector<glm::vec3>& inPositions,
+		const std::vector<std::uint32_t>& inIndices,
+		std::uint32_t inTargetIndexCount,
+		std::vector<std::uint32_t>& outIndices,
+		float& outError) {
+	const std::uint32_t vertexCount = static_cast<std::uint32_t>(inPositions.size());
+	if (inIndices.size() % 3 != 0) ReturnFalse(L"Index count is not a multiple of three");
+
+	outIndices = inIndices;
+	outError = 0.0f;
+
+	// Vertices sharing a position collapse onto the first of them for the topology.
+	std::vector<std::uint32_t> canonical(vertexCount);
+	std::vector<std::uint32_t> wedgeCount(vertexCount, 0);
+	{
+		std::unordered_map<glm::vec3, std::uint32_t> firstByPosition;
+		for (std::uint32_t i = 0; i < vertexCount; ++i) {
+			auto iter = firstByPosition.emplace(inPositions[i], i).first;
+			canonical[i] = iter->second;
+			++wedgeCount[iter->second];
+		}
+	}
+
+	std::vector<bool> bLocked(vertexCount, false);
+	{
+		std::unordered_map<std::uint64_t, std::uint32_t> edgeUses;
+		for (size_t i = 0; i < inIndices.size(); i += 3) {
+			for (std::uint32_t e = 0; e < 3; ++e) {
+				++edgeUses[EdgeKey(canonical[inIndices[i + e]], canonical[inIndices[i + (e + 1) % 3]])];
+			}
+		}
+		for (const auto& edge : edgeUses) {
+			if (edge.second != 1) continue;
+
+			bLocked[static_cast<std::uint32_t>(edge.first >> 32)] = true;
+			bLocked[static_cast<std::uint32_t>(edge.first & 0xFFFFFFFF)] = true;
+		}
+		for (std::uint32_t i = 0; i < vertexCount; ++i) {
+			if (wedgeCount[canonical[i]] > 1) bLocked[i] = true;
+			else if (bLocked[canonical[i]]) bLocked[i] = true;
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < inIndices.size(); i += 3) {
+		glm::dvec3 p0 = inPositions[inIndices[i + 0]];
+		glm::dvec3 p1 = inPositions[inIndices[i + 1]];
+		glm::dvec3 p2 = inPositions[inIndices[i + 2]];
+
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double length = glm::length(normal);
+		if (length <= 0.0) continue;
+		normal /= length;
+
+		// Weighted by area, so that small slivers do not dominate the error.
+		double weight = length * 0.5;
+		for (std::uint32_t v = 0; v < 3; ++v) {
+			quadrics[canonical[inIndices[i + v]]].AddPlane(normal, -glm::dot(normal, p0), weight);
+		}
+	}
+
+	std::vector<std::uint32_t> remap(vertexCount);
+	std::vector<bool> bTouched(vertexCount);
+	std::vector<std::uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<std::uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+	double maxError = 0.0;
+
+	while (outIndices.size() > inTargetIndexCount) {
+		const std::uint32_t triangleCount = static_cast<std::uint32_t>(outIndices.size() / 3);
+
+		// Triangles around each vertex, as a compressed list.
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (std::uint32_t index : outIndices) {
+			++triangleOffsets[index + 1];
+		}
+		for (std::uint32_t i = 0; i < vertexCount; ++i) {
+			triangleOffsets[i + 1] += triangleOffsets[i];
+		}
+		vertexTriangles.resize(outIndices.size());
+		{
+			std::vector<std::uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (std::uint32_t i = 0; i < outIndices.size(); ++i) {
+				vertexTriangles[cursor[outIndices[i]]++] = i / 3;
+			}
+		}
+
+		collapses.clear();
+		for (std::uint32_t t = 0; t < triangleCount; ++t) {
+			for (std::uint32_t e = 0; e < 3; ++e) {
+				std::uint32_t from = outIndices[t * 3 + e];
+				std::uint32_t to = outIndices[t * 3 + (e + 1) % 3];
+
+				for (std::uint32_t direction = 0; direction < 2; ++direction) {
+					if (!bLocked[from]) {
+						Quadric quadric = quadrics[canonical[from]];
+						quadric.Add(quadrics[canonical[to]]);
+						collapses.push_back({ quadric.Evaluate(inPositions[to]), from, to });
+					}
+					std::swap(from, to);
+				}
+			}
+		}
+		if (collapses.empty()) break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& inLhs, const Collapse& inRhs) {
+			return std::tie(inLhs.Cost, inLhs.From, inLhs.To) < std::tie(inRhs.Cost, inRhs.From, inRhs.To);
+		});
+
+		// Every collapse removes about two triangles; stopping at the target keeps the cheapest ones.
+		std::uint32_t collapseLimit = static_cast<std::uint32_t>((outIndices.size() - inTargetIndexCount) / 6 + 1);
+
+		for (std::uint32_t i = 0; i < vertexCount; ++i) {
+			remap[i] = i;
+		}
+		std::fill(bTouched.begin(), bTouched.end(), false);
+
+		std::uint32_t collapseCount = 0;
+		for (const auto& collapse : collapses) {
+			if (collapseCount >= collapseLimit) break;
+			if (bTouched[collapse.From] || bTouched[collapse.To]) continue;
+
+			// Moving the vertex must not flip any of the triangles that survive the collapse.
+			bool bFlips = false;
+			for (std::uint32_t j = triangleOffsets[collapse.From]; j < triangleOffsets[collapse.From + 1] && !bFlips; ++j) {
+				const std::uint32_t* pTriangle = &outIndices[vertexTriangles[j] * 3];
+				if (pTriangle[0] == collapse.To || pTriangle[1] == collapse.To || pTriangle[2] == collapse.To) continue;
+
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (std::uint32_t v = 0; v < 3; ++v) {
+					before[v] = inPositions[pTriangle[v]];
+					after[v] = pTriangle[v] == collapse.From ? inPositions[collapse.To] : before[v];
+				}
+
+				glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				// Also rejects rotations close to a fold, which later passes would finish.
+				float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+				bFlips = glm::dot(normalBefore, normalAfter) <= MinNormalCosine * lengths;
+			}
+			if (bFlips) continue;
+
+			remap[collapse.From] = collapse.To;
+			quadrics[canonical[collapse.To]].Add(quadrics[canonical[collapse.From]]);
+			maxError = std::max(maxError, collapse.Cost);
+			++collapseCount;
+
+			// Later collapses this pass must not see stale neighbourhoods.
+			for (std::uint32_t j = triangleOffsets[collapse.From]; j < triangleOffsets[collapse.From + 1]; ++j) {
+				const std::uint32_t* pTriangle = &outIndices[vertexTriangles[j] * 3];
+				bTouched[pTriangle[0]] = true;
+				bTouched[pTriangle[1]] = true;
+				bTouched[pTriangle[2]] = true;
+			}
+		}
+		if (collapseCount == 0) break;
+
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < outIndices.size(); i += 3) {
+			std::uint32_t i0 = remap[outIndices[i + 0]];
+			std::uint32_t i1 = remap[outIndices[i + 1]];
+			std::uint32_t i2 = remap[outIndices[i + 2]];
+			if (i0 == i1 || i1 == i2 || i0 == i2) continue;
+
+			outIndices[writeIndex++] = i0;
+			outIndices[writeIndex++] = i1;
+			outIndices[writeIndex++] = i2;
+		}
+		outIndices.resize(writeIndex);
+	}
+
+	outError = static_cast<float>(std::sqrt(maxError));
+
+	return true;
+}
\ No newline at end of file
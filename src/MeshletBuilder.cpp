@@ -0,0 +1,202 @@
+#include "MeshletBuilder.h"
+
+namespace {
+	const std::uint32_t NullIndex = UINT32_MAX;
+
+	// Cones wider than this (cosine of the half angle) reject too little to be worth testing.
+	const float MinConeCosine = 0.1f;
+
+	void ComputeMeshletBounds(
+			const std::vector<glm::vec3>& inPositions,
+			const std::vector<std::uint32_t>& inIndices,
+			const std::vector<glm::vec3>& inNormals,
+			const std::vector<std::uint32_t>& inTriangles,
+			Meshlet& ioMeshlet) {
+		glm::vec3 minPos(std::numeric_limits<float>::max());
+		glm::vec3 maxPos(-std::numeric_limits<float>::max());
+		glm::vec3 normalSum(0.0f);
+
+		for (std::uint32_t triangle : inTriangles) {
+			for (std::uint32_t v = 0; v < 3; ++v) {
+				const auto& pos = inPositions[inIndices[triangle * 3 + v]];
+				minPos = glm::min(minPos, pos);
+				maxPos = glm::max(maxPos, pos);
+			}
+			normalSum += inNormals[triangle];
+		}
+
+		ioMeshlet.Center = (minPos + maxPos) * 0.5f;
+		ioMeshlet.Extents = (maxPos - minPos) * 0.5f;
+		ioMeshlet.Radius = 0.0f;
+		for (std::uint32_t triangle : inTriangles) {
+			for (std::uint32_t v = 0; v < 3; ++v) {
+				ioMeshlet.Radius = std::max(ioMeshlet.Radius, glm::distance(ioMeshlet.Center, inPositions[inIndices[triangle * 3 + v]]));
+			}
+		}
+
+		ioMeshlet.ConeCutoff = 1.0f;
+
+		float length = glm::length(normalSum);
+		if (length <= 0.0f) return;
+
+		glm::vec3 axis = normalSum / length;
+		float minCosine = 1.0f;
+		for (std::uint32_t triangle : inTriangles) {
+			const auto& normal = inNormals[triangle];
+			if (normal == glm::vec3(0.0f)) continue;
+
+			minCosine = std::min(minCosine, glm::dot(axis, normal));
+		}
+
+		if (minCosine < MinConeCosine) return;
+
+		ioMeshlet.ConeAxis = axis;
+		ioMeshlet.ConeCutoff = std::sqrt(1.0f - minCosine * minCosine);
+	}
+}
+
+bool BuildMeshlets(
+		const std::vector<glm::vec3>& inPositions,
+		const std::vector<std::uint32_t>& inIndices,
+		std::uint32_t inMaxVertices,
+		std::uint32_t inMaxTriangles,
+		std::vector<std::uint32_t>& outIndices,
+		std::vector<Meshlet>& outMeshlets) {
+	const std::uint32_t vertexCount = static_cast<std::uint32_t>(inPositions.size());
+	const std::uint32_t triangleCount = static_cast<std::uint32_t>(inIndices.size() / 3);
+	if (inIndices.size() % 3 != 0) ReturnFalse(L"Index count is not a multiple of three");
+	if (inMaxVertices < 3 || inMaxTriangles == 0) ReturnFalse(L"Meshlet limits are too small for a triangle");
+
+	outIndices.clear();
+	outIndices.reserve(inIndices.size());
+	outMeshlets.clear();
+
+	// Adjacency goes through positions, so that triangles split by attribute seams still grow together.
+	std::vector<std::uint32_t> canonical(vertexCount);
+	{
+		std::unordered_map<glm::vec3, std::uint32_t> firstByPosition;
+		for (std::uint32_t i = 0; i < vertexCount; ++i) {
+			canonical[i] = firstByPosition.emplace(inPositions[i], i).first->second;
+		}
+	}
+
+	std::vector<std::uint32_t> triangleOffsets(vertexCount + 1, 0);
+	for (std::uint32_t index : inIndices) {
+		++triangleOffsets[canonical[index] + 1];
+	}
+	for (std::uint32_t i = 0; i < vertexCount; ++i) {
+		triangleOffsets[i + 1] += triangleOffsets[i];
+	}
+
+	std::vector<std::uint32_t> vertexTriangles(inIndices.size());
+	{
+		std::vector<std::uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (std::uint32_t i = 0, end = static_cast<std::uint32_t>(inIndices.size()); i < end; ++i) {
+			vertexTriangles[fill[canonical[inIndices[i]]]++] = i / 3;
+		}
+	}
+
+	std::vector<glm::vec3> normals(triangleCount, glm::vec3(0.0f));
+	for (std::uint32_t i = 0; i < triangleCount; ++i) {
+		const auto& p0 = inPositions[inIndices[i * 3 + 0]];
+		const auto& p1 = inPositions[inIndices[i * 3 + 1]];
+		const auto& p2 = inPositions[inIndices[i * 3 + 2]];
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length > 0.0f) normals[i] = normal / length;
+	}
+
+	std::vector<bool> bEmitted(triangleCount, false);
+	std::vector<std::uint32_t> vertexMeshlet(vertexCount, NullIndex);
+	std::vector<std::uint32_t> candidateMeshlet(triangleCount, NullIndex);
+	std::vector<std::uint32_t> candidates;
+	std::vector<std::uint32_t> meshletTriangles;
+
+	std::uint32_t nextSeed = 0;
+	while (true) {
+		while (nextSeed < triangleCount && bEmitted[nextSeed]) ++nextSeed;
+		if (nextSeed == triangleCount) break;
+
+		const std::uint32_t meshletIndex = static_cast<std::uint32_t>(outMeshlets.size());
+
+		Meshlet meshlet;
+		meshlet.FirstIndex = static_cast<std::uint32_t>(outIndices.size());
+
+		glm::vec3 normalSum(0.0f);
+		candidates.clear();
+		meshletTriangles.clear();
+
+		std::uint32_t triangle = nextSeed;
+		while (triangle != NullIndex) {
+			bEmitted[triangle] = true;
+			meshletTriangles.push_back(triangle);
+			normalSum += normals[triangle];
+			++meshlet.TriangleCount;
+
+			for (std::uint32_t v = 0; v < 3; ++v) {
+				std::uint32_t index = inIndices[triangle * 3 + v];
+				outIndices.push_back(index);
+
+				if (vertexMeshlet[index] != meshletIndex) {
+					vertexMeshlet[index] = meshletIndex;
+					++meshlet.VertexCount;
+				}
+
+				std::uint32_t vertex = canonical[index];
+				for (std::uint32_t i = triangleOffsets[vertex], end = triangleOffsets[vertex + 1]; i < end; ++i) {
+					std::uint32_t neighbour = vertexTriangles[i];
+					if (bEmitted[neighbour] || candidateMeshlet[neighbour] == meshletIndex) continue;
+
+					candidateMeshlet[neighbour] = meshletIndex;
+					candidates.push_back(neighbour);
+				}
+			}
+
+			if (meshlet.TriangleCount == inMaxTriangles) break;
+
+			// Fewest new vertices first, then the triangle closest to the meshlet's mean facing.
+			float axisLength = glm::length(normalSum);
+			glm::vec3 axis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3(0.0f);
+
+			triangle = NullIndex;
+			float bestScore = std::numeric_limits<float>::max();
+			for (size_t i = 0; i < candidates.size();) {
+				std::uint32_t candidate = candidates[i];
+				if (bEmitted[candidate]) {
+					candidates[i] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				++i;
+
+				std::uint32_t newVertexCount = 0;
+				for (std::uint32_t v = 0; v < 3; ++v) {
+					if (vertexMeshlet[inIndices[candidate * 3 + v]] != meshletIndex) ++newVertexCount;
+				}
+				if (meshlet.VertexCount + newVertexCount > inMaxVertices) continue;
+
+				float score = static_cast<float>(newVertexCount) + 1.0f - glm::dot(axis, normals[candidate]);
+				if (score < bestScore) {
+					bestScore = score;
+					triangle = candidate;
+				}
+			}
+		}
+
+		ComputeMeshletBounds(inPositions, inIndices, normals, meshletTriangles, meshlet);
+		outMeshlets.push_back(meshlet);
+	}
+
+	return true;
+}
+
+bool IsMeshletBackFacing(const Meshlet& inMeshlet, const glm::vec3& inCameraPos) {
+	if (inMeshlet.ConeCutoff >= 1.0f) return false;
+
+	// Conservative over the whole bounding sphere: every point of it has to be seen from behind
+	// by every normal of the cone.
+	glm::vec3 toCenter = inMeshlet.Center - inCameraPos;
+	return glm::dot(toCenter, inMeshlet.ConeAxis) >=
+		inMeshlet.ConeCutoff * glm::length(toCenter) + inMeshlet.Radius * (1.0f + inMeshlet.ConeCutoff);
+}
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+
+#include <cstring>
+
+namespace {
+	// Chunks smaller than this are not worth handing to another thread.
+	const size_t MinChunkSize = 256 * 1024;
+
+	// More chunks than threads, so that lines of uneven cost even out across the workers.
+	const std::uint32_t ChunksPerThread = 4;
+
+	// Largest number of significant decimal digits that fit in a 64-bit mantissa.
+	const int MaxMantissaDigits = 19;
+
+	const double PowersOfTen[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	// A line-aligned range of the text. Both passes walk the same lines, so the counts of the first
+	// one are exactly the number of elements the second one writes.
+	struct ObjChunk {
+		const char* pBegin = nullptr;
+		const char* pEnd = nullptr;
+
+		std::uint32_t PositionCount = 0;
+		std::uint32_t TexCoordCount = 0;
+		std::uint32_t CornerCount = 0;
+
+		// Where the chunk's elements start in the output, from the prefix sum over the counts.
+		std::uint32_t FirstPosition = 0;
+		std::uint32_t FirstTexCoord = 0;
+		std::uint32_t FirstCorner = 0;
+
+		// Start of the first line that failed to parse, if any.
+		const char* pError = nullptr;
+	};
+
+	inline bool IsBlank(char inChar) {
+		return inChar == ' ' || inChar == '\t';
+	}
+
+	inline bool IsDigit(char inChar) {
+		return static_cast<unsigned>(inChar - '0') < 10u;
+	}
+
+	inline bool IsLineEnd(const char* p, const char* pEnd) {
+		return p >= pEnd || *p == '\n' || *p == '\r' || *p == '#';
+	}
+
+	inline const char* SkipBlanks(const char* p, const char* pEnd) {
+		while (p < pEnd && IsBlank(*p)) ++p;
+		return p;
+	}
+
+	// Returns the start of the next line.
+	inline const char* SkipLine(const char* p, const char* pEnd) {
+		if (p >= pEnd) return pEnd;
+
+		const void* pNewline = std::memchr(p, '\n', static_cast<size_t>(pEnd - p));
+		return pNewline != nullptr ? static_cast<const char*>(pNewline) + 1 : pEnd;
+	}
+
+	inline bool IsKeyword(const char* p, const char* pEnd, const char* inKeyword, size_t inLength) {
+		return static_cast<size_t>(pEnd - p) > inLength && std::memcmp(p, inKeyword, inLength) == 0 && IsBlank(p[inLength]);
+	}
+
+	// Gathers up to MaxMantissaDigits significant digits in an integer and scales it by a power of ten.
+	// For the short decimals OBJ exporters write, both are exact in a double (Clinger's fast path), so
+	// the result is correctly rounded.
+	bool ParseFloat(const char*& p, const char* pEnd, float& outValue) {
+		bool bNegative = false;
+		if (p < pEnd && (*p == '-' || *p == '+')) {
+			bNegative = *p == '-';
+			++p;
+		}
+
+		std::uint64_t mantissa = 0;
+		int digitCount = 0;
+		int exponent = 0;
+		bool bAnyDigit = false;
+
+		for (; p < pEnd && IsDigit(*p); ++p) {
+			bAnyDigit = true;
+			if (digitCount < MaxMantissaDigits) {
+				mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+				if (mantissa != 0) ++digitCount;
+			}
+			else {
+				++exponent;
+			}
+		}
+
+		if (p < pEnd && *p == '.') {
+			++p;
+			for (; p < pEnd && IsDigit(*p); ++p) {
+				bAnyDigit = true;
+				if (digitCount < MaxMantissaDigits) {
+					mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+					if (mantissa != 0) ++digitCount;
+					--exponent;
+				}
+			}
+		}
+
+		if (!bAnyDigit) return false;
+
+		if (p < pEnd && (*p == 'e' || *p == 'E')) {
+			++p;
+
+			bool bNegativeExponent = false;
+			if (p < pEnd && (*p == '-' || *p == '+')) {
+				bNegativeExponent = *p == '-';
+				++p;
+			}
+			if (p >= pEnd || !IsDigit(*p)) return false;
+
+			int value = 0;
+			for (; p < pEnd && IsDigit(*p); ++p) {
+				if (value < 10000) value = value * 10 + (*p - '0');
+			}
+			exponent += bNegativeExponent ? -value : value;
+		}
+
+		double value = static_cast<double>(mantissa);
+		if (exponent < 0) {
+			value = exponent >= -22 ? value / PowersOfTen[-exponent] : value * std::pow(10.0, exponent);
+		}
+		else if (exponent > 0) {
+			value = exponent <= 22 ? value * PowersOfTen[exponent] : value * std::pow(10.0, exponent);
+		}
+
+		outValue = static_cast<float>(bNegative ? -value : value);
+
+		return true;
+	}
+
+	// OBJ indices start at one; negative ones count back from the last element defined so far.
+	bool ParseIndex(const char*& p, const char* pEnd, std::uint32_t inDefinedCount, std::uint32_t inTotalCount, std::uint32_t& outIndex) {
+		bool bNegative = false;
+		if (p < pEnd && *p == '-') {
+			bNegative = true;
+			++p;
+		}
+		if (p >= pEnd || !IsDigit(*p)) return false;
+
+		std::int64_t value = 0;
+		for (; p < pEnd && IsDigit(*p); ++p) {
+			value = value * 10 + (*p - '0');
+			if (value > UINT32_MAX) return false;
+		}
+
+		std::int64_t index = bNegative ? static_cast<std::int64_t>(inDefinedCount) - value : value - 1;
+		if (index < 0 || index >= static_cast<std::int64_t>(inTotalCount)) return false;
+
+		outIndex = static_cast<std::uint32_t>(index);
+
+		return true;
+	}
+
+	void CountChunk(ObjChunk& ioChunk) {
+		const char* p = ioChunk.pBegin;
+		const char* pEnd = ioChunk.pEnd;
+
+		while (p < pEnd) {
+			p = SkipBlanks(p, pEnd);
+
+			if (IsKeyword(p, pEnd, "v", 1)) {
+				++ioChunk.PositionCount;
+			}
+			else if (IsKeyword(p, pEnd, "vt", 2)) {
+				++ioChunk.TexCoordCount;
+			}
+			else if (IsKeyword(p, pEnd, "f", 1)) {
+				std::uint32_t cornerCount = 0;
+				p = SkipBlanks(p + 2, pEnd);
+				while (!IsLineEnd(p, pEnd)) {
+					++cornerCount;
+					while (!IsLineEnd(p, pEnd) && !IsBlank(*p)) ++p;
+					p = SkipBlanks(p, pEnd);
+				}
+				if (cornerCount >= 3) ioChunk.CornerCount += (cornerCount - 2) * 3;
+			}
+
+			p = SkipLine(p, pEnd);
+		}
+	}
+
+	void ParseChunk(ObjChunk& ioChunk, ObjData& outData) {
+		const char* p = ioChunk.pBegin;
+		const char* pEnd = ioChunk.pEnd;
+
+		const std::uint32_t totalPositionCount = static_cast<std::uint32_t>(outData.Positions.size());
+		const std::uint32_t totalTexCoordCount = static_cast<std::uint32_t>(outData.TexCoords.size());
+
+		std::uint32_t position = ioChunk.FirstPosition;
+		std::uint32_t texCoord = ioChunk.FirstTexCoord;
+		ObjCorner* pCorner = outData.Corners.data() + ioChunk.FirstCorner;
+
+		while (p < pEnd) {
+			p = SkipBlanks(p, pEnd);
+			const char* pLine = p;
+
+			if (IsKeyword(p, pEnd, "v", 1)) {
+				glm::vec3& pos = outData.Positions[position++];
+				p += 2;
+				for (int i = 0; i < 3; ++i) {
+					p = SkipBlanks(p, pEnd);
+					if (!ParseFloat(p, pEnd, pos[i])) {
+						ioChunk.pError = pLine;
+						return;
+					}
+				}
+			}
+			else if (IsKeyword(p, pEnd, "vt", 2)) {
+				glm::vec2& uv = outData.TexCoords[texCoord++];
+				p = SkipBlanks(p + 3, pEnd);
+				if (!ParseFloat(p, pEnd, uv.x)) {
+					ioChunk.pError = pLine;
+					return;
+				}
+
+				// The second coordinate is optional.
+				p = SkipBlanks(p, pEnd);
+				uv.y = 0.0f;
+				if (!IsLineEnd(p, pEnd) && !ParseFloat(p, pEnd, uv.y)) {
+					ioChunk.pError = pLine;
+					return;
+				}
+			}
+			else if (IsKeyword(p, pEnd, "f", 1)) {
+				ObjCorner first;
+				ObjCorner prev;
+				std::uint32_t cornerCount = 0;
+
+				p = SkipBlanks(p + 2, pEnd);
+				while (!IsLineEnd(p, pEnd)) {
+					ObjCorner corner;
+					corner.TexCoord = ObjNullIndex;
+
+					if (!ParseIndex(p, pEnd, position, totalPositionCount, corner.Position)) {
+						ioChunk.pError = pLine;
+						return;
+					}
+
+					// v, v/vt, v//vn or v/vt/vn; normals are skipped.
+					if (p < pEnd && *p == '/') {
+						++p;
+						if (p < pEnd && *p != '/' && !ParseIndex(p, pEnd, texCoord, totalTexCoordCount, corner.TexCoord)) {
+							ioChunk.pError = pLine;
+							return;
+						}
+						if (p < pEnd && *p == '/') {
+							++p;
+							while (p < pEnd && (IsDigit(*p) || *p == '-')) ++p;
+						}
+					}
+
+					if (p < pEnd && !IsBlank(*p) && !IsLineEnd(p, pEnd)) {
+						ioChunk.pError = pLine;
+						return;
+					}
+
+					if (cornerCount == 0) {
+						first = corner;
+					}
+					else if (cornerCount >= 2) {
+						pCorner[0] = first;
+						pCorner[1] = prev;
+						pCorner[2] = corner;
+						pCorner += 3;
+					}
+
+					prev = corner;
+					++cornerCount;
+
+					p = SkipBlanks(p, pEnd);
+				}
+			}
+
+			p = SkipLine(p, pEnd);
+		}
+	}
+}
+
+bool ParseObj(const char* pText, size_t inSize, ThreadPool& inThreadPool, ObjData& outData) {
+	outData.Positions.clear();
+	outData.TexCoords.clear();
+	outData.Corners.clear();
+
+	if (inSize == 0) return true;
+
+	const char* pTextEnd = pText + inSize;
+
+	size_t maxChunkCount = static_cast<size_t>(inThreadPool.GetThreadCount()) * ChunksPerThread;
+	std::uint32_t chunkCount = static_cast<std::uint32_t>(std::min(std::max<size_t>(inSize / MinChunkSize, 1), maxChunkCount));
+
+	// Every chunk but the last ends after the first line break past its even share of the text.
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char* pBegin = pText;
+	for (std::uint32_t i = 0; i < chunkCount; ++i) {
+		auto& chunk = chunks[i];
+		chunk.pBegin = pBegin;
+		chunk.pEnd = i + 1 == chunkCount ? pTextEnd : std::max(pBegin, SkipLine(pText + inSize / chunkCount * (i + 1), pTextEnd));
+		pBegin = chunk.pEnd;
+	}
+
+	inThreadPool.Run(chunkCount, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		CountChunk(chunks[inTaskIndex]);
+	});
+
+	std::uint64_t positionCount = 0;
+	std::uint64_t texCoordCount = 0;
+	std::uint64_t cornerCount = 0;
+	for (auto& chunk : chunks) {
+		chunk.FirstPosition = static_cast<std::uint32_t>(positionCount);
+		chunk.FirstTexCoord = static_cast<std::uint32_t>(texCoordCount);
+		chunk.FirstCorner = static_cast<std::uint32_t>(cornerCount);
+
+		positionCount += chunk.PositionCount;
+		texCoordCount += chunk.TexCoordCount;
+		cornerCount += chunk.CornerCount;
+	}
+
+	if (positionCount > UINT32_MAX || texCoordCount > UINT32_MAX || cornerCount > UINT32_MAX) {
+		ReturnFalse(L"OBJ file has too many elements");
+	}
+
+	outData.Positions.resize(static_cast<size_t>(positionCount));
+	outData.TexCoords.resize(static_cast<size_t>(texCoordCount));
+	outData.Corners.resize(static_cast<size_t>(cornerCount));
+
+	inThreadPool.Run(chunkCount, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		ParseChunk(chunks[inTaskIndex], outData);
+	});
+
+	for (const auto& chunk : chunks) {
+		if (chunk.pError != nullptr) {
+			std::wstringstream wsstream;
+			wsstream << L"Malformed OBJ line at byte " << static_cast<std::uint64_t>(chunk.pError - pText);
+			ReturnFalse(wsstream.str());
+		}
+	}
+
+	return true;
+}
+
+bool LoadObjFile(const std::string& inFilePath, ThreadPool& inThreadPool, ObjData& outData) {
+	MappedFile file;
+	CheckReturn(file.Open(inFilePath));
+
+	if (!ParseObj(reinterpret_cast<const char*>(file.GetData()), static_cast<size_t>(file.GetSize()), inThreadPool, outData)) {
+		std::wstringstream wsstream;
+		wsstream << L"Failed to parse OBJ file: " << inFilePath.c_str();
+		ReturnFalse(wsstream.str());
+	}
+
+	return true;
+}
\ No newline at end of file
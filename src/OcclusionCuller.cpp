@@ -0,0 +1,247 @@
+#include "OcclusionCuller.h"
+
+#include <immintrin.h>
+
+void OcclusionCuller::Initialize() {
+	mDepth.assign(static_cast<size_t>(Width) * Height, 1.0f);
+	mTileMaxDepth.fill(1.0f);
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4& inViewProj) {
+	mViewProj = inViewProj;
+
+	mTriangles.clear();
+	for (auto& bin : mTileBins) {
+		bin.clear();
+	}
+}
+
+void OcclusionCuller::AddOccluder(
+		const glm::mat4& inWorld,
+		const void* pVertices,
+		std::uint32_t inVertexStride,
+		std::uint32_t inVertexCount,
+		const std::uint32_t* pIndices,
+		std::uint32_t inIndexCount) {
+	glm::mat4 worldViewProj = mViewProj * inWorld;
+
+	mClipPositions.resize(inVertexCount);
+
+	auto pBytes = reinterpret_cast<const std::uint8_t*>(pVertices);
+	for (std::uint32_t i = 0; i < inVertexCount; ++i) {
+		glm::vec3 pos;
+		std::memcpy(&pos, pBytes + static_cast<size_t>(i) * inVertexStride, sizeof(pos));
+
+		mClipPositions[i] = worldViewProj * glm::vec4(pos, 1.0f);
+	}
+
+	for (std::uint32_t i = 0; i + 2 < inIndexCount; i += 3) {
+		SetupTriangle(mClipPositions[pIndices[i]], mClipPositions[pIndices[i + 1]], mClipPositions[pIndices[i + 2]]);
+	}
+}
+
+void OcclusionCuller::Rasterize(ThreadPool& inThreadPool) {
+	inThreadPool.Run(TileCountX * TileCountY, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		RasterizeTile(inTaskIndex);
+	});
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3& inCenter, const glm::vec3& inExtents) const {
+	float minX = std::numeric_limits<float>::max();
+	float minY = std::numeric_limits<float>::max();
+	float maxX = std::numeric_limits<float>::lowest();
+	float maxY = std::numeric_limits<float>::lowest();
+	float minZ = std::numeric_limits<float>::max();
+
+	for (std::uint32_t i = 0; i < 8; ++i) {
+		glm::vec3 corner = inCenter + inExtents * glm::vec3(
+			(i & 1) ? 1.0f : -1.0f,
+			(i & 2) ? 1.0f : -1.0f,
+			(i & 4) ? 1.0f : -1.0f);
+		glm::vec4 clip = mViewProj * glm::vec4(corner, 1.0f);
+
+		// Boxes crossing the near plane are never culled.
+		if (clip.z < 0.0f || clip.w <= 0.0f) return true;
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * Width;
+		float y = (clip.y * invW * 0.5f + 0.5f) * Height;
+
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip.z * invW);
+	}
+
+	std::int32_t rectMinX = std::max(static_cast<std::int32_t>(std::floor(minX)), 0);
+	std::int32_t rectMinY = std::max(static_cast<std::int32_t>(std::floor(minY)), 0);
+	std::int32_t rectMaxX = std::min(static_cast<std::int32_t>(std::floor(maxX)), static_cast<std::int32_t>(Width) - 1);
+	std::int32_t rectMaxY = std::min(static_cast<std::int32_t>(std::floor(maxY)), static_cast<std::int32_t>(Height) - 1);
+	if (rectMinX > rectMaxX || rectMinY > rectMaxY) return false;
+
+	const __m128 depth = _mm_set1_ps(minZ);
+
+	for (std::int32_t tileY = rectMinY / TileHeight; tileY <= rectMaxY / static_cast<std::int32_t>(TileHeight); ++tileY) {
+		for (std::int32_t tileX = rectMinX / TileWidth; tileX <= rectMaxX / static_cast<std::int32_t>(TileWidth); ++tileX) {
+			// Every occluder in the tile is in front of the box.
+			if (mTileMaxDepth[tileY * TileCountX + tileX] < minZ) continue;
+
+			std::int32_t beginX = std::max(rectMinX, tileX * static_cast<std::int32_t>(TileWidth));
+			std::int32_t endX = std::min(rectMaxX + 1, (tileX + 1) * static_cast<std::int32_t>(TileWidth));
+			std::int32_t beginY = std::max(rectMinY, tileY * static_cast<std::int32_t>(TileHeight));
+			std::int32_t endY = std::min(rectMaxY + 1, (tileY + 1) * static_cast<std::int32_t>(TileHeight));
+
+			for (std::int32_t y = beginY; y < endY; ++y) {
+				const float* pRow = &mDepth[static_cast<size_t>(y) * Width];
+
+				std::int32_t x = beginX;
+				for (; x + 4 <= endX; x += 4) {
+					if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(pRow + x), depth)) != 0) return true;
+				}
+				for (; x < endX; ++x) {
+					if (pRow[x] >= minZ) return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+std::uint32_t OcclusionCuller::GetTriangleCount() const {
+	return static_cast<std::uint32_t>(mTriangles.size());
+}
+
+void OcclusionCuller::SetupTriangle(const glm::vec4& inV0, const glm::vec4& inV1, const glm::vec4& inV2) {
+	// Triangles reaching in front of the near plane are clipped by the GPU, so they cannot hide anything.
+	if (inV0.z < 0.0f || inV1.z < 0.0f || inV2.z < 0.0f) return;
+	if (inV0.w <= 0.0f || inV1.w <= 0.0f || inV2.w <= 0.0f) return;
+
+	glm::vec3 screen[3];
+	const glm::vec4* clips[3] = { &inV0, &inV1, &inV2 };
+	for (std::uint32_t i = 0; i < 3; ++i) {
+		float invW = 1.0f / clips[i]->w;
+		screen[i] = glm::vec3(
+			(clips[i]->x * invW * 0.5f + 0.5f) * Width,
+			(clips[i]->y * invW * 0.5f + 0.5f) * Height,
+			clips[i]->z * invW);
+	}
+
+	float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+	if (std::abs(area) < 1e-6f) return;
+
+	// Both windings are rasterized; flipping one of them keeps the inside of every edge non-negative.
+	if (area < 0.0f) {
+		std::swap(screen[1], screen[2]);
+		area = -area;
+	}
+
+	float minX = std::min(screen[0].x, std::min(screen[1].x, screen[2].x));
+	float maxX = std::max(screen[0].x, std::max(screen[1].x, screen[2].x));
+	float minY = std::min(screen[0].y, std::min(screen[1].y, screen[2].y));
+	float maxY = std::max(screen[0].y, std::max(screen[1].y, screen[2].y));
+
+	Triangle triangle;
+	triangle.MinX = std::max(static_cast<std::int32_t>(std::ceil(minX - 0.5f)), 0);
+	triangle.MinY = std::max(static_cast<std::int32_t>(std::ceil(minY - 0.5f)), 0);
+	triangle.MaxX = std::min(static_cast<std::int32_t>(std::floor(maxX - 0.5f)), static_cast<std::int32_t>(Width) - 1);
+	triangle.MaxY = std::min(static_cast<std::int32_t>(std::floor(maxY - 0.5f)), static_cast<std::int32_t>(Height) - 1);
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY) return;
+
+	for (std::uint32_t i = 0; i < 3; ++i) {
+		const auto& from = screen[i];
+		const auto& to = screen[(i + 1) % 3];
+
+		triangle.EdgeA[i] = from.y - to.y;
+		triangle.EdgeB[i] = to.x - from.x;
+		triangle.EdgeC[i] = from.x * to.y - to.x * from.y;
+	}
+
+	float invArea = 1.0f / area;
+	triangle.DepthA = ((screen[1].z - screen[0].z) * (screen[2].y - screen[0].y) - (screen[2].z - screen[0].z) * (screen[1].y - screen[0].y)) * invArea;
+	triangle.DepthB = ((screen[2].z - screen[0].z) * (screen[1].x - screen[0].x) - (screen[1].z - screen[0].z) * (screen[2].x - screen[0].x)) * invArea;
+	triangle.DepthC = screen[0].z - triangle.DepthA * screen[0].x - triangle.DepthB * screen[0].y;
+
+	std::uint32_t index = static_cast<std::uint32_t>(mTriangles.size());
+	mTriangles.push_back(triangle);
+
+	for (std::int32_t tileY = triangle.MinY / TileHeight; tileY <= triangle.MaxY / static_cast<std::int32_t>(TileHeight); ++tileY) {
+		for (std::int32_t tileX = triangle.MinX / TileWidth; tileX <= triangle.MaxX / static_cast<std::int32_t>(TileWidth); ++tileX) {
+			mTileBins[tileY * TileCountX + tileX].push_back(index);
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTile(std::uint32_t inTileIndex) {
+	std::int32_t tileMinX = static_cast<std::int32_t>((inTileIndex % TileCountX) * TileWidth);
+	std::int32_t tileMinY = static_cast<std::int32_t>((inTileIndex / TileCountX) * TileHeight);
+	std::int32_t tileMaxX = tileMinX + TileWidth - 1;
+	std::int32_t tileMaxY = tileMinY + TileHeight - 1;
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (std::int32_t y = tileMinY; y <= tileMaxY; ++y) {
+		float* pRow = &mDepth[static_cast<size_t>(y) * Width];
+		for (std::int32_t x = tileMinX; x <= tileMaxX; x += 4) {
+			_mm_storeu_ps(pRow + x, one);
+		}
+	}
+
+	for (std::uint32_t triangleIndex : mTileBins[inTileIndex]) {
+		const auto& triangle = mTriangles[triangleIndex];
+
+		// Tiles start on multiples of four, so aligning down never leaves the tile.
+		std::int32_t minX = std::max(triangle.MinX, tileMinX) & ~3;
+		std::int32_t maxX = std::min(triangle.MaxX, tileMaxX);
+		std::int32_t minY = std::max(triangle.MinY, tileMinY);
+		std::int32_t maxY = std::min(triangle.MaxY, tileMaxY);
+
+		const __m128 edgeA0 = _mm_set1_ps(triangle.EdgeA[0]);
+		const __m128 edgeA1 = _mm_set1_ps(triangle.EdgeA[1]);
+		const __m128 edgeA2 = _mm_set1_ps(triangle.EdgeA[2]);
+		const __m128 depthA = _mm_set1_ps(triangle.DepthA);
+
+		for (std::int32_t y = minY; y <= maxY; ++y) {
+			float py = static_cast<float>(y) + 0.5f;
+
+			const __m128 row0 = _mm_set1_ps(triangle.EdgeB[0] * py + triangle.EdgeC[0]);
+			const __m128 row1 = _mm_set1_ps(triangle.EdgeB[1] * py + triangle.EdgeC[1]);
+			const __m128 row2 = _mm_set1_ps(triangle.EdgeB[2] * py + triangle.EdgeC[2]);
+			const __m128 rowDepth = _mm_set1_ps(triangle.DepthB * py + triangle.DepthC);
+
+			float* pRow = &mDepth[static_cast<size_t>(y) * Width];
+
+			for (std::int32_t x = minX; x <= maxX; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+
+				__m128 inside = _mm_and_ps(
+					_mm_and_ps(
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, px), row0), zero),
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, px), row1), zero)),
+					_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, px), row2), zero));
+				if (_mm_movemask_ps(inside) == 0) continue;
+
+				__m128 depth = _mm_max_ps(_mm_add_ps(_mm_mul_ps(depthA, px), rowDepth), zero);
+
+				__m128 oldDepth = _mm_loadu_ps(pRow + x);
+				__m128 newDepth = _mm_min_ps(oldDepth, depth);
+				_mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(inside, newDepth), _mm_andnot_ps(inside, oldDepth)));
+			}
+		}
+	}
+
+	__m128 maxDepth = zero;
+	for (std::int32_t y = tileMinY; y <= tileMaxY; ++y) {
+		const float* pRow = &mDepth[static_cast<size_t>(y) * Width];
+		for (std::int32_t x = tileMinX; x <= tileMaxX; x += 4) {
+			maxDepth = _mm_max_ps(maxDepth, _mm_loadu_ps(pRow + x));
+		}
+	}
+
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, maxDepth);
+	mTileMaxDepth[inTileIndex] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
\ No newline at end of file
@@ -0,0 +1,358 @@
+#include "PackArchive.h"
+#include "Hash.h"
+#include "Lz4.h"
+
+#include <cstring>
+#include <filesystem>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+	const std::uint32_t PackMagic = 0x4B434150;	// "PACK"
+	const std::uint32_t PackVersion = 1;
+
+	// Payloads and the table of contents start on cache lines; the mapping itself is page aligned.
+	const std::uint64_t PackAlignment = 64;
+
+	struct PackHeader {
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint32_t EntryCount;
+		std::uint32_t SlotCount;
+
+		std::uint64_t FileSize;
+		std::uint64_t TocOffset;
+		std::uint64_t SlotsOffset;
+		std::uint64_t NamesOffset;
+		std::uint64_t NamesSize;
+		std::uint64_t Reserved;
+	};
+
+	struct PackTocEntry {
+		std::uint64_t NameHash;
+		std::uint64_t Offset;
+		std::uint64_t StoredSize;
+		std::uint64_t Size;
+		std::uint32_t NameOffset;
+		std::uint32_t NameSize;
+		std::uint32_t Compression;
+		std::uint32_t Reserved;
+	};
+
+	static_assert(sizeof(PackHeader) == PackAlignment, "The header fills the first aligned block");
+	static_assert(sizeof(PackTocEntry) % 16 == 0, "Entries stay aligned when read in place");
+	static_assert(std::is_trivially_copyable<PackTocEntry>::value, "Entries are read in place");
+
+	std::uint64_t AlignUp(std::uint64_t inValue, std::uint64_t inAlignment) {
+		return (inValue + inAlignment - 1) / inAlignment * inAlignment;
+	}
+
+	std::uint64_t HashName(const char* pName, size_t inSize) {
+		return HashBytes(pName, inSize);
+	}
+
+	bool PackFileError(const std::string& inFilePath) {
+		std::wstringstream wsstream;
+		wsstream << L"Invalid or outdated pack archive: " << inFilePath.c_str();
+		ReturnFalse(wsstream.str());
+	}
+
+	struct PackPayload {
+		std::string FilePath;
+		std::vector<std::uint8_t> Data;
+		std::uint64_t Size = 0;
+		PackCompressions Compression = PackCompressions::EPackUncompressed;
+		std::uint64_t Offset = 0;
+		std::uint64_t StoredSize = 0;
+		bool bRead = false;
+	};
+
+	void ReadPayload(PackPayload& ioPayload, bool bCompress) {
+		MappedFile file;
+		if (!file.Open(ioPayload.FilePath)) return;
+
+		const std::uint8_t* pData = file.GetData();
+		ioPayload.Size = file.GetSize();
+
+		if (bCompress && ioPayload.Size > 0) {
+			ioPayload.Data.resize(GetLz4CompressBound(static_cast<size_t>(ioPayload.Size)));
+			size_t compressedSize = CompressLz4(pData, static_cast<size_t>(ioPayload.Size), ioPayload.Data.data(), ioPayload.Data.size());
+			if (compressedSize > 0 && compressedSize < ioPayload.Size) {
+				ioPayload.Data.resize(compressedSize);
+				ioPayload.Data.shrink_to_fit();
+				ioPayload.Compression = PackCompressions::EPackLz4;
+				ioPayload.bRead = true;
+				return;
+			}
+		}
+
+		ioPayload.Data.assign(pData, pData + ioPayload.Size);
+		ioPayload.bRead = true;
+	}
+
+	void WritePadding(std::ofstream& ioFile, std::uint64_t inAlignment) {
+		static const char zeros[PackAlignment] = {};
+		const std::uint64_t position = static_cast<std::uint64_t>(ioFile.tellp());
+		ioFile.write(zeros, static_cast<std::streamsize>(AlignUp(position, inAlignment) - position));
+	}
+}
+
+bool ReadPackEntry(const PackEntry& inEntry, void* pDst, std::uint64_t inSize) {
+	if (inSize > inEntry.Size) ReturnFalse(L"Read past the end of a pack entry");
+	if (inSize == 0) return true;
+
+	if (inEntry.Compression == PackCompressions::EPackLz4) {
+		if (!DecompressLz4(inEntry.pData, static_cast<size_t>(inEntry.StoredSize), pDst, static_cast<size_t>(inSize))) {
+			ReturnFalse(L"Failed to decompress a pack entry");
+		}
+	}
+	else {
+		std::memcpy(pDst, inEntry.pData, static_cast<size_t>(inSize));
+	}
+
+	return true;
+}
+
+void PrefetchPackEntry(const PackEntry& inEntry) {
+	if (inEntry.StoredSize == 0) return;
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<std::uint8_t*>(inEntry.pData);
+	range.NumberOfBytes = static_cast<SIZE_T>(inEntry.StoredSize);
+
+	// Only a hint; a failure just leaves the pages to be faulted in by the read.
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+PackArchive::~PackArchive() {
+	Close();
+}
+
+bool PackArchive::Open(const std::string& inFilePath) {
+	Close();
+
+	CheckReturn(mFile.Open(inFilePath));
+
+	const std::uint8_t* pData = mFile.GetData();
+	const std::uint64_t fileSize = mFile.GetSize();
+
+	PackHeader header;
+	if (fileSize < sizeof(header)) {
+		Close();
+		return PackFileError(inFilePath);
+	}
+	std::memcpy(&header, pData, sizeof(header));
+
+	// Only the header is checked, so opening costs the same for any number of entries.
+	const bool bValid =
+		header.Magic == PackMagic &&
+		header.Version == PackVersion &&
+		header.FileSize == fileSize &&
+		header.SlotCount > header.EntryCount &&
+		(header.SlotCount & (header.SlotCount - 1)) == 0 &&
+		header.TocOffset % PackAlignment == 0 &&
+		header.TocOffset >= sizeof(header) &&
+		header.TocOffset + static_cast<std::uint64_t>(header.EntryCount) * sizeof(PackTocEntry) <= header.SlotsOffset &&
+		header.SlotsOffset % sizeof(std::uint32_t) == 0 &&
+		header.SlotsOffset + static_cast<std::uint64_t>(header.SlotCount) * sizeof(std::uint32_t) <= header.NamesOffset &&
+		header.NamesOffset <= fileSize &&
+		header.NamesSize <= fileSize - header.NamesOffset;
+	if (!bValid) {
+		Close();
+		return PackFileError(inFilePath);
+	}
+
+	mpEntries = pData + header.TocOffset;
+	mpSlots = reinterpret_cast<const std::uint32_t*>(pData + header.SlotsOffset);
+	mpNames = reinterpret_cast<const char*>(pData + header.NamesOffset);
+	mEntryCount = header.EntryCount;
+	mSlotMask = header.SlotCount - 1;
+	mNamesSize = header.NamesSize;
+
+	return true;
+}
+
+void PackArchive::Close() {
+	mFile.Close();
+
+	mpEntries = nullptr;
+	mpSlots = nullptr;
+	mpNames = nullptr;
+	mEntryCount = 0;
+	mSlotMask = 0;
+	mNamesSize = 0;
+}
+
+bool PackArchive::IsOpen() const {
+	return mpEntries != nullptr;
+}
+
+std::uint32_t PackArchive::GetEntryCount() const {
+	return mEntryCount;
+}
+
+bool PackArchive::Find(const std::string& inName, PackEntry& outEntry) const {
+	if (!IsOpen()) return false;
+
+	const PackTocEntry* pEntries = static_cast<const PackTocEntry*>(mpEntries);
+	const std::uint64_t hash = HashName(inName.data(), inName.size());
+
+	// The writer keeps the table at most half full, so probes stop at an empty slot quickly.
+	for (std::uint32_t probe = 0, slot = static_cast<std::uint32_t>(hash) & mSlotMask; probe <= mSlotMask; ++probe, slot = (slot + 1) & mSlotMask) {
+		const std::uint32_t index = mpSlots[slot];
+		if (index == 0) return false;
+		if (index > mEntryCount) ReturnFalse(L"Corrupt pack archive lookup table");
+
+		const PackTocEntry& entry = pEntries[index - 1];
+		if (entry.NameHash != hash || entry.NameSize != inName.size()) continue;
+		if (static_cast<std::uint64_t>(entry.NameOffset) + entry.NameSize > mNamesSize) ReturnFalse(L"Corrupt pack archive entry");
+		if (std::memcmp(mpNames + entry.NameOffset, inName.data(), inName.size()) != 0) continue;
+
+		const bool bValid =
+			entry.Compression < PackCompressions::ENumPackCompressions &&
+			(entry.Compression != PackCompressions::EPackUncompressed || entry.StoredSize == entry.Size) &&
+			entry.Offset <= mFile.GetSize() &&
+			entry.StoredSize <= mFile.GetSize() - entry.Offset;
+		if (!bValid) ReturnFalse(L"Corrupt pack archive entry");
+
+		outEntry.pData = mFile.GetData() + entry.Offset;
+		outEntry.Offset = entry.Offset;
+		outEntry.StoredSize = entry.StoredSize;
+		outEntry.Size = entry.Size;
+		outEntry.Compression = static_cast<PackCompressions>(entry.Compression);
+
+		return true;
+	}
+
+	return false;
+}
+
+bool WritePackArchive(const std::string& inFilePath, const std::vector<PackSource>& inSources, bool bCompress, ThreadPool& inThreadPool) {
+	// Entries that name the same file share its payload.
+	std::vector<PackPayload> payloads;
+	std::vector<std::uint32_t> payloadIndices(inSources.size());
+	{
+		std::unordered_map<std::string, std::uint32_t> indices;
+		std::set<std::string> names;
+		for (size_t i = 0, end = inSources.size(); i < end; ++i) {
+			if (!names.insert(inSources[i].Name).second) {
+				std::wstringstream wsstream;
+				wsstream << L"Duplicate pack archive entry: " << inSources[i].Name.c_str();
+				ReturnFalse(wsstream.str());
+			}
+
+			auto result = indices.emplace(inSources[i].FilePath, static_cast<std::uint32_t>(payloads.size()));
+			if (result.second) {
+				PackPayload payload;
+				payload.FilePath = inSources[i].FilePath;
+				payloads.push_back(std::move(payload));
+			}
+			payloadIndices[i] = result.first->second;
+		}
+	}
+
+	inThreadPool.Run(static_cast<std::uint32_t>(payloads.size()), [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		ReadPayload(payloads[inTaskIndex], bCompress);
+	});
+
+	for (const auto& payload : payloads) {
+		if (!payload.bRead) {
+			std::wstringstream wsstream;
+			wsstream << L"Failed to read pack archive source: " << payload.FilePath.c_str();
+			ReturnFalse(wsstream.str());
+		}
+	}
+
+	const std::string tempPath = inFilePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::wstringstream wsstream;
+			wsstream << L"Failed to create file: " << tempPath.c_str();
+			ReturnFalse(wsstream.str());
+		}
+
+		PackHeader header = {};
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		for (auto& payload : payloads) {
+			WritePadding(file, PackAlignment);
+			payload.Offset = static_cast<std::uint64_t>(file.tellp());
+			payload.StoredSize = payload.Data.size();
+			file.write(reinterpret_cast<const char*>(payload.Data.data()), static_cast<std::streamsize>(payload.Data.size()));
+
+			payload.Data.clear();
+			payload.Data.shrink_to_fit();
+		}
+
+		const std::uint32_t entryCount = static_cast<std::uint32_t>(inSources.size());
+
+		std::uint32_t slotCount = 1;
+		while (slotCount < entryCount * 2 + 1) {
+			slotCount <<= 1;
+		}
+
+		std::vector<PackTocEntry> entries(entryCount);
+		std::vector<std::uint32_t> slots(slotCount, 0);
+		std::string names;
+		for (std::uint32_t i = 0; i < entryCount; ++i) {
+			const auto& source = inSources[i];
+			const auto& payload = payloads[payloadIndices[i]];
+
+			auto& entry = entries[i];
+			entry = {};
+			entry.NameHash = HashName(source.Name.data(), source.Name.size());
+			entry.Offset = payload.Offset;
+			entry.StoredSize = payload.StoredSize;
+			entry.Size = payload.Size;
+			entry.NameOffset = static_cast<std::uint32_t>(names.size());
+			entry.NameSize = static_cast<std::uint32_t>(source.Name.size());
+			entry.Compression = static_cast<std::uint32_t>(payload.Compression);
+			names += source.Name;
+
+			std::uint32_t slot = static_cast<std::uint32_t>(entry.NameHash) & (slotCount - 1);
+			while (slots[slot] != 0) {
+				slot = (slot + 1) & (slotCount - 1);
+			}
+			slots[slot] = i + 1;
+		}
+
+		WritePadding(file, PackAlignment);
+		header.TocOffset = static_cast<std::uint64_t>(file.tellp());
+		file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(sizeof(PackTocEntry) * entries.size()));
+
+		header.SlotsOffset = static_cast<std::uint64_t>(file.tellp());
+		file.write(reinterpret_cast<const char*>(slots.data()), static_cast<std::streamsize>(sizeof(std::uint32_t) * slots.size()));
+
+		header.NamesOffset = static_cast<std::uint64_t>(file.tellp());
+		header.NamesSize = names.size();
+		file.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+		header.Magic = PackMagic;
+		header.Version = PackVersion;
+		header.EntryCount = entryCount;
+		header.SlotCount = slotCount;
+		header.FileSize = static_cast<std::uint64_t>(file.tellp());
+
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		if (!file.good()) {
+			std::wstringstream wsstream;
+			wsstream << L"Failed to write file: " << tempPath.c_str();
+			ReturnFalse(wsstream.str());
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, inFilePath, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+
+		std::wstringstream wsstream;
+		wsstream << L"Failed to replace file: " << inFilePath.c_str();
+		ReturnFalse(wsstream.str());
+	}
+
+	return true;
+}
@@ -0,0 +1,204 @@
+#include "PortalGraph.h"
+
+namespace {
+	bool IsBoxOutside(const glm::vec4* pPlanes, std::uint32_t inPlaneCount, const glm::vec3& inCenter, const glm::vec3& inExtents) {
+		for (std::uint32_t i = 0; i < inPlaneCount; ++i) {
+			const auto& plane = pPlanes[i];
+			float dist = glm::dot(glm::vec3(plane), inCenter) + plane.w;
+			float reach = glm::dot(glm::abs(glm::vec3(plane)), inExtents);
+
+			if (dist + reach < 0.0f) return true;
+		}
+		return false;
+	}
+
+	// Sutherland-Hodgman against one plane, keeping the non-negative side.
+	void ClipPolygon(const std::vector<glm::vec3>& inPolygon, const glm::vec4& inPlane, std::vector<glm::vec3>& outPolygon) {
+		outPolygon.clear();
+
+		for (size_t i = 0, count = inPolygon.size(); i < count; ++i) {
+			const auto& from = inPolygon[i];
+			const auto& to = inPolygon[(i + 1) % count];
+
+			float fromDist = glm::dot(glm::vec3(inPlane), from) + inPlane.w;
+			float toDist = glm::dot(glm::vec3(inPlane), to) + inPlane.w;
+
+			if (fromDist >= 0.0f) outPolygon.push_back(from);
+			if ((fromDist >= 0.0f) != (toDist >= 0.0f)) {
+				float t = fromDist / (fromDist - toDist);
+				outPolygon.push_back(from + (to - from) * t);
+			}
+		}
+	}
+}
+
+void PortalGraph::Clear() {
+	mCells.clear();
+	mPortals.clear();
+
+	mFrusta.clear();
+	mPlanes.clear();
+	mVisibleCellCount = 0;
+}
+
+std::uint32_t PortalGraph::AddCell(const glm::vec3& inMin, const glm::vec3& inMax) {
+	Cell cell;
+	cell.Min = glm::min(inMin, inMax);
+	cell.Max = glm::max(inMin, inMax);
+	mCells.push_back(cell);
+
+	return static_cast<std::uint32_t>(mCells.size() - 1);
+}
+
+bool PortalGraph::AddPortal(std::uint32_t inCellA, std::uint32_t inCellB, const std::array<glm::vec3, 4>& inCorners) {
+	if (inCellA >= mCells.size() || inCellB >= mCells.size() || inCellA == inCellB) {
+		ReturnFalse(L"Portal has to connect two different cells");
+	}
+
+	Portal portal;
+	portal.Cells[0] = inCellA;
+	portal.Cells[1] = inCellB;
+	portal.Corners = inCorners;
+	portal.Center = (inCorners[0] + inCorners[1] + inCorners[2] + inCorners[3]) * 0.25f;
+
+	glm::vec3 normal = glm::cross(inCorners[1] - inCorners[0], inCorners[2] - inCorners[0]);
+	if (glm::length(normal) < 1e-6f) ReturnFalse(L"Portal quad is degenerate");
+	portal.Normal = glm::normalize(normal);
+
+	std::uint32_t index = static_cast<std::uint32_t>(mPortals.size());
+	mPortals.push_back(portal);
+
+	mCells[inCellA].Portals.push_back(index);
+	mCells[inCellB].Portals.push_back(index);
+
+	return true;
+}
+
+std::uint32_t PortalGraph::GetCellCount() const {
+	return static_cast<std::uint32_t>(mCells.size());
+}
+
+std::uint32_t PortalGraph::FindCell(const glm::vec3& inPoint) const {
+	for (std::uint32_t i = 0, end = static_cast<std::uint32_t>(mCells.size()); i < end; ++i) {
+		const auto& cell = mCells[i];
+		if (inPoint.x >= cell.Min.x && inPoint.y >= cell.Min.y && inPoint.z >= cell.Min.z &&
+			inPoint.x <= cell.Max.x && inPoint.y <= cell.Max.y && inPoint.z <= cell.Max.z) return i;
+	}
+	return NullIndex;
+}
+
+bool PortalGraph::ComputeVisibility(const glm::vec3& inEye, const std::array<glm::vec4, 6>& inFrustum) {
+	mFrusta.clear();
+	mPlanes.clear();
+	mPath.clear();
+	mVisibleCellCount = 0;
+	for (auto& cell : mCells) {
+		cell.Frusta.clear();
+	}
+
+	std::uint32_t eyeCell = FindCell(inEye);
+	if (eyeCell == NullIndex) return false;
+
+	mEye = inEye;
+	mFarPlane = inFrustum[5];
+
+	mPlanes.insert(mPlanes.end(), inFrustum.begin(), inFrustum.end());
+	mFrusta.push_back({ 0, static_cast<std::uint32_t>(inFrustum.size()) });
+
+	return Visit(eyeCell, 0, 0);
+}
+
+bool PortalGraph::IsCellVisible(std::uint32_t inCell) const {
+	return !mCells[inCell].Frusta.empty();
+}
+
+std::uint32_t PortalGraph::GetVisibleCellCount() const {
+	return mVisibleCellCount;
+}
+
+bool PortalGraph::IsVisible(std::uint32_t inCell, const glm::vec3& inCenter, const glm::vec3& inExtents) const {
+	for (std::uint32_t frustumIndex : mCells[inCell].Frusta) {
+		const auto& frustum = mFrusta[frustumIndex];
+		if (!IsBoxOutside(&mPlanes[frustum.FirstPlane], frustum.PlaneCount, inCenter, inExtents)) return true;
+	}
+	return false;
+}
+
+bool PortalGraph::Visit(std::uint32_t inCell, std::uint32_t inFrustum, std::uint32_t inDepth) {
+	auto& cell = mCells[inCell];
+
+	// Loops through many portals would multiply the frusta; culling is given up instead of guessing.
+	if (cell.Frusta.size() >= MaxFrustaPerCell || inDepth >= MaxDepth) return false;
+
+	if (cell.Frusta.empty()) ++mVisibleCellCount;
+	cell.Frusta.push_back(inFrustum);
+
+	mPath.push_back(inCell);
+
+	for (size_t i = 0; i < mCells[inCell].Portals.size(); ++i) {
+		const auto& portal = mPortals[mCells[inCell].Portals[i]];
+
+		std::uint32_t next = portal.Cells[0] == inCell ? portal.Cells[1] : portal.Cells[0];
+		if (std::find(mPath.begin(), mPath.end(), next) != mPath.end()) continue;
+
+		std::uint32_t narrowed;
+		if (!NarrowFrustum(portal, inFrustum, narrowed)) continue;
+
+		if (!Visit(next, narrowed, inDepth + 1)) return false;
+	}
+
+	mPath.pop_back();
+
+	return true;
+}
+
+bool PortalGraph::NarrowFrustum(const Portal& inPortal, std::uint32_t inFrustum, std::uint32_t& outFrustum) {
+	const Frustum frustum = mFrusta[inFrustum];
+
+	// Seen edge-on from the doorway, the portal cannot narrow anything.
+	float eyeDist = glm::dot(inPortal.Normal, mEye - inPortal.Center);
+	if (std::abs(eyeDist) < 1e-3f) {
+		outFrustum = inFrustum;
+		return true;
+	}
+
+	std::vector<glm::vec3> polygon(inPortal.Corners.begin(), inPortal.Corners.end());
+	std::vector<glm::vec3> clipped;
+	for (std::uint32_t i = 0; i < frustum.PlaneCount && polygon.size() >= 3; ++i) {
+		ClipPolygon(polygon, mPlanes[frustum.FirstPlane + i], clipped);
+		std::swap(polygon, clipped);
+	}
+	if (polygon.size() < 3) return false;
+
+	glm::vec3 centroid = glm::vec3(0.0f);
+	for (const auto& point : polygon) {
+		centroid += point;
+	}
+	centroid /= static_cast<float>(polygon.size());
+
+	Frustum narrowed;
+	narrowed.FirstPlane = static_cast<std::uint32_t>(mPlanes.size());
+
+	for (size_t i = 0, count = polygon.size(); i < count; ++i) {
+		glm::vec3 normal = glm::cross(polygon[i] - mEye, polygon[(i + 1) % count] - mEye);
+
+		float length = glm::length(normal);
+		if (length < 1e-6f) continue;
+		normal /= length;
+
+		if (glm::dot(normal, centroid - mEye) < 0.0f) normal = -normal;
+		mPlanes.push_back(glm::vec4(normal, -glm::dot(normal, mEye)));
+	}
+
+	// Only what lies beyond the portal can be seen through it.
+	glm::vec3 portalNormal = eyeDist > 0.0f ? -inPortal.Normal : inPortal.Normal;
+	mPlanes.push_back(glm::vec4(portalNormal, -glm::dot(portalNormal, inPortal.Center)));
+	mPlanes.push_back(mFarPlane);
+
+	narrowed.PlaneCount = static_cast<std::uint32_t>(mPlanes.size()) - narrowed.FirstPlane;
+
+	outFrustum = static_cast<std::uint32_t>(mFrusta.size());
+	mFrusta.push_back(narrowed);
+
+	return true;
+}
\ No newline at end of file
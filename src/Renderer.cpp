@@ -1,69 +1,77 @@
 #include "Renderer.h"
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include "TextureCompressor.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
-namespace {
-	VkCommandBuffer BeginSingleTimeCommands(const VkDevice& inDevice, const VkCommandPool& inCommandPool) {
-		VkCommandBufferAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = inCommandPool;
-		allocInfo.commandBufferCount = 1;
-
-		VkCommandBuffer commandBuffer;
-		vkAllocateCommandBuffers(inDevice, &allocInfo, &commandBuffer);
-
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+#include <filesystem>
+#include <random>
 
-		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+namespace {
+	// Image formats of the TextureFormats.
+	const VkFormat TextureImageFormats[TextureFormats::ENumTextureFormats] = {
+		VK_FORMAT_R8G8B8A8_UNORM,
+		VK_FORMAT_BC1_RGB_UNORM_BLOCK,
+		VK_FORMAT_BC3_UNORM_BLOCK,
+		VK_FORMAT_BC7_UNORM_BLOCK
+	};
 
-		return commandBuffer;
+	// Bytes of the levels of a texture from inFirstMip on.
+	std::uint64_t GetMipChainSize(const TextureImport& inImport, std::uint32_t inFirstMip) {
+		const auto& lastMip = inImport.Mips.back();
+		return lastMip.Offset + lastMip.Size - inImport.Mips[inFirstMip].Offset;
 	}
 
-	void EndSingleTimeCommands(const VkDevice& inDevice, const VkQueue& inQueue, const VkCommandPool& inCommandPool, VkCommandBuffer& ioCommandBuffer) {
-		vkEndCommandBuffer(ioCommandBuffer);
-
-		VkSubmitInfo submitInfo = {};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &ioCommandBuffer;
-
-		vkQueueSubmit(inQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(inQueue);
+	glm::mat4 BuildWorldMatrix(const RenderItem* pRItem) {
+		return glm::translate(glm::mat4(1.0f), pRItem->Pos) *
+			glm::mat4_cast(pRItem->Quat) *
+			glm::scale(glm::mat4(1.0f), pRItem->Scale);
+	}
 
-		vkFreeCommandBuffers(inDevice, inCommandPool, 1, &ioCommandBuffer);
+	// Planes point inwards and are normalized; clip space depth is [0, w].
+	void ExtractFrustumPlanes(const glm::mat4& inViewProj, std::array<glm::vec4, 6>& outPlanes) {
+		glm::vec4 row0 = glm::vec4(inViewProj[0][0], inViewProj[1][0], inViewProj[2][0], inViewProj[3][0]);
+		glm::vec4 row1 = glm::vec4(inViewProj[0][1], inViewProj[1][1], inViewProj[2][1], inViewProj[3][1]);
+		glm::vec4 row2 = glm::vec4(inViewProj[0][2], inViewProj[1][2], inViewProj[2][2], inViewProj[3][2]);
+		glm::vec4 row3 = glm::vec4(inViewProj[0][3], inViewProj[1][3], inViewProj[2][3], inViewProj[3][3]);
+
+		outPlanes[0] = row3 + row0;
+		outPlanes[1] = row3 - row0;
+		outPlanes[2] = row3 + row1;
+		outPlanes[3] = row3 - row1;
+		outPlanes[4] = row2;
+		outPlanes[5] = row3 - row2;
+
+		for (auto& plane : outPlanes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
 	}
 
-	std::uint32_t FindMemoryType(const VkPhysicalDevice& inPhysicalDevice, std::uint32_t inTypeFilter, const VkMemoryPropertyFlags& inProperties) {
-		std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+	void ComputeWorldBounds(const Mesh* pMesh, const glm::mat4& inWorld, glm::vec3& outCenter, float& outRadius, glm::vec3& outExtents) {
+		glm::vec3 axisX = glm::vec3(inWorld[0]);
+		glm::vec3 axisY = glm::vec3(inWorld[1]);
+		glm::vec3 axisZ = glm::vec3(inWorld[2]);
 
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(inPhysicalDevice, &memProperties);
+		glm::vec3 localExtents = (pMesh->BoundsMax - pMesh->BoundsMin) * 0.5f;
 
-		for (std::uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
-			if ((inTypeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & inProperties) == inProperties) {
-				index = i;
-				break;
-			}
-		}
+		outCenter = glm::vec3(inWorld * glm::vec4(pMesh->BoundsCenter, 1.0f));
+		outExtents = glm::abs(axisX) * localExtents.x + glm::abs(axisY) * localExtents.y + glm::abs(axisZ) * localExtents.z;
+		outRadius = pMesh->BoundsRadius * std::max(glm::length(axisX), std::max(glm::length(axisY), glm::length(axisZ)));
+	}
 
-		return index;
+	std::uint64_t AlignUp(std::uint64_t inValue, std::uint64_t inAlignment) {
+		if (inAlignment <= 1) return inValue;
+		return (inValue + inAlignment - 1) / inAlignment * inAlignment;
 	}
 
 	bool CreateBuffer(
-			const VkPhysicalDevice& inPhysicalDevice,
+			MemoryAllocator& inAllocator,
 			const VkDevice& inDevice,
 			VkDeviceSize inSize,
 			const VkBufferUsageFlags& inUsage,
 			const VkMemoryPropertyFlags& inProperties,
 			VkBuffer& outBuffer,
-			VkDeviceMemory& outBufferMemory) {
+			Allocation& outAllocation) {
 		VkBufferCreateInfo bufferInfo = {};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = inSize;
@@ -78,55 +86,52 @@ namespace {
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(inDevice, outBuffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = FindMemoryType(inPhysicalDevice, memRequirements.memoryTypeBits, inProperties);
-
-		if (vkAllocateMemory(inDevice, &allocInfo, nullptr, &outBufferMemory) != VK_SUCCESS) {
-			ReturnFalse(L"Failed to allocate vertex buffer memory");
+		if (!inAllocator.Allocate(memRequirements, inProperties, ResourceKinds::ELinearResource, false, outAllocation)) {
+			vkDestroyBuffer(inDevice, outBuffer, nullptr);
+			ReturnFalse(L"Failed to allocate buffer memory");
 		}
 
-		vkBindBufferMemory(inDevice, outBuffer, outBufferMemory, 0);
+		vkBindBufferMemory(inDevice, outBuffer, outAllocation.Memory, outAllocation.Offset);
 
 		return true;
 	}
 
+	void DestroyBuffer(MemoryAllocator& inAllocator, const VkDevice& inDevice, VkBuffer& ioBuffer, Allocation& ioAllocation) {
+		vkDestroyBuffer(inDevice, ioBuffer, nullptr);
+		inAllocator.Free(ioAllocation);
+
+		ioBuffer = VK_NULL_HANDLE;
+	}
+
 	void CopyBuffer(
-			const VkDevice& inDevice,
-			const VkQueue& inQueue,
-			const VkCommandPool& inCommandPool,
+			const VkCommandBuffer& inCommandBuffer,
 			const VkBuffer& inSrcBuffer,
 			const VkBuffer& inDstBuffer,
+			VkDeviceSize inSrcOffset,
+			VkDeviceSize inDstOffset,
 			VkDeviceSize inSize) {
-		VkCommandBuffer commandBuffer = BeginSingleTimeCommands(inDevice, inCommandPool);
-
 		VkBufferCopy copyRegion = {};
-		copyRegion.srcOffset = 0;
-		copyRegion.dstOffset = 0;
+		copyRegion.srcOffset = inSrcOffset;
+		copyRegion.dstOffset = inDstOffset;
 		copyRegion.size = inSize;
-		vkCmdCopyBuffer(commandBuffer, inSrcBuffer, inDstBuffer, 1, &copyRegion);
-
-		EndSingleTimeCommands(inDevice, inQueue, inCommandPool, commandBuffer);
+		vkCmdCopyBuffer(inCommandBuffer, inSrcBuffer, inDstBuffer, 1, &copyRegion);
 	}
 
 	void CopyBufferToImage(
-			const VkDevice& inDevice,
-			const VkQueue& inQueue,
-			const VkCommandPool& inCommandPool,
+			const VkCommandBuffer& inCommandBuffer,
 			const VkBuffer& inBuffer,
+			VkDeviceSize inBufferOffset,
 			const VkImage& inImage,
+			std::uint32_t inMipLevel,
 			std::uint32_t inWidth,
 			std::uint32_t inHeight) {
-		VkCommandBuffer commandBuffer = BeginSingleTimeCommands(inDevice, inCommandPool);
-
 		VkBufferImageCopy region = {};
-		region.bufferOffset = 0;
+		region.bufferOffset = inBufferOffset;
 		region.bufferRowLength = 0;
 		region.bufferImageHeight = 0;
 
 		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.mipLevel = inMipLevel;
 		region.imageSubresource.baseArrayLayer = 0;
 		region.imageSubresource.layerCount = 1;
 
@@ -134,125 +139,16 @@ namespace {
 		region.imageExtent = { inWidth, inHeight, 1 };
 
 		vkCmdCopyBufferToImage(
-			commandBuffer,
+			inCommandBuffer,
 			inBuffer,
 			inImage,
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			1,
 			&region);
-
-		EndSingleTimeCommands(inDevice, inQueue, inCommandPool, commandBuffer);
-	}
-
-	bool GenerateMipmaps(
-			const VkPhysicalDevice& inPhysicalDevice,
-			const VkDevice& inDevice,
-			const VkQueue& inQueue,
-			const VkCommandPool& inCommandPool,
-			const VkImage& inImage,
-			const VkFormat& inFormat,
-			std::int32_t inTexWidth,
-			std::int32_t inTexHeight,
-			std::uint32_t inMipLevles) {
-		VkFormatProperties formatProperties;
-		vkGetPhysicalDeviceFormatProperties(inPhysicalDevice, inFormat, &formatProperties);
-
-		if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-			ReturnFalse(L"Texture image format does not support linear bliting");
-		}
-
-		VkCommandBuffer commandBuffer = BeginSingleTimeCommands(inDevice, inCommandPool);
-
-		VkImageMemoryBarrier barrier = {};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.image = inImage;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.subresourceRange.levelCount = 1;
-
-		std::int32_t mipWidth = inTexWidth;
-		std::int32_t mipHeight = inTexHeight;
-
-		for (std::uint32_t i = 1; i < inMipLevles; ++i) {
-			barrier.subresourceRange.baseMipLevel = i - 1;
-			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-			vkCmdPipelineBarrier(
-				commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier);
-
-			VkImageBlit blit = {};
-			blit.srcOffsets[0] = { 0, 0, 0 };
-			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.srcSubresource.mipLevel = i - 1;
-			blit.srcSubresource.baseArrayLayer = 0;
-			blit.srcSubresource.layerCount = 1;
-			blit.dstOffsets[0] = { 0, 0, 0 };
-			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth >> 1 : 1, mipHeight > 1 ? mipHeight >> 1 : 1, 1 };
-			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.dstSubresource.mipLevel = i;
-			blit.dstSubresource.baseArrayLayer = 0;
-			blit.dstSubresource.layerCount = 1;
-
-			vkCmdBlitImage(
-				commandBuffer,
-				inImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				inImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1, &blit,
-				VK_FILTER_LINEAR);
-
-			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			vkCmdPipelineBarrier(
-				commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier);
-
-			if (mipWidth > 1) mipWidth = mipWidth >> 1;
-			if (mipHeight > 1) mipHeight = mipHeight >> 1;;
-		}
-
-		barrier.subresourceRange.baseMipLevel = inMipLevles - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(
-			commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier);
-
-		EndSingleTimeCommands(inDevice, inQueue, inCommandPool, commandBuffer);
-
-		return true;
 	}
 
 	bool CreateImage(
-		const VkPhysicalDevice& inPhysicalDevice,
+			MemoryAllocator& inAllocator,
 			const VkDevice& inDevice,
 			std::uint32_t inWidth,
 			std::uint32_t inHeight,
@@ -262,8 +158,9 @@ namespace {
 			const VkImageTiling& inTiling,
 			const VkImageUsageFlags& inUsage,
 			const VkMemoryPropertyFlags& inProperties,
+			bool bDedicated,
 			VkImage& outImage,
-			VkDeviceMemory& outImageMemory) {
+			Allocation& outAllocation) {
 		VkImageCreateInfo imageInfo = {};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -287,20 +184,24 @@ namespace {
 		VkMemoryRequirements memRequirements;
 		vkGetImageMemoryRequirements(inDevice, outImage, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = FindMemoryType(inPhysicalDevice, memRequirements.memoryTypeBits, inProperties);
-
-		if (vkAllocateMemory(inDevice, &allocInfo, nullptr, &outImageMemory) != VK_SUCCESS) {
-			ReturnFalse(L"Failed to allocate texture image memory");
+		ResourceKinds kind = inTiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKinds::EOptimalResource : ResourceKinds::ELinearResource;
+		if (!inAllocator.Allocate(memRequirements, inProperties, kind, bDedicated, outAllocation)) {
+			vkDestroyImage(inDevice, outImage, nullptr);
+			ReturnFalse(L"Failed to allocate image memory");
 		}
 
-		vkBindImageMemory(inDevice, outImage, outImageMemory, 0);
+		vkBindImageMemory(inDevice, outImage, outAllocation.Memory, outAllocation.Offset);
 
 		return true;
 	}
 
+	void DestroyImage(MemoryAllocator& inAllocator, const VkDevice& inDevice, VkImage& ioImage, Allocation& ioAllocation) {
+		vkDestroyImage(inDevice, ioImage, nullptr);
+		inAllocator.Free(ioAllocation);
+
+		ioImage = VK_NULL_HANDLE;
+	}
+
 	bool CreateImageView(
 			const VkDevice& inDevice,
 			const VkImage& inImage,
@@ -359,16 +260,12 @@ namespace {
 	}
 
 	bool TransitionImageLayout(
-			const VkDevice& inDevice,
-			const VkQueue& inQueue,
-			const VkCommandPool& inCommandPool,
+			const VkCommandBuffer& inCommandBuffer,
 			const VkImage& inImage,
 			const VkFormat& inFormat,
 			const VkImageLayout& inOldLayout,
 			const VkImageLayout& inNewLayout,
 			std::uint32_t inMipLevels) {
-		VkCommandBuffer commandBuffer = BeginSingleTimeCommands(inDevice, inCommandPool);
-
 		VkImageMemoryBarrier barrier = {};
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 		barrier.oldLayout = inOldLayout;
@@ -420,11 +317,8 @@ namespace {
 			ReturnFalse(L"Unsupported layout transition");
 		}
 
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = 0;
-
 		vkCmdPipelineBarrier(
-			commandBuffer,
+			inCommandBuffer,
 			sourceStage, destinationStage,
 			0,
 			0, nullptr,
@@ -432,8 +326,6 @@ namespace {
 			1, &barrier
 		);
 
-		EndSingleTimeCommands(inDevice, inQueue, inCommandPool, commandBuffer);
-
 		return true;
 	}
 
@@ -470,33 +362,26 @@ namespace {
 
 		return true;
 	}
-}
 
-VkVertexInputBindingDescription Vertex::GetBindingDescription() {
-	VkVertexInputBindingDescription bindingDescription = {};
-	bindingDescription.binding = 0;
-	bindingDescription.stride = sizeof(Vertex);
-	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	return bindingDescription;
+	// Built at compile time from the layouts.
+	constexpr VertexInputState<FullVertexLayout, InstanceLayout> FullVertexInput;
+	constexpr VertexInputState<CompactVertexLayout, InstanceLayout> CompactVertexInput;
+	constexpr VertexInputState<CompactHalfVertexLayout, InstanceLayout> CompactHalfVertexInput;
 }
 
-std::array<VkVertexInputAttributeDescription, 3> Vertex::GetAttributeDescriptions() {
-	std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
-	attributeDescriptions[0].binding = 0;
-	attributeDescriptions[0].location = 0;
-	attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attributeDescriptions[0].offset = offsetof(Vertex, mPos);
-
-	attributeDescriptions[1].binding = 0;
-	attributeDescriptions[1].location = 1;
-	attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attributeDescriptions[1].offset = offsetof(Vertex, mColor);
+VkPipelineVertexInputStateCreateInfo GetVertexInputState(VertexFormats inFormat) {
+	switch (inFormat) {
+	case VertexFormats::ECompactVertex:
+		return CompactVertexInput.GetCreateInfo();
+	case VertexFormats::ECompactHalfVertex:
+		return CompactHalfVertexInput.GetCreateInfo();
+	default:
+		return FullVertexInput.GetCreateInfo();
+	}
+}
 
-	attributeDescriptions[2].binding = 0;
-	attributeDescriptions[2].location = 2;
-	attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-	attributeDescriptions[2].offset = offsetof(Vertex, mTexCoord);
-	return attributeDescriptions;
+std::uint32_t GetVertexStride(VertexFormats inFormat) {
+	return inFormat == VertexFormats::EFullVertex ? FullVertexLayout::Stride : CompactVertexLayout::Stride;
 }
 
 Renderer::~Renderer() {
@@ -507,16 +392,71 @@ Renderer::~Renderer() {
 
 bool Renderer::Initialize(int inClientWidth, int inClientHeight, GLFWwindow* pWnd) {
 	CheckReturn(LowRenderer::Initialize(inClientWidth, inClientHeight, pWnd));
+	CheckReturn(mMemoryAllocator.Initialize(mPhysicalDevice, mDevice));
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(mPhysicalDevice, &properties);
+	mUniformAlignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+	mTextureCapacity = std::min({
+		MaxTextureCount,
+		properties.limits.maxPerStageDescriptorSampledImages,
+		properties.limits.maxDescriptorSetSampledImages });
+
+	bCompactVerticesSupported = true;
+	for (VkFormat format : { VK_FORMAT_R16G16B16A16_SNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16_SFLOAT }) {
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, format, &formatProperties);
+		if (!(formatProperties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT)) bCompactVerticesSupported = false;
+	}
+
+	// Textures cooked to a format the device lacks are decoded when loaded.
+	mSupportedTextureFormats = 0;
+	for (std::uint32_t format = 0; format < TextureFormats::ENumTextureFormats; ++format) {
+		const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, TextureImageFormats[format], &formatProperties);
+		if ((formatProperties.optimalTilingFeatures & required) == required) mSupportedTextureFormats |= 1u << format;
+	}
+	if (!(mSupportedTextureFormats & (1u << TextureFormats::ETextureRgba8))) ReturnFalse(L"RGBA8 textures are not supported");
 
 	CheckReturn(CreateImageViews());
 	CheckReturn(CreateRenderPass());
 	CheckReturn(CreateCommandPool());
+	CheckReturn(mThreadPool.Initialize(std::min(std::max(std::thread::hardware_concurrency(), 1u), MaxRecordingThreadCount) - 1));
+	CheckReturn(mLoadQueue.Initialize(std::min(std::max(std::thread::hardware_concurrency() / 2, 1u), MaxLoadThreadCount)));
+	CheckReturn(CreateRecordingContexts());
+	QueueFamilyIndices indices = FindQueueFamilies(mPhysicalDevice, mSurface);
+	CheckReturn(mUploadContext.Initialize(
+		mDevice,
+		mGraphicsQueue,
+		indices.GetGraphicsFamilyIndex(),
+		mTransferQueue,
+		indices.GetTransferFamilyIndex(),
+		&mMemoryAllocator,
+		StagingBufferSize));
+	for (std::uint32_t format = 0; format < VertexFormats::ENumVertexFormats; ++format) {
+		CheckReturn(CreateGeometryBuffer(
+			mVertexGeometries[format],
+			GetVertexStride(static_cast<VertexFormats>(format)),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			InitialVertexCapacity));
+	}
+	CheckReturn(CreateGeometryBuffer(mIndexGeometry, sizeof(std::uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, InitialIndexCapacity));
+	CheckReturn(CreateGeometryBuffer(mShortIndexGeometry, sizeof(std::uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, InitialIndexCapacity));
 	CheckReturn(CreateColorResources());
 	CheckReturn(CreateDepthResources());
 	CheckReturn(CreateFramebuffers());
 	CheckReturn(CreateDescriptorSetLayout());
 	CheckReturn(CreateGraphicsPipeline());
+	CheckReturn(CreateGpuCuller());
+
+	mOcclusionCuller.Initialize();
 	CheckReturn(CreateDescriptorPool());
+	CheckReturn(CreateDefaultTexture());
+	for (auto& arena : mUniformArenas) {
+		CheckReturn(CreateUniformArena(arena, InitialUniformArenaSize));
+	}
 	CheckReturn(CreateCommandBuffers());
 	CheckReturn(CreateSyncObjects());
 
@@ -524,7 +464,27 @@ bool Renderer::Initialize(int inClientWidth, int inClientHeight, GLFWwindow* pWn
 }
 
 void Renderer::CleanUp() {
+	// Loads still in flight are abandoned; their futures report failure.
+	mLoadQueue.CleanUp();
+	for (auto& load : mModelLoads) {
+		load->Resident.set_value(false);
+	}
+	for (auto& load : mUploadingModelLoads) {
+		load->Resident.set_value(false);
+	}
+	mModelLoads.clear();
+	mUploadingModelLoads.clear();
+	mMeshLoads.clear();
+	mTextureLoads.clear();
+
+	mAssetPack.Close();
+
 	vkDeviceWaitIdle(mDevice);
+
+	mUploadContext.CleanUp();
+
+	ReleaseRetiredTextures(true);
+	mStreamedMaterials.clear();
 	
 	for (size_t i = 0; i < SwapChainImageCount; ++i) {
 		vkDestroyFence(mDevice, mInFlightFences[i], nullptr);
@@ -534,29 +494,51 @@ void Renderer::CleanUp() {
 
 	for (const auto& matPair : mMaterials) {
 		const auto& mat = matPair.second;
-		vkDestroySampler(mDevice, mat->TextureSampler, nullptr);
-
 		vkDestroyImageView(mDevice, mat->TextureImageView, nullptr);
 
-		vkDestroyImage(mDevice, mat->TextureImage, nullptr);
-		vkFreeMemory(mDevice, mat->TextureImageMemory, nullptr);
+		DestroyImage(mMemoryAllocator, mDevice, mat->TextureImage, mat->TextureImageAllocation);
+	}
+
+	vkDestroyImageView(mDevice, mDefaultMaterial->TextureImageView, nullptr);
+	DestroyImage(mMemoryAllocator, mDevice, mDefaultMaterial->TextureImage, mDefaultMaterial->TextureImageAllocation);
+
+	for (const auto& samplerPair : mSamplerTable) {
+		vkDestroySampler(mDevice, samplerPair.second, nullptr);
 	}
 
-	for (const auto& meshPair : mMeshes) {
-		const auto& mesh = meshPair.second;
-		vkDestroyBuffer(mDevice, mesh->IndexBuffer, nullptr);
-		vkFreeMemory(mDevice, mesh->IndexBufferMemory, nullptr);
+	mMeshes.clear();
 
-		vkDestroyBuffer(mDevice, mesh->VertexBuffer, nullptr);
-		vkFreeMemory(mDevice, mesh->VertexBufferMemory, nullptr);
+	DestroyGeometryBuffer(mShortIndexGeometry);
+	DestroyGeometryBuffer(mIndexGeometry);
+	for (auto& geometry : mVertexGeometries) {
+		DestroyGeometryBuffer(geometry);
 	}
 
-	vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayout, nullptr);
+	for (auto& arena : mUniformArenas) {
+		DestroyUniformArena(arena);
+	}
+
+	vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+
+	vkDestroyDescriptorSetLayout(mDevice, mFrameDescriptorSetLayout, nullptr);
 	
 	CleanUpSwapChain();
 	
 	vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
 
+	for (auto& contexts : mRecordingContexts) {
+		for (auto& context : contexts) {
+			vkDestroyCommandPool(mDevice, context.CommandPool, nullptr);
+		}
+		contexts.clear();
+	}
+
+	mThreadPool.CleanUp();
+
+	if (bGpuCullerAvailable) mGpuCuller.CleanUp();
+
+	mMemoryAllocator.CleanUp();
+
 	LowRenderer::CleanUp();
 
 	bIsCleanedUp = true;
@@ -577,660 +559,2817 @@ bool Renderer::AddModel(
 		glm::vec3 inScale, 
 		glm::fquat inQuat,
 		glm::vec3 inPos) {
-	if (mMeshes.count(inFilePath) == 0) {
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warn, err;
+	AssetSource meshSource;
+	AssetSource textureSource;
+	ResolveAsset(inFilePath, meshSource);
+	ResolveAsset(inTexFilePath, textureSource);
+
+	// The mesh goes last, like in AddLoadedModel(), so that a failure never leaves it without an item.
+	if (mMaterials.count(textureSource.Key) == 0) {
+		TextureImport import;
+		CheckReturn(PrepareTexture(textureSource, mSupportedTextureFormats, mThreadPool, import));
+		CheckReturn(AddTexture(textureSource.Key, std::move(import)));
+	}
 
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, inFilePath.c_str())) {
-			std::wstringstream wsstream;
-			wsstream << warn.c_str() << err.c_str();
-			ReturnFalse(wsstream.str());
-		}
+	if (mMeshes.count(meshSource.Key) == 0) {
+		MeshImport import;
+		CheckReturn(PrepareMesh(meshSource, GetMeshImportOptions(bFlipped), mThreadPool, import));
+		CheckReturn(UploadMesh(meshSource.Key, import));
+	}
 
-		auto mesh = std::make_unique<Mesh>();
+	CheckReturn(AddRenderItem(meshSource.Key, textureSource.Key, inName, inType, inScale, inQuat, inPos));
 
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				Vertex vertex = {};
-
-				vertex.mPos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				float texY = attrib.texcoords[2 * index.texcoord_index + 1];
-				vertex.mTexCoord = {
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					bFlipped ? 1.0f - texY : texY,
-				};
-
-				vertex.mColor = { 1.0f, 1.0f, 1.0f };
-
-				if (mesh->UniqueVertices.count(vertex) == 0) {
-					mesh->UniqueVertices[vertex] = static_cast<std::uint32_t>(mesh->Vertices.size());
-					mesh->Vertices.push_back(vertex);
-				}
+	return true;
+}
 
-				mesh->Indices.push_back(static_cast<std::uint32_t>(mesh->UniqueVertices[vertex]));
-			}
+std::shared_future<bool> Renderer::AddModelAsync(
+		const std::string& inFilePath,
+		const std::string& inTexFilePath,
+		const std::string& inName,
+		RenderTypes inType,
+		bool bFlipped,
+		glm::vec3 inScale,
+		glm::fquat inQuat,
+		glm::vec3 inPos) {
+	// Meshes and textures are keyed by what they are loaded from, which is shared by cooked sources with
+	// identical contents.
+	AssetSource meshSource;
+	AssetSource textureSource;
+	ResolveAsset(inFilePath, meshSource);
+	ResolveAsset(inTexFilePath, textureSource);
+
+	auto load = std::make_unique<AsyncModelLoad>();
+	load->FilePath = meshSource.Key;
+	load->TexFilePath = textureSource.Key;
+	load->Name = inName;
+	load->Type = inType;
+	load->Scale = inScale;
+	load->Quat = inQuat;
+	load->Pos = inPos;
+
+	if (mMeshes.count(meshSource.Key) == 0) {
+		auto& pMeshLoad = mMeshLoads[meshSource.Key];
+		if (!pMeshLoad) {
+			pMeshLoad = std::make_shared<AsyncMeshLoad>();
+
+			MeshImportOptions options = GetMeshImportOptions(bFlipped);
+			mLoadQueue.Push([pLoad = pMeshLoad, meshSource, options]() {
+				// The shared thread pool belongs to the render thread; this one runs its tasks inline.
+				ThreadPool inlinePool;
+				pLoad->bSucceeded = PrepareMesh(meshSource, options, inlinePool, pLoad->Import);
+				pLoad->bDone = true;
+			});
+		}
+		load->pMeshLoad = pMeshLoad;
+	}
+
+	if (mMaterials.count(textureSource.Key) == 0) {
+		auto& pTextureLoad = mTextureLoads[textureSource.Key];
+		if (!pTextureLoad) {
+			pTextureLoad = std::make_shared<AsyncTextureLoad>();
+
+			mLoadQueue.Push([pLoad = pTextureLoad, textureSource, supportedFormats = mSupportedTextureFormats]() {
+				ThreadPool inlinePool;
+				pLoad->bSucceeded = PrepareTexture(textureSource, supportedFormats, inlinePool, pLoad->Import);
+				pLoad->bDone = true;
+			});
 		}
+		load->pTextureLoad = pTextureLoad;
+	}
+
+	std::shared_future<bool> future = load->Resident.get_future().share();
+	mModelLoads.push_back(std::move(load));
+
+	return future;
+}
+
+bool Renderer::SubmitUploads(std::uint64_t& outTicket) {
+	CheckReturn(mUploadContext.Submit(outTicket));
+
+	return true;
+}
 
-		CheckReturn(CreateVertexBuffer(mesh.get()));
-		CheckReturn(CreateIndexBuffer(mesh.get()));
+bool Renderer::IsUploadComplete(std::uint64_t inTicket) {
+	return mUploadContext.IsComplete(inTicket);
+}
+
+bool Renderer::RemoveModel(const std::string& inName, RenderTypes inType) {
+	auto& ritemRefs = mRItemRefs[inType];
 
-		mMeshes[inFilePath] = std::move(mesh);
+	auto refIter = ritemRefs.find(inName);
+	if (refIter == ritemRefs.end()) {
+		std::wstringstream wsstream;
+		wsstream << L"There is no render item named " << inName.c_str();
+		ReturnFalse(wsstream.str());
 	}
 
-	if (mMaterials.count(inTexFilePath) == 0) {
-		CheckReturn(AddTexture(inTexFilePath));
+	RenderItem* pRItem = refIter->second;
+	ritemRefs.erase(refIter);
+
+	for (auto iter = mOrderedRItemRefs.begin(); iter != mOrderedRItemRefs.end();) {
+		if (iter->second == pRItem) iter = mOrderedRItemRefs.erase(iter);
+		else ++iter;
 	}
 
-	auto ritem = std::make_unique<RenderItem>();
-	ritem->Scale = inScale;
-	ritem->Quat = inQuat;
-	ritem->Pos = inPos;
-	ritem->MeshName = inFilePath;
-	ritem->MatName = inTexFilePath;
+	// The item may still be referenced by frames in flight.
+	vkDeviceWaitIdle(mDevice);
 
-	CheckReturn(CreateUniformBuffers(ritem.get()));
-	CheckReturn(CreateDescriptorSets(ritem.get()));
+	mInstancedRItems.clear();
+	for (auto& batches : mInstanceBatches) {
+		batches.clear();
+	}
 
-	mRItemRefs[inType][inName] = ritem.get();
-	mRItems.push_back(std::move(ritem));
+	bGpuSceneDirty = true;
+
+	RemoveCullingVolume(inType, pRItem);
+
+	auto meshIter = mMeshes.find(pRItem->MeshName);
+	if (meshIter != mMeshes.end() && --meshIter->second->RefCount == 0) {
+		const auto& mesh = meshIter->second;
+		mVertexGeometries[mesh->VertexFormat].Allocator.Free(static_cast<std::uint64_t>(mesh->VertexOffset));
+		auto& indexGeometry = mesh->IndexType == VK_INDEX_TYPE_UINT16 ? mShortIndexGeometry : mIndexGeometry;
+		indexGeometry.Allocator.Free(mesh->FirstIndex);
+
+		mMeshes.erase(meshIter);
+	}
+
+	auto itemIter = std::find_if(mRItems.begin(), mRItems.end(), [&](const std::unique_ptr<RenderItem>& ritem) {
+		return ritem.get() == pRItem;
+	});
+	if (itemIter != mRItems.end()) mRItems.erase(itemIter);
 
 	return true;
 }
 
-bool Renderer::UpdateCamera(const glm::vec3& inPos, const glm::vec3& inTarget) {
-	mCameraPos = inPos;
-	mCameraTarget = inTarget;
+bool Renderer::SetCookedAssets(const std::string& inSourceDir, const std::string& inCookedDir) {
+	const std::filesystem::path cookedDir(inCookedDir);
+
+	CookedManifest manifest;
+	CheckReturn(ReadCookedManifest((cookedDir / CookedManifestFileName).string(), manifest));
+
+	const std::filesystem::path sourceDir = std::filesystem::absolute(inSourceDir);
+
+	mCookedAssetPaths.clear();
+	for (const auto& entry : manifest) {
+		std::string sourcePath = (sourceDir / entry.first).lexically_normal().generic_string();
+		mCookedAssetPaths[sourcePath] = (cookedDir / entry.second).string();
+	}
+
+	std::wstringstream wsstream;
+	wsstream << mCookedAssetPaths.size() << L" cooked assets in " << inCookedDir.c_str();
+	WLogln(wsstream.str());
 
 	return true;
 }
 
-bool Renderer::UpdateModel(
-		const std::string& inName, 
-		RenderTypes inType, 
-		glm::vec3 inScale, 
-		glm::fquat inQuat, 
-		glm::vec3 inPos) {
-	mRItemRefs[inType][inName]->Scale = inScale;
-	mRItemRefs[inType][inName]->Quat = inQuat;
-	mRItemRefs[inType][inName]->Pos = inPos;
+bool Renderer::OpenAssetPack(const std::string& inSourceDir, const std::string& inPackPath) {
+	if (!mModelLoads.empty() || !mUploadingModelLoads.empty()) {
+		ReturnFalse(L"The asset pack cannot change while models are loading");
+	}
+
+	// Textures streamed from the open pack keep the levels they have, since their entries go with it.
+	for (auto iter = mStreamedMaterials.begin(); iter != mStreamedMaterials.end();) {
+		auto& pStreaming = (*iter)->pStreaming;
+		if (pStreaming->Source.PackedEntry.pData == nullptr) {
+			++iter;
+			continue;
+		}
+
+		mStreamedTextureSize -= pStreaming->ResidentSize;
+		pStreaming.reset();
+		iter = mStreamedMaterials.erase(iter);
+	}
+
+	CheckReturn(mAssetPack.Open(inPackPath));
+
+	mAssetPackPath = inPackPath;
+	mAssetPackSourceDir = std::filesystem::absolute(inSourceDir).lexically_normal().generic_string();
+
+	std::wstringstream wsstream;
+	wsstream << mAssetPack.GetEntryCount() << L" packed assets in " << inPackPath.c_str();
+	WLogln(wsstream.str());
 
 	return true;
 }
 
-bool Renderer::Update(const GameTimer& gt) {
-	vkWaitForFences(mDevice, 1, &mInFlightFences[mCurrentFrame], VK_TRUE, UINT64_MAX);
+void Renderer::ResolveAsset(const std::string& inFilePath, AssetSource& outSource) const {
+	outSource = AssetSource();
+	outSource.SourcePath = inFilePath;
 
-	VkResult result = vkAcquireNextImageKHR(
-		mDevice,
-		mSwapChain,
-		UINT64_MAX,
-		mImageAvailableSemaphores[mCurrentFrame],
-		VK_NULL_HANDLE,
-		&mCurentImageIndex
-	);
+	if (mAssetPack.IsOpen() || !mCookedAssetPaths.empty()) {
+		const std::filesystem::path sourcePath = std::filesystem::absolute(inFilePath).lexically_normal();
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-		CheckReturn(RecreateSwapChain());
-		return true;
-	}
-	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-		ReturnFalse(L"Failed to acquire swap chain image");
+		if (mAssetPack.IsOpen()) {
+			const std::string name = sourcePath.lexically_relative(mAssetPackSourceDir).generic_string();
+			if (mAssetPack.Find(name, outSource.Entry)) {
+				// Entries with identical contents share their payload.
+				outSource.Key = mAssetPackPath + "@" + std::to_string(outSource.Entry.Offset);
+				outSource.FilePath = name;
+				return;
+			}
+		}
+
+		auto iter = mCookedAssetPaths.find(sourcePath.generic_string());
+		if (iter != mCookedAssetPaths.end()) {
+			outSource.Key = iter->second;
+			outSource.FilePath = iter->second;
+			return;
+		}
 	}
 
-	if (mImagesInFlight[mCurentImageIndex] != VK_NULL_HANDLE)
-		vkWaitForFences(mDevice, 1, &mImagesInFlight[mCurentImageIndex], VK_TRUE, UINT64_MAX);
-	
-	mImagesInFlight[mCurentImageIndex] = mInFlightFences[mCurrentFrame];
-	
-	CheckReturn(UpdateUniformBuffer(gt));
-	
-	if (bNeedToUpdateDescriptorSet) {
-		CheckReturn(UpdateDescriptorSet());
-		bNeedToUpdateDescriptorSet = false;
+	outSource.Key = inFilePath;
+	outSource.FilePath = inFilePath;
+}
+
+bool Renderer::PrepareMesh(const AssetSource& inSource, const MeshImportOptions& inOptions, ThreadPool& inThreadPool, MeshImport& outImport) {
+	outImport.pMesh = std::make_unique<Mesh>();
+
+	// Cooked data that fails validation is replaced by importing the source it was cooked from.
+	bool bCooked = false;
+	if (inSource.Entry.pData != nullptr) {
+		bCooked = ReadCookedMesh(inSource.Entry, inSource.FilePath, *outImport.pMesh);
+	}
+	else if (std::filesystem::path(inSource.FilePath).extension() == ".mesh") {
+		bCooked = ReadCookedMesh(inSource.FilePath, *outImport.pMesh);
+		if (!bCooked && inSource.SourcePath == inSource.FilePath) return false;
 	}
-	
-	mOrderedRItemRefs.clear();
-	const auto& blendRItemRefs = mRItemRefs[RenderTypes::EBlend];
-	for (const auto& blendRItemRefPair : blendRItemRefs) {
-		const auto& blendRItemRef = blendRItemRefPair.second;
 
-		float dist = glm::distance(mCameraPos, blendRItemRef->Pos);
-		mOrderedRItemRefs.insert(std::make_pair(dist, blendRItemRef));
+	if (!bCooked) {
+		outImport.pMesh = std::make_unique<Mesh>();
+		CheckReturn(ImportMesh(inSource.SourcePath, inOptions, inThreadPool, *outImport.pMesh));
 	}
-	
+
+	FinishMeshImport(inSource.FilePath, inOptions, outImport);
+
 	return true;
 }
 
-bool Renderer::Draw() {
-	auto& commandBuffer = mCommandBuffers[mCurrentFrame];
-	if (vkResetCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT) != VK_SUCCESS) {
-		ReturnFalse(L"Failed to reset command buffer");
+bool Renderer::PrepareTexture(const AssetSource& inSource, std::uint32_t inSupportedFormats, ThreadPool& inThreadPool, TextureImport& outImport) {
+	bool bCooked = false;
+	if (inSource.Entry.pData != nullptr) {
+		bCooked = ReadCookedTexture(inSource.Entry, inSource.FilePath, outImport);
+	}
+	else if (std::filesystem::path(inSource.FilePath).extension() == ".tex") {
+		bCooked = ReadCookedTexture(inSource.FilePath, outImport);
+		if (!bCooked && inSource.SourcePath == inSource.FilePath) return false;
 	}
 
-	VkCommandBufferBeginInfo beginInfo = {};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = 0;
-	beginInfo.pInheritanceInfo = nullptr;
+	if (!bCooked) {
+		outImport = TextureImport();
+		CheckReturn(ImportTexture(inSource.SourcePath, outImport));
+	}
 
-	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
-		ReturnFalse(L"Failed to begin recording command buffer");
+	if (!(inSupportedFormats & (1u << outImport.Format))) {
+		// Packed texels are read out of the archive first, since they are decoded rather than staged.
+		std::vector<std::uint8_t> packedTexels;
+		const std::uint8_t* pTexels = outImport.Pixels.data();
+		if (outImport.PackedEntry.pData != nullptr) {
+			packedTexels.resize(static_cast<size_t>(outImport.PackedEntry.Size));
+			CheckReturn(ReadPackEntry(outImport.PackedEntry, packedTexels.data(), outImport.PackedEntry.Size));
+			pTexels = packedTexels.data() + outImport.PackedPixelOffset;
+		}
+
+		TextureImport decoded;
+		CheckReturn(DecompressTexture(outImport, pTexels, inThreadPool, decoded));
+		outImport = std::move(decoded);
 	}
 
-	VkRenderPassBeginInfo renderPassInfo = {};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = mRenderPass;
-	renderPassInfo.framebuffer = mSwapChainFramebuffers[mCurentImageIndex];
-	renderPassInfo.renderArea.offset = { 0,0 };
-	renderPassInfo.renderArea.extent = mSwapChainExtent;
+	return true;
+}
 
-	// Note: that the order of clearValues should be identical to the order of attachments.
-	std::array<VkClearValue, 2> clearValues = {};
-	clearValues[0].color = { 0.87f, 0.87f, 0.87f, 1.0f };
-	clearValues[1].depthStencil = { 1.0f, 0 };
+MeshImportOptions Renderer::GetMeshImportOptions(bool bFlipped) const {
+	MeshImportOptions options;
+	options.bFlipped = bFlipped;
+	options.bOverdrawOrdering = bOverdrawOrdering;
+	options.bParallelWelding = bParallelWelding;
+	options.bCompactVertices = bCompactVertices && bCompactVerticesSupported;
+	return options;
+}
 
-	renderPassInfo.clearValueCount = static_cast<std::uint32_t>(clearValues.size());
-	renderPassInfo.pClearValues = clearValues.data();
+bool Renderer::UploadMesh(const std::string& inFilePath, MeshImport& ioImport) {
+	CheckReturn(CreateVertexBuffer(ioImport.pMesh.get(), ioImport.CompactVertices));
+	CheckReturn(CreateIndexBuffer(ioImport.pMesh.get()));
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	mMeshes[inFilePath] = std::move(ioImport.pMesh);
 
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipeline);
-	
-	for (const auto& ritemRefPair : mRItemRefs[RenderTypes::EOpaque]) {
-		const auto& ritemRef = ritemRefPair.second;
-		const auto& mesh = mMeshes[ritemRef->MeshName];
+	return true;
+}
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &ritemRef->DescriptorSets[mCurrentFrame], 0, nullptr);
-	
-		VkBuffer vertexBuffers[] = { mesh->VertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-	
-		vkCmdBindIndexBuffer(commandBuffer, mesh->IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-	
-		vkCmdDrawIndexed(commandBuffer, static_cast<std::uint32_t>(mesh->Indices.size()), 1, 0, 0, 0);
-	}
+bool Renderer::AddRenderItem(
+		const std::string& inFilePath,
+		const std::string& inTexFilePath,
+		const std::string& inName,
+		RenderTypes inType,
+		glm::vec3 inScale,
+		glm::fquat inQuat,
+		glm::vec3 inPos) {
+	++mMeshes[inFilePath]->RefCount;
+
+	auto ritem = std::make_unique<RenderItem>();
+	ritem->Scale = inScale;
+	ritem->Quat = inQuat;
+	ritem->Pos = inPos;
+	ritem->Name = inName;
+	ritem->MeshName = inFilePath;
+	ritem->MatName = inTexFilePath;
+	ritem->UploadTicket = mUploadContext.GetPendingTicket();
+
+	AddCullingVolume(inType, ritem.get());
+
+	mRItemRefs[inType][inName] = ritem.get();
+	mRItems.push_back(std::move(ritem));
+
+	bGpuSceneDirty = true;
+
+	return true;
+}
+
+// A mesh or texture that failed to load fails every model waiting for it; the next request tries again.
+// Both are checked before anything is uploaded, and the mesh goes last: a mesh is only freed with the
+// last item using it, while textures stay resident for later models anyway.
+bool Renderer::AddLoadedModel(AsyncModelLoad& ioLoad) {
+	const bool bMeshResident = mMeshes.count(ioLoad.FilePath) != 0;
+	const bool bTextureResident = mMaterials.count(ioLoad.TexFilePath) != 0;
+
+	// Without a load of its own, the mesh was resident when requested and has been removed since.
+	if (!bMeshResident && (!ioLoad.pMeshLoad || !ioLoad.pMeshLoad->bSucceeded)) ReturnFalse(L"Failed to load mesh");
+	if (!bTextureResident && (!ioLoad.pTextureLoad || !ioLoad.pTextureLoad->bSucceeded)) ReturnFalse(L"Failed to load texture");
+
+	if (!bTextureResident) CheckReturn(AddTexture(ioLoad.TexFilePath, std::move(ioLoad.pTextureLoad->Import)));
+	if (!bMeshResident) CheckReturn(UploadMesh(ioLoad.FilePath, ioLoad.pMeshLoad->Import));
+
+	CheckReturn(AddRenderItem(ioLoad.FilePath, ioLoad.TexFilePath, ioLoad.Name, ioLoad.Type, ioLoad.Scale, ioLoad.Quat, ioLoad.Pos));
+	ioLoad.UploadTicket = mUploadContext.GetPendingTicket();
+
+	return true;
+}
+
+// Uploads the models whose data has arrived and resolves the ones whose uploads became available.
+// Only fails on errors of the renderer itself; a failed load just resolves its future to false.
+bool Renderer::ProcessModelLoads() {
+	for (auto iter = mUploadingModelLoads.begin(); iter != mUploadingModelLoads.end();) {
+		auto& load = **iter;
+		if (!mUploadContext.IsAvailable(load.UploadTicket)) {
+			++iter;
+			continue;
+		}
+
+		load.Resident.set_value(true);
+		iter = mUploadingModelLoads.erase(iter);
+	}
+
+	for (auto iter = mModelLoads.begin(); iter != mModelLoads.end();) {
+		auto& load = **iter;
+		if ((load.pMeshLoad && !load.pMeshLoad->bDone) || (load.pTextureLoad && !load.pTextureLoad->bDone)) {
+			++iter;
+			continue;
+		}
+
+		// Later requests for the same data find it resident now, or load it again after a failure.
+		auto meshIter = mMeshLoads.find(load.FilePath);
+		if (meshIter != mMeshLoads.end() && meshIter->second == load.pMeshLoad) mMeshLoads.erase(meshIter);
+		auto textureIter = mTextureLoads.find(load.TexFilePath);
+		if (textureIter != mTextureLoads.end() && textureIter->second == load.pTextureLoad) mTextureLoads.erase(textureIter);
+
+		if (AddLoadedModel(load)) {
+			mUploadingModelLoads.push_back(std::move(*iter));
+		}
+		else {
+			std::wstringstream wsstream;
+			wsstream << L"Failed to load model " << load.Name.c_str() << L" from " << load.FilePath.c_str();
+			WLogln(wsstream.str());
+
+			load.Resident.set_value(false);
+		}
+
+		iter = mModelLoads.erase(iter);
+	}
+
+	return true;
+}
+
+void Renderer::GetMemoryStats(MemoryAllocator::Stats& outStats) const {
+	mMemoryAllocator.GetStats(outStats);
+}
+
+void Renderer::LogMemoryStats() const {
+	mMemoryAllocator.LogStats();
+}
+
+void Renderer::SetParallelRecording(bool bEnabled) {
+	bParallelRecording = bEnabled;
+}
+
+bool Renderer::IsParallelRecording() const {
+	return bParallelRecording;
+}
+
+void Renderer::GetRecordingStats(bool bParallel, RecordingStats& outStats) const {
+	outStats = mRecordingStats[bParallel ? 1 : 0];
+}
+
+void Renderer::LogRecordingStats() const {
+	for (std::uint32_t i = 0; i < 2; ++i) {
+		const auto& stats = mRecordingStats[i];
+		if (stats.FrameCount == 0) continue;
+
+		double frameCount = static_cast<double>(stats.FrameCount);
+
+		std::wstringstream wsstream;
+		wsstream << (i == 1 ? L"Parallel" : L"Serial") << L" recording: "
+			<< stats.RecordingTime / frameCount << L" ms/frame, "
+			<< static_cast<double>(stats.DrawCount) / frameCount << L" draws/frame, "
+			<< static_cast<double>(stats.TaskCount) / frameCount << L" tasks/frame over "
+			<< stats.FrameCount << L" frames";
+		WLogln(wsstream.str());
+	}
+}
+
+bool Renderer::SetGpuDrivenRendering(bool bEnabled) {
+	if (bEnabled && !bGpuCullerAvailable) {
+		WLogln(L"GPU-driven rendering requires drawIndirectFirstInstance");
+		return false;
+	}
+
+	bGpuDriven = bEnabled;
+	bGpuSceneDirty = true;
+
+	return true;
+}
+
+bool Renderer::IsGpuDrivenRendering() const {
+	return bGpuDriven;
+}
+
+void Renderer::SetCullingMethod(CullingMethods inMethod) {
+	mCullingMethod = inMethod;
+}
+
+CullingMethods Renderer::GetCullingMethod() const {
+	return mCullingMethod;
+}
+
+void Renderer::GetCullingStats(CullingMethods inMethod, CullingStats& outStats) const {
+	outStats = mCullingStats[inMethod];
+}
+
+void Renderer::LogCullingStats() const {
+	const wchar_t* methodNames[CullingMethods::ENumCullingMethods] = {
+		L"Scalar", FrustumCuller::IsAvx2Supported() ? L"SIMD (AVX2)" : L"SIMD (SSE)", L"Octree" };
+
+	for (std::uint32_t i = 0; i < CullingMethods::ENumCullingMethods; ++i) {
+		const auto& stats = mCullingStats[i];
+		if (stats.FrameCount == 0 || stats.CullingTime <= 0.0) continue;
+
+		double frameCount = static_cast<double>(stats.FrameCount);
+
+		std::wstringstream wsstream;
+		wsstream << methodNames[i] << L" culling: "
+			<< static_cast<double>(stats.TestedCount) / stats.CullingTime << L" objects/us, "
+			<< stats.CullingTime / frameCount << L" us/frame, "
+			<< static_cast<double>(stats.VisibleCount) / frameCount << L" of "
+			<< static_cast<double>(stats.TestedCount) / frameCount << L" visible/frame over "
+			<< stats.FrameCount << L" frames";
+		WLogln(wsstream.str());
+	}
+}
+
+void Renderer::QuerySphere(RenderTypes inType, const glm::vec3& inCenter, float inRadius, std::vector<std::string>& outNames) const {
+	std::vector<std::uint32_t> ids;
+	mSceneIndices[inType].QuerySphere(inCenter, inRadius, ids);
+	GetQueryNames(inType, ids, outNames);
+}
+
+void Renderer::QueryBox(RenderTypes inType, const glm::vec3& inMin, const glm::vec3& inMax, std::vector<std::string>& outNames) const {
+	std::vector<std::uint32_t> ids;
+	mSceneIndices[inType].QueryAabb(inMin, inMax, ids);
+	GetQueryNames(inType, ids, outNames);
+}
+
+void Renderer::QueryNearest(RenderTypes inType, const glm::vec3& inPoint, std::uint32_t inCount, std::vector<std::string>& outNames) const {
+	std::vector<std::uint32_t> ids;
+	mSceneIndices[inType].QueryNearest(inPoint, inCount, ids);
+	GetQueryNames(inType, ids, outNames);
+}
+
+void Renderer::LogSceneIndexScaling() {
+	const std::uint32_t QueryCount = 64;
+
+	std::array<glm::vec4, 6> planes;
+	glm::mat4 proj = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	ExtractFrustumPlanes(proj * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), UpVector), planes);
+
+	for (std::uint32_t itemCount = 1000; itemCount <= 1000000; itemCount *= 10) {
+		// The scene grows with the item count so that the density, and with it the result sizes, stay the same.
+		float halfSize = 8.0f * std::cbrt(static_cast<float>(itemCount));
+
+		std::mt19937 engine(itemCount);
+		std::uniform_real_distribution<float> position(-halfSize, halfSize);
+		std::uniform_real_distribution<float> extent(0.25f, 2.0f);
+
+		std::vector<glm::vec3> centers(itemCount);
+		std::vector<glm::vec3> extents(itemCount);
+		for (std::uint32_t i = 0; i < itemCount; ++i) {
+			centers[i] = glm::vec3(position(engine), position(engine), position(engine));
+			extents[i] = glm::vec3(extent(engine), extent(engine), extent(engine));
+		}
+
+		FrustumCuller culler;
+		LooseOctree octree;
+
+		auto buildBegin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < itemCount; ++i) {
+			octree.Insert(i, centers[i], extents[i]);
+		}
+		auto buildEnd = std::chrono::high_resolution_clock::now();
+
+		for (std::uint32_t i = 0; i < itemCount; ++i) {
+			culler.Add(centers[i], glm::length(extents[i]), extents[i]);
+		}
+
+		std::vector<std::uint32_t> ids;
+
+		auto linearFrustumBegin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < QueryCount; ++i) {
+			culler.Cull(planes, true, ids);
+		}
+		auto linearFrustumEnd = std::chrono::high_resolution_clock::now();
+
+		auto octreeFrustumBegin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < QueryCount; ++i) {
+			octree.QueryFrustum(planes, ids);
+		}
+		auto octreeFrustumEnd = std::chrono::high_resolution_clock::now();
+		size_t frustumCount = ids.size();
+
+		const float SphereRadius = 16.0f;
+
+		auto linearSphereBegin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < QueryCount; ++i) {
+			ids.clear();
+			const auto& center = centers[i % itemCount];
+			for (std::uint32_t j = 0; j < itemCount; ++j) {
+				glm::vec3 offset = glm::max(glm::abs(center - centers[j]) - extents[j], glm::vec3(0.0f));
+				if (glm::dot(offset, offset) <= SphereRadius * SphereRadius) ids.push_back(j);
+			}
+		}
+		auto linearSphereEnd = std::chrono::high_resolution_clock::now();
+
+		auto octreeSphereBegin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < QueryCount; ++i) {
+			octree.QuerySphere(centers[i % itemCount], SphereRadius, ids);
+		}
+		auto octreeSphereEnd = std::chrono::high_resolution_clock::now();
+
+		auto nearestBegin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < QueryCount; ++i) {
+			octree.QueryNearest(centers[i % itemCount], 16, ids);
+		}
+		auto nearestEnd = std::chrono::high_resolution_clock::now();
+
+		auto toMicro = [&](auto inBegin, auto inEnd) {
+			return std::chrono::duration<double, std::micro>(inEnd - inBegin).count() / QueryCount;
+		};
+
+		std::wstringstream wsstream;
+		wsstream << itemCount << L" items (" << octree.GetNodeCount() << L" nodes, built in "
+			<< std::chrono::duration<double, std::milli>(buildEnd - buildBegin).count() << L" ms): frustum "
+			<< toMicro(linearFrustumBegin, linearFrustumEnd) << L" us linear / "
+			<< toMicro(octreeFrustumBegin, octreeFrustumEnd) << L" us octree (" << frustumCount << L" visible), sphere "
+			<< toMicro(linearSphereBegin, linearSphereEnd) << L" us linear / "
+			<< toMicro(octreeSphereBegin, octreeSphereEnd) << L" us octree, nearest-16 "
+			<< toMicro(nearestBegin, nearestEnd) << L" us";
+		WLogln(wsstream.str());
+	}
+}
+
+void Renderer::LogObjParsingBenchmark() {
+	ThreadPool threadPool;
+	threadPool.Initialize(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+	const std::string filePath = (std::filesystem::temp_directory_path() / "GameMathObjBenchmark.obj").string();
+
+	std::mt19937 engine(0);
+	std::uniform_real_distribution<float> height(-0.5f, 0.5f);
+
+	for (std::uint32_t gridSize = 256; gridSize <= 2048; gridSize *= 2) {
+		// A height field of (gridSize + 1)^2 vertices and two triangles per cell, written like exporters do.
+		{
+			std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				WLogln(L"Failed to create the OBJ benchmark file");
+				return;
+			}
+
+			std::string text;
+			char line[128];
+			auto flush = [&](bool bForce) {
+				if (bForce || text.size() >= 4 * 1024 * 1024) {
+					file.write(text.data(), static_cast<std::streamsize>(text.size()));
+					text.clear();
+				}
+			};
+
+			const std::uint32_t rowLength = gridSize + 1;
+			const float scale = 1.0f / static_cast<float>(gridSize);
+			for (std::uint32_t y = 0; y < rowLength; ++y) {
+				for (std::uint32_t x = 0; x < rowLength; ++x) {
+					int length = std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\n",
+						static_cast<float>(x) * scale, height(engine), static_cast<float>(y) * scale,
+						static_cast<float>(x) * scale, static_cast<float>(y) * scale);
+					text.append(line, static_cast<size_t>(length));
+					flush(false);
+				}
+			}
+			for (std::uint32_t y = 0; y < gridSize; ++y) {
+				for (std::uint32_t x = 0; x < gridSize; ++x) {
+					std::uint32_t i0 = y * rowLength + x + 1;
+					std::uint32_t i1 = i0 + 1;
+					std::uint32_t i2 = i0 + rowLength;
+					std::uint32_t i3 = i2 + 1;
+					int length = std::snprintf(line, sizeof(line), "f %u/%u %u/%u %u/%u\nf %u/%u %u/%u %u/%u\n",
+						i0, i0, i2, i2, i1, i1, i1, i1, i2, i2, i3, i3);
+					text.append(line, static_cast<size_t>(length));
+					flush(false);
+				}
+			}
+			flush(true);
+		}
+
+		double fileSize = static_cast<double>(std::filesystem::file_size(filePath)) / (1024.0 * 1024.0);
+
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn, err;
+
+		auto tinyobjBegin = std::chrono::high_resolution_clock::now();
+		bool bTinyobjLoaded = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filePath.c_str());
+		auto tinyobjEnd = std::chrono::high_resolution_clock::now();
+
+		size_t tinyobjCornerCount = 0;
+		for (const auto& shape : shapes) {
+			tinyobjCornerCount += shape.mesh.indices.size();
+		}
+
+		ObjData obj;
+
+		auto parserBegin = std::chrono::high_resolution_clock::now();
+		bool bParsed = LoadObjFile(filePath, threadPool, obj);
+		auto parserEnd = std::chrono::high_resolution_clock::now();
+
+		double tinyobjTime = std::chrono::duration<double, std::milli>(tinyobjEnd - tinyobjBegin).count();
+		double parserTime = std::chrono::duration<double, std::milli>(parserEnd - parserBegin).count();
+
+		std::wstringstream wsstream;
+		wsstream << gridSize * gridSize * 2 << L" triangles (" << fileSize << L" MB): tinyobj "
+			<< tinyobjTime << L" ms (" << fileSize * 1000.0 / tinyobjTime << L" MB/s), parser "
+			<< parserTime << L" ms (" << fileSize * 1000.0 / parserTime << L" MB/s, " << threadPool.GetThreadCount()
+			<< L" threads), " << tinyobjTime / parserTime << L"x";
+		if (!bTinyobjLoaded || !bParsed || tinyobjCornerCount != obj.Corners.size()) wsstream << L", results differ";
+		WLogln(wsstream.str());
+	}
+
+	std::filesystem::remove(filePath);
+
+	threadPool.CleanUp();
+}
+
+void Renderer::LogAssetIoBenchmark() {
+	ThreadPool threadPool;
+	threadPool.Initialize(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "GameMathAssetIoBenchmark";
+
+	// Removes the files on every way out, including the early returns when writing them fails.
+	struct DirectoryGuard {
+		std::filesystem::path Path;
+		~DirectoryGuard() {
+			std::error_code error;
+			std::filesystem::remove_all(Path, error);
+		}
+	} directoryGuard{ directory };
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		WLogln(L"Failed to create the asset I/O benchmark directory");
+		return;
+	}
+
+	std::mt19937 engine(0);
+
+	// Loose files shaped like cooked assets: mostly small meshes and textures of 64 KB to 4 MB, with
+	// smooth texels and repeated vertex data, so compression behaves roughly as it does on real ones.
+	const std::uint32_t fileCount = 512;
+	std::vector<PackSource> sources;
+	std::uint64_t totalSize = 0;
+	for (std::uint32_t i = 0; i < fileCount; ++i) {
+		const size_t size = static_cast<size_t>(64 * 1024) << (engine() % 7);
+
+		std::vector<std::uint8_t> data(size);
+		std::uint8_t value = static_cast<std::uint8_t>(engine());
+		for (size_t j = 0; j < size; ++j) {
+			if (engine() % 8 == 0) value = static_cast<std::uint8_t>(value + engine() % 5 - 2);
+			data[j] = value;
+		}
+
+		PackSource source;
+		source.Name = "Asset" + std::to_string(i) + (i % 2 == 0 ? ".obj" : ".png");
+		source.FilePath = (directory / (std::to_string(i) + ".bin")).string();
+
+		std::ofstream file(source.FilePath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		if (!file.good()) {
+			WLogln(L"Failed to write the asset I/O benchmark files");
+			return;
+		}
+
+		totalSize += size;
+		sources.push_back(std::move(source));
+	}
+
+	const std::string storedPath = (directory / "Stored.pack").string();
+	const std::string compressedPath = (directory / "Compressed.pack").string();
+	if (!WritePackArchive(storedPath, sources, false, threadPool) || !WritePackArchive(compressedPath, sources, true, threadPool)) {
+		WLogln(L"Failed to write the asset I/O benchmark archives");
+		return;
+	}
+
+	// Stands in for mapped staging memory, and is touched beforehand so only the loads are timed.
+	std::vector<std::uint8_t> staging(static_cast<size_t>(4 * 1024 * 1024), 0);
+
+	auto toMilli = [](const auto& inBegin, const auto& inEnd) {
+		return std::chrono::duration<double, std::milli>(inEnd - inBegin).count();
+	};
+
+	// What ReadFile() and the cooked loaders did: read into an allocated buffer, then copy.
+	auto looseBegin = std::chrono::high_resolution_clock::now();
+	bool bLooseRead = true;
+	for (const auto& source : sources) {
+		std::ifstream file(source.FilePath, std::ios::ate | std::ios::binary);
+		std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		bLooseRead = bLooseRead && file.good();
+		std::memcpy(staging.data(), buffer.data(), buffer.size());
+	}
+	auto looseEnd = std::chrono::high_resolution_clock::now();
+
+	// Entries are found and copied or decompressed straight from the mapping.
+	auto readPack = [&](const std::string& inPackPath, double& outTime) {
+		auto begin = std::chrono::high_resolution_clock::now();
+		PackArchive pack;
+		bool bRead = pack.Open(inPackPath);
+		for (const auto& source : sources) {
+			PackEntry entry;
+			bRead = bRead && pack.Find(source.Name, entry) && ReadPackEntry(entry, staging.data(), entry.Size);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		outTime = toMilli(begin, end);
+		return bRead;
+	};
+
+	double storedTime = 0.0;
+	double compressedTime = 0.0;
+	bool bStoredRead = readPack(storedPath, storedTime);
+	bool bCompressedRead = readPack(compressedPath, compressedTime);
+	const std::uint64_t compressedSize = std::filesystem::file_size(compressedPath, error);
+
+	const double totalMegabytes = static_cast<double>(totalSize) / (1024.0 * 1024.0);
+	const double looseTime = toMilli(looseBegin, looseEnd);
+	{
+		std::wstringstream wsstream;
+		wsstream << fileCount << L" files (" << totalMegabytes << L" MB, warm cache): loose "
+			<< looseTime << L" ms (" << totalMegabytes * 1000.0 / looseTime << L" MB/s), pack "
+			<< storedTime << L" ms (" << totalMegabytes * 1000.0 / storedTime << L" MB/s), LZ4 pack "
+			<< compressedTime << L" ms (" << totalMegabytes * 1000.0 / compressedTime << L" MB/s, "
+			<< static_cast<double>(compressedSize) / (1024.0 * 1024.0) << L" MB on disk)";
+		if (!bLooseRead || !bStoredRead || !bCompressedRead) wsstream << L", reads failed";
+		WLogln(wsstream.str());
+	}
+
+	// Opening only maps the archive, so its cost should not grow with the number of entries.
+	const std::string emptyPath = (directory / "Empty.bin").string();
+	std::ofstream(emptyPath, std::ios::binary | std::ios::trunc);
+	for (std::uint32_t entryCount = 1024; entryCount <= 65536; entryCount *= 4) {
+		std::vector<PackSource> entries(entryCount);
+		for (std::uint32_t i = 0; i < entryCount; ++i) {
+			entries[i].Name = "Entry" + std::to_string(i);
+			entries[i].FilePath = emptyPath;
+		}
+
+		const std::string packPath = (directory / "Entries.pack").string();
+		if (!WritePackArchive(packPath, entries, false, threadPool)) {
+			WLogln(L"Failed to write the asset I/O benchmark archives");
+			break;
+		}
+
+		auto openBegin = std::chrono::high_resolution_clock::now();
+		PackArchive pack;
+		bool bOpened = pack.Open(packPath);
+		auto openEnd = std::chrono::high_resolution_clock::now();
+
+		PackEntry entry;
+		auto findBegin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < entryCount; ++i) {
+			bOpened = bOpened && pack.Find(entries[i].Name, entry);
+		}
+		auto findEnd = std::chrono::high_resolution_clock::now();
+
+		std::wstringstream wsstream;
+		wsstream << entryCount << L" entries: open " << toMilli(openBegin, openEnd) * 1000.0 << L" us, find "
+			<< toMilli(findBegin, findEnd) * 1000000.0 / entryCount << L" ns per entry";
+		if (!bOpened) wsstream << L", lookups failed";
+		WLogln(wsstream.str());
+	}
+
+	threadPool.CleanUp();
+}
+
+void Renderer::LogTextureCompressionBenchmark() {
+	ThreadPool threadPool;
+	threadPool.Initialize(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+	// Smooth gradients, hard edges and fine noise, with an alpha ramp for the formats that keep it.
+	const std::uint32_t size = 2048;
+	TextureImport source;
+	InitTextureMips(size, size, source);
+
+	std::mt19937 engine(0);
+	for (std::uint32_t y = 0; y < size; ++y) {
+		for (std::uint32_t x = 0; x < size; ++x) {
+			const float u = static_cast<float>(x) / size;
+			const float v = static_cast<float>(y) / size;
+			const int noise = static_cast<int>(engine() % 17) - 8;
+
+			std::uint8_t* pTexel = source.Pixels.data() + (static_cast<size_t>(y) * size + x) * 4;
+			pTexel[0] = static_cast<std::uint8_t>(std::clamp(static_cast<int>(127.5f + 127.5f * std::sin(u * 13.0f + v * 3.0f)) + noise, 0, 255));
+			pTexel[1] = static_cast<std::uint8_t>(std::clamp(static_cast<int>(255.0f * v) + noise, 0, 255));
+			pTexel[2] = ((x / 37 + y / 29) & 1) ? 200 : 40;
+			pTexel[3] = static_cast<std::uint8_t>(127.5f + 127.5f * std::cos(u * 7.0f));
+		}
+	}
+	GenerateMipChain(source);
+
+	const double megabytes = static_cast<double>(source.Pixels.size()) / (1024.0 * 1024.0);
+
+	const std::pair<TextureFormats, const wchar_t*> formats[] = {
+		{ TextureFormats::ETextureBc1, L"BC1" },
+		{ TextureFormats::ETextureBc3, L"BC3" },
+		{ TextureFormats::ETextureBc7, L"BC7" }
+	};
+	for (const auto& format : formats) {
+		TextureImport compressed;
+		auto begin = std::chrono::high_resolution_clock::now();
+		bool bCompressed = CompressTexture(source, format.first, threadPool, compressed);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		TextureImport decoded;
+		bCompressed = bCompressed && DecompressTexture(compressed, compressed.Pixels.data(), threadPool, decoded);
+
+		const double time = std::chrono::duration<double, std::milli>(end - begin).count();
+
+		std::wstringstream wsstream;
+		wsstream << format.second << L": " << size << L"x" << size << L" with mips (" << megabytes << L" MB) in "
+			<< time << L" ms (" << megabytes * 1000.0 / time << L" MB/s, " << threadPool.GetThreadCount()
+			<< L" threads), RGB PSNR " << GetTexturePsnr(source, decoded, 0, 3) << L" dB";
+		if (format.first != TextureFormats::ETextureBc1) wsstream << L", alpha PSNR " << GetTexturePsnr(source, decoded, 3, 1) << L" dB";
+		if (!bCompressed) wsstream << L", encoding failed";
+		WLogln(wsstream.str());
+	}
+
+	threadPool.CleanUp();
+}
+
+bool Renderer::SetOccluder(const std::string& inName, RenderTypes inType, bool bOccluder) {
+	auto iter = mRItemRefs[inType].find(inName);
+	if (iter == mRItemRefs[inType].end()) {
+		std::wstringstream wsstream;
+		wsstream << L"There is no render item named " << inName.c_str();
+		ReturnFalse(wsstream.str());
+	}
+
+	iter->second->bOccluder = bOccluder;
+
+	return true;
+}
+
+void Renderer::SetOcclusionCulling(bool bEnabled) {
+	bOcclusionCulling = bEnabled;
+}
+
+bool Renderer::IsOcclusionCulling() const {
+	return bOcclusionCulling;
+}
+
+void Renderer::GetOcclusionStats(OcclusionStats& outStats) const {
+	outStats = mOcclusionStats;
+}
+
+void Renderer::LogOcclusionStats() const {
+	const auto& stats = mOcclusionStats;
+	if (stats.FrameCount == 0) return;
+
+	double frameCount = static_cast<double>(stats.FrameCount);
+
+	std::wstringstream wsstream;
+	wsstream << L"Occlusion culling: "
+		<< static_cast<double>(stats.RejectedCount) / frameCount << L" of "
+		<< static_cast<double>(stats.TestedCount) / frameCount << L" draws rejected/frame, "
+		<< static_cast<double>(stats.OccluderTriangleCount) / frameCount << L" occluder triangles/frame, "
+		<< stats.RasterizationTime / frameCount << L" ms rasterization + "
+		<< stats.TestTime / frameCount << L" ms tests/frame over "
+		<< stats.FrameCount << L" frames";
+	WLogln(wsstream.str());
+}
+
+std::uint32_t Renderer::AddCell(const glm::vec3& inMin, const glm::vec3& inMax) {
+	std::uint32_t cell = mPortalGraph.AddCell(inMin, inMax);
+	AssignCells();
+
+	return cell;
+}
+
+bool Renderer::AddCellFromModel(const std::string& inName, RenderTypes inType, std::uint32_t& outCell) {
+	auto iter = mRItemRefs[inType].find(inName);
+	if (iter == mRItemRefs[inType].end()) {
+		std::wstringstream wsstream;
+		wsstream << L"There is no render item named " << inName.c_str();
+		ReturnFalse(wsstream.str());
+	}
+
+	glm::vec3 center;
+	float radius;
+	glm::vec3 extents;
+	mFrustumCullers[inType].Get(iter->second->CullIndex, center, radius, extents);
+
+	outCell = AddCell(center - extents, center + extents);
+
+	return true;
+}
+
+bool Renderer::AddPortal(std::uint32_t inCellA, std::uint32_t inCellB, const std::array<glm::vec3, 4>& inCorners) {
+	CheckReturn(mPortalGraph.AddPortal(inCellA, inCellB, inCorners));
+
+	return true;
+}
+
+void Renderer::SetPortalCulling(bool bEnabled) {
+	bPortalCulling = bEnabled;
+}
+
+bool Renderer::IsPortalCulling() const {
+	return bPortalCulling;
+}
+
+void Renderer::GetPortalStats(PortalStats& outStats) const {
+	outStats = mPortalStats;
+}
+
+void Renderer::LogPortalStats() const {
+	const auto& stats = mPortalStats;
+	if (stats.FrameCount == 0) return;
+
+	double frameCount = static_cast<double>(stats.FrameCount);
+
+	std::wstringstream wsstream;
+	wsstream << L"Portal culling: "
+		<< static_cast<double>(stats.VisibleCellCount) / frameCount << L" of " << mPortalGraph.GetCellCount() << L" cells visible/frame, "
+		<< static_cast<double>(stats.RejectedCount) / frameCount << L" of "
+		<< static_cast<double>(stats.TestedCount) / frameCount << L" draws rejected/frame, "
+		<< stats.CullingTime / frameCount << L" us/frame over "
+		<< stats.FrameCount << L" frames";
+	WLogln(wsstream.str());
+}
+
+void Renderer::SetLodSelection(bool bEnabled) {
+	bLodSelection = bEnabled;
+}
+
+bool Renderer::IsLodSelection() const {
+	return bLodSelection;
+}
+
+void Renderer::SetTriangleBudget(std::uint64_t inTriangleCount) {
+	mTriangleBudget = inTriangleCount;
+}
+
+void Renderer::SetOverdrawOrdering(bool bEnabled) {
+	bOverdrawOrdering = bEnabled;
+}
+
+void Renderer::SetCompactVertices(bool bEnabled) {
+	bCompactVertices = bEnabled;
+}
+
+void Renderer::SetParallelWelding(bool bEnabled) {
+	bParallelWelding = bEnabled;
+}
+
+void Renderer::SetClusterCulling(bool bEnabled) {
+	bClusterCulling = bEnabled;
+}
+
+bool Renderer::IsClusterCulling() const {
+	return bClusterCulling;
+}
+
+void Renderer::GetClusterStats(ClusterStats& outStats) const {
+	outStats = mClusterStats;
+}
+
+void Renderer::LogClusterStats() const {
+	const auto& stats = mClusterStats;
+	if (stats.FrameCount == 0 || stats.TestedCount == 0) return;
+
+	double frameCount = static_cast<double>(stats.FrameCount);
+
+	std::wstringstream wsstream;
+	wsstream << L"Cluster culling: "
+		<< static_cast<double>(stats.TestedCount) / frameCount << L" meshlets/frame, "
+		<< static_cast<double>(stats.FrustumRejectedCount) / frameCount << L" outside the frustum, "
+		<< static_cast<double>(stats.BackFacingRejectedCount) / frameCount << L" back-facing, "
+		<< static_cast<double>(stats.DrawnTriangleCount) / frameCount << L" of "
+		<< static_cast<double>(stats.TriangleCount) / frameCount << L" triangles drawn/frame";
+	WLogln(wsstream.str());
+}
+
+void Renderer::GetLodStats(LodStats& outStats) const {
+	outStats = mLodStats;
+}
+
+void Renderer::LogLodStats() const {
+	const auto& stats = mLodStats;
+	if (stats.FrameCount == 0) return;
+
+	double frameCount = static_cast<double>(stats.FrameCount);
+
+	std::wstringstream wsstream;
+	wsstream << L"Level of detail: "
+		<< static_cast<double>(stats.TriangleCount) / frameCount << L" of "
+		<< static_cast<double>(stats.FullDetailTriangleCount) / frameCount << L" triangles/frame, budget applied in "
+		<< stats.BudgetFrameCount << L" of " << stats.FrameCount << L" frames";
+	WLogln(wsstream.str());
+}
+
+void Renderer::SetTextureStreaming(bool bEnabled) {
+	bTextureStreaming = bEnabled;
+}
+
+bool Renderer::IsTextureStreaming() const {
+	return bTextureStreaming;
+}
+
+void Renderer::SetTextureBudget(std::uint64_t inSize) {
+	mTextureBudget = inSize;
+}
+
+void Renderer::GetTextureStreamingStats(TextureStreamingStats& outStats) const {
+	outStats = mTextureStreamingStats;
+	outStats.TextureCount = mStreamedMaterials.size();
+	outStats.ResidentSize = mStreamedTextureSize;
+	outStats.FullSize = 0;
+	for (const Material* pMat : mStreamedMaterials) {
+		outStats.FullSize += GetMipChainSize(pMat->pStreaming->Source, 0);
+	}
+}
+
+void Renderer::LogTextureStreamingStats() const {
+	TextureStreamingStats stats;
+	GetTextureStreamingStats(stats);
+	if (stats.FrameCount == 0 || stats.TextureCount == 0) return;
+
+	const double megabyte = 1024.0 * 1024.0;
+
+	std::wstringstream wsstream;
+	wsstream << L"Texture streaming: "
+		<< static_cast<double>(stats.ResidentSize) / megabyte << L" of "
+		<< static_cast<double>(stats.FullSize) / megabyte << L" MB of " << stats.TextureCount << L" textures resident, "
+		<< stats.UpgradeCount << L" upgrades, " << stats.EvictionCount << L" evictions, "
+		<< stats.DeferredCount << L" deferred by the budget, "
+		<< static_cast<double>(stats.StagedSize) / megabyte << L" MB staged over " << stats.FrameCount << L" frames";
+	WLogln(wsstream.str());
+}
+
+bool Renderer::UpdateCamera(const glm::vec3& inPos, const glm::vec3& inTarget) {
+	mCameraPos = inPos;
+	mCameraTarget = inTarget;
+
+	return true;
+}
+
+bool Renderer::UpdateModel(
+		const std::string& inName, 
+		RenderTypes inType, 
+		glm::vec3 inScale, 
+		glm::fquat inQuat, 
+		glm::vec3 inPos) {
+	// Models loading in the background are not there until they are resident.
+	auto iter = mRItemRefs[inType].find(inName);
+	if (iter == mRItemRefs[inType].end()) return false;
+
+	RenderItem* pRItem = iter->second;
+	// Items are updated every frame whether they moved or not; static ones cost nothing further.
+	if (pRItem->Scale == inScale && pRItem->Quat == inQuat && pRItem->Pos == inPos) return true;
+
+	pRItem->Scale = inScale;
+	pRItem->Quat = inQuat;
+	pRItem->Pos = inPos;
+
+	// Only opaque items are in the GPU scene. Moving one just changes its matrix, which is patched in
+	// place unless the scene is rebuilt anyway, and only that object is copied to the frames.
+	if (inType == RenderTypes::EOpaque) {
+		if (!bGpuSceneDirty && pRItem->GpuObjectIndex != RenderItem::NullGpuObject) {
+			mGpuObjects[pRItem->GpuObjectIndex].mModel = BuildWorldMatrix(pRItem) * mMeshes[pRItem->MeshName]->Dequantization;
+			mGpuCuller.MarkObjectDirty(pRItem->GpuObjectIndex);
+		}
+		else {
+			bGpuSceneDirty = true;
+		}
+	}
+	UpdateCullingVolume(inType, pRItem);
+
+	return true;
+}
+
+bool Renderer::Update(const GameTimer& gt) {
+	CheckReturn(ProcessModelLoads());
+
+	// Uploads recorded since the last frame are kicked off before it; on a single queue they are
+	// ordered ahead of it, otherwise they become visible once the transfer queue is done with them.
+	if (mUploadContext.HasPendingWork()) {
+		std::uint64_t ticket = 0;
+		CheckReturn(mUploadContext.Submit(ticket));
+	}
+	CheckReturn(mUploadContext.Pump());
+
+	vkWaitForFences(mDevice, 1, &mInFlightFences[mCurrentFrame], VK_TRUE, UINT64_MAX);
+
+	VkResult result = vkAcquireNextImageKHR(
+		mDevice,
+		mSwapChain,
+		UINT64_MAX,
+		mImageAvailableSemaphores[mCurrentFrame],
+		VK_NULL_HANDLE,
+		&mCurentImageIndex
+	);
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		CheckReturn(RecreateSwapChain());
+		return true;
+	}
+	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		ReturnFalse(L"Failed to acquire swap chain image");
+	}
+
+	if (mImagesInFlight[mCurentImageIndex] != VK_NULL_HANDLE)
+		vkWaitForFences(mDevice, 1, &mImagesInFlight[mCurentImageIndex], VK_TRUE, UINT64_MAX);
+	
+	mImagesInFlight[mCurentImageIndex] = mInFlightFences[mCurrentFrame];
+
+	++mFrameNumber;
+	FlushDescriptorWrites(mUniformArenas[mCurrentFrame]);
+
+	UpdateViewConstants();
+	CullRenderItems();
+	CullPortalRenderItems();
+	CullOccludedRenderItems();
+	SelectLods();
+	CheckReturn(UpdateTextureStreaming());
+	
+	mOrderedRItemRefs.clear();
+	const auto& blendRItems = mCullableRItems[RenderTypes::EBlend];
+	for (std::uint32_t index : mVisibleIndices[RenderTypes::EBlend]) {
+		RenderItem* pRItem = blendRItems[index];
+
+		float dist = glm::distance(mCameraPos, pRItem->Pos);
+		mOrderedRItemRefs.insert(std::make_pair(dist, pRItem));
+	}
+
+	BuildInstanceBatches();
+
+	if (bGpuDriven) {
+		if (bGpuSceneDirty) BuildGpuScene();
+
+		CheckReturn(mGpuCuller.UpdateScene(
+			static_cast<std::uint32_t>(mCurrentFrame),
+			mGpuSceneVersion,
+			mGpuObjects,
+			mGpuBatches,
+			static_cast<std::uint32_t>(mIndirectRuns.size())));
+	}
+	
+	CheckReturn(UpdateUniformBuffer(gt));
+	
+	return true;
+}
+
+bool Renderer::Draw() {
+	auto& commandBuffer = mCommandBuffers[mCurrentFrame];
+	if (vkResetCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to reset command buffer");
+	}
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = 0;
+	beginInfo.pInheritanceInfo = nullptr;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to begin recording command buffer");
+	}
+
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = mRenderPass;
+	renderPassInfo.framebuffer = mSwapChainFramebuffers[mCurentImageIndex];
+	renderPassInfo.renderArea.offset = { 0,0 };
+	renderPassInfo.renderArea.extent = mSwapChainExtent;
+
+	// Note: that the order of clearValues should be identical to the order of attachments.
+	std::array<VkClearValue, 2> clearValues = {};
+	clearValues[0].color = { 0.87f, 0.87f, 0.87f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+
+	renderPassInfo.clearValueCount = static_cast<std::uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	auto recordingBegin = std::chrono::high_resolution_clock::now();
+
+	bool bIndirect = bGpuDriven && !mIndirectRuns.empty();
+	if (bIndirect) mGpuCuller.RecordCulling(commandBuffer, static_cast<std::uint32_t>(mCurrentFrame), mFrustumPlanes);
+
+	size_t drawCount = mInstanceBatches[RenderTypes::EOpaque].size() + mInstanceBatches[RenderTypes::EBlend].size();
+
+	// Small draw lists are cheaper to record inline than to hand out to workers.
+	std::uint32_t taskCount = 1;
+	if (bParallelRecording && !bGpuDriven) {
+		size_t neededTasks = (drawCount + MinDrawsPerRecordingTask - 1) / MinDrawsPerRecordingTask;
+		taskCount = static_cast<std::uint32_t>(std::min<size_t>(neededTasks, mThreadPool.GetThreadCount()));
+	}
+
+	if (taskCount <= 1) {
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		if (bIndirect) RecordIndirectDraws(commandBuffer);
+		RecordDraws(commandBuffer, 0, drawCount);
+	}
+	else {
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+		CheckReturn(RecordDrawsParallel(taskCount, drawCount));
+
+		std::vector<VkCommandBuffer> secondaryCommandBuffers(taskCount);
+		for (std::uint32_t i = 0; i < taskCount; ++i) {
+			secondaryCommandBuffers[i] = mRecordingContexts[mCurrentFrame][i].CommandBuffer;
+		}
+
+		vkCmdExecuteCommands(commandBuffer, taskCount, secondaryCommandBuffers.data());
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to record command buffer");
+	}
+
+	auto& stats = mRecordingStats[bParallelRecording ? 1 : 0];
+	++stats.FrameCount;
+	stats.DrawCount += drawCount + (bIndirect ? mGpuBatches.size() : 0);
+	stats.TaskCount += taskCount;
+	stats.RecordingTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordingBegin).count();
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+	VkSemaphore waitSemaphores[] = {
+		mImageAvailableSemaphores[mCurrentFrame]
+	};
+	VkPipelineStageFlags waitStages[] = {
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+	};
+	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages;
+
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	VkSemaphore signalSemaphores[] = {
+		mRenderFinishedSemaphores[mCurrentFrame]
+	};
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+
+	vkResetFences(mDevice, 1, &mInFlightFences[mCurrentFrame]);
+
+	if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, mInFlightFences[mCurrentFrame]) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to submit draw command buffer");
+	}
+
+	VkPresentInfoKHR presentInfo = {};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = signalSemaphores;
+
+	VkSwapchainKHR swapChains[] = { mSwapChain };
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = swapChains;
+	presentInfo.pImageIndices = &mCurentImageIndex;
+	presentInfo.pResults = nullptr;
+
+	VkResult result = vkQueuePresentKHR(mPresentQueue, &presentInfo);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || bFramebufferResized) {
+		bFramebufferResized = false;
+		CheckReturn(RecreateSwapChain());
+	}
+	else if (result != VK_SUCCESS) {
+		ReturnFalse(L"Failed to present swap chain image");
+	}
+
+	mCurrentFrame = (mCurrentFrame + 1) % SwapChainImageCount;
+
+	return true;
+}
+
+bool Renderer::RecreateSwapChain() {
+	vkDeviceWaitIdle(mDevice);
+
+	CleanUpSwapChain();
+
+	LowRenderer::RecreateSwapChain();
+
+	CheckReturn(CreateImageViews());
+	CheckReturn(CreateRenderPass());
+	CheckReturn(CreateGraphicsPipeline());
+	CheckReturn(CreateColorResources());
+	CheckReturn(CreateDepthResources());
+	CheckReturn(CreateFramebuffers());
+	CheckReturn(CreateCommandBuffers());
+
+	return true;
+}
+
+void Renderer::CleanUpSwapChain() {
+	vkDestroyImageView(mDevice, mColorImageView, nullptr);
+	DestroyImage(mMemoryAllocator, mDevice, mColorImage, mColorImageAllocation);
+	
+	vkDestroyImageView(mDevice, mDepthImageView, nullptr);
+	DestroyImage(mMemoryAllocator, mDevice, mDepthImage, mDepthImageAllocation);
+	
+	for (size_t i = 0; i < SwapChainImageCount; ++i) {
+		vkDestroyFramebuffer(mDevice, mSwapChainFramebuffers[i], nullptr);
+	}
+	
+	vkFreeCommandBuffers(mDevice, mCommandPool, static_cast<std::uint32_t>(mCommandBuffers.size()), mCommandBuffers.data());
+	
+	for (auto pipeline : mGraphicsPipelines) {
+		vkDestroyPipeline(mDevice, pipeline, nullptr);
+	}
+	vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
+	vkDestroyRenderPass(mDevice, mRenderPass, nullptr);
+	
+	for (size_t i = 0; i < SwapChainImageCount; ++i) {
+		vkDestroyImageView(mDevice, mSwapChainImageViews[i], nullptr);
+	}
+
+	LowRenderer::CleanUpSwapChain();
+}
+
+// Only the levels of StreamingTailSize and smaller are uploaded; the texture keeps its import to stage
+// the finer ones from when its items come close.
+bool Renderer::AddTexture(const std::string& inFilePath, TextureImport&& inImport) {
+	std::uint32_t tailMip = 0;
+	while (tailMip + 1 < inImport.Mips.size() &&
+			std::max(inImport.Mips[tailMip].Width, inImport.Mips[tailMip].Height) > StreamingTailSize) {
+		++tailMip;
+	}
+
+	auto material = std::make_unique<Material>();
+	auto pMat = material.get();
+	CheckReturn(CreateTextureImage(inImport, tailMip, pMat));
+	CheckReturn(CreateTextureImageView(pMat));
+	CheckReturn(GetSampler(SamplerDesc(), pMat->SamplerIndex));
+	CheckReturn(RegisterTexture(pMat, mUploadContext.GetPendingTicket()));
+
+	if (tailMip > 0) {
+		pMat->pStreaming = std::make_unique<TextureStreaming>();
+		auto& streaming = *pMat->pStreaming;
+		streaming.ResidentMip = tailMip;
+		streaming.WantedMip = tailMip;
+		streaming.TailMip = tailMip;
+		streaming.ResidentSize = GetMipChainSize(inImport, tailMip);
+		streaming.LastUsedFrame = mFrameNumber;
+		streaming.UploadTicket = mUploadContext.GetPendingTicket();
+		streaming.Source = std::move(inImport);
+
+		mStreamedTextureSize += streaming.ResidentSize;
+		mStreamedMaterials.push_back(pMat);
+	}
+
+	mMaterials[inFilePath] = std::move(material);
+
+	return true;
+}
+
+bool Renderer::CreateDefaultTexture() {
+	// Fills every texture slot that has not been written yet, since the table is not partially bound.
+	TextureImport white;
+	InitTextureMips(1, 1, white);
+	std::fill(white.Pixels.begin(), white.Pixels.end(), static_cast<std::uint8_t>(0xFF));
+
+	mDefaultMaterial = std::make_unique<Material>();
+	auto pMat = mDefaultMaterial.get();
+	CheckReturn(CreateTextureImage(white, 0, pMat));
+	CheckReturn(CreateTextureImageView(pMat));
+	CheckReturn(GetSampler(SamplerDesc(), pMat->SamplerIndex));
+
+	pMat->TextureIndex = static_cast<std::uint32_t>(mTextureTable.size());
+	mTextureTable.push_back(pMat->TextureImageView);
+
+	return true;
+}
+
+bool Renderer::RegisterTexture(Material* ioMaterial, std::uint64_t inUploadTicket) {
+	if (mTextureTable.size() >= mTextureCapacity) ReturnFalse(L"Texture table is full");
+
+	ioMaterial->TextureIndex = static_cast<std::uint32_t>(mTextureTable.size());
+	mTextureTable.push_back(ioMaterial->TextureImageView);
+
+	QueueTextureWrite(ioMaterial, inUploadTicket);
+
+	return true;
+}
+
+void Renderer::QueueTextureWrite(const Material* pMaterial, std::uint64_t inUploadTicket) {
+	for (auto& arena : mUniformArenas) {
+		PendingDescriptorWrite write;
+		write.Binding = 1;
+		write.Slot = pMaterial->TextureIndex;
+		write.UploadTicket = inUploadTicket;
+		write.ImageView = pMaterial->TextureImageView;
+		arena.PendingWrites.push_back(write);
+	}
+}
+
+bool Renderer::GetSampler(const SamplerDesc& inDesc, std::uint32_t& outIndex) {
+	for (size_t i = 0, end = mSamplerTable.size(); i < end; ++i) {
+		if (mSamplerTable[i].first == inDesc) {
+			outIndex = static_cast<std::uint32_t>(i);
+			return true;
+		}
+	}
+
+	if (mSamplerTable.size() >= MaxSamplerCount) ReturnFalse(L"Sampler table is full");
+
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = inDesc.Filter;
+	samplerInfo.minFilter = inDesc.Filter;
+	samplerInfo.addressModeU = inDesc.AddressMode;
+	samplerInfo.addressModeV = inDesc.AddressMode;
+	samplerInfo.addressModeW = inDesc.AddressMode;
+	samplerInfo.anisotropyEnable = inDesc.MaxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+	samplerInfo.maxAnisotropy = inDesc.MaxAnisotropy;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.mipmapMode = inDesc.MipmapMode;
+	samplerInfo.mipLodBias = 0.0f;
+	samplerInfo.minLod = 0.0f;
+	// The image views limit the mip chain, so one sampler serves textures of any size.
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	VkSampler sampler;
+	if (vkCreateSampler(mDevice, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to create texture sampler");
+	}
+
+	outIndex = static_cast<std::uint32_t>(mSamplerTable.size());
+	mSamplerTable.push_back(std::make_pair(inDesc, sampler));
+
+	for (auto& arena : mUniformArenas) {
+		PendingDescriptorWrite write;
+		write.Binding = 2;
+		write.Slot = outIndex;
+		arena.PendingWrites.push_back(write);
+	}
+
+	return true;
+}
+
+void Renderer::FlushDescriptorWrites(UniformArena& ioArena) {
+	if (ioArena.DescriptorSet == VK_NULL_HANDLE) return;
+
+	auto& pendingWrites = ioArena.PendingWrites;
+	for (auto iter = pendingWrites.begin(); iter != pendingWrites.end();) {
+		if (!mUploadContext.IsAvailable(iter->UploadTicket)) {
+			++iter;
+			continue;
+		}
+
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		if (iter->Binding == 1) imageInfo.imageView = iter->ImageView;
+		else imageInfo.sampler = mSamplerTable[iter->Slot].second;
+
+		VkWriteDescriptorSet descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = ioArena.DescriptorSet;
+		descriptorWrite.dstBinding = iter->Binding;
+		descriptorWrite.dstArrayElement = iter->Slot;
+		descriptorWrite.descriptorType = iter->Binding == 1 ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(mDevice, 1, &descriptorWrite, 0, nullptr);
+
+		iter = pendingWrites.erase(iter);
+	}
+}
+
+void Renderer::RecordDraws(VkCommandBuffer inCommandBuffer, size_t inBegin, size_t inEnd) {
+	const auto& arena = mUniformArenas[mCurrentFrame];
+
+	// The pipeline and vertex buffer follow the vertex format of the batches.
+	vkCmdBindVertexBuffers(inCommandBuffer, 1, 1, &arena.Buffer, &mInstanceOffset);
+
+	vkCmdBindDescriptorSets(inCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &arena.DescriptorSet, 1, &mViewUniformOffset);
+
+	// Opaque batches first, then the blend batches from back to front.
+	const auto& opaqueBatches = mInstanceBatches[RenderTypes::EOpaque];
+	const auto& blendBatches = mInstanceBatches[RenderTypes::EBlend];
+
+	Material* pBoundMaterial = nullptr;
+	VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+	VertexFormats boundVertexFormat = VertexFormats::ENumVertexFormats;
+	for (size_t i = inBegin; i < inEnd; ++i) {
+		const auto& batch = i < opaqueBatches.size() ? opaqueBatches[i] : blendBatches[i - opaqueBatches.size()];
+
+		if (batch.pMesh->VertexFormat != boundVertexFormat) {
+			boundVertexFormat = batch.pMesh->VertexFormat;
+			vkCmdBindPipeline(inCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipelines[boundVertexFormat]);
+
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(inCommandBuffer, 0, 1, &mVertexGeometries[boundVertexFormat].Buffer, &offset);
+		}
+
+		if (batch.pMesh->IndexType != boundIndexType) {
+			boundIndexType = batch.pMesh->IndexType;
+			VkBuffer indexBuffer = boundIndexType == VK_INDEX_TYPE_UINT16 ? mShortIndexGeometry.Buffer : mIndexGeometry.Buffer;
+			vkCmdBindIndexBuffer(inCommandBuffer, indexBuffer, 0, boundIndexType);
+		}
+
+		if (batch.pMaterial != pBoundMaterial) {
+			DrawConstants drawConstants = { batch.pMaterial->TextureIndex, batch.pMaterial->SamplerIndex };
+			vkCmdPushConstants(inCommandBuffer, mPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(drawConstants), &drawConstants);
+			pBoundMaterial = batch.pMaterial;
+		}
+
+		vkCmdDrawIndexed(
+			inCommandBuffer,
+			batch.IndexCount,
+			batch.InstanceCount,
+			batch.pMesh->FirstIndex + batch.FirstIndex,
+			batch.pMesh->VertexOffset,
+			batch.FirstInstance);
+	}
+}
+
+void Renderer::RecordIndirectDraws(VkCommandBuffer inCommandBuffer) {
+	std::uint32_t frameIndex = static_cast<std::uint32_t>(mCurrentFrame);
+
+	VkBuffer instanceBuffer = mGpuCuller.GetInstanceBuffer(frameIndex);
+	VkDeviceSize instanceOffset = 0;
+	vkCmdBindVertexBuffers(inCommandBuffer, 1, 1, &instanceBuffer, &instanceOffset);
+
+	const auto& arena = mUniformArenas[mCurrentFrame];
+	vkCmdBindDescriptorSets(inCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &arena.DescriptorSet, 1, &mViewUniformOffset);
+
+	VkBuffer drawBuffer = mGpuCuller.GetDrawCommandBuffer(frameIndex);
+	VkBuffer countBuffer = mGpuCuller.GetDrawCountBuffer(frameIndex);
+	const std::uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+	VertexFormats boundVertexFormat = VertexFormats::ENumVertexFormats;
+	for (size_t i = 0, end = mIndirectRuns.size(); i < end; ++i) {
+		const auto& run = mIndirectRuns[i];
+
+		if (run.VertexFormat != boundVertexFormat) {
+			boundVertexFormat = run.VertexFormat;
+			vkCmdBindPipeline(inCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipelines[boundVertexFormat]);
+
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(inCommandBuffer, 0, 1, &mVertexGeometries[boundVertexFormat].Buffer, &offset);
+		}
+
+		if (run.IndexType != boundIndexType) {
+			boundIndexType = run.IndexType;
+			VkBuffer indexBuffer = boundIndexType == VK_INDEX_TYPE_UINT16 ? mShortIndexGeometry.Buffer : mIndexGeometry.Buffer;
+			vkCmdBindIndexBuffer(inCommandBuffer, indexBuffer, 0, boundIndexType);
+		}
+
+		DrawConstants drawConstants = { run.pMaterial->TextureIndex, run.pMaterial->SamplerIndex };
+		vkCmdPushConstants(inCommandBuffer, mPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(drawConstants), &drawConstants);
+
+		VkDeviceSize offset = static_cast<VkDeviceSize>(run.FirstDraw) * stride;
+
+		if (bDrawIndirectCountSupported) {
+			mCmdDrawIndexedIndirectCount(inCommandBuffer, drawBuffer, offset, countBuffer, sizeof(std::uint32_t) * i, run.DrawCount, stride);
+		}
+		else if (mEnabledFeatures.multiDrawIndirect) {
+			vkCmdDrawIndexedIndirect(inCommandBuffer, drawBuffer, offset, run.DrawCount, stride);
+		}
+		else {
+			for (std::uint32_t draw = 0; draw < run.DrawCount; ++draw) {
+				vkCmdDrawIndexedIndirect(inCommandBuffer, drawBuffer, offset + static_cast<VkDeviceSize>(draw) * stride, 1, stride);
+			}
+		}
+	}
+}
+
+void Renderer::BuildGpuScene() {
+	bGpuSceneDirty = false;
+
+	mSortedOpaqueRItems.clear();
+	for (const auto& ritemRefPair : mRItemRefs[RenderTypes::EOpaque]) {
+		RenderItem* pRItem = ritemRefPair.second;
+		pRItem->GpuObjectIndex = RenderItem::NullGpuObject;
+
+		// Picked up by a later rebuild once its uploads are available.
+		if (!mUploadContext.IsAvailable(pRItem->UploadTicket)) {
+			bGpuSceneDirty = true;
+			continue;
+		}
+
+		mSortedOpaqueRItems.emplace_back(mMeshes[pRItem->MeshName].get(), mMaterials[pRItem->MatName].get(), pRItem);
+	}
+
+	// Vertex format, material and index type first, so that every run is one contiguous range of batches.
+	std::sort(mSortedOpaqueRItems.begin(), mSortedOpaqueRItems.end(), [](const auto& inLhs, const auto& inRhs) {
+		return std::make_tuple(std::get<0>(inLhs)->VertexFormat, std::get<1>(inLhs), std::get<0>(inLhs)->IndexType, std::get<0>(inLhs)) <
+			std::make_tuple(std::get<0>(inRhs)->VertexFormat, std::get<1>(inRhs), std::get<0>(inRhs)->IndexType, std::get<0>(inRhs));
+	});
+
+	mGpuObjects.clear();
+	mGpuBatches.clear();
+	mIndirectRuns.clear();
+
+	Mesh* pBatchMesh = nullptr;
+	Material* pBatchMaterial = nullptr;
+	for (const auto& entry : mSortedOpaqueRItems) {
+		Mesh* pMesh = std::get<0>(entry);
+		Material* pMaterial = std::get<1>(entry);
+
+		if (mIndirectRuns.empty() || pMaterial != pBatchMaterial || pMesh->IndexType != mIndirectRuns.back().IndexType ||
+				pMesh->VertexFormat != mIndirectRuns.back().VertexFormat) {
+			IndirectRun run;
+			run.pMaterial = pMaterial;
+			run.VertexFormat = pMesh->VertexFormat;
+			run.IndexType = pMesh->IndexType;
+			run.FirstDraw = static_cast<std::uint32_t>(mGpuBatches.size());
+			mIndirectRuns.push_back(run);
+		}
+
+		if (mGpuBatches.empty() || pMesh != pBatchMesh || pMaterial != pBatchMaterial) {
+			GpuBatch batch = {};
+			batch.mIndexCount = pMesh->Lods[0].IndexCount;
+			batch.mFirstIndex = pMesh->FirstIndex;
+			batch.mVertexOffset = pMesh->VertexOffset;
+			batch.mFirstInstance = static_cast<std::uint32_t>(mGpuObjects.size());
+			batch.mRunIndex = static_cast<std::uint32_t>(mIndirectRuns.size() - 1);
+			batch.mRunFirstDraw = mIndirectRuns.back().FirstDraw;
+			mGpuBatches.push_back(batch);
+
+			++mIndirectRuns.back().DrawCount;
+
+			pBatchMesh = pMesh;
+			pBatchMaterial = pMaterial;
+		}
+
+		// The culling shader sees the instance matrix, so the sphere is given in quantized space. Its radius
+		// is scaled by the smallest dequantization axis, which keeps the world-space sphere conservative.
+		const auto& dequantization = pMesh->Dequantization;
+		glm::vec3 quantizationScale = glm::vec3(dequantization[0][0], dequantization[1][1], dequantization[2][2]);
+		glm::vec3 quantizedCenter = (pMesh->BoundsCenter - glm::vec3(dequantization[3])) / quantizationScale;
+		float quantizedRadius = pMesh->BoundsRadius / std::min(quantizationScale.x, std::min(quantizationScale.y, quantizationScale.z));
+
+		GpuObject object = {};
+		object.mModel = BuildWorldMatrix(std::get<2>(entry)) * dequantization;
+		object.mBoundingSphere = glm::vec4(quantizedCenter, quantizedRadius);
+		object.mBatchIndex = static_cast<std::uint32_t>(mGpuBatches.size() - 1);
+		std::get<2>(entry)->GpuObjectIndex = static_cast<std::uint32_t>(mGpuObjects.size());
+		mGpuObjects.push_back(object);
+	}
+
+	++mGpuSceneVersion;
+}
+
+bool Renderer::RecordDrawsParallel(std::uint32_t inTaskCount, size_t inDrawCount) {
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = mRenderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = mSwapChainFramebuffers[mCurentImageIndex];
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	// Each task owns the pool it records into, so no two threads ever touch the same pool.
+	// Slices are contiguous and executed in task order, which keeps the blend order intact.
+	std::atomic<bool> bFailed = false;
+	mThreadPool.Run(inTaskCount, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		const auto& context = mRecordingContexts[mCurrentFrame][inTaskIndex];
+
+		// The fence of this frame has been waited on, so the previous recording is no longer in use.
+		if (vkResetCommandPool(mDevice, context.CommandPool, 0) != VK_SUCCESS ||
+			vkBeginCommandBuffer(context.CommandBuffer, &beginInfo) != VK_SUCCESS) {
+			bFailed = true;
+			return;
+		}
+
+		size_t begin = inDrawCount * inTaskIndex / inTaskCount;
+		size_t end = inDrawCount * (inTaskIndex + 1) / inTaskCount;
+		RecordDraws(context.CommandBuffer, begin, end);
+
+		if (vkEndCommandBuffer(context.CommandBuffer) != VK_SUCCESS) bFailed = true;
+	});
+
+	if (bFailed) ReturnFalse(L"Failed to record secondary command buffers");
+
+	return true;
+}
+
+void Renderer::UpdateViewConstants() {
+	mViewConstants.mView = glm::lookAt(
+		mCameraPos,
+		mCameraTarget,
+		UpVector);
+
+	mViewConstants.mProj = glm::perspective(glm::radians(90.0f), static_cast<float>(mSwapChainExtent.width) / static_cast<float>(mSwapChainExtent.height), 0.1f, 1000.0f);
+	mViewConstants.mProj[1][1] *= -1.0f;
+
+	ExtractFrustumPlanes(mViewConstants.mProj * mViewConstants.mView, mFrustumPlanes);
+}
+
+void Renderer::AddCullingVolume(RenderTypes inType, RenderItem* pRItem) {
+	glm::vec3 center;
+	float radius;
+	glm::vec3 extents;
+	ComputeWorldBounds(mMeshes[pRItem->MeshName].get(), BuildWorldMatrix(pRItem), center, radius, extents);
+
+	pRItem->CullIndex = mFrustumCullers[inType].Add(center, radius, extents);
+	pRItem->CellIndex = mPortalGraph.FindCell(center);
+	mSceneIndices[inType].Insert(pRItem->CullIndex, center, extents);
+	mCullableRItems[inType].push_back(pRItem);
+}
+
+void Renderer::UpdateCullingVolume(RenderTypes inType, RenderItem* pRItem) {
+	glm::vec3 center;
+	float radius;
+	glm::vec3 extents;
+	ComputeWorldBounds(mMeshes[pRItem->MeshName].get(), BuildWorldMatrix(pRItem), center, radius, extents);
+
+	mFrustumCullers[inType].Set(pRItem->CullIndex, center, radius, extents);
+	pRItem->CellIndex = mPortalGraph.FindCell(center);
+	mSceneIndices[inType].Update(pRItem->CullIndex, center, extents);
+}
+
+// Slots stay dense: the last item takes over the slot of the removed one.
+void Renderer::RemoveCullingVolume(RenderTypes inType, RenderItem* pRItem) {
+	auto& ritems = mCullableRItems[inType];
+	std::uint32_t index = pRItem->CullIndex;
+	std::uint32_t lastIndex = static_cast<std::uint32_t>(ritems.size() - 1);
+
+	mFrustumCullers[inType].Remove(index);
+	mSceneIndices[inType].Remove(lastIndex);
+
+	if (index != lastIndex) {
+		RenderItem* pMoved = ritems[lastIndex];
+		pMoved->CullIndex = index;
+		ritems[index] = pMoved;
+
+		UpdateCullingVolume(inType, pMoved);
+	}
+
+	ritems.pop_back();
+}
+
+void Renderer::GetQueryNames(RenderTypes inType, const std::vector<std::uint32_t>& inIds, std::vector<std::string>& outNames) const {
+	outNames.clear();
+	for (std::uint32_t id : inIds) {
+		outNames.push_back(mCullableRItems[inType][id]->Name);
+	}
+}
+
+void Renderer::CullRenderItems() {
+	auto cullingBegin = std::chrono::high_resolution_clock::now();
+
+	std::uint64_t testedCount = 0;
+	std::uint64_t visibleCount = 0;
+	for (std::uint32_t type = 0; type < RenderTypes::ENumTypes; ++type) {
+		// The compute pass culls opaque items in GPU-driven mode. They are still frustum culled for the
+		// CPU passes that need them, such as gathering occluders, but not drawn from that list.
+		const bool bGpuCulled = bGpuDriven && type == RenderTypes::EOpaque;
+		auto& visibleIndices = bGpuCulled ? mGpuCulledIndices : mVisibleIndices[type];
+		if (bGpuCulled) mVisibleIndices[type].clear();
+
+		if (mCullingMethod == CullingMethods::EOctreeCulling) {
+			mSceneIndices[type].QueryFrustum(mFrustumPlanes, visibleIndices);
+		}
+		else {
+			mFrustumCullers[type].Cull(mFrustumPlanes, mCullingMethod == CullingMethods::ESimdCulling, visibleIndices);
+		}
+
+		if (bGpuCulled) continue;
+
+		testedCount += mFrustumCullers[type].GetCount();
+		visibleCount += mVisibleIndices[type].size();
+	}
+
+	auto cullingEnd = std::chrono::high_resolution_clock::now();
+
+	auto& stats = mCullingStats[mCullingMethod];
+	++stats.FrameCount;
+	stats.TestedCount += testedCount;
+	stats.VisibleCount += visibleCount;
+	stats.CullingTime += std::chrono::duration<double, std::micro>(cullingEnd - cullingBegin).count();
+}
+
+void Renderer::AssignCells() {
+	for (std::uint32_t type = 0; type < RenderTypes::ENumTypes; ++type) {
+		for (RenderItem* pRItem : mCullableRItems[type]) {
+			glm::vec3 center;
+			float radius;
+			glm::vec3 extents;
+			mFrustumCullers[type].Get(pRItem->CullIndex, center, radius, extents);
+
+			pRItem->CellIndex = mPortalGraph.FindCell(center);
+		}
+	}
+}
+
+void Renderer::CullPortalRenderItems() {
+	if (!bPortalCulling || mPortalGraph.GetCellCount() == 0) return;
+
+	auto cullingBegin = std::chrono::high_resolution_clock::now();
+
+	// Outside of every cell, or when the flood fill gives up, only the frustum test applies.
+	if (!mPortalGraph.ComputeVisibility(mCameraPos, mFrustumPlanes)) return;
+
+	std::uint64_t testedCount = 0;
+	std::uint64_t rejectedCount = 0;
+	for (std::uint32_t type = 0; type < RenderTypes::ENumTypes; ++type) {
+		auto& visibleIndices = mVisibleIndices[type];
+		const auto& ritems = mCullableRItems[type];
+
+		std::uint32_t visibleCount = 0;
+		for (std::uint32_t index : visibleIndices) {
+			const RenderItem* pRItem = ritems[index];
+
+			bool bVisible = true;
+			if (pRItem->CellIndex != PortalGraph::NullIndex) {
+				glm::vec3 center;
+				float radius;
+				glm::vec3 extents;
+				mFrustumCullers[type].Get(index, center, radius, extents);
+
+				bVisible = mPortalGraph.IsVisible(pRItem->CellIndex, center, extents);
+			}
+
+			if (bVisible) visibleIndices[visibleCount++] = index;
+		}
+
+		testedCount += visibleIndices.size();
+		rejectedCount += visibleIndices.size() - visibleCount;
+
+		visibleIndices.resize(visibleCount);
+	}
+
+	auto cullingEnd = std::chrono::high_resolution_clock::now();
+
+	auto& stats = mPortalStats;
+	++stats.FrameCount;
+	stats.VisibleCellCount += mPortalGraph.GetVisibleCellCount();
+	stats.TestedCount += testedCount;
+	stats.RejectedCount += rejectedCount;
+	stats.CullingTime += std::chrono::duration<double, std::micro>(cullingEnd - cullingBegin).count();
+}
+
+void Renderer::SelectLods() {
+	// Pixels covered by one world unit at distance one.
+	float pixelsPerUnit = 0.5f * static_cast<float>(mSwapChainExtent.height) * std::abs(mViewConstants.mProj[1][1]);
+
+	std::uint64_t triangleCount = 0;
+	std::uint64_t fullDetailTriangleCount = 0;
+	mLodCandidates.clear();
+
+	for (std::uint32_t type = 0; type < RenderTypes::ENumTypes; ++type) {
+		const auto& ritems = mCullableRItems[type];
+
+		for (std::uint32_t index : mVisibleIndices[type]) {
+			RenderItem* pRItem = ritems[index];
+			const Mesh* pMesh = mMeshes[pRItem->MeshName].get();
+			const auto& lods = pMesh->Lods;
+
+			glm::vec3 center;
+			float radius;
+			glm::vec3 extents;
+			mFrustumCullers[type].Get(index, center, radius, extents);
+
+			float distance = std::max(glm::distance(mCameraPos, center) - radius, 0.1f);
+			float scale = pMesh->BoundsRadius > 0.0f ? radius / pMesh->BoundsRadius : 1.0f;
+			float errorToPixels = scale * pixelsPerUnit / distance;
+
+			std::uint32_t lod = std::min(pRItem->ErrorLodIndex, static_cast<std::uint32_t>(lods.size() - 1));
+			if (!bLodSelection) {
+				lod = 0;
+			}
+			else {
+				// Coarser levels have to be clearly good enough, finer ones clearly needed, so that items
+				// sitting at a threshold do not switch back and forth.
+				while (lod + 1 < lods.size() && lods[lod + 1].Error * errorToPixels <= MaxLodPixelError * (1.0f - LodHysteresis)) ++lod;
+				while (lod > 0 && lods[lod].Error * errorToPixels > MaxLodPixelError * (1.0f + LodHysteresis)) --lod;
+			}
+			pRItem->ErrorLodIndex = lod;
+			pRItem->LodIndex = lod;
+
+			triangleCount += lods[lod].IndexCount / 3;
+			fullDetailTriangleCount += lods[0].IndexCount / 3;
+
+			if (mTriangleBudget != 0) mLodCandidates.emplace_back(radius * pixelsPerUnit / distance, pRItem);
+		}
+	}
+
+	bool bBudgetApplied = false;
+	if (bLodSelection && mTriangleBudget != 0 && triangleCount > mTriangleBudget) {
+		bBudgetApplied = true;
+
+		std::sort(mLodCandidates.begin(), mLodCandidates.end(), [](const auto& inLhs, const auto& inRhs) {
+			return inLhs.first < inRhs.first;
+		});
+
+		// One level at a time, smallest on screen first, until the budget is met or nothing is left.
+		bool bCoarsened = true;
+		while (triangleCount > mTriangleBudget && bCoarsened) {
+			bCoarsened = false;
+
+			for (const auto& candidate : mLodCandidates) {
+				RenderItem* pRItem = candidate.second;
+				const auto& lods = mMeshes[pRItem->MeshName]->Lods;
+				if (pRItem->LodIndex + 1 >= lods.size()) continue;
+
+				triangleCount -= (lods[pRItem->LodIndex].IndexCount - lods[pRItem->LodIndex + 1].IndexCount) / 3;
+				++pRItem->LodIndex;
+				bCoarsened = true;
+
+				if (triangleCount <= mTriangleBudget) break;
+			}
+		}
+	}
+
+	auto& stats = mLodStats;
+	++stats.FrameCount;
+	stats.TriangleCount += triangleCount;
+	stats.FullDetailTriangleCount += fullDetailTriangleCount;
+	if (bBudgetApplied) ++stats.BudgetFrameCount;
+}
+
+// Each streamed texture wants the level its visible items need at their projected size. Upgrades go to
+// the textures missing the most levels first, up to MaxStreamingSizePerFrame staged per frame, and
+// make room under the budget by dropping the finer levels of the least recently seen textures. Either
+// way the image is replaced by one staged again from the source, since an image cannot gain or lose
+// levels.
+bool Renderer::UpdateTextureStreaming() {
+	ReleaseRetiredTextures(false);
+	if (mStreamedMaterials.empty()) return true;
+
+	auto& stats = mTextureStreamingStats;
+	++stats.FrameCount;
+
+	for (Material* pMat : mStreamedMaterials) {
+		auto& streaming = *pMat->pStreaming;
+		if (bTextureStreaming) {
+			streaming.WantedMip = streaming.TailMip;
+			continue;
+		}
+
+		// Without streaming every level is wanted, and nothing is evicted for being out of sight.
+		streaming.WantedMip = 0;
+		streaming.LastUsedFrame = mFrameNumber;
+	}
+
+	if (bTextureStreaming) {
+		// Pixels covered by one world unit at distance one.
+		float pixelsPerUnit = 0.5f * static_cast<float>(mSwapChainExtent.height) * std::abs(mViewConstants.mProj[1][1]);
+
+		for (std::uint32_t type = 0; type < RenderTypes::ENumTypes; ++type) {
+			// The compute pass culls opaque items in GPU-driven mode, so only their frustum test applies.
+			const auto& indices = bGpuDriven && type == RenderTypes::EOpaque ? mGpuCulledIndices : mVisibleIndices[type];
+			for (std::uint32_t index : indices) {
+				RequestTextureMip(static_cast<RenderTypes>(type), index, pixelsPerUnit);
+			}
+		}
+	}
+
+	// An evicted texture keeps the levels its items want this frame, or only its tail when none were
+	// seen. Textures whose last image is still uploading are left alone.
+	auto getKeptMip = [this](const TextureStreaming& inStreaming) {
+		return inStreaming.LastUsedFrame == mFrameNumber ? inStreaming.WantedMip : inStreaming.TailMip;
+	};
+
+	mStreamingOrder.clear();
+	mEvictionOrder.clear();
+	std::uint64_t evictableSize = 0;
+	for (Material* pMat : mStreamedMaterials) {
+		const auto& streaming = *pMat->pStreaming;
+		if (!mUploadContext.IsAvailable(streaming.UploadTicket)) continue;
+
+		if (streaming.WantedMip < streaming.ResidentMip) {
+			mStreamingOrder.push_back(pMat);
+		}
+		else if (getKeptMip(streaming) > streaming.ResidentMip) {
+			mEvictionOrder.push_back(pMat);
+			evictableSize += streaming.ResidentSize - GetMipChainSize(streaming.Source, getKeptMip(streaming));
+		}
+	}
+
+	std::sort(mStreamingOrder.begin(), mStreamingOrder.end(), [](const Material* pLhs, const Material* pRhs) {
+		return pLhs->pStreaming->ResidentMip - pLhs->pStreaming->WantedMip > pRhs->pStreaming->ResidentMip - pRhs->pStreaming->WantedMip;
+	});
+	std::sort(mEvictionOrder.begin(), mEvictionOrder.end(), [](const Material* pLhs, const Material* pRhs) {
+		return pLhs->pStreaming->LastUsedFrame < pRhs->pStreaming->LastUsedFrame;
+	});
+
+	std::uint64_t stagedSize = 0;
+	size_t evictedCount = 0;
+	auto evictNext = [&]() {
+		Material* pMat = mEvictionOrder[evictedCount++];
+		auto& streaming = *pMat->pStreaming;
+		const std::uint64_t residentSize = streaming.ResidentSize;
+
+		CheckReturn(StreamTexture(pMat, getKeptMip(streaming)));
+
+		evictableSize -= residentSize - streaming.ResidentSize;
+		stagedSize += streaming.ResidentSize;
+		++stats.EvictionCount;
+
+		return true;
+	};
+
+	for (Material* pMat : mStreamingOrder) {
+		if (stagedSize >= MaxStreamingSizePerFrame) break;
+
+		auto& streaming = *pMat->pStreaming;
+		auto getTotalSize = [&](std::uint32_t inMip) {
+			return mStreamedTextureSize - streaming.ResidentSize + GetMipChainSize(streaming.Source, inMip);
+		};
+
+		// Over the budget, a texture gets as many of its wanted levels as eviction can make room for.
+		std::uint32_t mip = streaming.WantedMip;
+		if (mTextureBudget != 0) {
+			while (mip < streaming.ResidentMip && getTotalSize(mip) > mTextureBudget + evictableSize) ++mip;
+			if (mip > streaming.WantedMip) ++stats.DeferredCount;
+			if (mip == streaming.ResidentMip) continue;
+
+			while (getTotalSize(mip) > mTextureBudget && evictedCount < mEvictionOrder.size()) {
+				CheckReturn(evictNext());
+			}
+		}
+
+		CheckReturn(StreamTexture(pMat, mip));
+
+		stagedSize += streaming.ResidentSize;
+		++stats.UpgradeCount;
+	}
+
+	// A lowered budget leaves too much resident without any upgrade asking for room.
+	while (mTextureBudget != 0 && mStreamedTextureSize > mTextureBudget && evictedCount < mEvictionOrder.size()) {
+		CheckReturn(evictNext());
+	}
+
+	stats.StagedSize += stagedSize;
+
+	return true;
+}
+
+// The texture is taken to span the item once, so a level is fine enough when it has about as many
+// texels across as the item covers pixels.
+void Renderer::RequestTextureMip(RenderTypes inType, std::uint32_t inIndex, float inPixelsPerUnit) {
+	const RenderItem* pRItem = mCullableRItems[inType][inIndex];
+
+	auto iter = mMaterials.find(pRItem->MatName);
+	if (iter == mMaterials.end() || !iter->second->pStreaming) return;
+	auto& streaming = *iter->second->pStreaming;
+
+	glm::vec3 center;
+	float radius;
+	glm::vec3 extents;
+	mFrustumCullers[inType].Get(inIndex, center, radius, extents);
+
+	float distance = std::max(glm::distance(mCameraPos, center) - radius, 0.1f);
+	float pixels = std::max(2.0f * radius * inPixelsPerUnit / distance, 1.0f);
+
+	const auto& finestMip = streaming.Source.Mips[0];
+	float texels = static_cast<float>(std::max(finestMip.Width, finestMip.Height));
+
+	std::uint32_t mip = texels > pixels ? static_cast<std::uint32_t>(std::log2(texels / pixels)) : 0;
+	streaming.WantedMip = std::min(streaming.WantedMip, mip);
+	streaming.LastUsedFrame = mFrameNumber;
+}
+
+// Replaces the image of a streamed texture with one holding the levels from inFirstMip on. The old one
+// is retired, and sampled until the new one is available and written to the frame descriptor sets.
+bool Renderer::StreamTexture(Material* ioMaterial, std::uint32_t inFirstMip) {
+	auto& streaming = *ioMaterial->pStreaming;
+
+	RetiredTexture retired;
+	retired.Image = ioMaterial->TextureImage;
+	retired.ImageAllocation = ioMaterial->TextureImageAllocation;
+	retired.ImageView = ioMaterial->TextureImageView;
+
+	CheckReturn(CreateTextureImage(streaming.Source, inFirstMip, ioMaterial));
+	CheckReturn(CreateTextureImageView(ioMaterial));
+
+	const std::uint64_t ticket = mUploadContext.GetPendingTicket();
+	retired.UploadTicket = ticket;
+	mRetiredTextures.push_back(retired);
+
+	mTextureTable[ioMaterial->TextureIndex] = ioMaterial->TextureImageView;
+	QueueTextureWrite(ioMaterial, ticket);
+
+	const std::uint64_t residentSize = GetMipChainSize(streaming.Source, inFirstMip);
+	mStreamedTextureSize = mStreamedTextureSize - streaming.ResidentSize + residentSize;
+
+	streaming.ResidentMip = inFirstMip;
+	streaming.ResidentSize = residentSize;
+	streaming.UploadTicket = ticket;
+
+	return true;
+}
+
+// Once its replacement is available, every frame in flight writes it to its descriptor set when it
+// begins, so the old image is unused after as many frames as are in flight. bAll is for clean-up, once
+// the device is idle.
+void Renderer::ReleaseRetiredTextures(bool bAll) {
+	for (auto iter = mRetiredTextures.begin(); iter != mRetiredTextures.end();) {
+		auto& retired = *iter;
+		if (!bAll) {
+			if (retired.ReleaseFrame == 0) {
+				if (!mUploadContext.IsAvailable(retired.UploadTicket)) {
+					++iter;
+					continue;
+				}
+				retired.ReleaseFrame = mFrameNumber + SwapChainImageCount;
+			}
+
+			if (mFrameNumber < retired.ReleaseFrame) {
+				++iter;
+				continue;
+			}
+		}
+
+		vkDestroyImageView(mDevice, retired.ImageView, nullptr);
+		DestroyImage(mMemoryAllocator, mDevice, retired.Image, retired.ImageAllocation);
+
+		iter = mRetiredTextures.erase(iter);
+	}
+}
+
+void Renderer::CullOccludedRenderItems() {
+	if (!bOcclusionCulling) return;
 
-	for (auto begin = mOrderedRItemRefs.rbegin(), end = mOrderedRItemRefs.rend(); begin != end; ++begin) {
-		const auto& ritemRef = begin->second;
-		const auto& mesh = mMeshes[ritemRef->MeshName];
+	auto rasterizationBegin = std::chrono::high_resolution_clock::now();
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &ritemRef->DescriptorSets[mCurrentFrame], 0, nullptr);
-	
-		VkBuffer vertexBuffers[] = { mesh->VertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-	
-		vkCmdBindIndexBuffer(commandBuffer, mesh->IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-	
-		vkCmdDrawIndexed(commandBuffer, static_cast<std::uint32_t>(mesh->Indices.size()), 1, 0, 0, 0);
-	}
+	mOcclusionCuller.BeginFrame(mViewConstants.mProj * mViewConstants.mView);
 
-	vkCmdEndRenderPass(commandBuffer);
+	// Occluders are gathered whether or not opaque items are drawn from the CPU list.
+	const auto& opaqueRItems = mCullableRItems[RenderTypes::EOpaque];
+	for (std::uint32_t index : bGpuDriven ? mGpuCulledIndices : mVisibleIndices[RenderTypes::EOpaque]) {
+		RenderItem* pRItem = opaqueRItems[index];
+		if (!pRItem->bOccluder) continue;
 
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-		ReturnFalse(L"Failed to record command buffer");
+		const Mesh* pMesh = mMeshes[pRItem->MeshName].get();
+		mOcclusionCuller.AddOccluder(
+			BuildWorldMatrix(pRItem),
+			pMesh->Vertices.data(),
+			sizeof(Vertex),
+			static_cast<std::uint32_t>(pMesh->Vertices.size()),
+			pMesh->Indices.data(),
+			pMesh->Lods[0].IndexCount);
 	}
 
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	if (mOcclusionCuller.GetTriangleCount() == 0) return;
 
-	VkSemaphore waitSemaphores[] = {
-		mImageAvailableSemaphores[mCurrentFrame]
-	};
-	VkPipelineStageFlags waitStages[] = {
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-	};
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	mOcclusionCuller.Rasterize(mThreadPool);
 
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
+	auto rasterizationEnd = std::chrono::high_resolution_clock::now();
 
-	VkSemaphore signalSemaphores[] = {
-		mRenderFinishedSemaphores[mCurrentFrame]
-	};
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	std::uint64_t testedCount = 0;
+	std::uint64_t rejectedCount = 0;
+	for (std::uint32_t type = 0; type < RenderTypes::ENumTypes; ++type) {
+		auto& visibleIndices = mVisibleIndices[type];
+		const auto& ritems = mCullableRItems[type];
+		const auto& frustumCuller = mFrustumCullers[type];
 
-	vkResetFences(mDevice, 1, &mInFlightFences[mCurrentFrame]);
+		std::uint32_t count = static_cast<std::uint32_t>(visibleIndices.size());
+		mOcclusionResults.resize(count);
 
-	if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, mInFlightFences[mCurrentFrame]) != VK_SUCCESS) {
-		ReturnFalse(L"Failed to submit draw command buffer");
-	}
+		std::uint32_t taskCount = (count + MinOccludeesPerTask - 1) / MinOccludeesPerTask;
+		mThreadPool.Run(taskCount, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+			std::uint32_t begin = inTaskIndex * MinOccludeesPerTask;
+			std::uint32_t end = std::min(begin + MinOccludeesPerTask, count);
 
-	VkPresentInfoKHR presentInfo = {};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+			for (std::uint32_t i = begin; i < end; ++i) {
+				std::uint32_t index = visibleIndices[i];
+				if (ritems[index]->bOccluder) {
+					mOcclusionResults[i] = 1;
+					continue;
+				}
 
-	VkSwapchainKHR swapChains[] = { mSwapChain };
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapChains;
-	presentInfo.pImageIndices = &mCurentImageIndex;
-	presentInfo.pResults = nullptr;
+				glm::vec3 center;
+				float radius;
+				glm::vec3 extents;
+				frustumCuller.Get(index, center, radius, extents);
 
-	VkResult result = vkQueuePresentKHR(mPresentQueue, &presentInfo);
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || bFramebufferResized) {
-		bFramebufferResized = false;
-		CheckReturn(RecreateSwapChain());
-	}
-	else if (result != VK_SUCCESS) {
-		ReturnFalse(L"Failed to present swap chain image");
+				mOcclusionResults[i] = mOcclusionCuller.IsVisible(center, extents) ? 1 : 0;
+			}
+		});
+
+		std::uint32_t visibleCount = 0;
+		for (std::uint32_t i = 0; i < count; ++i) {
+			if (mOcclusionResults[i] != 0) visibleIndices[visibleCount++] = visibleIndices[i];
+		}
+		visibleIndices.resize(visibleCount);
+
+		testedCount += count;
+		rejectedCount += count - visibleCount;
 	}
 
-	mCurrentFrame = (mCurrentFrame + 1) % SwapChainImageCount;
+	auto testEnd = std::chrono::high_resolution_clock::now();
 
-	return true;
+	auto& stats = mOcclusionStats;
+	++stats.FrameCount;
+	stats.OccluderTriangleCount += mOcclusionCuller.GetTriangleCount();
+	stats.TestedCount += testedCount;
+	stats.RejectedCount += rejectedCount;
+	stats.RasterizationTime += std::chrono::duration<double, std::milli>(rasterizationEnd - rasterizationBegin).count();
+	stats.TestTime += std::chrono::duration<double, std::milli>(testEnd - rasterizationEnd).count();
 }
 
-bool Renderer::RecreateSwapChain() {
-	vkDeviceWaitIdle(mDevice);
-
-	CleanUpSwapChain();
+void Renderer::BuildInstanceBatches() {
+	mInstancedRItems.clear();
+	for (auto& batches : mInstanceBatches) {
+		batches.clear();
+	}
 
-	LowRenderer::RecreateSwapChain();
+	// Opaque items can be drawn in any order, so they are sorted into runs of the same vertex format,
+	// material and mesh.
+	// With GPU-driven rendering they are batched by BuildGpuScene instead.
+	if (!bGpuDriven) {
+		mSortedOpaqueRItems.clear();
+		const auto& opaqueRItems = mCullableRItems[RenderTypes::EOpaque];
+		for (std::uint32_t index : mVisibleIndices[RenderTypes::EOpaque]) {
+			RenderItem* pRItem = opaqueRItems[index];
+			if (!mUploadContext.IsAvailable(pRItem->UploadTicket)) continue;
+
+			mSortedOpaqueRItems.emplace_back(mMeshes[pRItem->MeshName].get(), mMaterials[pRItem->MatName].get(), pRItem);
+		}
 
-	CheckReturn(CreateImageViews());
-	CheckReturn(CreateRenderPass());
-	CheckReturn(CreateGraphicsPipeline());
-	CheckReturn(CreateColorResources());
-	CheckReturn(CreateDepthResources());
-	CheckReturn(CreateFramebuffers());
-	CheckReturn(RecreateUniformBuffers());
-	CheckReturn(CreateDescriptorPool());
-	CheckReturn(RecreateDescriptorSets());
-	CheckReturn(CreateCommandBuffers());
+		std::sort(mSortedOpaqueRItems.begin(), mSortedOpaqueRItems.end(), [](const auto& inLhs, const auto& inRhs) {
+			return std::tie(std::get<0>(inLhs)->VertexFormat, std::get<1>(inLhs), std::get<0>(inLhs), std::get<2>(inLhs)->LodIndex) <
+				std::tie(std::get<0>(inRhs)->VertexFormat, std::get<1>(inRhs), std::get<0>(inRhs), std::get<2>(inRhs)->LodIndex);
+		});
 
-	return true;
-}
+		for (const auto& entry : mSortedOpaqueRItems) {
+			Mesh* pMesh = std::get<0>(entry);
+			RenderItem* pRItem = std::get<2>(entry);
 
-void Renderer::CleanUpSwapChain() {
-	vkDestroyImageView(mDevice, mColorImageView, nullptr);
-	vkDestroyImage(mDevice, mColorImage, nullptr);
-	vkFreeMemory(mDevice, mColorImageMemory, nullptr);
-	
-	vkDestroyImageView(mDevice, mDepthImageView, nullptr);
-	vkDestroyImage(mDevice, mDepthImage, nullptr);
-	vkFreeMemory(mDevice, mDepthImageMemory, nullptr);
-	
-	for (auto& ritem : mRItems) {
-		for (size_t i = 0; i < SwapChainImageCount; ++i) {
-			vkDestroyBuffer(mDevice, ritem->UniformBuffers[i], nullptr);
-			vkFreeMemory(mDevice, ritem->UniformBufferMemories[i], nullptr);
+			if (bClusterCulling && pRItem->LodIndex == 0 && !pMesh->Meshlets.empty()) AppendClusters(pMesh, std::get<1>(entry), pRItem);
+			else AppendInstance(RenderTypes::EOpaque, pMesh, std::get<1>(entry), pRItem);
 		}
+
+		if (bClusterCulling) ++mClusterStats.FrameCount;
 	}
-	
-	vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
-	
-	for (size_t i = 0; i < SwapChainImageCount; ++i) {
-		vkDestroyFramebuffer(mDevice, mSwapChainFramebuffers[i], nullptr);
+
+	// Blend items have to stay in back-to-front order, so only neighbours are merged.
+	for (auto begin = mOrderedRItemRefs.rbegin(), end = mOrderedRItemRefs.rend(); begin != end; ++begin) {
+		RenderItem* pRItem = begin->second;
+		if (!mUploadContext.IsAvailable(pRItem->UploadTicket)) continue;
+
+		AppendInstance(RenderTypes::EBlend, mMeshes[pRItem->MeshName].get(), mMaterials[pRItem->MatName].get(), pRItem);
 	}
-	
-	vkFreeCommandBuffers(mDevice, mCommandPool, static_cast<std::uint32_t>(mCommandBuffers.size()), mCommandBuffers.data());
-	
-	vkDestroyPipeline(mDevice, mGraphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
-	vkDestroyRenderPass(mDevice, mRenderPass, nullptr);
-	
-	for (size_t i = 0; i < SwapChainImageCount; ++i) {
-		vkDestroyImageView(mDevice, mSwapChainImageViews[i], nullptr);
+}
+
+void Renderer::AppendInstance(RenderTypes inType, Mesh* pMesh, Material* pMaterial, RenderItem* pRItem) {
+	auto& batches = mInstanceBatches[inType];
+
+	const auto& lod = pMesh->Lods[pRItem->LodIndex];
+
+	if (batches.empty() || batches.back().pMesh != pMesh || batches.back().pMaterial != pMaterial ||
+			batches.back().FirstIndex != lod.FirstIndex || batches.back().IndexCount != lod.IndexCount) {
+		InstanceBatch batch;
+		batch.pMesh = pMesh;
+		batch.pMaterial = pMaterial;
+		batch.LodIndex = pRItem->LodIndex;
+		batch.FirstIndex = lod.FirstIndex;
+		batch.IndexCount = lod.IndexCount;
+		batch.FirstInstance = static_cast<std::uint32_t>(mInstancedRItems.size());
+		batches.push_back(batch);
 	}
 
-	LowRenderer::CleanUpSwapChain();
+	++batches.back().InstanceCount;
+	mInstancedRItems.push_back(pRItem);
 }
 
-bool Renderer::AddTexture(const std::string& inFilePath) {
-	int texWidth = 0;
-	int texHeight = 0;
-	int texChannels = 0;
+// One instance, drawn as one batch per run of consecutive surviving meshlets. The tests run in mesh
+// space, where the bounds and cones were built.
+void Renderer::AppendClusters(Mesh* pMesh, Material* pMaterial, RenderItem* pRItem) {
+	auto& batches = mInstanceBatches[RenderTypes::EOpaque];
 
-	stbi_uc* pixels = stbi_load(inFilePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-	if (!pixels) ReturnFalse(L"Failed to load texture image");
+	glm::mat4 world = BuildWorldMatrix(pRItem);
 
-	auto material = std::make_unique<Material>();
-	auto pMat = material.get();
-	CheckReturn(CreateTextureImage(texWidth, texHeight, pixels, pMat));
-	CheckReturn(CreateTextureImageView(pMat));
-	CheckReturn(CreateTextureSampler(pMat));
-	mMaterials[inFilePath] = std::move(material);
+	// Planes map to mesh space with the transposed world matrix; renormalized, they give exact
+	// mesh-space distances even under non-uniform scale.
+	glm::mat4 worldTransposed = glm::transpose(world);
+	std::array<glm::vec4, 6> planes;
+	for (size_t i = 0; i < planes.size(); ++i) {
+		glm::vec4 plane = worldTransposed * mFrustumPlanes[i];
+		planes[i] = plane / glm::length(glm::vec3(plane));
+	}
 
-	stbi_image_free(pixels);
+	glm::vec3 cameraPos = glm::vec3(glm::inverse(world) * glm::vec4(mCameraPos, 1.0f));
 
-	bNeedToUpdateDescriptorSet = true;
+	// A mirroring scale flips the winding, and with it which side of a cone is the back.
+	bool bMirrored = pRItem->Scale.x * pRItem->Scale.y * pRItem->Scale.z < 0.0f;
 
-	return true;
-}
+	pMesh->MeshletBounds.Cull(planes, true, mVisibleMeshlets);
 
-bool Renderer::UpdateUniformBuffer(const GameTimer& gt) {
-	for (auto& ritem : mRItems) {
-		UniformBufferObject ubo = {};		
+	const std::uint32_t instance = static_cast<std::uint32_t>(mInstancedRItems.size());
+	const size_t firstBatch = batches.size();
+
+	std::uint64_t backFacingCount = 0;
+	std::uint64_t drawnTriangleCount = 0;
+	for (std::uint32_t index : mVisibleMeshlets) {
+		const auto& meshlet = pMesh->Meshlets[index];
+		if (!bMirrored && IsMeshletBackFacing(meshlet, cameraPos)) {
+			++backFacingCount;
+			continue;
+		}
 
-		ubo.mModel = glm::translate(glm::mat4(1.0f), ritem->Pos) *
-			glm::mat4_cast(ritem->Quat) *
-			glm::scale(glm::mat4(1.0f), ritem->Scale);		
-		
-		ubo.mView = glm::lookAt(
-			mCameraPos,
-			mCameraTarget,
-			UpVector);
+		drawnTriangleCount += meshlet.TriangleCount;
 
-		ubo.mProj = glm::perspective(glm::radians(90.0f), static_cast<float>(mSwapChainExtent.width) / static_cast<float>(mSwapChainExtent.height), 0.1f, 1000.0f);
-		ubo.mProj[1][1] *= -1.0f;
+		if (batches.size() > firstBatch && batches.back().FirstIndex + batches.back().IndexCount == meshlet.FirstIndex) {
+			batches.back().IndexCount += meshlet.TriangleCount * 3;
+			continue;
+		}
 
-		void* data;
-		const auto& bufferMemory = ritem->UniformBufferMemories[mCurentImageIndex];		
-		vkMapMemory(mDevice, bufferMemory, 0, sizeof(ubo), 0, &data);
-		std::memcpy(data, &ubo, sizeof(ubo));
-		vkUnmapMemory(mDevice, bufferMemory);
+		InstanceBatch batch;
+		batch.pMesh = pMesh;
+		batch.pMaterial = pMaterial;
+		batch.LodIndex = 0;
+		batch.FirstIndex = meshlet.FirstIndex;
+		batch.IndexCount = meshlet.TriangleCount * 3;
+		batch.FirstInstance = instance;
+		batch.InstanceCount = 1;
+		batches.push_back(batch);
 	}
 
-	return true;
+	if (batches.size() > firstBatch) mInstancedRItems.push_back(pRItem);
+
+	auto& stats = mClusterStats;
+	stats.TestedCount += pMesh->Meshlets.size();
+	stats.FrustumRejectedCount += pMesh->Meshlets.size() - mVisibleMeshlets.size();
+	stats.BackFacingRejectedCount += backFacingCount;
+	stats.TriangleCount += pMesh->Lods[0].IndexCount / 3;
+	stats.DrawnTriangleCount += drawnTriangleCount;
 }
 
-bool Renderer::UpdateDescriptorSet() {
-	for (auto& ritem : mRItems) {
-		for (size_t i = 0; i < SwapChainImageCount; ++i) {
-			VkDescriptorBufferInfo bufferInfo = {};
-			bufferInfo.buffer = ritem->UniformBuffers[i];
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(UniformBufferObject);
+bool Renderer::UpdateUniformBuffer(const GameTimer& gt) {
+	auto& arena = mUniformArenas[mCurrentFrame];
+
+	VkDeviceSize viewSize = AlignUp(sizeof(ViewConstants), mUniformAlignment);
+	VkDeviceSize instanceSize = sizeof(InstanceData) * mInstancedRItems.size();
 
-			const auto& mat = mMaterials[ritem->MatName];
-			VkDescriptorImageInfo imageInfo = {};
-			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfo.imageView = mat->TextureImageView;
-			imageInfo.sampler = mat->TextureSampler;
+	// One extra instance covers the padding in front of the instance range.
+	VkDeviceSize requiredSize = viewSize + sizeof(InstanceData) + instanceSize;
 
-			std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
-			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[0].dstSet = ritem->DescriptorSets[i];
-			descriptorWrites[0].dstBinding = 0;
-			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[0].descriptorCount = 1;
-			descriptorWrites[0].pBufferInfo = &bufferInfo;
+	// The fence of this frame has been waited on, so nothing reads from the arena anymore.
+	if (requiredSize > arena.Capacity) {
+		VkDeviceSize newCapacity = std::max(arena.Capacity * 2, requiredSize);
+		DestroyUniformArena(arena);
+		CheckReturn(CreateUniformArena(arena, newCapacity));
 
-			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[1].dstSet = ritem->DescriptorSets[i];
-			descriptorWrites[1].dstBinding = 1;
-			descriptorWrites[1].dstArrayElement = 0;
-			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[1].descriptorCount = 1;
-			descriptorWrites[1].pImageInfo = &imageInfo;
+		WLogln(L"Uniform arena grown to ", std::to_wstring(newCapacity), L" bytes");
+	}
 
-			vkUpdateDescriptorSets(mDevice, static_cast<std::uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	arena.Head = 0;
+
+	VkDeviceSize viewOffset = 0;
+	std::uint8_t* pData = nullptr;
+	CheckReturn(AllocateArena(arena, sizeof(mViewConstants), mUniformAlignment, viewOffset, pData));
+	std::memcpy(pData, &mViewConstants, sizeof(mViewConstants));
+	mViewUniformOffset = static_cast<std::uint32_t>(viewOffset);
+
+	// Instances are written in batch order, straight into the mapped arena. Their mesh comes from the
+	// batches; the cluster batches of an item share its single instance.
+	CheckReturn(AllocateArena(arena, instanceSize, sizeof(InstanceData), mInstanceOffset, pData));
+	auto pInstances = reinterpret_cast<InstanceData*>(pData);
+	std::uint32_t instanceCount = 0;
+	for (const auto& batches : mInstanceBatches) {
+		for (const auto& batch : batches) {
+			for (std::uint32_t i = std::max(batch.FirstInstance, instanceCount), end = batch.FirstInstance + batch.InstanceCount; i < end; ++i) {
+				pInstances[i].mModel = BuildWorldMatrix(mInstancedRItems[i]) * batch.pMesh->Dequantization;
+			}
+			instanceCount = std::max(instanceCount, batch.FirstInstance + batch.InstanceCount);
 		}
 	}
 
 	return true;
 }
 
-bool Renderer::CreateVertexBuffer(Mesh* pMesh) {
-	auto& vertices = pMesh->Vertices;
-	auto& vertexBuffer = pMesh->VertexBuffer;
-	auto& vertexBufferMemory = pMesh->VertexBufferMemory;
-
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+bool Renderer::CreateUniformArena(UniformArena& ioArena, VkDeviceSize inCapacity) {
 	CheckReturn(CreateBuffer(
-		mPhysicalDevice,
+		mMemoryAllocator,
 		mDevice,
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		inCapacity,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory));
+		ioArena.Buffer,
+		ioArena.BufferAllocation));
 
-	void* data;
-	vkMapMemory(mDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	std::memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-	vkUnmapMemory(mDevice, stagingBufferMemory);
+	ioArena.Capacity = inCapacity;
+	ioArena.Head = 0;
 
-	CheckReturn(CreateBuffer(
-		mPhysicalDevice,
-		mDevice,
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		vertexBuffer,
-		vertexBufferMemory));
+	if (ioArena.DescriptorSet == VK_NULL_HANDLE) {
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = mDescriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &mFrameDescriptorSetLayout;
+
+		if (vkAllocateDescriptorSets(mDevice, &allocInfo, &ioArena.DescriptorSet) != VK_SUCCESS) {
+			ReturnFalse(L"Failed to allocate descriptor sets");
+		}
+
+		// Every slot must hold a valid descriptor; the real ones are written by FlushDescriptorWrites.
+		std::vector<VkDescriptorImageInfo> textureInfos(mTextureCapacity);
+		for (auto& info : textureInfos) {
+			info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			info.imageView = mDefaultMaterial->TextureImageView;
+		}
+
+		std::vector<VkDescriptorImageInfo> samplerInfos(MaxSamplerCount);
+		for (auto& info : samplerInfos) {
+			info.sampler = mSamplerTable[mDefaultMaterial->SamplerIndex].second;
+		}
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = ioArena.DescriptorSet;
+		descriptorWrites[0].dstBinding = 1;
+		descriptorWrites[0].dstArrayElement = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		descriptorWrites[0].descriptorCount = static_cast<std::uint32_t>(textureInfos.size());
+		descriptorWrites[0].pImageInfo = textureInfos.data();
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = ioArena.DescriptorSet;
+		descriptorWrites[1].dstBinding = 2;
+		descriptorWrites[1].dstArrayElement = 0;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+		descriptorWrites[1].descriptorCount = static_cast<std::uint32_t>(samplerInfos.size());
+		descriptorWrites[1].pImageInfo = samplerInfos.data();
+
+		vkUpdateDescriptorSets(mDevice, static_cast<std::uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+
+	// The offset of the view constants is supplied as a dynamic offset when binding.
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = ioArena.Buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = sizeof(ViewConstants);
 
-	CopyBuffer(mDevice, mGraphicsQueue, mCommandPool, stagingBuffer, vertexBuffer, bufferSize);
+	VkWriteDescriptorSet descriptorWrite = {};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = ioArena.DescriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
 
-	vkDestroyBuffer(mDevice, stagingBuffer, nullptr);
-	vkFreeMemory(mDevice, stagingBufferMemory, nullptr);
+	vkUpdateDescriptorSets(mDevice, 1, &descriptorWrite, 0, nullptr);
 
 	return true;
 }
 
-bool Renderer::CreateIndexBuffer(Mesh* pMesh) {
-	auto& indices = pMesh->Indices;
-	auto& indexBuffer = pMesh->IndexBuffer;
-	auto& indexBufferMemory = pMesh->IndexBufferMemory;
+bool Renderer::AllocateArena(UniformArena& ioArena, VkDeviceSize inSize, VkDeviceSize inAlignment, VkDeviceSize& outOffset, std::uint8_t*& pOutData) {
+	VkDeviceSize offset = AlignUp(ioArena.Head, inAlignment);
+	if (offset + inSize > ioArena.Capacity) ReturnFalse(L"Uniform arena is out of space");
 
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+	ioArena.Head = offset + inSize;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	CheckReturn(CreateBuffer(
-		mPhysicalDevice,
-		mDevice,
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory));
+	outOffset = offset;
+	pOutData = static_cast<std::uint8_t*>(ioArena.BufferAllocation.pMappedData) + offset;
+
+	return true;
+}
 
-	void* data;
-	vkMapMemory(mDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	std::memcpy(data, indices.data(), bufferSize);
-	vkUnmapMemory(mDevice, stagingBufferMemory);
+void Renderer::DestroyUniformArena(UniformArena& ioArena) {
+	DestroyBuffer(mMemoryAllocator, mDevice, ioArena.Buffer, ioArena.BufferAllocation);
+
+	ioArena.Capacity = 0;
+	ioArena.Head = 0;
+}
+
+bool Renderer::CreateGeometryBuffer(GeometryBuffer& ioGeometry, std::uint32_t inStride, const VkBufferUsageFlags& inUsage, std::uint32_t inCapacity) {
+	ioGeometry.Stride = inStride;
+	ioGeometry.Usage = inUsage;
 
 	CheckReturn(CreateBuffer(
-		mPhysicalDevice,
+		mMemoryAllocator,
 		mDevice,
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		static_cast<VkDeviceSize>(ioGeometry.Stride) * inCapacity,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | ioGeometry.Usage,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indexBuffer,
-		indexBufferMemory));
-
-	CopyBuffer(mDevice, mGraphicsQueue, mCommandPool, stagingBuffer, indexBuffer, bufferSize);
+		ioGeometry.Buffer,
+		ioGeometry.BufferAllocation));
 
-	vkDestroyBuffer(mDevice, stagingBuffer, nullptr);
-	vkFreeMemory(mDevice, stagingBufferMemory, nullptr);
+	ioGeometry.Capacity = inCapacity;
+	ioGeometry.Allocator.Initialize(inCapacity);
 
 	return true;
 }
 
-bool Renderer::CreateUniformBuffers(RenderItem* inRItem) {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+bool Renderer::AllocateGeometry(GeometryBuffer& ioGeometry, std::uint32_t inCount, std::uint32_t& outOffset) {
+	std::uint64_t offset = 0;
 
-	inRItem->UniformBuffers.resize(SwapChainImageCount);
-	inRItem->UniformBufferMemories.resize(SwapChainImageCount);
+	if (!ioGeometry.Allocator.Allocate(inCount, 1, offset)) {
+		CheckReturn(GrowGeometryBuffer(ioGeometry, ioGeometry.Capacity + inCount));
 
-	for (size_t i = 0; i < SwapChainImageCount; ++i) {
-		CreateBuffer(
-			mPhysicalDevice,
-			mDevice,
-			bufferSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			inRItem->UniformBuffers[i],
-			inRItem->UniformBufferMemories[i]);
+		if (!ioGeometry.Allocator.Allocate(inCount, 1, offset)) {
+			ReturnFalse(L"Failed to allocate geometry range");
+		}
 	}
 
+	outOffset = static_cast<std::uint32_t>(offset);
+
 	return true;
 }
 
-bool Renderer::RecreateUniformBuffers() {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+bool Renderer::GrowGeometryBuffer(GeometryBuffer& ioGeometry, std::uint32_t inMinCapacity) {
+	std::uint32_t newCapacity = std::max(ioGeometry.Capacity * 2, inMinCapacity);
 
-	for (auto& ritem : mRItems) {
-		ritem ->UniformBuffers.resize(SwapChainImageCount);
-		ritem ->UniformBufferMemories.resize(SwapChainImageCount);
+	VkBuffer newBuffer;
+	Allocation newBufferAllocation;
+	CheckReturn(CreateBuffer(
+		mMemoryAllocator,
+		mDevice,
+		static_cast<VkDeviceSize>(ioGeometry.Stride) * newCapacity,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | ioGeometry.Usage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		newBuffer,
+		newBufferAllocation));
+
+	// Growing is rare, so it waits on the GPU instead of ordering the copy against uploads on another
+	// queue. Everything recorded so far completes first, so the old buffer holds all its data; the copy
+	// then completes on its own, before later uploads in the holes it covers are recorded and before any
+	// frame binds the new buffer.
+	std::uint64_t ticket = 0;
+	CheckReturn(mUploadContext.Submit(ticket));
+	CheckReturn(mUploadContext.Wait(ticket));
+
+	// The old contents have been acquired by the graphics queue, so copy them there.
+	VkCommandBuffer commandBuffer;
+	CheckReturn(mUploadContext.GetGraphicsCommandBuffer(commandBuffer));
+
+	// Earlier batches made their writes available; make them visible to the copy.
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	CopyBuffer(
+		commandBuffer,
+		ioGeometry.Buffer,
+		newBuffer,
+		0,
+		0,
+		static_cast<VkDeviceSize>(ioGeometry.Stride) * ioGeometry.Capacity);
+
+	// Frames in flight were submitted before the copy, so the old buffer is unused once it completes.
+	mUploadContext.DeferDestroy(ioGeometry.Buffer, ioGeometry.BufferAllocation);
+
+	CheckReturn(mUploadContext.Submit(ticket));
+	CheckReturn(mUploadContext.Wait(ticket));
+
+	ioGeometry.Buffer = newBuffer;
+	ioGeometry.BufferAllocation = newBufferAllocation;
+	ioGeometry.Capacity = newCapacity;
+	ioGeometry.Allocator.Grow(newCapacity);
+
+	WLogln(L"Geometry buffer grown to ", std::to_wstring(newCapacity), L" elements");
 
-		for (size_t i = 0; i < SwapChainImageCount; ++i) {
-			CreateBuffer(
-				mPhysicalDevice,
-				mDevice,
-				bufferSize,
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				ritem->UniformBuffers[i],
-				ritem->UniformBufferMemories[i]);
-		}
-	}
+	return true;
+}
+
+bool Renderer::UploadGeometry(GeometryBuffer& ioGeometry, std::uint32_t inOffset, const void* pData, VkDeviceSize inSize) {
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset = 0;
+	CheckReturn(mUploadContext.Stage(pData, inSize, StagingAlignment, stagingBuffer, stagingOffset));
+
+	VkCommandBuffer commandBuffer;
+	CheckReturn(mUploadContext.GetTransferCommandBuffer(commandBuffer));
+
+	VkDeviceSize dstOffset = static_cast<VkDeviceSize>(ioGeometry.Stride) * inOffset;
+	CopyBuffer(
+		commandBuffer,
+		stagingBuffer,
+		ioGeometry.Buffer,
+		stagingOffset,
+		dstOffset,
+		inSize);
+
+	mUploadContext.ReleaseBuffer(
+		ioGeometry.Buffer,
+		dstOffset,
+		inSize,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
 
 	return true;
 }
 
-bool Renderer::CreateDescriptorSets(RenderItem* inRItem) {
-	std::vector<VkDescriptorSetLayout> layouts(SwapChainImageCount, mDescriptorSetLayout);
+void Renderer::DestroyGeometryBuffer(GeometryBuffer& ioGeometry) {
+	DestroyBuffer(mMemoryAllocator, mDevice, ioGeometry.Buffer, ioGeometry.BufferAllocation);
+
+	ioGeometry.Capacity = 0;
+}
+
+bool Renderer::CreateVertexBuffer(Mesh* pMesh, const std::vector<CompactVertex>& inCompactVertices) {
+	auto& vertices = pMesh->Vertices;
+	const std::uint32_t vertexCount = static_cast<std::uint32_t>(vertices.size());
+
+	auto& geometry = mVertexGeometries[pMesh->VertexFormat];
 
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = mDescriptorPool;
-	allocInfo.descriptorSetCount = static_cast<std::uint32_t>(SwapChainImageCount);
-	allocInfo.pSetLayouts = layouts.data();
+	std::uint32_t offset = 0;
+	CheckReturn(AllocateGeometry(geometry, vertexCount, offset));
+	pMesh->VertexOffset = static_cast<std::int32_t>(offset);
 
-	inRItem->DescriptorSets.resize(SwapChainImageCount);
-	if (vkAllocateDescriptorSets(mDevice, &allocInfo, inRItem->DescriptorSets.data()) != VK_SUCCESS) {
-		ReturnFalse(L"Failed to allocate descriptor sets");
+	if (pMesh->VertexFormat == VertexFormats::EFullVertex) {
+		CheckReturn(UploadGeometry(geometry, offset, vertices.data(), sizeof(vertices[0]) * vertices.size()));
+	}
+	else {
+		CheckReturn(UploadGeometry(geometry, offset, inCompactVertices.data(), sizeof(inCompactVertices[0]) * inCompactVertices.size()));
 	}
 
 	return true;
 }
 
-bool Renderer::RecreateDescriptorSets() {
-	std::vector<VkDescriptorSetLayout> layouts(SwapChainImageCount, mDescriptorSetLayout);
+bool Renderer::CreateIndexBuffer(Mesh* pMesh) {
+	auto& indices = pMesh->Indices;
 
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = mDescriptorPool;
-	allocInfo.descriptorSetCount = static_cast<std::uint32_t>(SwapChainImageCount);
-	allocInfo.pSetLayouts = layouts.data();
+	if (pMesh->IndexType == VK_INDEX_TYPE_UINT16) {
+		std::vector<std::uint16_t> shortIndices(indices.begin(), indices.end());
 
-	for (auto& ritem : mRItems) {
-		ritem->DescriptorSets.resize(SwapChainImageCount);
-		if (vkAllocateDescriptorSets(mDevice, &allocInfo, ritem->DescriptorSets.data()) != VK_SUCCESS) {
-			ReturnFalse(L"Failed to allocate descriptor sets");
-		}
+		CheckReturn(AllocateGeometry(mShortIndexGeometry, static_cast<std::uint32_t>(shortIndices.size()), pMesh->FirstIndex));
+
+		CheckReturn(UploadGeometry(mShortIndexGeometry, pMesh->FirstIndex, shortIndices.data(), sizeof(shortIndices[0]) * shortIndices.size()));
+
+		return true;
 	}
 
+	CheckReturn(AllocateGeometry(mIndexGeometry, static_cast<std::uint32_t>(indices.size()), pMesh->FirstIndex));
+
+	CheckReturn(UploadGeometry(mIndexGeometry, pMesh->FirstIndex, indices.data(), sizeof(indices[0]) * indices.size()));
+
 	return true;
 }
 
-bool Renderer::CreateTextureImage(int inTexWidth, int inTexHeight, void* pData, Material* ioMaterial) {
-	VkDeviceSize imageSize = inTexWidth * inTexHeight * 4;
+// Stages the levels of a texture from inFirstMip on, back to back, with outOffset at the first one.
+bool Renderer::StageTextureMips(const TextureImport& inImport, std::uint32_t inFirstMip, VkBuffer& outBuffer, VkDeviceSize& outOffset) {
+	const auto& firstMip = inImport.Mips[inFirstMip];
+	const std::uint64_t size = GetMipChainSize(inImport, inFirstMip);
 
-	ioMaterial->MipLevels = static_cast<std::uint32_t>(std::floor(std::log2(std::max(inTexWidth, inTexHeight)))) + 1;
+	const auto& entry = inImport.PackedEntry;
+	if (entry.pData == nullptr) {
+		CheckReturn(mUploadContext.Stage(inImport.Pixels.data() + firstMip.Offset, size, StagingAlignment, outBuffer, outOffset));
+	}
+	else if (entry.Compression == PackCompressions::EPackUncompressed) {
+		CheckReturn(mUploadContext.Stage(entry.pData + inImport.PackedPixelOffset + firstMip.Offset, size, StagingAlignment, outBuffer, outOffset));
+	}
+	else {
+		// A compressed entry can only be decoded from its start, so it is staged from there, header
+		// included, and the copies skip what comes before the first level.
+		const std::uint64_t readSize = inImport.PackedPixelOffset + firstMip.Offset + size;
+
+		void* pStaging = nullptr;
+		CheckReturn(mUploadContext.Reserve(readSize, StagingAlignment, outBuffer, outOffset, pStaging));
+		CheckReturn(ReadPackEntry(entry, pStaging, readSize));
+		outOffset += inImport.PackedPixelOffset + firstMip.Offset;
+	}
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	return true;
+}
 
-	CreateBuffer(
-		mPhysicalDevice,
-		mDevice,
-		imageSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory);
+// The mip chain is built on the CPU, at import or when cooking, so the levels from inFirstMip on are
+// copied and the image goes straight to shader reads. Its first level is inFirstMip, which keeps the
+// sizes of the others in step with the import. Block-compressed levels are copied as they are.
+bool Renderer::CreateTextureImage(const TextureImport& inImport, std::uint32_t inFirstMip, Material* ioMaterial) {
+	const auto& firstMip = inImport.Mips[inFirstMip];
+	ioMaterial->TextureFormat = TextureImageFormats[inImport.Format];
+	ioMaterial->MipLevels = static_cast<std::uint32_t>(inImport.Mips.size()) - inFirstMip;
 
-	void* data;
-	vkMapMemory(mDevice, stagingBufferMemory, 0, imageSize, 0, &data);
-	std::memcpy(data, pData, static_cast<size_t>(imageSize));
-	vkUnmapMemory(mDevice, stagingBufferMemory);
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset = 0;
+	CheckReturn(StageTextureMips(inImport, inFirstMip, stagingBuffer, stagingOffset));
 
 	CheckReturn(CreateImage(
-		mPhysicalDevice,
+		mMemoryAllocator,
 		mDevice,
-		inTexWidth,
-		inTexHeight,
+		firstMip.Width,
+		firstMip.Height,
 		ioMaterial->MipLevels,
 		VK_SAMPLE_COUNT_1_BIT,
-		ImageFormat,
+		ioMaterial->TextureFormat,
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		false,
 		ioMaterial->TextureImage,
-		ioMaterial->TextureImageMemory));
+		ioMaterial->TextureImageAllocation));
+
+	VkCommandBuffer commandBuffer;
+	CheckReturn(mUploadContext.GetTransferCommandBuffer(commandBuffer));
 
 	CheckReturn(TransitionImageLayout(
-		mDevice,
-		mGraphicsQueue,
-		mCommandPool,
+		commandBuffer,
 		ioMaterial->TextureImage,
-		ImageFormat,
+		ioMaterial->TextureFormat,
 		VK_IMAGE_LAYOUT_UNDEFINED,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 		ioMaterial->MipLevels));
 
-	CopyBufferToImage(
-		mDevice,
-		mGraphicsQueue,
-		mCommandPool,
-		stagingBuffer,
-		ioMaterial->TextureImage,
-		static_cast<std::uint32_t>(inTexWidth),
-		static_cast<std::uint32_t>(inTexHeight));
+	// Levels are whole texels or blocks back to back, which keeps every offset a multiple of their size.
+	// Copies cover the texels of a level; its last blocks may extend past them.
+	for (std::uint32_t level = 0; level < ioMaterial->MipLevels; ++level) {
+		const auto& mip = inImport.Mips[inFirstMip + level];
+		CopyBufferToImage(
+			commandBuffer,
+			stagingBuffer,
+			stagingOffset + (mip.Offset - firstMip.Offset),
+			ioMaterial->TextureImage,
+			level,
+			mip.Width,
+			mip.Height);
+	}
 
-	GenerateMipmaps(
-		mPhysicalDevice,
-		mDevice,
-		mGraphicsQueue,
-		mCommandPool,
-		ioMaterial->TextureImage,
-		ImageFormat,
-		inTexWidth,
-		inTexHeight,
-		ioMaterial->MipLevels);
+	VkImageSubresourceRange range = {};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = ioMaterial->MipLevels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
 
-	vkDestroyBuffer(mDevice, stagingBuffer, nullptr);
-	vkFreeMemory(mDevice, stagingBufferMemory, nullptr);
+	mUploadContext.ReleaseImage(
+		ioMaterial->TextureImage,
+		range,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT);
 
-	return true;
-}
+	// The layout transition to shader reads happens on the queue that samples the image.
+	CheckReturn(mUploadContext.GetGraphicsCommandBuffer(commandBuffer));
 
-bool Renderer::CreateTextureImageView(Material* ioMaterial) {
-	CheckReturn(CreateImageView(mDevice, ioMaterial->TextureImage, ImageFormat, ioMaterial->MipLevels, VK_IMAGE_ASPECT_COLOR_BIT, ioMaterial->TextureImageView));
+	CheckReturn(TransitionImageLayout(
+		commandBuffer,
+		ioMaterial->TextureImage,
+		ioMaterial->TextureFormat,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		ioMaterial->MipLevels));
 
 	return true;
 }
 
-bool Renderer::CreateTextureSampler(Material* ioMaterial) {
-	VkSamplerCreateInfo samplerInfo = {};
-	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	samplerInfo.magFilter = VK_FILTER_LINEAR;
-	samplerInfo.minFilter = VK_FILTER_LINEAR;
-	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.anisotropyEnable = VK_TRUE;
-	samplerInfo.maxAnisotropy = 16;
-	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-	samplerInfo.unnormalizedCoordinates = VK_FALSE;
-	samplerInfo.compareEnable = VK_FALSE;
-	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerInfo.mipLodBias = 0.0f;
-	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = static_cast<float>(ioMaterial->MipLevels);
-
-	if (vkCreateSampler(mDevice, &samplerInfo, nullptr, &ioMaterial->TextureSampler) != VK_SUCCESS) {
-		ReturnFalse(L"Failed to create texture sampler");
-	}
+bool Renderer::CreateTextureImageView(Material* ioMaterial) {
+	CheckReturn(CreateImageView(mDevice, ioMaterial->TextureImage, ioMaterial->TextureFormat, ioMaterial->MipLevels, VK_IMAGE_ASPECT_COLOR_BIT, ioMaterial->TextureImageView));
 
 	return true;
 }
@@ -1336,11 +3475,42 @@ bool Renderer::CreateCommandPool() {
 	return true;
 }
 
+bool Renderer::CreateRecordingContexts() {
+	QueueFamilyIndices indices = FindQueueFamilies(mPhysicalDevice, mSurface);
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = indices.GetGraphicsFamilyIndex();
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	for (auto& contexts : mRecordingContexts) {
+		contexts.resize(mThreadPool.GetThreadCount());
+
+		for (auto& context : contexts) {
+			if (vkCreateCommandPool(mDevice, &poolInfo, nullptr, &context.CommandPool) != VK_SUCCESS) {
+				ReturnFalse(L"Failed to create command pool");
+			}
+
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = context.CommandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(mDevice, &allocInfo, &context.CommandBuffer) != VK_SUCCESS) {
+				ReturnFalse(L"Failed to create command buffers");
+			}
+		}
+	}
+
+	return true;
+}
+
 bool Renderer::CreateColorResources() {
 	VkFormat colorFormat = mSwapChainImageFormat;
 
 	CheckReturn(CreateImage(
-		mPhysicalDevice,
+		mMemoryAllocator,
 		mDevice,
 		mSwapChainExtent.width,
 		mSwapChainExtent.height,
@@ -1350,8 +3520,9 @@ bool Renderer::CreateColorResources() {
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		true,
 		mColorImage,
-		mColorImageMemory));
+		mColorImageAllocation));
 
 	CheckReturn(CreateImageView(
 		mDevice,
@@ -1368,7 +3539,7 @@ bool Renderer::CreateDepthResources() {
 	VkFormat depthFormat = FindDepthFormat(mPhysicalDevice);
 
 	CheckReturn(CreateImage(
-		mPhysicalDevice,
+		mMemoryAllocator,
 		mDevice,
 		mSwapChainExtent.width,
 		mSwapChainExtent.height,
@@ -1378,8 +3549,9 @@ bool Renderer::CreateDepthResources() {
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		true,
 		mDepthImage,
-		mDepthImageMemory));
+		mDepthImageAllocation));
 
 	CheckReturn(CreateImageView(
 		mDevice, 
@@ -1389,10 +3561,11 @@ bool Renderer::CreateDepthResources() {
 		VK_IMAGE_ASPECT_DEPTH_BIT, 
 		mDepthImageView));
 
+	VkCommandBuffer commandBuffer;
+	CheckReturn(mUploadContext.GetGraphicsCommandBuffer(commandBuffer));
+
 	CheckReturn(TransitionImageLayout(
-		mDevice,
-		mGraphicsQueue,
-		mCommandPool,
+		commandBuffer,
 		mDepthImage,
 		depthFormat,
 		VK_IMAGE_LAYOUT_UNDEFINED,
@@ -1431,28 +3604,34 @@ bool Renderer::CreateFramebuffers() {
 }
 
 bool Renderer::CreateDescriptorSetLayout() {
-	VkDescriptorSetLayoutBinding uboLayoutBinding = {};
-	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	uboLayoutBinding.pImmutableSamplers = nullptr;
-
-	VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
-	samplerLayoutBinding.binding = 1;
-	samplerLayoutBinding.descriptorCount = 1;
-	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerLayoutBinding.pImmutableSamplers = nullptr;
-	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings = {};
+
+	// Per-frame view constants, selected with a dynamic offset.
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	bindings[0].pImmutableSamplers = nullptr;
+
+	// Texture and sampler tables, indexed through DrawConstants.
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	bindings[1].descriptorCount = mTextureCapacity;
+	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindings[1].pImmutableSamplers = nullptr;
+
+	bindings[2].binding = 2;
+	bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	bindings[2].descriptorCount = MaxSamplerCount;
+	bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindings[2].pImmutableSamplers = nullptr;
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	layoutInfo.bindingCount = static_cast<std::uint32_t>(bindings.size());
 	layoutInfo.pBindings = bindings.data();
 
-	if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mDescriptorSetLayout) != VK_SUCCESS) {
+	if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mFrameDescriptorSetLayout) != VK_SUCCESS) {
 		ReturnFalse(L"Failed to create descriptor set layout");
 	}
 
@@ -1485,19 +3664,26 @@ bool Renderer::CreateGraphicsPipeline() {
 	fragShaderStageInfo.module = fragShaderModule;
 	fragShaderStageInfo.pName = "main";
 
+	// The table sizes depend on the device limits.
+	std::array<std::uint32_t, 2> tableSizes = { mTextureCapacity, MaxSamplerCount };
+	std::array<VkSpecializationMapEntry, 2> specializationEntries = {};
+	for (std::uint32_t i = 0; i < 2; ++i) {
+		specializationEntries[i].constantID = i;
+		specializationEntries[i].offset = sizeof(std::uint32_t) * i;
+		specializationEntries[i].size = sizeof(std::uint32_t);
+	}
+
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = static_cast<std::uint32_t>(specializationEntries.size());
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = sizeof(tableSizes);
+	specializationInfo.pData = tableSizes.data();
+	fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
 	VkPipelineShaderStageCreateInfo shaderStages[] = {
 		vertShaderStageInfo, fragShaderStageInfo
 	};
 
-	auto bindingDescription = Vertex::GetBindingDescription();
-	auto attributeDescriptioins = Vertex::GetAttributeDescriptions();
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<std::uint32_t>(attributeDescriptioins.size());
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptioins.data();
-
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -1571,10 +3757,15 @@ bool Renderer::CreateGraphicsPipeline() {
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DrawConstants);
+
 	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &mDescriptorSetLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
+	pipelineLayoutInfo.pSetLayouts = &mFrameDescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
 	if (vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS) {
 		ReturnFalse(L"Failed to create pipeline layout");
@@ -1596,7 +3787,6 @@ bool Renderer::CreateGraphicsPipeline() {
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipelineInfo.stageCount = 2;
 	pipelineInfo.pStages = shaderStages;
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &inputAssembly;
 	pipelineInfo.pViewportState = &viewportState;
 	pipelineInfo.pRasterizationState = &rasterizer;
@@ -1610,8 +3800,14 @@ bool Renderer::CreateGraphicsPipeline() {
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
-	if (vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mGraphicsPipeline) != VK_SUCCESS) {
-		ReturnFalse(L"Failed to create graphics pipeline");
+	// One pipeline per vertex format; only the vertex input state differs.
+	for (std::uint32_t format = 0; format < VertexFormats::ENumVertexFormats; ++format) {
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo = GetVertexInputState(static_cast<VertexFormats>(format));
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+
+		if (vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mGraphicsPipelines[format]) != VK_SUCCESS) {
+			ReturnFalse(L"Failed to create graphics pipeline");
+		}
 	}
 
 	vkDestroyShaderModule(mDevice, fragShaderModule, nullptr);
@@ -1620,20 +3816,48 @@ bool Renderer::CreateGraphicsPipeline() {
 	return true;
 }
 
+bool Renderer::CreateGpuCuller() {
+	// Visible instances start at their batch's slot, so indirect draws need a non-zero firstInstance.
+	if (!mEnabledFeatures.drawIndirectFirstInstance) return true;
+
+	std::vector<char> cullShaderCode;
+	CheckReturn(ReadFile("./../../../../Assets/Shaders/cull.spv", cullShaderCode));
+
+	VkShaderModule cullShaderModule;
+	CheckReturn(CreateShaderModule(mDevice, cullShaderCode, cullShaderModule));
+
+	bool status = mGpuCuller.Initialize(
+		mDevice,
+		&mMemoryAllocator,
+		cullShaderModule,
+		SwapChainImageCount,
+		bDrawIndirectCountSupported);
+
+	vkDestroyShaderModule(mDevice, cullShaderModule, nullptr);
+
+	CheckReturn(status);
+
+	bGpuCullerAvailable = true;
+
+	return true;
+}
+
 bool Renderer::CreateDescriptorPool() {
-	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	std::array<VkDescriptorPoolSize, 3> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	poolSizes[0].descriptorCount = static_cast<std::uint32_t>(SwapChainImageCount);
 
-	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = static_cast<std::uint32_t>(SwapChainImageCount);
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	poolSizes[1].descriptorCount = static_cast<std::uint32_t>(SwapChainImageCount * mTextureCapacity);
+
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+	poolSizes[2].descriptorCount = static_cast<std::uint32_t>(SwapChainImageCount * MaxSamplerCount);
 
 	VkDescriptorPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount = static_cast<std::uint32_t>(poolSizes.size());
 	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = static_cast<std::uint32_t>(SwapChainImageCount * 32);
-	poolInfo.flags = 0;
+	poolInfo.maxSets = static_cast<std::uint32_t>(SwapChainImageCount);
 
 	if (vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS) {
 		ReturnFalse(L"Failed to create descriptor pool");
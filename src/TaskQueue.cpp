@@ -0,0 +1,60 @@
+#include "TaskQueue.h"
+
+TaskQueue::~TaskQueue() {
+	if (!bIsCleanedUp) {
+		CleanUp();
+	}
+}
+
+bool TaskQueue::Initialize(std::uint32_t inWorkerCount) {
+	bQuit = false;
+
+	for (std::uint32_t i = 0; i < inWorkerCount; ++i) {
+		mWorkers.emplace_back(&TaskQueue::WorkerLoop, this);
+	}
+
+	bIsCleanedUp = false;
+
+	return true;
+}
+
+void TaskQueue::CleanUp() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		bQuit = true;
+	}
+	mTaskAvailable.notify_all();
+
+	for (auto& worker : mWorkers) {
+		if (worker.joinable()) worker.join();
+	}
+	mWorkers.clear();
+	mTasks.clear();
+
+	bIsCleanedUp = true;
+}
+
+void TaskQueue::Push(TaskFunc&& inFunc) {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTasks.push_back(std::move(inFunc));
+	}
+	mTaskAvailable.notify_one();
+}
+
+void TaskQueue::WorkerLoop() {
+	while (true) {
+		TaskFunc func;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mTaskAvailable.wait(lock, [this] { return bQuit || !mTasks.empty(); });
+
+			if (bQuit) return;
+
+			func = std::move(mTasks.front());
+			mTasks.pop_front();
+		}
+
+		func();
+	}
+}
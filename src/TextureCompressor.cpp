@@ -0,0 +1,719 @@
+#include "TextureCompressor.h"
+
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#include <limits>
+
+namespace {
+	// Passes of least squares over the chosen indices; each one is kept only if it lowers the error.
+	const int RefineIterationCount = 2;
+
+	const int PowerIterationCount = 8;
+
+	// Interpolation weights of the BC7 4-bit indices, in 64ths.
+	const std::uint32_t Bc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+	// The texels of one block, channel by channel, in [0, 255].
+	struct BlockTexels {
+		alignas(16) float Channels[4][16];
+	};
+
+	struct Bc7Endpoints {
+		std::uint8_t Values[2][4];	// 7 bits
+		std::uint8_t PBits[2];
+	};
+
+	inline float HorizontalSum(__m128 inValue) {
+		const __m128 sums = _mm_add_ps(inValue, _mm_movehl_ps(inValue, inValue));
+		return _mm_cvtss_f32(_mm_add_ss(sums, _mm_shuffle_ps(sums, sums, 1)));
+	}
+
+	inline float HorizontalMin(__m128 inValue) {
+		const __m128 mins = _mm_min_ps(inValue, _mm_movehl_ps(inValue, inValue));
+		return _mm_cvtss_f32(_mm_min_ss(mins, _mm_shuffle_ps(mins, mins, 1)));
+	}
+
+	inline float HorizontalMax(__m128 inValue) {
+		const __m128 maxs = _mm_max_ps(inValue, _mm_movehl_ps(inValue, inValue));
+		return _mm_cvtss_f32(_mm_max_ss(maxs, _mm_shuffle_ps(maxs, maxs, 1)));
+	}
+
+	void LoadBlock(const TextureMip& inMip, const std::uint8_t* pPixels, std::uint32_t inBlockX, std::uint32_t inBlockY, BlockTexels& outBlock) {
+		for (std::uint32_t i = 0; i < 16; ++i) {
+			// Texels past the edge repeat the last column or row, so they bring no colors of their own.
+			const std::uint32_t x = std::min(inBlockX * 4 + (i & 3), inMip.Width - 1);
+			const std::uint32_t y = std::min(inBlockY * 4 + (i >> 2), inMip.Height - 1);
+			const std::uint8_t* pTexel = pPixels + (static_cast<size_t>(y) * inMip.Width + x) * 4;
+			for (int c = 0; c < 4; ++c) {
+				outBlock.Channels[c][i] = pTexel[c];
+			}
+		}
+	}
+
+	// Endpoints of the line through the mean of inChannelCount channels along their principal axis,
+	// just spanning every texel.
+	void FitPrincipalAxis(const BlockTexels& inBlock, std::uint32_t inChannelCount, float outEndpoints[2][4]) {
+		float mean[4] = {};
+		__m128 centered[4][4];
+		for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+			const float* pChannel = inBlock.Channels[c];
+			__m128 sum = _mm_add_ps(_mm_add_ps(_mm_load_ps(pChannel), _mm_load_ps(pChannel + 4)),
+				_mm_add_ps(_mm_load_ps(pChannel + 8), _mm_load_ps(pChannel + 12)));
+			mean[c] = HorizontalSum(sum) * (1.0f / 16.0f);
+
+			const __m128 meanValue = _mm_set1_ps(mean[c]);
+			for (int g = 0; g < 4; ++g) {
+				centered[c][g] = _mm_sub_ps(_mm_load_ps(pChannel + g * 4), meanValue);
+			}
+		}
+
+		float covariance[4][4] = {};
+		for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+			for (std::uint32_t d = c; d < inChannelCount; ++d) {
+				__m128 sum = _mm_setzero_ps();
+				for (int g = 0; g < 4; ++g) {
+					sum = _mm_add_ps(sum, _mm_mul_ps(centered[c][g], centered[d][g]));
+				}
+				covariance[c][d] = covariance[d][c] = HorizontalSum(sum);
+			}
+		}
+
+		// Power iteration, from the column of the channel that varies most.
+		std::uint32_t widest = 0;
+		for (std::uint32_t c = 1; c < inChannelCount; ++c) {
+			if (covariance[c][c] > covariance[widest][widest]) widest = c;
+		}
+		float axis[4] = {};
+		for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+			axis[c] = covariance[c][widest];
+		}
+		for (int iteration = 0; iteration < PowerIterationCount; ++iteration) {
+			float next[4] = {};
+			float largest = 0.0f;
+			for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+				for (std::uint32_t d = 0; d < inChannelCount; ++d) {
+					next[c] += covariance[c][d] * axis[d];
+				}
+				largest = std::max(largest, std::abs(next[c]));
+			}
+			if (largest < 1e-12f) break;
+			for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+				axis[c] = next[c] / largest;
+			}
+		}
+
+		float lengthSquared = 0.0f;
+		for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+			lengthSquared += axis[c] * axis[c];
+		}
+
+		// A flat block collapses to its mean.
+		float tMin = 0.0f;
+		float tMax = 0.0f;
+		if (lengthSquared > 1e-12f) {
+			const float invLength = 1.0f / std::sqrt(lengthSquared);
+			__m128 tMins = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128 tMaxs = _mm_set1_ps(-std::numeric_limits<float>::max());
+			for (int g = 0; g < 4; ++g) {
+				__m128 t = _mm_setzero_ps();
+				for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+					t = _mm_add_ps(t, _mm_mul_ps(centered[c][g], _mm_set1_ps(axis[c] * invLength)));
+				}
+				tMins = _mm_min_ps(tMins, t);
+				tMaxs = _mm_max_ps(tMaxs, t);
+			}
+			tMin = HorizontalMin(tMins) * invLength;
+			tMax = HorizontalMax(tMaxs) * invLength;
+		}
+
+		for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+			outEndpoints[0][c] = std::min(std::max(mean[c] + axis[c] * tMin, 0.0f), 255.0f);
+			outEndpoints[1][c] = std::min(std::max(mean[c] + axis[c] * tMax, 0.0f), 255.0f);
+		}
+	}
+
+	// Picks for every texel the nearest of inPaletteSize colors over inChannelCount channels from
+	// inFirstChannel, and returns the summed squared error.
+	float SelectNearest(
+			const BlockTexels& inBlock,
+			const float inPalette[][4],
+			std::uint32_t inPaletteSize,
+			std::uint32_t inFirstChannel,
+			std::uint32_t inChannelCount,
+			std::uint8_t outIndices[16]) {
+		__m128 error = _mm_setzero_ps();
+		for (int g = 0; g < 4; ++g) {
+			__m128 texel[4];
+			for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+				texel[c] = _mm_load_ps(inBlock.Channels[inFirstChannel + c] + g * 4);
+			}
+
+			__m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128 bestIndex = _mm_setzero_ps();
+			for (std::uint32_t k = 0; k < inPaletteSize; ++k) {
+				__m128 distance = _mm_setzero_ps();
+				for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+					const __m128 delta = _mm_sub_ps(texel[c], _mm_set1_ps(inPalette[k][inFirstChannel + c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(delta, delta));
+				}
+
+				const __m128 closer = _mm_cmplt_ps(distance, best);
+				best = _mm_min_ps(best, distance);
+				bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(k))), _mm_andnot_ps(closer, bestIndex));
+			}
+			error = _mm_add_ps(error, best);
+
+			alignas(16) std::int32_t indices[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvttps_epi32(bestIndex));
+			for (int i = 0; i < 4; ++i) {
+				outIndices[g * 4 + i] = static_cast<std::uint8_t>(indices[i]);
+			}
+		}
+
+		return HorizontalSum(error);
+	}
+
+	// Least-squares endpoints for the chosen indices, each of which stands for the fraction inWeights of
+	// the way from the first endpoint to the second. False when the indices leave them undetermined.
+	bool FitEndpoints(
+			const BlockTexels& inBlock,
+			std::uint32_t inFirstChannel,
+			std::uint32_t inChannelCount,
+			const std::uint8_t inIndices[16],
+			const float* pWeights,
+			float outEndpoints[2][4]) {
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for (int i = 0; i < 16; ++i) {
+			const float t = pWeights[inIndices[i]];
+			const float s = 1.0f - t;
+			aa += s * s;
+			ab += s * t;
+			bb += t * t;
+			for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+				const float x = inBlock.Channels[inFirstChannel + c][i];
+				ax[c] += s * x;
+				bx[c] += t * x;
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f) return false;
+
+		const float invDeterminant = 1.0f / determinant;
+		for (std::uint32_t c = 0; c < inChannelCount; ++c) {
+			const float a = (ax[c] * bb - bx[c] * ab) * invDeterminant;
+			const float b = (bx[c] * aa - ax[c] * ab) * invDeterminant;
+			outEndpoints[0][inFirstChannel + c] = std::min(std::max(a, 0.0f), 255.0f);
+			outEndpoints[1][inFirstChannel + c] = std::min(std::max(b, 0.0f), 255.0f);
+		}
+
+		return true;
+	}
+
+	std::uint16_t QuantizeRgb565(const float inColor[4]) {
+		const std::uint32_t r = static_cast<std::uint32_t>(inColor[0] * (31.0f / 255.0f) + 0.5f);
+		const std::uint32_t g = static_cast<std::uint32_t>(inColor[1] * (63.0f / 255.0f) + 0.5f);
+		const std::uint32_t b = static_cast<std::uint32_t>(inColor[2] * (31.0f / 255.0f) + 0.5f);
+		return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRgb565(std::uint16_t inColor, std::uint32_t outColor[3]) {
+		const std::uint32_t r = (inColor >> 11) & 31;
+		const std::uint32_t g = (inColor >> 5) & 63;
+		const std::uint32_t b = inColor & 31;
+		outColor[0] = (r << 3) | (r >> 2);
+		outColor[1] = (g << 2) | (g >> 4);
+		outColor[2] = (b << 3) | (b >> 2);
+	}
+
+	// Colors of the four indices in the four-color mode, the only one BC3 has.
+	void BuildBc1Palette(const std::uint16_t inColors[2], std::uint32_t outPalette[4][3]) {
+		UnpackRgb565(inColors[0], outPalette[0]);
+		UnpackRgb565(inColors[1], outPalette[1]);
+		for (int c = 0; c < 3; ++c) {
+			outPalette[2][c] = (2 * outPalette[0][c] + outPalette[1][c]) / 3;
+			outPalette[3][c] = (outPalette[0][c] + 2 * outPalette[1][c]) / 3;
+		}
+	}
+
+	float SelectBc1Indices(const BlockTexels& inBlock, const std::uint16_t inColors[2], std::uint8_t outIndices[16]) {
+		std::uint32_t palette[4][3];
+		BuildBc1Palette(inColors, palette);
+
+		float paletteValues[4][4] = {};
+		for (int k = 0; k < 4; ++k) {
+			for (int c = 0; c < 3; ++c) {
+				paletteValues[k][c] = static_cast<float>(palette[k][c]);
+			}
+		}
+
+		return SelectNearest(inBlock, paletteValues, 4, 0, 3, outIndices);
+	}
+
+	void EncodeBc1Color(const BlockTexels& inBlock, std::uint8_t* pOut) {
+		static const float Weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+		float endpoints[2][4];
+		FitPrincipalAxis(inBlock, 3, endpoints);
+
+		std::uint16_t colors[2] = {QuantizeRgb565(endpoints[0]), QuantizeRgb565(endpoints[1])};
+		std::uint8_t indices[16];
+		float error = SelectBc1Indices(inBlock, colors, indices);
+
+		for (int iteration = 0; iteration < RefineIterationCount && error > 0.0f; ++iteration) {
+			if (!FitEndpoints(inBlock, 0, 3, indices, Weights, endpoints)) break;
+
+			const std::uint16_t refined[2] = {QuantizeRgb565(endpoints[0]), QuantizeRgb565(endpoints[1])};
+			if (refined[0] == colors[0] && refined[1] == colors[1]) break;
+
+			std::uint8_t refinedIndices[16];
+			const float refinedError = SelectBc1Indices(inBlock, refined, refinedIndices);
+			if (refinedError >= error) break;
+
+			colors[0] = refined[0];
+			colors[1] = refined[1];
+			std::memcpy(indices, refinedIndices, sizeof(indices));
+			error = refinedError;
+		}
+
+		// The first color must be the greater one to select the four-color mode in BC1. Swapping them
+		// swaps the indices of each pair.
+		if (colors[0] < colors[1]) {
+			std::swap(colors[0], colors[1]);
+			for (auto& index : indices) {
+				index ^= 1;
+			}
+		}
+		else if (colors[0] == colors[1]) {
+			std::memset(indices, 0, sizeof(indices));
+		}
+
+		std::uint32_t indexBits = 0;
+		for (int i = 0; i < 16; ++i) {
+			indexBits |= static_cast<std::uint32_t>(indices[i]) << (i * 2);
+		}
+
+		pOut[0] = static_cast<std::uint8_t>(colors[0]);
+		pOut[1] = static_cast<std::uint8_t>(colors[0] >> 8);
+		pOut[2] = static_cast<std::uint8_t>(colors[1]);
+		pOut[3] = static_cast<std::uint8_t>(colors[1] >> 8);
+		std::memcpy(pOut + 4, &indexBits, sizeof(indexBits));
+	}
+
+	void BuildAlphaPalette(std::uint32_t inAlpha0, std::uint32_t inAlpha1, std::uint32_t outPalette[8]) {
+		outPalette[0] = inAlpha0;
+		outPalette[1] = inAlpha1;
+		if (inAlpha0 > inAlpha1) {
+			for (std::uint32_t k = 2; k < 8; ++k) {
+				outPalette[k] = ((8 - k) * inAlpha0 + (k - 1) * inAlpha1) / 7;
+			}
+		}
+		else {
+			for (std::uint32_t k = 2; k < 6; ++k) {
+				outPalette[k] = ((6 - k) * inAlpha0 + (k - 1) * inAlpha1) / 5;
+			}
+			outPalette[6] = 0;
+			outPalette[7] = 255;
+		}
+	}
+
+	// Always in the eight-value mode, spanning the range of the block.
+	void EncodeAlphaBlock(const BlockTexels& inBlock, std::uint8_t* pOut) {
+		const float* pAlpha = inBlock.Channels[3];
+		const __m128 mins = _mm_min_ps(_mm_min_ps(_mm_load_ps(pAlpha), _mm_load_ps(pAlpha + 4)),
+			_mm_min_ps(_mm_load_ps(pAlpha + 8), _mm_load_ps(pAlpha + 12)));
+		const __m128 maxs = _mm_max_ps(_mm_max_ps(_mm_load_ps(pAlpha), _mm_load_ps(pAlpha + 4)),
+			_mm_max_ps(_mm_load_ps(pAlpha + 8), _mm_load_ps(pAlpha + 12)));
+		const std::uint32_t alpha0 = static_cast<std::uint32_t>(HorizontalMax(maxs));
+		const std::uint32_t alpha1 = static_cast<std::uint32_t>(HorizontalMin(mins));
+
+		std::uint8_t indices[16] = {};
+		if (alpha0 > alpha1) {
+			std::uint32_t palette[8];
+			BuildAlphaPalette(alpha0, alpha1, palette);
+
+			float paletteValues[8][4] = {};
+			for (int k = 0; k < 8; ++k) {
+				paletteValues[k][3] = static_cast<float>(palette[k]);
+			}
+			SelectNearest(inBlock, paletteValues, 8, 3, 1, indices);
+		}
+
+		std::uint64_t indexBits = 0;
+		for (int i = 0; i < 16; ++i) {
+			indexBits |= static_cast<std::uint64_t>(indices[i]) << (i * 3);
+		}
+
+		pOut[0] = static_cast<std::uint8_t>(alpha0);
+		pOut[1] = static_cast<std::uint8_t>(alpha1);
+		for (int i = 0; i < 6; ++i) {
+			pOut[2 + i] = static_cast<std::uint8_t>(indexBits >> (i * 8));
+		}
+	}
+
+	void EncodeBc1Block(const BlockTexels& inBlock, std::uint8_t* pOut) {
+		EncodeBc1Color(inBlock, pOut);
+	}
+
+	void EncodeBc3Block(const BlockTexels& inBlock, std::uint8_t* pOut) {
+		EncodeAlphaBlock(inBlock, pOut);
+		EncodeBc1Color(inBlock, pOut + 8);
+	}
+
+	// Each endpoint gets the low bit that brings its four channels closest.
+	void QuantizeBc7Endpoints(const float inEndpoints[2][4], Bc7Endpoints& outEndpoints) {
+		for (int e = 0; e < 2; ++e) {
+			float bestError = std::numeric_limits<float>::max();
+			for (std::uint32_t pBit = 0; pBit < 2; ++pBit) {
+				std::uint8_t values[4];
+				float error = 0.0f;
+				for (int c = 0; c < 4; ++c) {
+					const float value = std::floor((inEndpoints[e][c] - pBit) * 0.5f + 0.5f);
+					values[c] = static_cast<std::uint8_t>(std::min(std::max(value, 0.0f), 127.0f));
+
+					const float delta = static_cast<float>((values[c] << 1) | pBit) - inEndpoints[e][c];
+					error += delta * delta;
+				}
+				if (error < bestError) {
+					bestError = error;
+					std::memcpy(outEndpoints.Values[e], values, sizeof(values));
+					outEndpoints.PBits[e] = static_cast<std::uint8_t>(pBit);
+				}
+			}
+		}
+	}
+
+	void BuildBc7Palette(const Bc7Endpoints& inEndpoints, std::uint32_t outPalette[16][4]) {
+		for (int c = 0; c < 4; ++c) {
+			const std::uint32_t value0 = (static_cast<std::uint32_t>(inEndpoints.Values[0][c]) << 1) | inEndpoints.PBits[0];
+			const std::uint32_t value1 = (static_cast<std::uint32_t>(inEndpoints.Values[1][c]) << 1) | inEndpoints.PBits[1];
+			for (int k = 0; k < 16; ++k) {
+				outPalette[k][c] = ((64 - Bc7Weights[k]) * value0 + Bc7Weights[k] * value1 + 32) >> 6;
+			}
+		}
+	}
+
+	float SelectBc7Indices(const BlockTexels& inBlock, const Bc7Endpoints& inEndpoints, std::uint8_t outIndices[16]) {
+		std::uint32_t palette[16][4];
+		BuildBc7Palette(inEndpoints, palette);
+
+		float paletteValues[16][4];
+		for (int k = 0; k < 16; ++k) {
+			for (int c = 0; c < 4; ++c) {
+				paletteValues[k][c] = static_cast<float>(palette[k][c]);
+			}
+		}
+
+		return SelectNearest(inBlock, paletteValues, 16, 0, 4, outIndices);
+	}
+
+	// Bits of a 128-bit block, from the lowest bit of the first byte on.
+	class BlockBitWriter {
+	public:
+		explicit BlockBitWriter(std::uint8_t* pBlock) : mpBlock(pBlock) {
+			std::memset(pBlock, 0, 16);
+		}
+
+		void Write(std::uint32_t inValue, std::uint32_t inBitCount) {
+			for (std::uint32_t i = 0; i < inBitCount; ++i, ++mBit) {
+				if ((inValue >> i) & 1) mpBlock[mBit >> 3] |= static_cast<std::uint8_t>(1 << (mBit & 7));
+			}
+		}
+
+	private:
+		std::uint8_t* mpBlock;
+		std::uint32_t mBit = 0;
+	};
+
+	class BlockBitReader {
+	public:
+		explicit BlockBitReader(const std::uint8_t* pBlock) : mpBlock(pBlock) {}
+
+		std::uint32_t Read(std::uint32_t inBitCount) {
+			std::uint32_t value = 0;
+			for (std::uint32_t i = 0; i < inBitCount; ++i, ++mBit) {
+				value |= static_cast<std::uint32_t>((mpBlock[mBit >> 3] >> (mBit & 7)) & 1) << i;
+			}
+			return value;
+		}
+
+	private:
+		const std::uint8_t* mpBlock;
+		std::uint32_t mBit = 0;
+	};
+
+	// Mode 6: one subset, RGBA endpoints of seven bits and a shared low bit each, 4-bit indices.
+	void EncodeBc7Block(const BlockTexels& inBlock, std::uint8_t* pOut) {
+		static const float Weights[16] = {
+			0.0f, 4.0f / 64, 9.0f / 64, 13.0f / 64, 17.0f / 64, 21.0f / 64, 26.0f / 64, 30.0f / 64,
+			34.0f / 64, 38.0f / 64, 43.0f / 64, 47.0f / 64, 51.0f / 64, 55.0f / 64, 60.0f / 64, 1.0f
+		};
+
+		float endpoints[2][4];
+		FitPrincipalAxis(inBlock, 4, endpoints);
+
+		Bc7Endpoints quantized;
+		QuantizeBc7Endpoints(endpoints, quantized);
+		std::uint8_t indices[16];
+		float error = SelectBc7Indices(inBlock, quantized, indices);
+
+		for (int iteration = 0; iteration < RefineIterationCount && error > 0.0f; ++iteration) {
+			if (!FitEndpoints(inBlock, 0, 4, indices, Weights, endpoints)) break;
+
+			Bc7Endpoints refined;
+			QuantizeBc7Endpoints(endpoints, refined);
+			if (std::memcmp(&refined, &quantized, sizeof(refined)) == 0) break;
+
+			std::uint8_t refinedIndices[16];
+			const float refinedError = SelectBc7Indices(inBlock, refined, refinedIndices);
+			if (refinedError >= error) break;
+
+			quantized = refined;
+			std::memcpy(indices, refinedIndices, sizeof(indices));
+			error = refinedError;
+		}
+
+		// The index of the first texel is stored without its top bit, which must be clear. The weights are
+		// symmetric, so swapping the endpoints and mirroring the indices decodes the same.
+		if (indices[0] & 8) {
+			std::swap(quantized.Values[0], quantized.Values[1]);
+			std::swap(quantized.PBits[0], quantized.PBits[1]);
+			for (auto& index : indices) {
+				index = static_cast<std::uint8_t>(15 - index);
+			}
+		}
+
+		BlockBitWriter writer(pOut);
+		writer.Write(1u << 6, 7);
+		for (int c = 0; c < 4; ++c) {
+			writer.Write(quantized.Values[0][c], 7);
+			writer.Write(quantized.Values[1][c], 7);
+		}
+		writer.Write(quantized.PBits[0], 1);
+		writer.Write(quantized.PBits[1], 1);
+		writer.Write(indices[0], 3);
+		for (int i = 1; i < 16; ++i) {
+			writer.Write(indices[i], 4);
+		}
+	}
+
+	// Decoded texels of a block, row by row.
+	using DecodedBlock = std::uint8_t[16][4];
+
+	void DecodeBc1Color(const std::uint8_t* pBlock, bool bFourColorsOnly, DecodedBlock& outTexels) {
+		const std::uint16_t colors[2] = {
+			static_cast<std::uint16_t>(pBlock[0] | (pBlock[1] << 8)),
+			static_cast<std::uint16_t>(pBlock[2] | (pBlock[3] << 8))
+		};
+
+		std::uint32_t palette[4][3];
+		BuildBc1Palette(colors, palette);
+		if (!bFourColorsOnly && colors[0] <= colors[1]) {
+			// The three-color mode; the fourth is black, which is transparent in the formats with alpha.
+			for (int c = 0; c < 3; ++c) {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+
+		std::uint32_t indexBits;
+		std::memcpy(&indexBits, pBlock + 4, sizeof(indexBits));
+		for (int i = 0; i < 16; ++i) {
+			const std::uint32_t index = (indexBits >> (i * 2)) & 3;
+			for (int c = 0; c < 3; ++c) {
+				outTexels[i][c] = static_cast<std::uint8_t>(palette[index][c]);
+			}
+			outTexels[i][3] = 255;
+		}
+	}
+
+	void DecodeAlphaBlock(const std::uint8_t* pBlock, DecodedBlock& outTexels) {
+		std::uint32_t palette[8];
+		BuildAlphaPalette(pBlock[0], pBlock[1], palette);
+
+		std::uint64_t indexBits = 0;
+		for (int i = 0; i < 6; ++i) {
+			indexBits |= static_cast<std::uint64_t>(pBlock[2 + i]) << (i * 8);
+		}
+		for (int i = 0; i < 16; ++i) {
+			outTexels[i][3] = static_cast<std::uint8_t>(palette[(indexBits >> (i * 3)) & 7]);
+		}
+	}
+
+	bool DecodeBc1Block(const std::uint8_t* pBlock, DecodedBlock& outTexels) {
+		DecodeBc1Color(pBlock, false, outTexels);
+		return true;
+	}
+
+	bool DecodeBc3Block(const std::uint8_t* pBlock, DecodedBlock& outTexels) {
+		DecodeBc1Color(pBlock + 8, true, outTexels);
+		DecodeAlphaBlock(pBlock, outTexels);
+		return true;
+	}
+
+	bool DecodeBc7Block(const std::uint8_t* pBlock, DecodedBlock& outTexels) {
+		BlockBitReader reader(pBlock);
+		if (reader.Read(7) != (1u << 6)) return false;
+
+		Bc7Endpoints endpoints;
+		for (int c = 0; c < 4; ++c) {
+			endpoints.Values[0][c] = static_cast<std::uint8_t>(reader.Read(7));
+			endpoints.Values[1][c] = static_cast<std::uint8_t>(reader.Read(7));
+		}
+		endpoints.PBits[0] = static_cast<std::uint8_t>(reader.Read(1));
+		endpoints.PBits[1] = static_cast<std::uint8_t>(reader.Read(1));
+
+		std::uint32_t palette[16][4];
+		BuildBc7Palette(endpoints, palette);
+
+		for (int i = 0; i < 16; ++i) {
+			const std::uint32_t index = reader.Read(i == 0 ? 3 : 4);
+			for (int c = 0; c < 4; ++c) {
+				outTexels[i][c] = static_cast<std::uint8_t>(palette[index][c]);
+			}
+		}
+
+		return true;
+	}
+
+	// A row of blocks of one level; the unit of work of the encoders and decoders.
+	struct BlockRow {
+		std::uint32_t Level;
+		std::uint32_t BlockY;
+	};
+
+	void ListBlockRows(const std::vector<TextureMip>& inMips, std::vector<BlockRow>& outRows) {
+		outRows.clear();
+		for (std::uint32_t level = 0, end = static_cast<std::uint32_t>(inMips.size()); level < end; ++level) {
+			for (std::uint32_t y = 0, rowCount = (inMips[level].Height + 3) / 4; y < rowCount; ++y) {
+				outRows.push_back({level, y});
+			}
+		}
+	}
+}
+
+bool IsTextureOpaque(const TextureImport& inImport) {
+	if (inImport.Format != TextureFormats::ETextureRgba8 || inImport.Mips.empty()) return false;
+
+	const auto& mip = inImport.Mips[0];
+	const std::uint8_t* pPixels = inImport.Pixels.data() + mip.Offset;
+	for (size_t i = 3; i < mip.Size; i += 4) {
+		if (pPixels[i] != 255) return false;
+	}
+
+	return true;
+}
+
+bool CompressTexture(const TextureImport& inImport, TextureFormats inFormat, ThreadPool& inThreadPool, TextureImport& outImport) {
+	const std::uint32_t blockSize = GetTextureBlockSize(inFormat);
+	if (inImport.Format != TextureFormats::ETextureRgba8 || inImport.Pixels.empty() || blockSize == 0) {
+		ReturnFalse(L"Only the texels of RGBA8 textures can be block-compressed");
+	}
+
+	outImport.Width = inImport.Width;
+	outImport.Height = inImport.Height;
+	outImport.Format = inFormat;
+	outImport.Pixels.resize(LayoutTextureMips(inImport.Width, inImport.Height, inFormat, outImport.Mips));
+	outImport.PackedEntry = PackEntry();
+	outImport.PackedPixelOffset = 0;
+
+	void (*encodeBlock)(const BlockTexels&, std::uint8_t*) =
+		inFormat == TextureFormats::ETextureBc1 ? EncodeBc1Block :
+		inFormat == TextureFormats::ETextureBc3 ? EncodeBc3Block : EncodeBc7Block;
+
+	std::vector<BlockRow> rows;
+	ListBlockRows(inImport.Mips, rows);
+
+	inThreadPool.Run(static_cast<std::uint32_t>(rows.size()), [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		const auto& row = rows[inTaskIndex];
+		const auto& src = inImport.Mips[row.Level];
+		const auto& dst = outImport.Mips[row.Level];
+
+		const std::uint32_t blocksPerRow = (src.Width + 3) / 4;
+		std::uint8_t* pOut = outImport.Pixels.data() + dst.Offset + static_cast<size_t>(row.BlockY) * blocksPerRow * blockSize;
+
+		BlockTexels block;
+		for (std::uint32_t x = 0; x < blocksPerRow; ++x, pOut += blockSize) {
+			LoadBlock(src, inImport.Pixels.data() + src.Offset, x, row.BlockY, block);
+			encodeBlock(block, pOut);
+		}
+	});
+
+	return true;
+}
+
+bool DecompressTexture(const TextureImport& inImport, const std::uint8_t* pTexels, ThreadPool& inThreadPool, TextureImport& outImport) {
+	const std::uint32_t blockSize = GetTextureBlockSize(inImport.Format);
+	if (blockSize == 0) ReturnFalse(L"Texture is not block-compressed");
+
+	InitTextureMips(inImport.Width, inImport.Height, outImport);
+	outImport.PackedEntry = PackEntry();
+	outImport.PackedPixelOffset = 0;
+
+	bool (*decodeBlock)(const std::uint8_t*, DecodedBlock&) =
+		inImport.Format == TextureFormats::ETextureBc1 ? DecodeBc1Block :
+		inImport.Format == TextureFormats::ETextureBc3 ? DecodeBc3Block : DecodeBc7Block;
+
+	std::vector<BlockRow> rows;
+	ListBlockRows(inImport.Mips, rows);
+
+	std::atomic<bool> bFailed = false;
+	inThreadPool.Run(static_cast<std::uint32_t>(rows.size()), [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		const auto& row = rows[inTaskIndex];
+		const auto& src = inImport.Mips[row.Level];
+		const auto& dst = outImport.Mips[row.Level];
+
+		const std::uint32_t blocksPerRow = (src.Width + 3) / 4;
+		const std::uint8_t* pBlock = pTexels + src.Offset + static_cast<size_t>(row.BlockY) * blocksPerRow * blockSize;
+		std::uint8_t* pPixels = outImport.Pixels.data() + dst.Offset;
+
+		DecodedBlock texels;
+		for (std::uint32_t x = 0; x < blocksPerRow; ++x, pBlock += blockSize) {
+			if (!decodeBlock(pBlock, texels)) {
+				bFailed = true;
+				return;
+			}
+
+			// Padding texels past the edge are dropped.
+			for (std::uint32_t i = 0; i < 16; ++i) {
+				const std::uint32_t texelX = x * 4 + (i & 3);
+				const std::uint32_t texelY = row.BlockY * 4 + (i >> 2);
+				if (texelX >= dst.Width || texelY >= dst.Height) continue;
+
+				std::memcpy(pPixels + (static_cast<size_t>(texelY) * dst.Width + texelX) * 4, texels[i], 4);
+			}
+		}
+	});
+	if (bFailed) ReturnFalse(L"Unsupported block in compressed texture");
+
+	return true;
+}
+
+double GetTexturePsnr(const TextureImport& inReference, const TextureImport& inImport, std::uint32_t inFirstChannel, std::uint32_t inChannelCount) {
+	if (inReference.Format != TextureFormats::ETextureRgba8 || inImport.Format != TextureFormats::ETextureRgba8 ||
+			inReference.Width != inImport.Width || inReference.Height != inImport.Height || inReference.Mips.empty() ||
+			inImport.Mips.empty() || inFirstChannel + inChannelCount > 4 || inChannelCount == 0) {
+		return 0.0;
+	}
+
+	const std::uint8_t* pReference = inReference.Pixels.data() + inReference.Mips[0].Offset;
+	const std::uint8_t* pPixels = inImport.Pixels.data() + inImport.Mips[0].Offset;
+	const size_t texelCount = static_cast<size_t>(inReference.Width) * inReference.Height;
+
+	std::uint64_t squaredError = 0;
+	for (size_t i = 0; i < texelCount; ++i) {
+		for (std::uint32_t c = inFirstChannel; c < inFirstChannel + inChannelCount; ++c) {
+			const std::int32_t delta = static_cast<std::int32_t>(pReference[i * 4 + c]) - pPixels[i * 4 + c];
+			squaredError += static_cast<std::uint64_t>(delta * delta);
+		}
+	}
+	if (squaredError == 0) return std::numeric_limits<double>::infinity();
+
+	const double meanSquaredError = static_cast<double>(squaredError) / (static_cast<double>(texelCount) * inChannelCount);
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
@@ -0,0 +1,112 @@
+#include "TextureImporter.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cstring>
+
+std::uint32_t GetMipLevelCount(std::uint32_t inWidth, std::uint32_t inHeight) {
+	std::uint32_t levels = 1;
+	for (std::uint32_t size = std::max(inWidth, inHeight); size > 1; size >>= 1) {
+		++levels;
+	}
+	return levels;
+}
+
+std::uint32_t GetTextureBlockSize(TextureFormats inFormat) {
+	switch (inFormat) {
+	case TextureFormats::ETextureBc1:
+		return 8;
+	case TextureFormats::ETextureBc3:
+	case TextureFormats::ETextureBc7:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+size_t LayoutTextureMips(std::uint32_t inWidth, std::uint32_t inHeight, TextureFormats inFormat, std::vector<TextureMip>& outMips) {
+	const std::uint32_t blockSize = GetTextureBlockSize(inFormat);
+
+	const std::uint32_t levelCount = GetMipLevelCount(inWidth, inHeight);
+	outMips.resize(levelCount);
+
+	size_t offset = 0;
+	for (std::uint32_t level = 0; level < levelCount; ++level) {
+		auto& mip = outMips[level];
+		mip.Width = std::max(inWidth >> level, 1u);
+		mip.Height = std::max(inHeight >> level, 1u);
+		mip.Offset = offset;
+		mip.Size = blockSize == 0 ? static_cast<size_t>(mip.Width) * mip.Height * 4 :
+			static_cast<size_t>((mip.Width + 3) / 4) * ((mip.Height + 3) / 4) * blockSize;
+		offset += mip.Size;
+	}
+
+	return offset;
+}
+
+void InitTextureMips(std::uint32_t inWidth, std::uint32_t inHeight, TextureImport& outImport) {
+	outImport.Width = inWidth;
+	outImport.Height = inHeight;
+	outImport.Format = TextureFormats::ETextureRgba8;
+	outImport.Pixels.resize(LayoutTextureMips(inWidth, inHeight, outImport.Format, outImport.Mips));
+}
+
+bool ImportTexture(const std::string& inFilePath, TextureImport& outImport) {
+	int texWidth = 0;
+	int texHeight = 0;
+	int texChannels = 0;
+
+	stbi_uc* pixels = stbi_load(inFilePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	if (!pixels) ReturnFalse(L"Failed to load texture image");
+
+	InitTextureMips(static_cast<std::uint32_t>(texWidth), static_cast<std::uint32_t>(texHeight), outImport);
+	std::memcpy(outImport.Pixels.data(), pixels, outImport.Mips[0].Size);
+	stbi_image_free(pixels);
+
+	GenerateMipChain(outImport);
+
+	return true;
+}
+
+void GenerateMipChain(TextureImport& ioImport) {
+	for (size_t level = 1, end = ioImport.Mips.size(); level < end; ++level) {
+		const auto& src = ioImport.Mips[level - 1];
+		const auto& dst = ioImport.Mips[level];
+
+		const std::uint8_t* pSrc = ioImport.Pixels.data() + src.Offset;
+		std::uint8_t* pDst = ioImport.Pixels.data() + dst.Offset;
+
+		// Each destination texel covers 2x2 source texels, or fewer along an axis that is already 1.
+		const std::uint32_t stepX = src.Width > 1 ? 2 : 1;
+		const std::uint32_t stepY = src.Height > 1 ? 2 : 1;
+
+		for (std::uint32_t y = 0; y < dst.Height; ++y) {
+			std::uint32_t y0 = y * stepY;
+			std::uint32_t y1 = std::min(y0 + stepY - 1, src.Height - 1);
+			if (y == dst.Height - 1) y1 = src.Height - 1;
+
+			for (std::uint32_t x = 0; x < dst.Width; ++x) {
+				std::uint32_t x0 = x * stepX;
+				std::uint32_t x1 = std::min(x0 + stepX - 1, src.Width - 1);
+				if (x == dst.Width - 1) x1 = src.Width - 1;
+
+				std::uint32_t sums[4] = {};
+				for (std::uint32_t sy = y0; sy <= y1; ++sy) {
+					const std::uint8_t* pRow = pSrc + (static_cast<size_t>(sy) * src.Width) * 4;
+					for (std::uint32_t sx = x0; sx <= x1; ++sx) {
+						for (int c = 0; c < 4; ++c) {
+							sums[c] += pRow[sx * 4 + c];
+						}
+					}
+				}
+
+				const std::uint32_t count = (y1 - y0 + 1) * (x1 - x0 + 1);
+				std::uint8_t* pTexel = pDst + (static_cast<size_t>(y) * dst.Width + x) * 4;
+				for (int c = 0; c < 4; ++c) {
+					pTexel[c] = static_cast<std::uint8_t>((sums[c] + count / 2) / count);
+				}
+			}
+		}
+	}
+}
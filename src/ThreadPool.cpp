@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+
+ThreadPool::~ThreadPool() {
+	if (!bIsCleanedUp) {
+		CleanUp();
+	}
+}
+
+bool ThreadPool::Initialize(std::uint32_t inWorkerCount) {
+	bQuit = false;
+
+	for (std::uint32_t i = 0; i < inWorkerCount; ++i) {
+		// Thread index 0 belongs to the thread calling Run().
+		mWorkers.emplace_back(&ThreadPool::WorkerLoop, this, i + 1);
+	}
+
+	bIsCleanedUp = false;
+
+	return true;
+}
+
+void ThreadPool::CleanUp() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		bQuit = true;
+	}
+	mWorkAvailable.notify_all();
+
+	for (auto& worker : mWorkers) {
+		if (worker.joinable()) worker.join();
+	}
+	mWorkers.clear();
+
+	bIsCleanedUp = true;
+}
+
+void ThreadPool::Run(std::uint32_t inTaskCount, const TaskFunc& inFunc) {
+	if (inTaskCount == 0) return;
+
+	if (mWorkers.empty() || inTaskCount == 1) {
+		for (std::uint32_t i = 0; i < inTaskCount; ++i) {
+			inFunc(i, 0);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mpFunc = &inFunc;
+		mTaskCount = inTaskCount;
+		mNextTask = 0;
+		mBusyWorkerCount = static_cast<std::uint32_t>(mWorkers.size());
+		++mGeneration;
+	}
+	mWorkAvailable.notify_all();
+
+	ExecuteTasks(0);
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWorkDone.wait(lock, [this] { return mBusyWorkerCount == 0; });
+
+	mpFunc = nullptr;
+}
+
+std::uint32_t ThreadPool::GetThreadCount() const {
+	return static_cast<std::uint32_t>(mWorkers.size()) + 1;
+}
+
+void ThreadPool::WorkerLoop(std::uint32_t inThreadIndex) {
+	std::uint64_t generation = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkAvailable.wait(lock, [&] { return bQuit || mGeneration != generation; });
+
+			if (bQuit) return;
+
+			generation = mGeneration;
+		}
+
+		ExecuteTasks(inThreadIndex);
+
+		bool bLast = false;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			bLast = --mBusyWorkerCount == 0;
+		}
+		if (bLast) mWorkDone.notify_one();
+	}
+}
+
+void ThreadPool::ExecuteTasks(std::uint32_t inThreadIndex) {
+	while (true) {
+		std::uint32_t task = mNextTask.fetch_add(1);
+		if (task >= mTaskCount) return;
+
+		(*mpFunc)(task, inThreadIndex);
+	}
+}
\ No newline at end of file
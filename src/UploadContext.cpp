@@ -0,0 +1,617 @@
+#include "UploadContext.h"
+
+namespace {
+	std::uint64_t AlignUp(std::uint64_t inValue, std::uint64_t inAlignment) {
+		if (inAlignment <= 1) return inValue;
+		return (inValue + inAlignment - 1) / inAlignment * inAlignment;
+	}
+
+	bool CreateStagingBuffer(
+			MemoryAllocator& inAllocator,
+			const VkDevice& inDevice,
+			VkDeviceSize inSize,
+			VkBuffer& outBuffer,
+			Allocation& outAllocation) {
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = inSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(inDevice, &bufferInfo, nullptr, &outBuffer) != VK_SUCCESS) {
+			ReturnFalse(L"Failed to create staging buffer");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(inDevice, outBuffer, &memRequirements);
+
+		if (!inAllocator.Allocate(
+				memRequirements,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				ResourceKinds::ELinearResource,
+				false,
+				outAllocation)) {
+			vkDestroyBuffer(inDevice, outBuffer, nullptr);
+			ReturnFalse(L"Failed to allocate staging buffer memory");
+		}
+
+		vkBindBufferMemory(inDevice, outBuffer, outAllocation.Memory, outAllocation.Offset);
+
+		return true;
+	}
+}
+
+UploadContext::~UploadContext() {
+	if (!bIsCleanedUp) {
+		CleanUp();
+	}
+}
+
+bool UploadContext::Initialize(
+		const VkDevice& inDevice,
+		const VkQueue& inGraphicsQueue,
+		std::uint32_t inGraphicsFamilyIndex,
+		const VkQueue& inTransferQueue,
+		std::uint32_t inTransferFamilyIndex,
+		MemoryAllocator* pAllocator,
+		VkDeviceSize inStagingSize) {
+	mDevice = inDevice;
+	mMemoryAllocator = pAllocator;
+
+	mGraphicsQueue = inGraphicsQueue;
+	mTransferQueue = inTransferQueue;
+	mGraphicsFamilyIndex = inGraphicsFamilyIndex;
+	mTransferFamilyIndex = inTransferFamilyIndex;
+	bDedicatedTransfer = inGraphicsFamilyIndex != inTransferFamilyIndex;
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = mGraphicsFamilyIndex;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	if (vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mGraphicsCommandPool) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to create upload command pool");
+	}
+
+	if (bDedicatedTransfer) {
+		poolInfo.queueFamilyIndex = mTransferFamilyIndex;
+
+		if (vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mTransferCommandPool) != VK_SUCCESS) {
+			ReturnFalse(L"Failed to create transfer command pool");
+		}
+	}
+
+	CheckReturn(CreateStagingBuffer(*mMemoryAllocator, mDevice, inStagingSize, mStagingBuffer, mStagingBufferAllocation));
+	mStagingSize = inStagingSize;
+	mRingHead = 0;
+
+	WLogln(L"Uploads use ", bDedicatedTransfer ? L"a dedicated transfer queue" : L"the graphics queue");
+
+	bIsCleanedUp = false;
+
+	return true;
+}
+
+void UploadContext::CleanUp() {
+	if (mRecordingBatch) {
+		std::uint64_t ticket = 0;
+		Submit(ticket);
+	}
+
+	while (!mInFlightBatches.empty()) {
+		if (!RetireBatches(true)) break;
+	}
+
+	vkQueueWaitIdle(mGraphicsQueue);
+	if (bDedicatedTransfer) vkQueueWaitIdle(mTransferQueue);
+
+	for (auto& batch : mInFlightBatches) {
+		ReleaseDeferredBuffers(*batch);
+		DestroyBatch(*batch);
+	}
+	mInFlightBatches.clear();
+
+	for (auto& batch : mFreeBatches)
+		DestroyBatch(*batch);
+	mFreeBatches.clear();
+
+	vkDestroyBuffer(mDevice, mStagingBuffer, nullptr);
+	mMemoryAllocator->Free(mStagingBufferAllocation);
+	mStagingBuffer = VK_NULL_HANDLE;
+
+	if (bDedicatedTransfer) vkDestroyCommandPool(mDevice, mTransferCommandPool, nullptr);
+	vkDestroyCommandPool(mDevice, mGraphicsCommandPool, nullptr);
+
+	bIsCleanedUp = true;
+}
+
+bool UploadContext::Stage(const void* pData, VkDeviceSize inSize, VkDeviceSize inAlignment, VkBuffer& outBuffer, VkDeviceSize& outOffset) {
+	void* pStaging = nullptr;
+	CheckReturn(Reserve(inSize, inAlignment, outBuffer, outOffset, pStaging));
+
+	std::memcpy(pStaging, pData, static_cast<size_t>(inSize));
+
+	return true;
+}
+
+bool UploadContext::Reserve(VkDeviceSize inSize, VkDeviceSize inAlignment, VkBuffer& outBuffer, VkDeviceSize& outOffset, void*& outMappedData) {
+	if (inSize > mStagingSize) {
+		CheckReturn(ReserveOversized(inSize, outBuffer, outOffset, outMappedData));
+
+		return true;
+	}
+
+	if (!mRecordingBatch) CheckReturn(BeginBatch());
+
+	CheckReturn(RetireBatches(false));
+
+	while (!ReserveRing(inSize, inAlignment, outOffset)) {
+		// The batch being recorded holds the rest of the ring; hand it to the GPU so it can be reclaimed.
+		if (mInFlightBatches.empty() && mRecordingBatch->RingBegin != mRingHead) {
+			std::uint64_t ticket = 0;
+			CheckReturn(Submit(ticket));
+			CheckReturn(BeginBatch());
+		}
+
+		if (mInFlightBatches.empty()) {
+			ReturnFalse(L"Staging ring is too small for the upload");
+		}
+
+		CheckReturn(RetireBatches(true));
+	}
+
+	outMappedData = reinterpret_cast<std::uint8_t*>(mStagingBufferAllocation.pMappedData) + outOffset;
+	outBuffer = mStagingBuffer;
+
+	return true;
+}
+
+bool UploadContext::GetTransferCommandBuffer(VkCommandBuffer& outCommandBuffer) {
+	if (!mRecordingBatch) CheckReturn(BeginBatch());
+
+	outCommandBuffer = mRecordingBatch->TransferCommandBuffer;
+
+	return true;
+}
+
+bool UploadContext::GetGraphicsCommandBuffer(VkCommandBuffer& outCommandBuffer) {
+	if (!mRecordingBatch) CheckReturn(BeginBatch());
+
+	outCommandBuffer = mRecordingBatch->GraphicsCommandBuffer;
+
+	return true;
+}
+
+void UploadContext::ReleaseBuffer(
+		const VkBuffer& inBuffer,
+		VkDeviceSize inOffset,
+		VkDeviceSize inSize,
+		const VkPipelineStageFlags& inDstStages,
+		const VkAccessFlags& inDstAccess) {
+	// Within one queue the final memory barrier of the batch is all that is needed.
+	if (!bDedicatedTransfer || !mRecordingBatch) return;
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = mTransferFamilyIndex;
+	barrier.dstQueueFamilyIndex = mGraphicsFamilyIndex;
+	barrier.buffer = inBuffer;
+	barrier.offset = inOffset;
+	barrier.size = inSize;
+
+	// Release: the destination access is ignored on the releasing queue.
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+
+	vkCmdPipelineBarrier(
+		mRecordingBatch->TransferCommandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0,
+		0, nullptr,
+		1, &barrier,
+		0, nullptr);
+
+	// Acquire: the source access is ignored on the acquiring queue; the semaphore covers it.
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = inDstAccess;
+
+	vkCmdPipelineBarrier(
+		mRecordingBatch->GraphicsCommandBuffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		inDstStages,
+		0,
+		0, nullptr,
+		1, &barrier,
+		0, nullptr);
+}
+
+void UploadContext::ReleaseImage(
+		const VkImage& inImage,
+		const VkImageSubresourceRange& inRange,
+		const VkImageLayout& inLayout,
+		const VkPipelineStageFlags& inDstStages,
+		const VkAccessFlags& inDstAccess) {
+	if (!bDedicatedTransfer || !mRecordingBatch) return;
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = mTransferFamilyIndex;
+	barrier.dstQueueFamilyIndex = mGraphicsFamilyIndex;
+	barrier.image = inImage;
+	barrier.subresourceRange = inRange;
+	barrier.oldLayout = inLayout;
+	barrier.newLayout = inLayout;
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+
+	vkCmdPipelineBarrier(
+		mRecordingBatch->TransferCommandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0,
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = inDstAccess;
+
+	vkCmdPipelineBarrier(
+		mRecordingBatch->GraphicsCommandBuffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		inDstStages,
+		0,
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+}
+
+void UploadContext::DeferDestroy(const VkBuffer& inBuffer, const Allocation& inAllocation) {
+	if (!mRecordingBatch && !BeginBatch()) {
+		vkQueueWaitIdle(mGraphicsQueue);
+		if (bDedicatedTransfer) vkQueueWaitIdle(mTransferQueue);
+
+		vkDestroyBuffer(mDevice, inBuffer, nullptr);
+
+		Allocation allocation = inAllocation;
+		mMemoryAllocator->Free(allocation);
+
+		return;
+	}
+
+	mRecordingBatch->DeferredBuffers.emplace_back(inBuffer, inAllocation);
+}
+
+bool UploadContext::HasPendingWork() const {
+	return mRecordingBatch != nullptr;
+}
+
+bool UploadContext::HasDedicatedTransferQueue() const {
+	return bDedicatedTransfer;
+}
+
+bool UploadContext::Submit(std::uint64_t& outTicket) {
+	if (!mRecordingBatch) {
+		outTicket = mNextTicket - 1;
+
+		return true;
+	}
+
+	auto& batch = *mRecordingBatch;
+
+	if (bDedicatedTransfer) {
+		if (vkEndCommandBuffer(batch.TransferCommandBuffer) != VK_SUCCESS) {
+			ReturnFalse(L"Failed to record transfer command buffer");
+		}
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.TransferCommandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &batch.TransferSemaphore;
+
+		vkResetFences(mDevice, 1, &batch.TransferFence);
+
+		if (vkQueueSubmit(mTransferQueue, 1, &submitInfo, batch.TransferFence) != VK_SUCCESS) {
+			ReturnFalse(L"Failed to submit transfer command buffer");
+		}
+
+		batch.State = BatchStates::ETransferSubmitted;
+	}
+	else {
+		CheckReturn(SubmitGraphics(batch));
+	}
+
+	batch.RingEnd = mRingHead;
+	batch.Ticket = mNextTicket++;
+	outTicket = batch.Ticket;
+
+	if (batch.State == BatchStates::EGraphicsSubmitted) mAvailableTicket = batch.Ticket;
+
+	mInFlightBatches.push_back(std::move(mRecordingBatch));
+
+	return true;
+}
+
+bool UploadContext::Pump() {
+	CheckReturn(PumpBatches(false));
+	CheckReturn(RetireBatches(false));
+
+	return true;
+}
+
+std::uint64_t UploadContext::GetPendingTicket() const {
+	return mRecordingBatch ? mNextTicket : mNextTicket - 1;
+}
+
+bool UploadContext::IsAvailable(std::uint64_t inTicket) const {
+	return inTicket <= mAvailableTicket;
+}
+
+bool UploadContext::IsComplete(std::uint64_t inTicket) {
+	if (inTicket <= mCompletedTicket) return true;
+
+	CheckReturn(Pump());
+
+	return inTicket <= mCompletedTicket;
+}
+
+bool UploadContext::Wait(std::uint64_t inTicket) {
+	while (inTicket > mCompletedTicket) {
+		if (mInFlightBatches.empty()) {
+			ReturnFalse(L"Waiting for an upload ticket that was never submitted");
+		}
+
+		CheckReturn(RetireBatches(true));
+	}
+
+	return true;
+}
+
+bool UploadContext::CreateBatch(std::unique_ptr<Batch>& outBatch) {
+	auto batch = std::make_unique<Batch>();
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = mGraphicsCommandPool;
+	allocInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(mDevice, &allocInfo, &batch->GraphicsCommandBuffer) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to allocate upload command buffer");
+	}
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	if (vkCreateFence(mDevice, &fenceInfo, nullptr, &batch->Fence) != VK_SUCCESS) {
+		DestroyBatch(*batch);
+		ReturnFalse(L"Failed to create upload fence");
+	}
+
+	if (bDedicatedTransfer) {
+		allocInfo.commandPool = mTransferCommandPool;
+
+		if (vkAllocateCommandBuffers(mDevice, &allocInfo, &batch->TransferCommandBuffer) != VK_SUCCESS) {
+			DestroyBatch(*batch);
+			ReturnFalse(L"Failed to allocate transfer command buffer");
+		}
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		if (vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &batch->TransferSemaphore) != VK_SUCCESS ||
+			vkCreateFence(mDevice, &fenceInfo, nullptr, &batch->TransferFence) != VK_SUCCESS) {
+			DestroyBatch(*batch);
+			ReturnFalse(L"Failed to create transfer synchronization objects");
+		}
+	}
+	else {
+		batch->TransferCommandBuffer = batch->GraphicsCommandBuffer;
+	}
+
+	outBatch = std::move(batch);
+
+	return true;
+}
+
+void UploadContext::DestroyBatch(Batch& ioBatch) {
+	if (ioBatch.GraphicsCommandBuffer != VK_NULL_HANDLE)
+		vkFreeCommandBuffers(mDevice, mGraphicsCommandPool, 1, &ioBatch.GraphicsCommandBuffer);
+	vkDestroyFence(mDevice, ioBatch.Fence, nullptr);
+
+	if (bDedicatedTransfer) {
+		if (ioBatch.TransferCommandBuffer != VK_NULL_HANDLE)
+			vkFreeCommandBuffers(mDevice, mTransferCommandPool, 1, &ioBatch.TransferCommandBuffer);
+		vkDestroySemaphore(mDevice, ioBatch.TransferSemaphore, nullptr);
+		vkDestroyFence(mDevice, ioBatch.TransferFence, nullptr);
+	}
+
+	ioBatch = Batch();
+}
+
+bool UploadContext::BeginBatch() {
+	std::unique_ptr<Batch> batch;
+
+	if (!mFreeBatches.empty()) {
+		batch = std::move(mFreeBatches.back());
+		mFreeBatches.pop_back();
+	}
+	else {
+		CheckReturn(CreateBatch(batch));
+	}
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(batch->GraphicsCommandBuffer, &beginInfo) != VK_SUCCESS ||
+		(bDedicatedTransfer && vkBeginCommandBuffer(batch->TransferCommandBuffer, &beginInfo) != VK_SUCCESS)) {
+		mFreeBatches.push_back(std::move(batch));
+		ReturnFalse(L"Failed to begin upload command buffer");
+	}
+
+	batch->State = BatchStates::ERecording;
+	batch->RingBegin = mRingHead;
+	batch->RingEnd = mRingHead;
+	batch->Ticket = 0;
+
+	mRecordingBatch = std::move(batch);
+
+	return true;
+}
+
+bool UploadContext::SubmitGraphics(Batch& ioBatch) {
+	auto& commandBuffer = ioBatch.GraphicsCommandBuffer;
+
+	// Make every transfer write visible to whatever reads the uploaded data later on this queue.
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to record upload command buffer");
+	}
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	if (bDedicatedTransfer) {
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &ioBatch.TransferSemaphore;
+		submitInfo.pWaitDstStageMask = &waitStage;
+	}
+
+	vkResetFences(mDevice, 1, &ioBatch.Fence);
+
+	if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, ioBatch.Fence) != VK_SUCCESS) {
+		ReturnFalse(L"Failed to submit upload command buffer");
+	}
+
+	ioBatch.State = BatchStates::EGraphicsSubmitted;
+
+	return true;
+}
+
+bool UploadContext::PumpBatches(bool bWaitForOldest) {
+	// Graphics halves go out in ticket order so that availability stays monotonic.
+	for (auto& batch : mInFlightBatches) {
+		if (batch->State != BatchStates::ETransferSubmitted) continue;
+
+		if (bWaitForOldest) {
+			if (vkWaitForFences(mDevice, 1, &batch->TransferFence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+				ReturnFalse(L"Failed to wait for transfer fence");
+			}
+
+			bWaitForOldest = false;
+		}
+		else if (vkGetFenceStatus(mDevice, batch->TransferFence) != VK_SUCCESS) {
+			break;
+		}
+
+		CheckReturn(SubmitGraphics(*batch));
+		mAvailableTicket = batch->Ticket;
+	}
+
+	return true;
+}
+
+bool UploadContext::RetireBatches(bool bWaitForOldest) {
+	while (!mInFlightBatches.empty()) {
+		auto& batch = mInFlightBatches.front();
+
+		if (bWaitForOldest) {
+			if (batch->State == BatchStates::ETransferSubmitted) CheckReturn(PumpBatches(true));
+
+			if (vkWaitForFences(mDevice, 1, &batch->Fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+				ReturnFalse(L"Failed to wait for upload fence");
+			}
+
+			bWaitForOldest = false;
+		}
+		else if (batch->State != BatchStates::EGraphicsSubmitted || vkGetFenceStatus(mDevice, batch->Fence) != VK_SUCCESS) {
+			break;
+		}
+
+		mCompletedTicket = batch->Ticket;
+		ReleaseDeferredBuffers(*batch);
+
+		mFreeBatches.push_back(std::move(batch));
+		mInFlightBatches.pop_front();
+	}
+
+	return true;
+}
+
+void UploadContext::ReleaseDeferredBuffers(Batch& ioBatch) {
+	for (auto& bufferPair : ioBatch.DeferredBuffers) {
+		vkDestroyBuffer(mDevice, bufferPair.first, nullptr);
+		mMemoryAllocator->Free(bufferPair.second);
+	}
+
+	ioBatch.DeferredBuffers.clear();
+}
+
+std::uint64_t UploadContext::GetRingTail() const {
+	if (!mInFlightBatches.empty()) return mInFlightBatches.front()->RingBegin;
+	if (mRecordingBatch) return mRecordingBatch->RingBegin;
+
+	return mRingHead;
+}
+
+bool UploadContext::ReserveRing(VkDeviceSize inSize, VkDeviceSize inAlignment, VkDeviceSize& outOffset) {
+	// Nothing is in use, so restart from the beginning of the ring to give large uploads the most room.
+	if (GetRingTail() == mRingHead) {
+		std::uint64_t physical = mRingHead % mStagingSize;
+		if (physical != 0) mRingHead += mStagingSize - physical;
+
+		if (mRecordingBatch) mRecordingBatch->RingBegin = mRingHead;
+	}
+
+	std::uint64_t head = mRingHead;
+	std::uint64_t physical = head % mStagingSize;
+	std::uint64_t aligned = AlignUp(physical, inAlignment);
+
+	// Never split an upload across the end of the ring; skip the tail bytes instead.
+	if (aligned + inSize > mStagingSize) {
+		head += mStagingSize - physical;
+		physical = 0;
+		aligned = 0;
+	}
+
+	std::uint64_t newHead = head + (aligned - physical) + inSize;
+	if (newHead - GetRingTail() > mStagingSize) return false;
+
+	mRingHead = newHead;
+	outOffset = aligned;
+
+	return true;
+}
+
+bool UploadContext::ReserveOversized(VkDeviceSize inSize, VkBuffer& outBuffer, VkDeviceSize& outOffset, void*& outMappedData) {
+	Allocation allocation;
+	CheckReturn(CreateStagingBuffer(*mMemoryAllocator, mDevice, inSize, outBuffer, allocation));
+
+	outMappedData = allocation.pMappedData;
+	outOffset = 0;
+
+	DeferDestroy(outBuffer, allocation);
+
+	return true;
+}
\ No newline at end of file
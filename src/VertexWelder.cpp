@@ -0,0 +1,143 @@
+#include "VertexWelder.h"
+
+namespace {
+	const std::uint32_t MinSlotCount = 16;
+
+	// Fewer vertices than this per task are not worth the hand-off.
+	const std::uint32_t MinVerticesPerTask = 64 * 1024;
+
+	struct WeldKey {
+		std::uint64_t Hash;
+		std::uint32_t Index;
+
+		bool operator<(const WeldKey& inOther) const {
+			return Hash < inOther.Hash || (Hash == inOther.Hash && Index < inOther.Index);
+		}
+	};
+
+	std::uint32_t CeilPowerOfTwo(std::uint64_t inValue) {
+		std::uint64_t value = MinSlotCount;
+		while (value < inValue) value <<= 1;
+		return static_cast<std::uint32_t>(value);
+	}
+}
+
+void VertexWelder::Reset(std::uint32_t inExpectedCount) {
+	mCount = 0;
+
+	// At most half full, which keeps probe sequences short.
+	std::uint32_t slotCount = CeilPowerOfTwo(static_cast<std::uint64_t>(inExpectedCount) * 2);
+	mMask = slotCount - 1;
+	mSlots.assign(slotCount, Slot{ 0, NullIndex });
+}
+
+void VertexWelder::Grow() {
+	std::vector<Slot> oldSlots;
+	oldSlots.swap(mSlots);
+
+	std::uint32_t slotCount = CeilPowerOfTwo(static_cast<std::uint64_t>(oldSlots.size()) * 2);
+	mMask = slotCount - 1;
+	mSlots.assign(slotCount, Slot{ 0, NullIndex });
+
+	// The stored hashes are enough to place the entries again.
+	for (const auto& entry : oldSlots) {
+		if (entry.Index == NullIndex) continue;
+
+		std::uint32_t slot = entry.Hash & mMask;
+		while (mSlots[slot].Index != NullIndex) {
+			slot = (slot + 1) & mMask;
+		}
+		mSlots[slot] = entry;
+	}
+}
+
+std::uint32_t WeldVerticesSorted(
+		const void* pVertices,
+		std::uint32_t inCount,
+		std::uint32_t inStride,
+		VertexHashFunc inHash,
+		VertexEqualFunc inEqual,
+		ThreadPool& inThreadPool,
+		std::vector<std::uint32_t>& outRemap) {
+	outRemap.resize(inCount);
+	if (inCount == 0) return 0;
+
+	const std::uint8_t* pBytes = static_cast<const std::uint8_t*>(pVertices);
+
+	const std::uint32_t taskCount = std::max(std::min(inThreadPool.GetThreadCount(), inCount / MinVerticesPerTask), 1u);
+	auto rangeBegin = [&](std::uint32_t inTask) {
+		return static_cast<std::uint32_t>(static_cast<std::uint64_t>(inCount) * inTask / taskCount);
+	};
+
+	// Each task hashes and sorts its own range; the sorted ranges are then merged pairwise.
+	std::vector<WeldKey> keys(inCount);
+	inThreadPool.Run(taskCount, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		std::uint32_t begin = rangeBegin(inTaskIndex);
+		std::uint32_t end = rangeBegin(inTaskIndex + 1);
+		for (std::uint32_t i = begin; i < end; ++i) {
+			keys[i].Hash = inHash(pBytes + static_cast<size_t>(i) * inStride);
+			keys[i].Index = i;
+		}
+		std::sort(keys.begin() + begin, keys.begin() + end);
+	});
+
+	for (std::uint32_t width = 1; width < taskCount; width *= 2) {
+		std::uint32_t pairCount = (taskCount + width * 2 - 1) / (width * 2);
+		inThreadPool.Run(pairCount, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+			std::uint32_t first = inTaskIndex * width * 2;
+			std::uint32_t middle = std::min(first + width, taskCount);
+			std::uint32_t last = std::min(first + width * 2, taskCount);
+			if (middle == last) return;
+
+			std::inplace_merge(keys.begin() + rangeBegin(first), keys.begin() + rangeBegin(middle), keys.begin() + rangeBegin(last));
+		});
+	}
+
+	// Runs of equal hashes are split between the tasks as a whole. Within a run, indices are ascending,
+	// so the first of equal vertices is the one the others map to. outRemap temporarily holds it.
+	std::vector<std::uint32_t> runBegins(taskCount + 1, inCount);
+	runBegins[0] = 0;
+	for (std::uint32_t i = 1; i < taskCount; ++i) {
+		std::uint32_t begin = std::max(rangeBegin(i), runBegins[i - 1]);
+		while (begin < inCount && begin > 0 && keys[begin].Hash == keys[begin - 1].Hash) ++begin;
+		runBegins[i] = begin;
+	}
+
+	inThreadPool.Run(taskCount, [&](std::uint32_t inTaskIndex, std::uint32_t inThreadIndex) {
+		std::vector<std::uint32_t> firsts;
+
+		std::uint32_t end = runBegins[inTaskIndex + 1];
+		for (std::uint32_t runBegin = runBegins[inTaskIndex]; runBegin < end;) {
+			std::uint32_t runEnd = runBegin + 1;
+			while (runEnd < end && keys[runEnd].Hash == keys[runBegin].Hash) ++runEnd;
+
+			// Different vertices sharing a 64-bit hash are vanishingly rare, so this stays tiny.
+			firsts.clear();
+			for (std::uint32_t i = runBegin; i < runEnd; ++i) {
+				std::uint32_t index = keys[i].Index;
+				const std::uint8_t* pVertex = pBytes + static_cast<size_t>(index) * inStride;
+
+				std::uint32_t first = index;
+				for (std::uint32_t candidate : firsts) {
+					if (inEqual(pBytes + static_cast<size_t>(candidate) * inStride, pVertex)) {
+						first = candidate;
+						break;
+					}
+				}
+				if (first == index) firsts.push_back(index);
+
+				outRemap[index] = first;
+			}
+
+			runBegin = runEnd;
+		}
+	});
+
+	// Numbers the unique vertices by first occurrence; a vertex's first copy always comes before it.
+	std::uint32_t uniqueCount = 0;
+	for (std::uint32_t i = 0; i < inCount; ++i) {
+		outRemap[i] = outRemap[i] == i ? uniqueCount++ : outRemap[outRemap[i]];
+	}
+
+	return uniqueCount;
+}
\ No newline at end of file